@@ -0,0 +1,351 @@
+// gcc -O2 -march=native 1_sampling_without_replacement.c ../9_random_numbers/prng.c -o sampling -lm
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "../9_random_numbers/prng.h"
+
+/*
+Sampling without replacement, replacing the retry loops of the arrays chapter:
+  - urand() scans the whole flags array on every call and re-rolls until it hits an
+    unused value: O(n) per call plus O(n log n) rolls in total
+  - kolon_yaz() and the "different random values" example re-roll on repeats
+Here:
+  - Floyd's algorithm: k distinct values of [0, n) with exactly k random numbers
+  - partial Fisher-Yates: the first k slots of a pool become the sample, O(k)
+  - UniqueRand: a shuffled-permutation iterator, O(1) per urand() call
+  - Reservoir: uniform k-sample of a stream of unknown length (Li's Algorithm L)
+*/
+
+#define MAX 100000
+#define COLUMNS 2000000
+#define KOLON_SAYISI 8
+
+// ---- Floyd's algorithm ----
+
+/*
+For j = n - k .. n - 1: pick t in [0, j]; take t unless it was taken, then take j.
+Every k-subset comes out with the same probability, but the order inside out[] is not
+random (large values tend to come last); shuffle out[] if the order matters.
+Membership is kept in a small open-addressing table of 2k..4k slots, so the cost does
+not depend on n; its size is computed in size_t, as 2k overflows 32 bits from k = 2^31.
+Returns 0 if k > n or if the table does not fit in memory.
+*/
+int floyd_sample(Xoshiro256 *g, uint32_t n, uint32_t k, uint32_t *out) {
+    if (k > n)
+        return 0;
+    size_t size = 1;
+    while (size < 2 * (size_t)k)
+        size <<= 1;
+    uint32_t stack_table[256];
+    uint32_t *table = size <= 256 ? stack_table : malloc(size * sizeof(*table));
+    if (!table)
+        return 0;
+    memset(table, 0xFF, size * sizeof(*table)); // UINT32_MAX = empty
+    size_t mask = size - 1;
+
+    for (uint32_t j = n - k, count = 0; j < n; ++j) {
+        uint32_t t = (uint32_t)xoshiro256_bounded(g, (uint64_t)j + 1);
+        size_t h = (t * 0x9E3779B1u) & mask;
+        while (table[h] != UINT32_MAX && table[h] != t)
+            h = (h + 1) & mask;
+        if (table[h] == t) { // t already taken: j cannot be, it was never offered before
+            t = j;
+            h = (t * 0x9E3779B1u) & mask;
+            while (table[h] != UINT32_MAX)
+                h = (h + 1) & mask;
+        }
+        table[h] = t;
+        out[count++] = t;
+    }
+    if (table != stack_table)
+        free(table);
+    return 1;
+}
+
+// For n <= 64 the taken set fits in one register, and the bits come out already sorted.
+uint64_t floyd_sample_mask64(Xoshiro256 *g, uint32_t n, uint32_t k) {
+    uint64_t taken = 0;
+    for (uint32_t j = n - k; j < n; ++j) {
+        uint32_t t = (uint32_t)xoshiro256_bounded(g, (uint64_t)j + 1);
+        uint64_t bit = 1ULL << t;
+        taken |= (taken & bit) ? 1ULL << j : bit;
+    }
+    return taken;
+}
+
+// ---- Partial Fisher-Yates ----
+
+// Moves a uniform random k-subset of pool[0..n) into pool[0..k) in O(k). The pool stays a
+// permutation of its values, so it can be sampled again without being reset.
+void partial_fisher_yates(Xoshiro256 *g, int *pool, uint32_t n, uint32_t k) {
+    for (uint32_t i = 0; i < k; ++i) {
+        uint32_t j = i + (uint32_t)xoshiro256_bounded(g, n - i);
+        int temp = pool[i];
+        pool[i] = pool[j];
+        pool[j] = temp;
+    }
+}
+
+// ---- Permutation iterator: the O(1) urand ----
+
+typedef struct {
+    int *perm;
+    int n;
+    int next; // perm[0..next) has been handed out
+    Xoshiro256 rng;
+} UniqueRand;
+
+int unique_rand_init(UniqueRand *u, int n, uint64_t seed) {
+    u->perm = malloc(n * sizeof(*u->perm));
+    if (!u->perm)
+        return 0;
+    for (int i = 0; i < n; ++i)
+        u->perm[i] = i;
+    u->n = n;
+    u->next = 0;
+    xoshiro256_seed(&u->rng, seed);
+    return 1;
+}
+
+// Same contract as the chapter's urand(): a value of [0, n) not returned before, or -1
+// once all n values have been returned. The shuffle is done lazily, one step per call.
+int unique_rand_next(UniqueRand *u) {
+    if (u->next == u->n)
+        return -1;
+    int j = u->next + (int)xoshiro256_bounded(&u->rng, (uint64_t)(u->n - u->next));
+    int val = u->perm[j];
+    u->perm[j] = u->perm[u->next];
+    u->perm[u->next++] = val;
+    return val;
+}
+
+// Starts a new round; the array is still a permutation, no re-initialization needed.
+void unique_rand_reset(UniqueRand *u) {
+    u->next = 0;
+}
+
+void unique_rand_free(UniqueRand *u) {
+    free(u->perm);
+    u->perm = NULL;
+}
+
+// ---- Reservoir sampling ----
+
+/*
+Algorithm L: after the reservoir is full, the number of items to skip before the next
+replacement is drawn directly from its geometric-like distribution, so only
+O(k (1 + log(N / k))) random numbers are used for a stream of N items.
+*/
+typedef struct {
+    int *items;
+    uint32_t k;
+    uint64_t seen;      // items fed so far
+    uint64_t next_pick; // index of the next item that enters the reservoir
+    double w;
+    Xoshiro256 rng;
+} Reservoir;
+
+static double open_unit(Xoshiro256 *g) { // uniform in (0, 1), safe for log()
+    return ((double)(xoshiro256_next(g) >> 11) + 0.5) * 0x1.0p-53;
+}
+
+static void reservoir_schedule(Reservoir *r) {
+    r->w *= exp(log(open_unit(&r->rng)) / r->k);
+    r->next_pick += (uint64_t)floor(log(open_unit(&r->rng)) / log1p(-r->w)) + 1;
+}
+
+int reservoir_init(Reservoir *r, uint32_t k, uint64_t seed) {
+    r->items = malloc(k * sizeof(*r->items));
+    r->k = k;
+    r->seen = 0;
+    r->w = 1.0;
+    r->next_pick = k - 1;
+    xoshiro256_seed(&r->rng, seed);
+    return r->items != NULL;
+}
+
+void reservoir_feed(Reservoir *r, int item) {
+    uint64_t index = r->seen++;
+    if (index < r->k) {
+        r->items[index] = item;
+        if (index == r->k - 1)
+            reservoir_schedule(r);
+    } else if (index == r->next_pick) {
+        r->items[xoshiro256_bounded(&r->rng, r->k)] = item;
+        reservoir_schedule(r);
+    }
+}
+
+void reservoir_free(Reservoir *r) {
+    free(r->items);
+    r->items = NULL;
+}
+
+// ---- Chapter versions ----
+
+int flags[MAX] = {0};
+
+int urand(void) {
+    int k, val;
+    for (k = 0; k < MAX; ++k)
+        if (flags[k] == 0)
+            break;
+    if (k == MAX)
+        return -1;
+    while (flags[val = rand() % MAX])
+        ;
+    ++flags[val];
+    return val;
+}
+
+uint64_t kolon_yaz_flags(void) { // print_column, returning the column as a bit mask
+    int numaralar[50] = {0}; // numbers
+    int k, no;
+    for (k = 0; k < 6; ++k) {
+        while (numaralar[no = rand() % 49 + 1])
+            ;
+        numaralar[no]++;
+    }
+    uint64_t column = 0;
+    for (k = 1; k < 50; ++k)
+        if (numaralar[k])
+            column |= 1ULL << k;
+    return column;
+}
+
+// Lottery column 1..49: Floyd on [0, 49), shifted up one bit.
+uint64_t kolon_yaz(Xoshiro256 *g) {
+    return floyd_sample_mask64(g, 49, 6) << 1;
+}
+
+void print_column(uint64_t column) {
+    while (column) {
+        printf("%2d ", __builtin_ctzll(column));
+        column &= column - 1;
+    }
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int main(void) {
+    Xoshiro256 g;
+    xoshiro256_seed(&g, (uint64_t)time(0));
+    srand((unsigned)time(0));
+    int errors = 0;
+
+    printf("--- 1. Lottery columns ---\n");
+    for (int k = 0; k < KOLON_SAYISI; ++k) {
+        printf("column %2d : ", k + 1);
+        print_column(kolon_yaz(&g));
+        printf("\n");
+    }
+
+    // Every number 1..49 should appear in 6/49 of the columns.
+    static long hits[50];
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int k = 0; k < COLUMNS; ++k) {
+        uint64_t column = kolon_yaz(&g);
+        if (__builtin_popcountll(column) != 6 || (column & 1) || (column >> 50))
+            errors++;
+        for (; column; column &= column - 1)
+            hits[__builtin_ctzll(column)]++;
+    }
+    double t_floyd = seconds_since(t0);
+    double worst = 0;
+    for (int k = 1; k < 50; ++k) {
+        double ratio = hits[k] / (COLUMNS * 6.0 / 49.0);
+        if (fabs(ratio - 1) > worst)
+            worst = fabs(ratio - 1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    volatile uint64_t sink = 0;
+    for (int k = 0; k < COLUMNS; ++k)
+        sink ^= kolon_yaz_flags();
+    double t_flags = seconds_since(t0);
+    printf("%d columns: Floyd %.1f M/s, chapter flags %.1f M/s, max frequency deviation %.3f%%\n",
+           COLUMNS, COLUMNS / t_floyd / 1e6, COLUMNS / t_flags / 1e6, worst * 100);
+
+    printf("\n--- 2. urand over %d values ---\n", MAX);
+    UniqueRand u;
+    if (!unique_rand_init(&u, MAX, 7)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    static unsigned char seen[MAX];
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int k = 0; k < MAX; ++k) {
+        int val = unique_rand_next(&u);
+        if (val < 0 || seen[val]++)
+            errors++;
+    }
+    double t_iter = seconds_since(t0);
+    if (unique_rand_next(&u) != -1)
+        errors++;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int k = 0; k < MAX; ++k)
+        sink ^= (uint64_t)urand();
+    double t_urand = seconds_since(t0);
+    printf("UniqueRand %.4f s, chapter urand %.4f s, call after exhaustion returns %d\n",
+           t_iter, t_urand, urand());
+    unique_rand_free(&u);
+
+    printf("\n--- 3. 50 distinct values of [0, 100) ---\n");
+    uint32_t distinct[50];
+    errors += !floyd_sample(&g, 100, 50, distinct);
+    memset(seen, 0, 100);
+    for (int k = 0; k < 50; ++k) {
+        printf("%u ", distinct[k]);
+        if (distinct[k] >= 100 || seen[distinct[k]]++)
+            errors++;
+    }
+    printf("\n");
+    static uint32_t many[1000]; // a table of 2048 slots, on the heap
+    static unsigned char seen_many[1000000];
+    errors += !floyd_sample(&g, 1000000, 1000, many);
+    for (int k = 0; k < 1000; ++k)
+        if (many[k] >= 1000000 || seen_many[many[k]]++)
+            errors++;
+    errors += floyd_sample(&g, 999, 1000, many); // more values than there are: refused
+    int pool[100];
+    for (int k = 0; k < 100; ++k)
+        pool[k] = k;
+    partial_fisher_yates(&g, pool, 100, 10);
+    printf("partial Fisher-Yates, 10 of 100: ");
+    for (int k = 0; k < 10; ++k)
+        printf("%d ", pool[k]);
+    printf("\n");
+
+    printf("\n--- 4. Reservoir: 5 of a 10M-item stream ---\n");
+    // Every item should end up in the reservoir with probability k / N.
+    Reservoir r;
+    long in_first_half = 0;
+    const int rounds = 200;
+    for (int round = 0; round < rounds; ++round) {
+        if (!reservoir_init(&r, 5, 1000 + round)) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (int item = 0; item < 10000000; ++item)
+            reservoir_feed(&r, item);
+        for (uint32_t k = 0; k < r.k; ++k)
+            in_first_half += r.items[k] < 5000000;
+        if (round == 0) {
+            for (uint32_t k = 0; k < r.k; ++k)
+                printf("%d ", r.items[k]);
+            printf("\n");
+        }
+        reservoir_free(&r);
+    }
+    printf("share of picks from the first half: %.3f (expected 0.500)\n",
+           (double)in_first_half / (rounds * 5));
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,192 @@
+// gcc -O2 -march=native -pthread 2_sorting_benchmark.c sort.c -o sort_bench
+// ./sort_bench [n (default 10^7, up to 10^9 with enough memory)] [thread_count]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sort.h"
+
+/*
+Benchmarks the sort module against qsort on five input distributions, checks every
+result, and shows why the chapter's O(n^2) sorts are only usable for tiny arrays.
+*/
+
+#define SIZE 10
+#define SMALL_N 20000 // bubble/insertion/selection sort size
+
+typedef enum { RANDOM, SORTED, REVERSED, FEW_UNIQUE, ORGAN_PIPE, DISTRIBUTION_COUNT } Distribution;
+
+static const char *const distribution_names[] = {"random", "sorted", "reversed", "few unique", "organ pipe"};
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+void fill(int *a, size_t n, Distribution d) {
+    for (size_t i = 0; i < n; ++i) {
+        switch (d) {
+            case RANDOM    : a[i] = (int)(uint32_t)xorshift64(); break;
+            case SORTED    : a[i] = (int)i; break;
+            case REVERSED  : a[i] = (int)(n - i); break;
+            case FEW_UNIQUE: a[i] = (int)(xorshift64() % 16); break;
+            case ORGAN_PIPE: a[i] = (int)(i < n / 2 ? i : n - i); break;
+            default        : break;
+        }
+    }
+}
+
+// Order-independent fingerprint, so a sort that loses or duplicates values is caught.
+uint64_t fingerprint(const int *a, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t x = (uint32_t)a[i] * 0x9E3779B97F4A7C15ULL;
+        sum += x ^ (x >> 29);
+    }
+    return sum;
+}
+
+int is_sorted_int(const int *a, size_t n) {
+    for (size_t i = 1; i < n; ++i)
+        if (a[i] < a[i - 1])
+            return 0;
+    return 1;
+}
+
+int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// The chapter's ordering: odd values first, then even values, both ascending.
+int odd_before_even(int a, int b) {
+    int a_odd = a & 1, b_odd = b & 1;
+    return a_odd != b_odd ? a_odd : a < b;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- Chapter versions ----
+
+void bubble_sort(int *a, size_t n) {
+    for (size_t i = 0; i + 1 < n; ++i)
+        for (size_t k = 0; k < n - 1 - i; ++k)
+            if (a[k] > a[k + 1]) {
+                int temp = a[k];
+                a[k] = a[k + 1];
+                a[k + 1] = temp;
+            }
+}
+
+void insertion_sort(int *a, size_t n) {
+    for (size_t i = 1; i < n; ++i) {
+        int temp = a[i];
+        size_t k;
+        for (k = i; k > 0 && a[k - 1] > temp; --k)
+            a[k] = a[k - 1];
+        a[k] = temp;
+    }
+}
+
+void selection_sort(int *a, size_t n) {
+    for (size_t k = 0; k < n; ++k) {
+        int min = a[k];
+        size_t index = k;
+        for (size_t i = k + 1; i < n; ++i)
+            if (a[i] < min) {
+                min = a[i];
+                index = i;
+            }
+        a[index] = a[k];
+        a[k] = min;
+    }
+}
+
+// ---- Benchmark ----
+
+enum { QSORT, INTROSORT, RADIX, PARALLEL_MERGE, METHOD_COUNT };
+static const char *const method_names[] = {"qsort", "sort_int", "radix_sort_i32", "parallel_merge"};
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+    int errors = 0;
+
+    printf("--- 1. Odd before even with a comparator ---\n");
+    int a[SIZE] = {2, 3, 1, 7, 9, 12, 4, 8, 19, 10};
+    sort_int_by(a, SIZE, odd_before_even);
+    for (int k = 0; k < SIZE; ++k)
+        printf("%d ", a[k]);
+    printf("\n");
+
+    printf("\n--- 2. Floating keys with radix sort ---\n");
+    float f[] = {3.5f, -0.0f, -2.25f, 1e30f, -1e30f, 0.0f, 0.5f, -0.5f};
+    float ftmp[8];
+    radix_sort_float(f, ftmp, 8);
+    for (int k = 0; k < 8; ++k)
+        printf("%g ", f[k]);
+    printf("\n");
+
+    printf("\n--- 3. n = %zu, %d threads (seconds) ---\n", n, thread_count);
+    int *data = malloc(n * sizeof(*data));
+    int *work = malloc(n * sizeof(*work));
+    int *tmp = malloc(n * sizeof(*tmp));
+    if (!data || !work || !tmp) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    printf("%-12s", "");
+    for (int m = 0; m < METHOD_COUNT; ++m)
+        printf("%16s", method_names[m]);
+    printf("\n");
+    for (Distribution d = 0; d < DISTRIBUTION_COUNT; ++d) {
+        fill(data, n, d);
+        uint64_t expected = fingerprint(data, n);
+        printf("%-12s", distribution_names[d]);
+        for (int m = 0; m < METHOD_COUNT; ++m) {
+            memcpy(work, data, n * sizeof(*work));
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            switch (m) {
+                case QSORT         : qsort(work, n, sizeof(*work), compare_int); break;
+                case INTROSORT     : sort_int(work, n); break;
+                case RADIX         : radix_sort_i32(work, tmp, n); break;
+                case PARALLEL_MERGE: parallel_merge_sort_int(work, n, thread_count); break;
+            }
+            double t = seconds_since(t0);
+            int ok = is_sorted_int(work, n) && fingerprint(work, n) == expected;
+            errors += !ok;
+            printf("%15.3f%s", t, ok ? " " : "!");
+        }
+        printf("\n");
+    }
+
+    size_t small = n < SMALL_N ? n : SMALL_N;
+    printf("\n--- 4. Chapter sorts, n = %zu random (seconds) ---\n", small);
+    fill(data, small, RANDOM);
+    void (*chapter_sorts[])(int *, size_t) = {bubble_sort, insertion_sort, selection_sort, sort_int};
+    const char *chapter_names[] = {"bubble sort", "insertion sort", "selection sort", "sort_int"};
+    for (int m = 0; m < 4; ++m) {
+        memcpy(work, data, small * sizeof(*work));
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        chapter_sorts[m](work, small);
+        double t = seconds_since(t0);
+        errors += !is_sorted_int(work, small);
+        printf("%-16s %.4f\n", chapter_names[m], t);
+    }
+
+    printf("\nerrors: %d\n", errors);
+    free(data);
+    free(work);
+    free(tmp);
+    return errors != 0;
+}
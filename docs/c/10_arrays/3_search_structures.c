@@ -0,0 +1,381 @@
+// gcc -O2 -march=native 3_search_structures.c -o search
+// ./search [n (sorted keys, default 2^24)] [query_count]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+Search structures for large sorted tables.
+
+The chapter's binary search has an unpredictable branch at every level, and the keys it
+touches are spread over the whole array, so every level below the top few is a cache
+miss. Here:
+  - linear_search_simd: 8 keys per compare, for small unsorted arrays
+  - lower_bound_branchless: the same halving, written so that it compiles to cmov
+  - Eytzinger layout: the sorted keys in BFS order of the implicit search tree
+    (children of k are 2k and 2k + 1), so the next 4 levels of the path share a few
+    cache lines that can be prefetched
+  - S-tree: a static B-tree with 16 keys (one cache line) per node; a node is searched
+    with two SIMD compares, and the tree is only log17(n) levels deep
+  - batch lookups: G searches advance one level at a time in lockstep, so G cache misses
+    are in flight at once instead of one
+
+Every lower_bound returns the smallest key >= the searched key (INT_MAX if there is none),
+so all structures can be checked against each other.
+*/
+
+#define BATCH_GROUP 16
+#define STREE_B 16 // keys per node: 16 * 4 bytes = one cache line
+
+// ---- Linear search ----
+
+// Index of the first element equal to key, or -1.
+long linear_search_simd(const int *a, size_t n, int key) {
+    size_t i = 0;
+#ifdef __AVX2__
+    __m256i k = _mm256_set1_epi32(key);
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, k)));
+        if (mask)
+            return (long)(i + __builtin_ctz(mask));
+    }
+#endif
+    for (; i < n; ++i)
+        if (a[i] == key)
+            return (long)i;
+    return -1;
+}
+
+long linear_search(const int *a, size_t n, int key) {
+    size_t k;
+    for (k = 0; k < n; ++k)
+        if (a[k] == key)
+            break;
+    return k < n ? (long)k : -1;
+}
+
+// ---- Binary search ----
+
+// The chapter's loop, returning the index of key or -1.
+long binary_search(const int *a, size_t n, int key) {
+    long low = 0, high = (long)n - 1;
+    while (low <= high) {
+        long mid = (low + high) / 2;
+        if (a[mid] == key)
+            return mid;
+        if (a[mid] > key)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+    return -1;
+}
+
+// Index of the first element >= key (n if none). The loop count depends only on n.
+size_t lower_bound_branchless(const int *a, size_t n, int key) {
+    if (n == 0)
+        return 0;
+    const int *base = a;
+    while (n > 1) {
+        size_t half = n / 2;
+        base = base[half - 1] < key ? base + half : base; // cmov, not a jump
+        n -= half;
+    }
+    return (size_t)(base - a) + (*base < key);
+}
+
+// ---- Eytzinger layout ----
+
+typedef struct {
+    int *keys; // keys[1..n]; keys[0] = INT_MAX is returned when nothing is >= key
+    size_t n;
+} Eytzinger;
+
+// In-order walk of the implicit tree assigns the sorted keys; done iteratively with an
+// explicit "next node" computation instead of recursion.
+int eytzinger_build(Eytzinger *e, const int *sorted, size_t n) {
+    e->keys = aligned_alloc(64, ((n + 1) * sizeof(int) + 63) / 64 * 64);
+    if (!e->keys)
+        return 0;
+    e->n = n;
+    e->keys[0] = INT_MAX;
+    size_t k = 1;
+    while (2 * k <= n) // leftmost node
+        k *= 2;
+    for (size_t i = 0; i < n; ++i) {
+        e->keys[k] = sorted[i];
+        if (2 * k + 1 <= n) { // successor: leftmost node of the right subtree
+            k = 2 * k + 1;
+            while (2 * k <= n)
+                k *= 2;
+        } else { // successor: climb while we are a right child
+            while (k & 1)
+                k >>= 1;
+            k >>= 1;
+        }
+    }
+    return 1;
+}
+
+/*
+The loop goes left/right by the comparison result only. When it falls off the tree, the
+bits of k are the path taken (0 = left, 1 = right), and the answer is the node where the
+path last went left: strip the trailing 1 bits and one 0 bit. If the path never went
+left, this gives 0, i.e. keys[0] = INT_MAX.
+keys + 16 * k is 4 levels below k (16 ints = one cache line), prefetched in advance.
+*/
+static inline size_t eytzinger_index(const Eytzinger *e, int key) {
+    size_t k = 1;
+    while (k <= e->n) {
+        __builtin_prefetch(e->keys + 16 * k);
+        k = 2 * k + (e->keys[k] < key);
+    }
+    return k >> __builtin_ffsll((long long)~k);
+}
+
+int eytzinger_lower_bound(const Eytzinger *e, int key) {
+    return e->keys[eytzinger_index(e, key)];
+}
+
+void eytzinger_lower_bound_batch(const Eytzinger *e, const int *keys, size_t m, int *out) {
+    int height = 64 - __builtin_clzll(e->n | 1); // levels of the tree
+    size_t i = 0;
+    for (; i + BATCH_GROUP <= m; i += BATCH_GROUP) {
+        size_t k[BATCH_GROUP];
+        for (int j = 0; j < BATCH_GROUP; ++j)
+            k[j] = 1;
+        for (int level = 0; level < height; ++level)
+            for (int j = 0; j < BATCH_GROUP; ++j) {
+                // a lane that already left the tree (shorter path) stays where it is
+                size_t kj = k[j];
+                int inside = kj <= e->n;
+                size_t next = 2 * kj + (e->keys[inside ? kj : 0] < keys[i + j]);
+                k[j] = inside ? next : kj;
+                __builtin_prefetch(e->keys + 16 * k[j]);
+            }
+        for (int j = 0; j < BATCH_GROUP; ++j)
+            out[i + j] = e->keys[k[j] >> __builtin_ffsll((long long)~k[j])];
+    }
+    for (; i < m; ++i)
+        out[i] = eytzinger_lower_bound(e, keys[i]);
+}
+
+// ---- S-tree (static B-tree) ----
+
+typedef struct {
+    int *keys;       // node b holds keys[b * STREE_B .. b * STREE_B + 15], padded with INT_MAX
+    size_t n_blocks;
+} STree;
+
+// Child i (0..16) of node b is b * (STREE_B + 1) + i + 1.
+static inline size_t stree_child(size_t b, int i) {
+    return b * (STREE_B + 1) + (size_t)i + 1;
+}
+
+static void stree_fill(STree *t, const int *sorted, size_t n, size_t b, size_t *next) {
+    if (b >= t->n_blocks)
+        return;
+    for (int i = 0; i < STREE_B; ++i) {
+        stree_fill(t, sorted, n, stree_child(b, i), next);
+        t->keys[b * STREE_B + i] = *next < n ? sorted[*next] : INT_MAX;
+        ++*next;
+    }
+    stree_fill(t, sorted, n, stree_child(b, STREE_B), next);
+}
+
+int stree_build(STree *t, const int *sorted, size_t n) {
+    t->n_blocks = (n + STREE_B - 1) / STREE_B;
+    if (t->n_blocks == 0)
+        t->n_blocks = 1;
+    t->keys = aligned_alloc(64, t->n_blocks * STREE_B * sizeof(int));
+    if (!t->keys)
+        return 0;
+    size_t next = 0;
+    stree_fill(t, sorted, n, 0, &next);
+    return 1;
+}
+
+// Number of node keys < key. The keys of a node are sorted, so this is the child to take.
+static inline int stree_rank_in_node(const int *node, int key) {
+#ifdef __AVX2__
+    __m256i k = _mm256_set1_epi32(key);
+    __m256i lo = _mm256_cmpgt_epi32(k, _mm256_load_si256((const __m256i *)node));
+    __m256i hi = _mm256_cmpgt_epi32(k, _mm256_load_si256((const __m256i *)(node + 8)));
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(lo)) | _mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8;
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (int i = 0; i < STREE_B; ++i)
+        count += node[i] < key;
+    return count;
+#endif
+}
+
+int stree_lower_bound(const STree *t, int key) {
+    int result = INT_MAX;
+    size_t b = 0;
+    while (b < t->n_blocks) {
+        const int *node = t->keys + b * STREE_B;
+        int i = stree_rank_in_node(node, key);
+        if (i < STREE_B)
+            result = node[i];
+        b = stree_child(b, i);
+    }
+    return result;
+}
+
+void stree_lower_bound_batch(const STree *t, const int *keys, size_t m, int *out) {
+    int height = 0;
+    for (size_t b = 0; b < t->n_blocks; b = stree_child(b, 0))
+        height++;
+    size_t i = 0;
+    for (; i + BATCH_GROUP <= m; i += BATCH_GROUP) {
+        size_t b[BATCH_GROUP];
+        int result[BATCH_GROUP];
+        for (int j = 0; j < BATCH_GROUP; ++j) {
+            b[j] = 0;
+            result[j] = INT_MAX;
+        }
+        for (int level = 0; level < height; ++level)
+            for (int j = 0; j < BATCH_GROUP; ++j) {
+                if (b[j] >= t->n_blocks)
+                    continue;
+                const int *node = t->keys + b[j] * STREE_B;
+                int r = stree_rank_in_node(node, keys[i + j]);
+                if (r < STREE_B)
+                    result[j] = node[r];
+                b[j] = stree_child(b[j], r);
+                if (b[j] < t->n_blocks)
+                    __builtin_prefetch(t->keys + b[j] * STREE_B);
+            }
+        memcpy(out + i, result, sizeof(result));
+    }
+    for (; i < m; ++i)
+        out[i] = stree_lower_bound(t, keys[i]);
+}
+
+// ---- Benchmark ----
+
+static uint64_t rng_state = 0x853C49E6748FEA9BULL;
+
+uint32_t next_random(void) {
+    rng_state = rng_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (uint32_t)(rng_state >> 32);
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void report(const char *name, size_t m, struct timespec t0) {
+    double t = seconds_since(t0);
+    printf("  %-32s %7.1f ns/lookup\n", name, t / m * 1e9);
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : (1u << 24);
+    size_t m = argc > 2 ? strtoull(argv[2], NULL, 10) : 4000000;
+    if (n > INT_MAX - 1) // distinct int keys below INT_MAX, the "not found" value
+        n = INT_MAX - 1;
+    int errors = 0;
+
+    printf("--- 1. Linear search, 64-element arrays ---\n");
+    int small[64];
+    for (int i = 0; i < 64; ++i)
+        small[i] = (int)(next_random() % 1000);
+    volatile long sink = 0;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t q = 0; q < m; ++q)
+        sink += linear_search(small, 64, (int)(q % 1000));
+    report("linear_search", m, t0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t q = 0; q < m; ++q)
+        sink += linear_search_simd(small, 64, (int)(q % 1000));
+    report("linear_search_simd", m, t0);
+    for (int q = 0; q < 1000; ++q)
+        errors += linear_search(small, 64, q) != linear_search_simd(small, 64, q);
+
+    printf("\n--- 2. Lower bound on %zu sorted keys, %zu random lookups ---\n", n, m);
+    int *sorted = malloc(n * sizeof(int));
+    int *queries = malloc(m * sizeof(int));
+    int *expected = calloc(m ? m : 1, sizeof(int));
+    int *out = calloc(m ? m : 1, sizeof(int));
+    if (!sorted || !queries || !expected || !out) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    // strictly increasing keys with random gaps, like the chapter's example; the gaps
+    // shrink for large n so that the last key stays below INT_MAX
+    int64_t val = 1;
+    uint32_t max_gap = n < (INT_MAX - 1) / 100 ? 100 : (uint32_t)((INT_MAX - 1) / n);
+    for (size_t i = 0; i < n; ++i) {
+        sorted[i] = (int)val;
+        val += 1 + next_random() % max_gap;
+    }
+    for (size_t q = 0; q < m; ++q)
+        queries[q] = (int)(next_random() % (uint64_t)(val + 1));
+
+    Eytzinger e;
+    STree t;
+    if (!eytzinger_build(&e, sorted, n) || !stree_build(&t, sorted, n)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t q = 0; q < m; ++q)
+        sink += binary_search(sorted, n, queries[q]);
+    report("chapter binary search", m, t0);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t q = 0; q < m; ++q) {
+        size_t i = lower_bound_branchless(sorted, n, queries[q]);
+        expected[q] = i < n ? sorted[i] : INT_MAX;
+    }
+    report("lower_bound_branchless", m, t0);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t q = 0; q < m; ++q)
+        out[q] = eytzinger_lower_bound(&e, queries[q]);
+    report("eytzinger_lower_bound", m, t0);
+    errors += memcmp(out, expected, m * sizeof(int)) != 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    eytzinger_lower_bound_batch(&e, queries, m, out);
+    report("eytzinger_lower_bound_batch", m, t0);
+    errors += memcmp(out, expected, m * sizeof(int)) != 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t q = 0; q < m; ++q)
+        out[q] = stree_lower_bound(&t, queries[q]);
+    report("stree_lower_bound", m, t0);
+    errors += memcmp(out, expected, m * sizeof(int)) != 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    stree_lower_bound_batch(&t, queries, m, out);
+    report("stree_lower_bound_batch", m, t0);
+    errors += memcmp(out, expected, m * sizeof(int)) != 0;
+
+    // binary_search and lower_bound must agree on membership
+    for (size_t q = 0; q < m && q < 100000; ++q)
+        errors += (binary_search(sorted, n, queries[q]) >= 0) != (expected[q] == queries[q]);
+
+    printf("\nerrors: %d\n", errors);
+    free(sorted);
+    free(queries);
+    free(expected);
+    free(out);
+    free(e.keys);
+    free(t.keys);
+    return errors != 0;
+}
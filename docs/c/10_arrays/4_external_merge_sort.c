@@ -0,0 +1,202 @@
+// gcc -O2 -march=native -pthread 4_external_merge_sort.c merge.c sort.c -o extsort
+// ./extsort [count (int64 values in the file)] [memory_mb] [tmp_dir] [thread_count]
+// 100 GB on a 16 GB machine: ./extsort 13421772800 12000 /mnt/scratch
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "merge.h"
+#include "sort.h"
+
+/*
+Merging, from the chapter's two 10-element arrays up to a file larger than memory:
+  1. the chapter's merge next to merge_i64
+  2. two large sorted arrays: branchy loop, branchless loop, merge-path parallel merge
+  3. k-way merge of many sorted runs with a loser tree
+  4. external sort of a generated file, with the time and throughput of each phase
+*/
+
+#define SIZE 10
+#define IO_BLOCK (1 << 20) // values per read/write while generating and checking the file
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+uint64_t mix(int64_t v) { // per-value hash for an order-independent fingerprint
+    uint64_t x = (uint64_t)v * 0x9E3779B97F4A7C15ULL;
+    return x ^ (x >> 29);
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// The chapter's loop, for int64 arrays of any size.
+void merge_chapter(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *c) {
+    size_t index1 = 0, index2 = 0;
+    for (size_t k = 0; k < na + nb; ++k)
+        if (index1 == na)
+            c[k] = b[index2++];
+        else if (index2 == nb)
+            c[k] = a[index1++];
+        else {
+            if (a[index1] < b[index2])
+                c[k] = a[index1++];
+            else
+                c[k] = b[index2++];
+        }
+}
+
+int64_t *sorted_random(size_t n) {
+    int64_t *a = malloc(n * sizeof(*a));
+    if (a) {
+        for (size_t i = 0; i < n; ++i)
+            a[i] = (int64_t)(xorshift64() >> 1);
+        sort_i64(a, n);
+    }
+    return a;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t count = argc > 1 ? strtoull(argv[1], NULL, 10) : 25000000;
+    size_t memory_mb = argc > 2 ? strtoull(argv[2], NULL, 10) : 32;
+    const char *tmp_dir = argc > 3 ? argv[3] : "/tmp";
+    int thread_count = argc > 4 ? atoi(argv[4]) : 4;
+    int errors = 0;
+
+    printf("--- 1. Chapter arrays ---\n");
+    int64_t a[SIZE] = {2, 3, 6, 7, 8, 9, 13, 45, 78, 79};
+    int64_t b[SIZE] = {1, 2, 4, 5, 7, 9, 10, 18, 33, 47};
+    int64_t c[SIZE + SIZE], d[SIZE + SIZE];
+    merge_chapter(a, SIZE, b, SIZE, c);
+    merge_i64(a, SIZE, b, SIZE, d);
+    for (int k = 0; k < SIZE + SIZE; ++k)
+        printf("%lld ", (long long)d[k]);
+    printf("\n");
+    errors += memcmp(c, d, sizeof(c)) != 0;
+
+    size_t n = 20000000;
+    printf("\n--- 2. Two sorted arrays of %zu values (seconds) ---\n", n);
+    int64_t *x = sorted_random(n), *y = sorted_random(n);
+    int64_t *out = malloc(2 * n * sizeof(*out)), *expected = malloc(2 * n * sizeof(*expected));
+    if (!x || !y || !out || !expected) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(out, 0, 2 * n * sizeof(*out)); // touch the pages before timing
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    merge_chapter(x, n, y, n, expected);
+    printf("chapter loop        %.3f\n", seconds_since(t0));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    merge_i64(x, n, y, n, out);
+    printf("merge_i64           %.3f\n", seconds_since(t0));
+    errors += memcmp(out, expected, 2 * n * sizeof(*out)) != 0;
+    memset(out, 0, 2 * n * sizeof(*out));
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    parallel_merge_i64(x, n, y, n, out, thread_count);
+    printf("parallel, %d threads %.3f\n", thread_count, seconds_since(t0));
+    errors += memcmp(out, expected, 2 * n * sizeof(*out)) != 0;
+    // uneven sizes and many equal keys exercise the merge-path split
+    for (size_t i = 0; i < n; ++i)
+        x[i] = (int64_t)(i / 1000);
+    parallel_merge_i64(x, n, y, n / 3, out, thread_count);
+    merge_i64(x, n, y, n / 3, expected);
+    errors += memcmp(out, expected, (n + n / 3) * sizeof(*out)) != 0;
+
+    printf("\n--- 3. k-way merge of 2n values ---\n");
+    for (int k = 2; k <= 256; k *= 4) {
+        // the runs are consecutive slices of `expected` after sorting each slice
+        const int64_t *runs[256];
+        size_t lengths[256];
+        for (size_t i = 0; i < 2 * n; ++i)
+            expected[i] = (int64_t)xorshift64();
+        for (int r = 0; r < k; ++r) {
+            size_t first = 2 * n * r / k, last = 2 * n * (r + 1) / k;
+            sort_i64(expected + first, last - first);
+            runs[r] = expected + first;
+            lengths[r] = last - first;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        errors += !kway_merge_i64(runs, lengths, k, out);
+        double t = seconds_since(t0);
+        for (size_t i = 1; i < 2 * n; ++i)
+            errors += out[i] < out[i - 1];
+        printf("k = %3d: %.3f s, %.0f M values/s\n", k, t, 2 * n / t / 1e6);
+    }
+    free(x);
+    free(y);
+    free(out);
+    free(expected);
+
+    printf("\n--- 4. External sort: %llu values (%.1f GB), %zu MB memory ---\n",
+           (unsigned long long)count, count * 8.0 / 1e9, memory_mb);
+    char input_path[4096], output_path[4096];
+    snprintf(input_path, sizeof(input_path), "%s/extsort_input.bin", tmp_dir);
+    snprintf(output_path, sizeof(output_path), "%s/extsort_output.bin", tmp_dir);
+    int64_t *block = malloc(IO_BLOCK * sizeof(*block));
+    FILE *f = fopen(input_path, "wb");
+    if (!block || !f) {
+        perror(input_path);
+        return 1;
+    }
+    uint64_t input_fingerprint = 0;
+    for (uint64_t done = 0; done < count;) {
+        size_t len = count - done < IO_BLOCK ? (size_t)(count - done) : IO_BLOCK;
+        for (size_t i = 0; i < len; ++i) {
+            block[i] = (int64_t)xorshift64();
+            input_fingerprint += mix(block[i]);
+        }
+        if (fwrite(block, sizeof(*block), len, f) != len) {
+            perror(input_path);
+            return 1;
+        }
+        done += len;
+    }
+    fclose(f);
+
+    ExternalSortStats s;
+    if (!external_sort_i64(input_path, output_path, tmp_dir, memory_mb << 20, &s)) {
+        perror("external_sort_i64");
+        remove(input_path);
+        remove(output_path);
+        return 1;
+    }
+    double gb = s.count * 8.0 / 1e9;
+    printf("runs: %d, merge passes: %d\n", s.run_count, s.merge_passes);
+    printf("phase 1 read   %7.2f s  %7.0f MB/s\n", s.read_seconds, gb * 1e3 / s.read_seconds);
+    printf("phase 1 sort   %7.2f s  %7.0f MB/s\n", s.sort_seconds, gb * 1e3 / s.sort_seconds);
+    printf("phase 1 write  %7.2f s  %7.0f MB/s\n", s.write_seconds, gb * 1e3 / s.write_seconds);
+    printf("phase 2 merge  %7.2f s  %7.0f MB/s per pass\n", s.merge_seconds,
+           gb * 1e3 * s.merge_passes / s.merge_seconds);
+
+    // check the output: sorted, same length, same multiset of values
+    f = fopen(output_path, "rb");
+    uint64_t output_count = 0, output_fingerprint = 0;
+    int64_t prev = INT64_MIN;
+    for (size_t len; f && (len = fread(block, sizeof(*block), IO_BLOCK, f)) > 0;) {
+        for (size_t i = 0; i < len; ++i) {
+            errors += block[i] < prev;
+            prev = block[i];
+            output_fingerprint += mix(block[i]);
+        }
+        output_count += len;
+    }
+    if (f)
+        fclose(f);
+    errors += output_count != count || output_fingerprint != input_fingerprint || s.count != count;
+    remove(input_path);
+    remove(output_path);
+    free(block);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,191 @@
+// gcc -O2 -march=native 5_hash_tables.c hash_table.c sort.c -o hash_tables
+// ./hash_tables [id_count (default 2 * 10^7)] [id_range]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hash_table.h"
+#include "sort.h"
+
+/*
+  1. the chapter's "unique elements" program next to unique_only_int
+  2. the same at n = 50000, where the O(n^2) scan is already slow
+  3. distinct count of many IDs: one insert at a time, batch insert with prefetching,
+     and radix sort + adjacent compare for comparison
+  4. word frequencies with string keys, the general form of the letter counter
+*/
+
+#define SIZE 100
+#define LARGE_SIZE 50000
+#define WORD_COUNT 5000000
+#define VOCABULARY 200000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// The chapter's scan, writing to out instead of printing.
+size_t unique_only_scan(const int *a, size_t n, int *out) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        int counter = 0;
+        for (size_t k = 0; k < n; ++k)
+            if (a[k] == a[i])
+                if (++counter == 2)
+                    break;
+        if (counter == 1)
+            out[count++] = a[i];
+    }
+    return count;
+}
+
+// Word number i as text: a few letters derived from i, always the same for the same i.
+size_t make_word(uint32_t i, char *buf) {
+    size_t len = 3 + i % 7;
+    uint32_t x = i * 2654435761u;
+    for (size_t k = 0; k < len; ++k) {
+        buf[k] = (char)('a' + (x % 26));
+        x = x / 26 + i;
+    }
+    size_t pos = len;
+    do
+        buf[pos++] = (char)('0' + i % 10);
+    while (i /= 10);
+    return pos;
+}
+
+int main(int argc, char *argv[]) {
+    size_t id_count = argc > 1 ? strtoull(argv[1], NULL, 10) : 20000000;
+    uint64_t id_range = argc > 2 ? strtoull(argv[2], NULL, 10) : id_count;
+    int errors = 0;
+
+    printf("--- 1. Unique elements of %d values in [0, 30) ---\n", SIZE);
+    int a[SIZE], expected[SIZE], got[SIZE];
+    for (int k = 0; k < SIZE; ++k)
+        a[k] = (int)(xorshift64() % 30);
+    size_t n_expected = unique_only_scan(a, SIZE, expected);
+    size_t n_got = unique_only_int(a, SIZE, got);
+    for (size_t k = 0; k < n_got; ++k)
+        printf("%d ", got[k]);
+    printf("\n");
+    errors += n_got != n_expected || memcmp(got, expected, n_got * sizeof(int)) != 0;
+
+    printf("\n--- 2. Unique elements of %d values ---\n", LARGE_SIZE);
+    int *large = malloc(LARGE_SIZE * sizeof(int));
+    int *out1 = malloc(LARGE_SIZE * sizeof(int)), *out2 = malloc(LARGE_SIZE * sizeof(int));
+    if (!large || !out1 || !out2) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int k = 0; k < LARGE_SIZE; ++k)
+        large[k] = (int)(xorshift64() % (2 * LARGE_SIZE)) - LARGE_SIZE;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    n_expected = unique_only_scan(large, LARGE_SIZE, out1);
+    double t_scan = seconds_since(t0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    n_got = unique_only_int(large, LARGE_SIZE, out2);
+    double t_table = seconds_since(t0);
+    printf("%zu unique values; chapter scan %.3f s, hash table %.5f s\n", n_got, t_scan, t_table);
+    errors += n_got != n_expected || memcmp(out1, out2, n_got * sizeof(int)) != 0;
+    free(large);
+    free(out1);
+    free(out2);
+
+    printf("\n--- 3. Distinct count of %zu IDs in [0, %llu) ---\n", id_count, (unsigned long long)id_range);
+    uint64_t *ids = malloc(id_count * sizeof(*ids));
+    uint64_t *sorted = malloc(id_count * sizeof(*sorted));
+    uint64_t *tmp = malloc(id_count * sizeof(*tmp));
+    if (!ids || !sorted || !tmp) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < id_count; ++i)
+        ids[i] = id_range ? xorshift64() % id_range : xorshift64();
+
+    IntTable set;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int ok = int_table_init(&set, 1 << 16, 0);
+    size_t one_by_one = 0;
+    for (size_t i = 0; ok && i < id_count; ++i) {
+        int r = int_table_insert(&set, ids[i]);
+        ok = r >= 0;
+        one_by_one += r > 0;
+    }
+    double t_single = seconds_since(t0);
+    int_table_free(&set);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t batch = distinct_count_u64(ids, id_count);
+    double t_batch = seconds_since(t0);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    memcpy(sorted, ids, id_count * sizeof(*ids));
+    radix_sort_u64(sorted, tmp, id_count);
+    size_t by_sorting = id_count > 0;
+    for (size_t i = 1; i < id_count; ++i)
+        by_sorting += sorted[i] != sorted[i - 1];
+    double t_sort = seconds_since(t0);
+    printf("%zu distinct\n", batch);
+    printf("insert one by one    %.3f s  %6.1f M keys/s\n", t_single, id_count / t_single / 1e6);
+    printf("insert batch         %.3f s  %6.1f M keys/s\n", t_batch, id_count / t_batch / 1e6);
+    printf("radix sort + compare %.3f s  %6.1f M keys/s\n", t_sort, id_count / t_sort / 1e6);
+    errors += !ok || one_by_one != batch || batch != by_sorting;
+    free(sorted);
+    free(tmp);
+
+    printf("\n--- 4. Word frequencies: %d words from %d ---\n", WORD_COUNT, VOCABULARY);
+    // skewed choice: small word numbers are much more frequent, like in real text
+    StrTable words;
+    IntTable numbers;
+    if (!str_table_init(&words, 1024) || !int_table_init(&numbers, 1024, 1)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    char buf[32];
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int k = 0; k < WORD_COUNT; ++k) {
+        uint32_t i = (uint32_t)((xorshift64() % VOCABULARY) * (xorshift64() % VOCABULARY) / VOCABULARY);
+        errors += str_table_add(&words, buf, make_word(i, buf)) == NULL;
+        errors += int_table_insert(&numbers, i) < 0;
+    }
+    printf("%zu different words, %.1f M words/s\n", words.size, WORD_COUNT / seconds_since(t0) / 1e6);
+    uint64_t total = 0;
+    const StrEntry *top[5] = {NULL};
+    for (size_t s = 0; s < words.capacity; ++s) {
+        if (!str_table_used(&words, s))
+            continue;
+        const StrEntry *e = &words.entries[s];
+        total += e->count;
+        for (int r = 0; r < 5; ++r)
+            if (!top[r] || e->count > top[r]->count) {
+                memmove(top + r + 1, top + r, (4 - r) * sizeof(*top));
+                top[r] = e;
+                break;
+            }
+    }
+    for (int r = 0; r < 5 && top[r]; ++r)
+        printf("%8llu of %.*s\n", (unsigned long long)top[r]->count, (int)top[r]->len, top[r]->str);
+    errors += total != WORD_COUNT || words.size != numbers.size;
+    // every word must have been counted as often as its number
+    for (uint32_t i = 0; i < 1000; ++i) {
+        const StrEntry *e = str_table_find(&words, buf, make_word(i, buf));
+        errors += (e ? e->count : 0) != int_table_count(&numbers, i);
+    }
+    str_table_free(&words);
+    int_table_free(&numbers);
+    free(ids);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
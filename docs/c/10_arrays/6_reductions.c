@@ -0,0 +1,188 @@
+// gcc -O2 -march=native -pthread 6_reductions.c reduce.c -o reductions
+// ./reductions [n (default 10^8 ints)] [thread_count]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "reduce.h"
+
+/*
+The chapter's statistics loops (sum, minimum, max1/max2, odd and even averages) next to
+the reduction module, checked against each other and measured in GB/s. The reference
+speed is a plain read of the whole array: no reduction over memory can be faster.
+*/
+
+#define SIZE 10
+#define REPEAT 5 // each measurement is the best of REPEAT runs
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- Chapter versions, one loop per statistic (sums widened to avoid overflow) ----
+
+ArrayStats chapter_stats(const int *a, size_t n) {
+    ArrayStats st = {n, 0, {INT_MAX, INT_MIN, SIZE_MAX, SIZE_MAX}, {INT_MIN, INT_MIN}, {0, 0}};
+    for (size_t k = 0; k < n; ++k)
+        st.sum += a[k];
+    if (n) // the chapter starts from a[0]
+        st.minmax = (MinMax){a[0], a[0], 0, 0};
+    for (size_t k = 1; k < n; ++k)
+        if (a[k] < st.minmax.min) {
+            st.minmax.min = a[k];
+            st.minmax.argmin = k;
+        }
+    for (size_t k = 1; k < n; ++k)
+        if (a[k] > st.minmax.max) {
+            st.minmax.max = a[k];
+            st.minmax.argmax = k;
+        }
+    if (n >= 2) {
+        st.top2.max1 = a[0];
+        st.top2.max2 = a[1];
+        if (a[1] > a[0]) {
+            st.top2.max1 = a[1];
+            st.top2.max2 = a[0];
+        }
+    } else if (n == 1)
+        st.top2.max1 = a[0];
+    for (size_t k = 2; k < n; ++k)
+        if (a[k] > st.top2.max1) {
+            st.top2.max2 = st.top2.max1;
+            st.top2.max1 = a[k];
+        } else if (a[k] > st.top2.max2)
+            st.top2.max2 = a[k];
+    for (size_t k = 0; k < n; ++k)
+        if (a[k] % 2) {
+            st.odd.sum += a[k];
+            st.odd.count++;
+        }
+    return st;
+}
+
+int same_stats(const ArrayStats *x, const ArrayStats *y) {
+    return x->n == y->n && x->sum == y->sum && x->minmax.min == y->minmax.min &&
+           x->minmax.max == y->minmax.max && x->minmax.argmin == y->minmax.argmin &&
+           x->minmax.argmax == y->minmax.argmax && x->top2.max1 == y->top2.max1 &&
+           x->top2.max2 == y->top2.max2 && x->odd.sum == y->odd.sum && x->odd.count == y->odd.count;
+}
+
+void print_averages(const ArrayStats *st) {
+    if (st->odd.count)
+        printf("Average of odds = %lf\n", (double)st->odd.sum / st->odd.count);
+    else
+        printf("No odd numbers in the array!\n");
+    if (st->n - st->odd.count)
+        printf("Average of evens = %lf\n", (double)(st->sum - st->odd.sum) / (st->n - st->odd.count));
+    else
+        printf("No even numbers in the array!\n");
+}
+
+// Best-case read speed: four independent XOR chains over the buffer.
+uint64_t read_all(const int *a, size_t n) {
+    const uint64_t *p = (const uint64_t *)a;
+    uint64_t x0 = 0, x1 = 0, x2 = 0, x3 = 0;
+    size_t words = n / 2, i = 0;
+    for (; i + 4 <= words; i += 4) {
+        x0 ^= p[i];
+        x1 ^= p[i + 1];
+        x2 ^= p[i + 2];
+        x3 ^= p[i + 3];
+    }
+    return x0 ^ x1 ^ x2 ^ x3;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000000;
+    int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+    int errors = 0;
+
+    printf("--- 1. Chapter array ---\n");
+    int a[SIZE] = {12, 34, 3, 56, 2, 23, 7, 18, 91, 4};
+    ArrayStats st = array_stats_i32(a, SIZE);
+    printf("sum = %lld, min = a[%zu] = %d, second largest value = %d\n", (long long)st.sum,
+           st.minmax.argmin, st.minmax.min, st.top2.max2);
+    print_averages(&st);
+
+    // every length around the vector width, extreme values and many ties
+    for (size_t len = 0; len < 100; ++len) {
+        int b[100];
+        for (size_t k = 0; k < len; ++k) {
+            uint64_t r = xorshift64();
+            b[k] = r % 7 == 0 ? INT_MIN : r % 7 == 1 ? INT_MAX : (int)(r % 9) - 4;
+        }
+        ArrayStats ref = chapter_stats(b, len), fused = array_stats_i32(b, len);
+        ArrayStats par = array_stats_parallel_i32(b, len, 3);
+        ArrayStats parts = {len, sum_i32(b, len), minmax_i32(b, len), top2_i32(b, len),
+                            masked_sum_i32(b, len, (Predicate){PRED_ODD, 0, 0})};
+        SumCount even = masked_sum_i32(b, len, (Predicate){PRED_EVEN, 0, 0});
+        SumCount range = masked_sum_i32(b, len, (Predicate){PRED_RANGE, -2, 3});
+        SumCount range_ref = {0, 0};
+        for (size_t k = 0; k < len; ++k)
+            if (-2 <= b[k] && b[k] <= 3) {
+                range_ref.sum += b[k];
+                range_ref.count++;
+            }
+        errors += !same_stats(&ref, &fused) || !same_stats(&ref, &par) || !same_stats(&ref, &parts);
+        errors += even.sum != ref.sum - ref.odd.sum || even.count != len - ref.odd.count;
+        errors += range.sum != range_ref.sum || range.count != range_ref.count;
+    }
+
+    printf("\n--- 2. n = %zu ints (%.2f GB), best of %d ---\n", n, n * 4.0 / 1e9, REPEAT);
+    int *data = malloc(n * sizeof(*data));
+    if (!data) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    for (size_t k = 0; k < n; ++k)
+        data[k] = (int)xorshift64();
+
+    enum { READ, CHAPTER, SUM, MINMAX, TOP2, ODD, FUSED, PARALLEL, METHOD_COUNT };
+    static const char *const names[] = {"read only", "chapter loops (5 passes)", "sum_i32", "minmax_i32",
+                                        "top2_i32", "masked_sum_i32 (odd)", "array_stats_i32 (fused)",
+                                        "array_stats_parallel_i32"};
+    ArrayStats ref = chapter_stats(data, n);
+    volatile uint64_t sink = 0;
+    double read_gbs = 0;
+    for (int m = 0; m < METHOD_COUNT; ++m) {
+        double best = 1e30;
+        for (int r = 0; r < REPEAT; ++r) {
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            switch (m) {
+                case READ    : sink ^= read_all(data, n); break;
+                case CHAPTER : st = chapter_stats(data, n); break;
+                case SUM     : errors += sum_i32(data, n) != ref.sum; break;
+                case MINMAX  : errors += minmax_i32(data, n).argmin != ref.minmax.argmin; break;
+                case TOP2    : errors += top2_i32(data, n).max2 != ref.top2.max2; break;
+                case ODD     : errors += masked_sum_i32(data, n, (Predicate){PRED_ODD, 0, 0}).sum != ref.odd.sum; break;
+                case FUSED   : st = array_stats_i32(data, n); errors += !same_stats(&st, &ref); break;
+                case PARALLEL: st = array_stats_parallel_i32(data, n, thread_count); errors += !same_stats(&st, &ref); break;
+            }
+            double t = seconds_since(t0);
+            if (t < best)
+                best = t;
+        }
+        double gbs = n * 4.0 / best / 1e9;
+        if (m == READ)
+            read_gbs = gbs;
+        printf("%-28s %8.4f s %7.2f GB/s  %5.1f%% of read\n", names[m], best, gbs, 100 * gbs / read_gbs);
+    }
+    print_averages(&ref);
+    free(data);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
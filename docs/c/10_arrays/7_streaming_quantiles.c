@@ -0,0 +1,216 @@
+// gcc -O2 -march=native -pthread 7_streaming_quantiles.c sketch.c sort.c ../9_random_numbers/prng.c -o quantiles -lm
+// ./quantiles [samples (default 5 * 10^7)] [thread_count] [compression]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "sketch.h"
+#include "sort.h"
+#include "../9_random_numbers/prng.h"
+
+/*
+  1. second largest and top 3 of the chapter's array
+  2. accuracy: a latency stream is summarized per thread, the sketches are merged, and
+     p50/p90/p99/p99.9/max are compared with the exact values from the sorted samples
+  3. throughput with nothing stored: the memory used does not depend on the sample count;
+     each thread must reach at least a third of the rate of a lone thread, in CPU time so
+     that sharing the cores does not count
+*/
+
+#define SIZE 10
+#define TOP_FEW 10
+#define TOP_MANY 1000
+#define CHECK_SAMPLES 2000000
+#define MAX_THREADS 64
+#define MIN_THREAD_SHARE 3 // each thread at least 1/3 of the rate of a lone thread
+
+typedef struct {
+    _Alignas(64) Xoshiro256 rng; // one cache line per worker, no false sharing
+    size_t count;
+    double *store; // NULL: summarize only
+    TDigest digest;
+    TopK slowest;
+    TopKBuffer slowest_many;
+    double cpu_seconds;
+} Worker;
+
+// Log-normal around 2 ms with 0.5% of requests 20..100 times slower.
+static double latency_ms(Xoshiro256 *g) {
+    double u1 = (xoshiro256_next(g) >> 11) * 0x1.0p-53 + 0x1.0p-54; // (0, 1)
+    double u2 = xoshiro256_double(g);
+    double z = sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+    double x = 2.0 * exp(0.6 * z);
+    if (xoshiro256_bounded(g, 200) == 0)
+        x *= 20 + 80 * xoshiro256_double(g);
+    return x;
+}
+
+static double thread_cpu_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void *worker_run(void *arg) {
+    Worker *w = arg;
+    double start = thread_cpu_seconds();
+    for (size_t i = 0; i < w->count; ++i) {
+        double x = latency_ms(&w->rng);
+        tdigest_add(&w->digest, x);
+        topk_push(&w->slowest, x);
+        topk_buffer_push(&w->slowest_many, x);
+        if (w->store)
+            w->store[i] = x;
+    }
+    w->cpu_seconds = thread_cpu_seconds() - start;
+    return NULL;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Runs thread_count workers over `total` samples and merges everything into workers[0].
+// With store != NULL the samples are also kept, worker after worker.
+int run_stream(Worker *workers, int thread_count, size_t total, double compression, double *store) {
+    pthread_t threads[MAX_THREADS];
+    for (int t = 0; t < thread_count; ++t) {
+        Worker *w = &workers[t];
+        xoshiro256_stream(&w->rng, 2024, (unsigned)t);
+        w->count = total * (t + 1) / thread_count - total * t / thread_count;
+        w->store = store ? store + total * t / thread_count : NULL;
+        if (!tdigest_init(&w->digest, compression) || !topk_init(&w->slowest, TOP_FEW) ||
+            !topk_buffer_init(&w->slowest_many, TOP_MANY))
+            return 0;
+    }
+    for (int t = 1; t < thread_count; ++t)
+        if (pthread_create(&threads[t], NULL, worker_run, &workers[t]) != 0)
+            return 0;
+    worker_run(&workers[0]);
+    for (int t = 1; t < thread_count; ++t) {
+        pthread_join(threads[t], NULL);
+        tdigest_merge(&workers[0].digest, &workers[t].digest);
+        topk_merge(&workers[0].slowest, &workers[t].slowest);
+        topk_buffer_merge(&workers[0].slowest_many, &workers[t].slowest_many);
+        tdigest_free(&workers[t].digest);
+        topk_free(&workers[t].slowest);
+        topk_buffer_free(&workers[t].slowest_many);
+    }
+    return 1;
+}
+
+void free_worker(Worker *w) {
+    tdigest_free(&w->digest);
+    topk_free(&w->slowest);
+    topk_buffer_free(&w->slowest_many);
+}
+
+// Number of sorted values below x.
+size_t rank_of(const double *sorted, size_t n, double x) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sorted[mid] < x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int main(int argc, char *argv[]) {
+    size_t samples = argc > 1 ? strtoull(argv[1], NULL, 10) : 50000000;
+    int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+    double compression = argc > 3 ? atof(argv[3]) : 200;
+    if (thread_count < 1 || thread_count > MAX_THREADS)
+        thread_count = 4;
+    int errors = 0;
+
+    printf("--- 1. Chapter array ---\n");
+    int a[SIZE] = {12, 34, 3, 56, 2, 23, 7, 18, 91, 4};
+    TopK top2;
+    double b[SIZE], sorted2[2];
+    topk_init(&top2, 2);
+    for (int k = 0; k < SIZE; ++k) {
+        topk_push(&top2, a[k]);
+        b[k] = a[k];
+    }
+    topk_sorted(&top2, sorted2);
+    top_k_select(b, SIZE, 3);
+    printf("second largest value = %g, top 3 (any order) = %g %g %g\n", sorted2[1], b[0], b[1], b[2]);
+    errors += sorted2[1] != 56 || b[2] != 34;
+    topk_free(&top2);
+
+    // The rate of a lone thread for section 3, measured first: a register state left dirty
+    // by the seeding would carry over to this thread and to the ones it starts later.
+    static Worker workers[MAX_THREADS];
+    if (!run_stream(workers, 1, CHECK_SAMPLES, compression, NULL)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    double lone_rate = CHECK_SAMPLES / workers[0].cpu_seconds;
+    free_worker(&workers[0]);
+
+    printf("\n--- 2. Accuracy: %d latencies, %d threads, compression %g ---\n", CHECK_SAMPLES,
+           thread_count, compression);
+    double *store = malloc(CHECK_SAMPLES * sizeof(*store));
+    double *tmp = malloc(CHECK_SAMPLES * sizeof(*tmp));
+    double *top = malloc(TOP_MANY * sizeof(*top));
+    if (!store || !tmp || !top || !run_stream(workers, thread_count, CHECK_SAMPLES, compression, store)) {
+        fprintf(stderr, "out of memory or no threads\n");
+        return 1;
+    }
+    radix_sort_double(store, tmp, CHECK_SAMPLES);
+    const double qs[] = {0.5, 0.9, 0.99, 0.999, 1};
+    printf("%8s %12s %12s %12s\n", "q", "estimate", "exact", "rank error");
+    for (int i = 0; i < 5; ++i) {
+        double est = tdigest_quantile(&workers[0].digest, qs[i]);
+        double exact = store[(size_t)(qs[i] * (CHECK_SAMPLES - 1))];
+        double rank_error = (double)rank_of(store, CHECK_SAMPLES, est) / CHECK_SAMPLES - qs[i];
+        printf("%8g %12.4f %12.4f %+12.5f\n", qs[i], est, exact, rank_error);
+        // a centroid near q holds about pi / compression * sqrt(q (1 - q)) of the samples
+        errors += fabs(rank_error) > 2 * M_PI / compression * sqrt(qs[i] * (1 - qs[i])) + 1e-4;
+    }
+    printf("centroids kept: %zu\n", workers[0].digest.count);
+    size_t kept = topk_sorted(&workers[0].slowest, top);
+    for (size_t k = 0; k < kept; ++k)
+        errors += top[k] != store[CHECK_SAMPLES - 1 - k];
+    kept = topk_buffer_sorted(&workers[0].slowest_many, top);
+    for (size_t k = 0; k < kept; ++k)
+        errors += top[k] != store[CHECK_SAMPLES - 1 - k];
+    printf("slowest %d (heap) and %d (buffer + quickselect) match the sorted samples\n", TOP_FEW, TOP_MANY);
+    free_worker(&workers[0]);
+    free(store);
+    free(tmp);
+
+    printf("\n--- 3. Throughput: %zu latencies, nothing stored ---\n", samples);
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (!run_stream(workers, thread_count, samples, compression, NULL)) {
+        fprintf(stderr, "out of memory or no threads\n");
+        return 1;
+    }
+    double t = seconds_since(t0);
+    printf("%.2f s, %.1f M samples/s\n", t, samples / t / 1e6);
+    for (int k = 0; k < thread_count; ++k) {
+        double rate = workers[k].count / workers[k].cpu_seconds;
+        int slow = rate * MIN_THREAD_SHARE < lone_rate;
+        printf("thread %d: %.1f M samples per CPU second (lone thread %.1f)%s\n", k, rate / 1e6,
+               lone_rate / 1e6, slow ? "  MISMATCH" : "");
+        errors += slow;
+    }
+    printf("p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms\n", tdigest_quantile(&workers[0].digest, 0.5),
+           tdigest_quantile(&workers[0].digest, 0.99), tdigest_quantile(&workers[0].digest, 0.999),
+           tdigest_quantile(&workers[0].digest, 1));
+    if (topk_sorted(&workers[0].slowest, top))
+        errors += top[0] != workers[0].digest.max;
+    free_worker(&workers[0]);
+    free(top);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,357 @@
+// gcc -O2 -march=native 8_array_transforms.c transform.c -o transforms
+// ./transforms [n (default 10^8 bytes)]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include "transform.h"
+
+/*
+  1. the chapter's examples: reversing an array and a string, deleting the digit
+     characters and squeezing runs of equal characters
+  2. every kernel against the chapter's loops for all lengths around the vector widths,
+     in place and into a separate array
+  3. speed on n bytes and n / 4 ints, best of REPEAT runs
+*/
+
+#define SIZE 10
+#define CHECK_LENGTH 300
+#define REPEAT 5
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- Chapter versions ----
+
+void chapter_reverse_u8(unsigned char *a, size_t n) {
+    for (size_t k = 0; k < n / 2; ++k) {
+        unsigned char temp = a[k];
+        a[k] = a[n - 1 - k];
+        a[n - 1 - k] = temp;
+    }
+}
+
+void chapter_reverse_i32(int *a, size_t n) {
+    for (size_t k = 0; k < n / 2; ++k) {
+        int temp = a[k];
+        a[k] = a[n - 1 - k];
+        a[n - 1 - k] = temp;
+    }
+}
+
+size_t chapter_delete_digits(unsigned char *dst, const unsigned char *src, size_t n) {
+    size_t index = 0;
+    for (size_t k = 0; k < n; ++k)
+        if (!isdigit(src[k]))
+            dst[index++] = src[k];
+    return index;
+}
+
+size_t chapter_squeeze(unsigned char *dst, const unsigned char *src, size_t n) {
+    if (n == 0)
+        return 0;
+    size_t index = 0;
+    dst[0] = src[0];
+    for (size_t k = 1; k < n; ++k)
+        if (src[k] != dst[index])
+            dst[++index] = src[k];
+    return index + 1;
+}
+
+size_t chapter_squeeze_i32(int *dst, const int *src, size_t n) {
+    if (n == 0)
+        return 0;
+    size_t index = 0;
+    dst[0] = src[0];
+    for (size_t k = 1; k < n; ++k)
+        if (src[k] != dst[index])
+            dst[++index] = src[k];
+    return index + 1;
+}
+
+size_t chapter_keep_range_i32(int *dst, const int *src, size_t n, int lo, int hi) {
+    size_t index = 0;
+    for (size_t k = 0; k < n; ++k)
+        if (lo <= src[k] && src[k] <= hi)
+            dst[index++] = src[k];
+    return index;
+}
+
+void chapter_prefix_sum(int *dst, const int *src, size_t n) {
+    unsigned sum = 0;
+    for (size_t k = 0; k < n; ++k) {
+        sum += (unsigned)src[k];
+        dst[k] = (int)sum;
+    }
+}
+
+// The classic rotation that follows the cycles of i -> i + k (mod n), one element at a time.
+size_t gcd(size_t a, size_t b) {
+    while (b) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+void cycle_rotate_left_i32(int *a, size_t n, size_t k) {
+    if (n == 0 || (k %= n) == 0)
+        return;
+    for (size_t start = 0, cycles = gcd(n, k); start < cycles; ++start) {
+        int temp = a[start];
+        size_t i = start;
+        for (;;) {
+            size_t next = i + k < n ? i + k : i + k - n;
+            if (next == start)
+                break;
+            a[i] = a[next];
+            i = next;
+        }
+        a[i] = temp;
+    }
+}
+
+// ---- Checks ----
+
+// Text-like bytes: letters, some digits, and runs of equal characters.
+void fill_text(unsigned char *s, size_t n) {
+    for (size_t k = 0; k < n; ++k) {
+        uint64_t r = xorshift64();
+        if (k > 0 && r % 4 == 0)
+            s[k] = s[k - 1];
+        else
+            s[k] = (unsigned char)(r % 10 == 1 ? '0' + (r >> 8) % 10 : 'a' + (r >> 8) % 6);
+    }
+}
+
+int check_bytes(size_t len) {
+    unsigned char src[CHECK_LENGTH], a[CHECK_LENGTH], b[CHECK_LENGTH];
+    int errors = 0;
+    fill_text(src, len);
+    memcpy(a, src, len);
+    memcpy(b, src, len);
+    reverse_u8(a, len);
+    chapter_reverse_u8(b, len);
+    errors += memcmp(a, b, len) != 0;
+
+    size_t ref = chapter_delete_digits(b, src, len);
+    memcpy(a, src, len);
+    errors += filter_range_u8(a, a, len, '0', '9', 0) != ref || memcmp(a, b, ref) != 0;
+    errors += filter_range_u8(a, src, len, '0', '9', 0) != ref || memcmp(a, b, ref) != 0;
+    size_t digits = filter_range_u8(a, src, len, '0', '9', 1);
+    errors += digits != len - ref;
+    for (size_t k = 0; k < digits; ++k)
+        errors += !isdigit(a[k]);
+
+    ref = chapter_squeeze(b, src, len);
+    memcpy(a, src, len);
+    errors += squeeze_u8(a, a, len) != ref || memcmp(a, b, ref) != 0;
+    errors += squeeze_u8(a, src, len) != ref || memcmp(a, b, ref) != 0;
+
+    for (size_t k = 0; k <= len + 1; k += 1 + len / 16) {
+        memcpy(a, src, len);
+        rotate_left_u8(a, len, k);
+        for (size_t i = 0; i < len; ++i)
+            errors += a[i] != src[(i + k) % len];
+    }
+    return errors;
+}
+
+int check_ints(size_t len) {
+    int src[CHECK_LENGTH], a[CHECK_LENGTH], b[CHECK_LENGTH] = {0};
+    int errors = 0;
+    for (size_t k = 0; k < len; ++k) {
+        uint64_t r = xorshift64();
+        src[k] = k > 0 && r % 3 == 0 ? src[k - 1] : r % 5 == 0 ? (int)(r >> 32) : (int)(r % 9) - 4;
+    }
+    memcpy(a, src, len * sizeof(*a));
+    memcpy(b, src, len * sizeof(*b));
+    reverse_i32(a, len);
+    chapter_reverse_i32(b, len);
+    errors += memcmp(a, b, len * sizeof(*a)) != 0;
+
+    chapter_prefix_sum(b, src, len);
+    prefix_sum_i32(a, src, len);
+    errors += memcmp(a, b, len * sizeof(*a)) != 0;
+    memcpy(a, src, len * sizeof(*a));
+    int total = exclusive_prefix_sum_i32(a, a, len);
+    for (size_t k = 0; k < len; ++k)
+        errors += a[k] != (k ? b[k - 1] : 0);
+    errors += total != (len ? b[len - 1] : 0);
+
+    size_t ref = chapter_keep_range_i32(b, src, len, -2, 3);
+    memcpy(a, src, len * sizeof(*a));
+    errors += filter_range_i32(a, a, len, -2, 3, 1) != ref || memcmp(a, b, ref * sizeof(*a)) != 0;
+    errors += filter_range_i32(a, src, len, -2, 3, 0) != len - ref;
+
+    ref = chapter_squeeze_i32(b, src, len);
+    memcpy(a, src, len * sizeof(*a));
+    errors += squeeze_i32(a, a, len) != ref || memcmp(a, b, ref * sizeof(*a)) != 0;
+
+    for (size_t k = 0; k <= len + 1; k += 1 + len / 16) {
+        memcpy(a, src, len * sizeof(*a));
+        memcpy(b, src, len * sizeof(*b));
+        rotate_left_i32(a, len, k);
+        cycle_rotate_left_i32(b, len, k);
+        errors += memcmp(a, b, len * sizeof(*a)) != 0;
+    }
+    return errors;
+}
+
+// ---- Timing ----
+
+enum { REVERSE_U8, DELETE_DIGITS, SQUEEZE_U8, REVERSE_I32, ROTATE_I32, PREFIX_SUM, KEEP_RANGE, SQUEEZE_I32, OP_COUNT };
+
+static const char *const op_names[] = {"reverse bytes",   "delete digits", "squeeze bytes",  "reverse ints",
+                                       "rotate ints",     "prefix sum",    "keep range ints", "squeeze ints"};
+
+typedef struct {
+    unsigned char *text, *text_out;
+    int *ints, *ints_out;
+    size_t n, int_count;
+} Data;
+
+// The in-place operations work on a fresh copy of the input, made before the timing starts.
+void prepare(int op, Data *d) {
+    if (op == REVERSE_U8)
+        memcpy(d->text_out, d->text, d->n);
+    else if (op == REVERSE_I32 || op == ROTATE_I32)
+        memcpy(d->ints_out, d->ints, d->int_count * sizeof(int));
+}
+
+// Runs one operation, the chapter's loop (chapter != 0) or the kernel; returns a value
+// that depends on the output, so both can be compared.
+
+size_t run(int op, int chapter, Data *d) {
+    size_t n = d->n, m = d->int_count;
+    switch (op) {
+        case REVERSE_U8:
+            chapter ? chapter_reverse_u8(d->text_out, n) : reverse_u8(d->text_out, n);
+            return n ? d->text_out[0] : 0;
+        case DELETE_DIGITS:
+            return chapter ? chapter_delete_digits(d->text_out, d->text, n)
+                           : filter_range_u8(d->text_out, d->text, n, '0', '9', 0);
+        case SQUEEZE_U8:
+            return chapter ? chapter_squeeze(d->text_out, d->text, n) : squeeze_u8(d->text_out, d->text, n);
+        case REVERSE_I32:
+            chapter ? chapter_reverse_i32(d->ints_out, m) : reverse_i32(d->ints_out, m);
+            return m ? (size_t)d->ints_out[0] : 0;
+        case ROTATE_I32:
+            chapter ? cycle_rotate_left_i32(d->ints_out, m, m / 3 + 1) : rotate_left_i32(d->ints_out, m, m / 3 + 1);
+            return m ? (size_t)d->ints_out[0] : 0;
+        case PREFIX_SUM:
+            chapter ? chapter_prefix_sum(d->ints_out, d->ints, m) : prefix_sum_i32(d->ints_out, d->ints, m);
+            return m ? (size_t)d->ints_out[m - 1] : 0;
+        case KEEP_RANGE:
+            return chapter ? chapter_keep_range_i32(d->ints_out, d->ints, m, -1000000000, 1000000000)
+                           : filter_range_i32(d->ints_out, d->ints, m, -1000000000, 1000000000, 1);
+        default:
+            return chapter ? chapter_squeeze_i32(d->ints_out, d->ints, m) : squeeze_i32(d->ints_out, d->ints, m);
+    }
+}
+
+double best_of(int op, int chapter, Data *d, size_t *result) {
+    double best = 1e30;
+    for (int r = 0; r < REPEAT; ++r) {
+        prepare(op, d);
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        *result = run(op, chapter, d);
+        double t = seconds_since(t0);
+        if (t < best)
+            best = t;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000000;
+    int errors = 0;
+
+    printf("--- 1. Chapter examples ---\n");
+    int a[SIZE] = {2, 3, 1, 7, 9, 12, 4, 8, 19, 10};
+    reverse_i32(a, SIZE);
+    for (int k = 0; k < SIZE; ++k)
+        printf("%d ", a[k]);
+    printf("\n");
+    errors += a[0] != 10 || a[SIZE - 1] != 2;
+
+    char str[] = "2 ships and 12 boats left the harbour at 0630, heeeading north";
+    size_t len = strlen(str);
+    reverse_u8((unsigned char *)str, len);
+    printf("reversed string = (%s)\n", str);
+    reverse_u8((unsigned char *)str, len);
+    len = filter_range_u8((unsigned char *)str, (unsigned char *)str, len, '0', '9', 0);
+    str[len] = '\0';
+    printf("without digits  = (%s)\n", str);
+    len = squeeze_u8((unsigned char *)str, (unsigned char *)str, len);
+    str[len] = '\0';
+    printf("squeezed        = (%s)\n", str);
+    errors += strcmp(str, " ships and boats left the harbour at , heading north") != 0;
+
+    printf("\n--- 2. Checks against the chapter's loops, lengths 0..%d ---\n", CHECK_LENGTH - 1);
+    int check_errors = 0;
+    for (size_t l = 0; l < CHECK_LENGTH; ++l)
+        check_errors += check_bytes(l) + check_ints(l);
+    // rotations too long for the stack buffer take the three-reversal path
+    size_t big = 100003;
+    int *x = malloc(big * sizeof(*x)), *y = malloc(big * sizeof(*y));
+    if (!x || !y) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t k = 1; k < big; k += big / 7) {
+        for (size_t i = 0; i < big; ++i)
+            x[i] = y[i] = (int)i;
+        rotate_left_i32(x, big, k);
+        cycle_rotate_left_i32(y, big, k);
+        check_errors += memcmp(x, y, big * sizeof(*x)) != 0;
+    }
+    free(x);
+    free(y);
+    printf("%s\n", check_errors ? "MISMATCH" : "all kernels match");
+    errors += check_errors;
+
+    printf("\n--- 3. n = %zu bytes (%zu ints), best of %d ---\n", n, n / 4, REPEAT);
+    Data d = {malloc(n + 1), malloc(n + 1), malloc(n / 4 * sizeof(int) + 1), malloc(n / 4 * sizeof(int) + 1), n,
+              n / 4};
+    if (!d.text || !d.text_out || !d.ints || !d.ints_out) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    fill_text(d.text, n);
+    for (size_t k = 0; k < d.int_count; ++k) {
+        uint64_t r = xorshift64();
+        d.ints[k] = k > 0 && r % 4 == 0 ? d.ints[k - 1] : (int)r;
+    }
+    printf("%-16s %12s %12s %9s\n", "", "chapter GB/s", "kernel GB/s", "speedup");
+    for (int op = 0; op < OP_COUNT; ++op) {
+        size_t chapter_result, kernel_result;
+        double chapter = best_of(op, 1, &d, &chapter_result);
+        double kernel = best_of(op, 0, &d, &kernel_result);
+        errors += chapter_result != kernel_result;
+        printf("%-16s %12.2f %12.2f %8.1fx\n", op_names[op], n / chapter / 1e9, n / kernel / 1e9, chapter / kernel);
+    }
+    free(d.text);
+    free(d.text_out);
+    free(d.ints);
+    free(d.ints_out);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
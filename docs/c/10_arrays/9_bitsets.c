@@ -0,0 +1,316 @@
+// gcc -O2 -march=native 9_bitsets.c bitset.c -o bitsets
+// ./bitsets [-n bits]   (bits per set in the benchmark, default 5000000000: three sets of 625 MB)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bitset.h"
+
+/*
+  1. the chapter's flags: the lottery column of kolon_yaz and the drawn values of urand
+     in bit sets, and the bits of 93 from 1_numbering_systems/4_check_LSD.c
+  2. checks against an array of one char per bit: the bulk operations, counts, next set
+     and clear bit from every position, rank of every position and select of every rank,
+     for all sizes around the word, part and block sizes and densities from empty to full,
+     and select on a set whose density changes from 1/8 to 2^-20
+  3. n bits, a dense and a sparse set: bulk operations and counts in GB/s of one set,
+     visiting the members, building the index, and random rank and select queries, also
+     on a set of 1 in 2^20
+*/
+
+#define REPEAT 3
+#define QUERIES 10000000
+#define CHECK_BITS 20000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- Checks ----
+
+// Sets about density / 1024 of the bits, in both forms.
+void random_bits(Bitset *b, unsigned char *flags, size_t n, unsigned density) {
+    bitset_fill(b, 0);
+    for (size_t i = 0; i < n; ++i) {
+        flags[i] = xorshift64() % 1024 < density;
+        if (flags[i])
+            bitset_set(b, i);
+    }
+}
+
+int check_size(size_t n, unsigned density_a, unsigned density_b) {
+    static unsigned char fa[CHECK_BITS], fb[CHECK_BITS];
+    Bitset a, b, d;
+    if (!bitset_init(&a, n) || !bitset_init(&b, n) || !bitset_init(&d, n))
+        return 1;
+    random_bits(&a, fa, n, density_a);
+    random_bits(&b, fb, n, density_b);
+    int errors = 0;
+    size_t count = 0, both = 0;
+    for (size_t i = 0; i < n; ++i) {
+        count += fa[i];
+        both += fa[i] & fb[i];
+    }
+    errors += bitset_count(&a) != count || bitset_and_count(&a, &b) != both;
+    for (int op = 0; op < 4; ++op) {
+        void (*const ops[])(Bitset *, const Bitset *, const Bitset *) = {bitset_and, bitset_or, bitset_xor,
+                                                                          bitset_andnot};
+        ops[op](&d, &a, &b);
+        for (size_t i = 0; i < n; ++i) {
+            int expected = op == 0 ? fa[i] & fb[i] : op == 1 ? fa[i] | fb[i] : op == 2 ? fa[i] ^ fb[i] : fa[i] & !fb[i];
+            errors += bitset_test(&d, i) != expected;
+        }
+        if (n % 64) // the bits past the size stay clear
+            errors += (d.words[d.word_count - 1] >> (n % 64)) != 0;
+    }
+
+    // next set and clear bit, from the end backwards
+    size_t next_set = n, next_clear = n;
+    for (size_t i = n + 1; i-- > 0;) {
+        if (i < n && fa[i])
+            next_set = i;
+        if (i < n && !fa[i])
+            next_clear = i;
+        errors += bitset_next_set(&a, i) != next_set || bitset_next_clear(&a, i) != next_clear;
+    }
+
+    RankSelect r;
+    if (!rank_select_init(&r, &a))
+        return errors + 1;
+    size_t rank = 0;
+    for (size_t i = 0; i <= n; ++i) {
+        errors += bitset_rank(&r, i) != rank;
+        if (i < n && fa[i])
+            errors += bitset_select(&r, rank++) != i;
+    }
+    errors += r.ones != count || bitset_select(&r, count) != n;
+    rank_select_free(&r);
+
+    bitset_fill(&d, 1);
+    errors += bitset_count(&d) != n;
+    bitset_free(&a);
+    bitset_free(&b);
+    bitset_free(&d);
+    return errors;
+}
+
+// Select on 2^24 bits whose density changes every 2^20 bits: stretches without a second
+// level, with subsamples and with spilled positions.
+int check_sparse_select(void) {
+    static const unsigned shifts[] = {3, 8, 12, 20};
+    size_t n = ((size_t)1 << 24) + 12345;
+    Bitset a;
+    if (!bitset_init(&a, n))
+        return 1;
+    for (size_t i = 0; i < n; ++i)
+        if (xorshift64() % (1ULL << shifts[i >> 20 & 3]) == 0)
+            bitset_set(&a, i);
+    RankSelect r;
+    if (!rank_select_init(&r, &a)) {
+        bitset_free(&a);
+        return 1;
+    }
+    int errors = r.stretch_count == 0 || r.spilled_count == 0;
+    size_t rank = 0;
+    for (size_t i = bitset_next_set(&a, 0); i < n; i = bitset_next_set(&a, i + 1), ++rank)
+        errors += bitset_select(&r, rank) != i || bitset_rank(&r, i) != rank;
+    errors += rank != r.ones || bitset_select(&r, rank) != n;
+    rank_select_free(&r);
+    bitset_free(&a);
+    return errors;
+}
+
+int check_all(void) {
+    static const unsigned densities[] = {0, 1, 30, 512, 1000, 1024};
+    int errors = 0;
+    for (size_t n = 0; n <= 200; ++n)
+        errors += check_size(n, densities[n % 6], densities[(n / 6) % 6]);
+    static const size_t sizes[] = {511, 512, 513, 2047, 2048, 2049, 4096, 8191, 10000, CHECK_BITS};
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(*sizes); ++k)
+        for (size_t d = 0; d < 6; ++d)
+            errors += check_size(sizes[k], densities[d], densities[(d + k) % 6]);
+    return errors + check_sparse_select();
+}
+
+// ---- Benchmark ----
+
+// Words with each bit set with probability 2^-(and_of), independently.
+void fill_random(Bitset *b, int and_of) {
+    for (size_t i = 0; i < b->word_count; ++i) {
+        uint64_t w = ~0ULL;
+        for (int k = 0; k < and_of; ++k)
+            w &= xorshift64();
+        b->words[i] = w;
+    }
+    if (b->bits % 64)
+        b->words[b->word_count - 1] &= ~0ULL >> (64 - b->bits % 64);
+}
+
+typedef enum { AND, OR, XOR, ANDNOT, COUNT, AND_COUNT, OP_COUNT } BenchOp;
+
+// Random rank and select queries; the answers are checked against each other.
+int bench_queries(const char *name, const Bitset *b) {
+    RankSelect r;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (!rank_select_init(&r, b)) {
+        fprintf(stderr, "out of memory for the index\n");
+        return 1;
+    }
+    double build = seconds_since(t0);
+    int errors = 0;
+    volatile size_t sink = 0;
+    double rank_time = 1e30, select_time = 1e30;
+    for (int rep = 0; rep < REPEAT; ++rep) {
+        size_t sum = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int q = 0; q < QUERIES; ++q)
+            sum += bitset_rank(&r, xorshift64() % (b->bits + 1));
+        double t = seconds_since(t0);
+        if (t < rank_time)
+            rank_time = t;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (int q = 0; q < QUERIES && r.ones; ++q)
+            sum += bitset_select(&r, xorshift64() % r.ones);
+        t = seconds_since(t0);
+        if (t < select_time)
+            select_time = t;
+        sink = sum;
+    }
+    (void)sink;
+    for (int q = 0; q < 100000 && r.ones; ++q) {
+        size_t k = xorshift64() % r.ones, i = bitset_select(&r, k);
+        errors += i >= b->bits || !bitset_test(b, i) || bitset_rank(&r, i) != k;
+    }
+    printf("%-8s %12zu ones  index %6.3f s, %5.2f%% of the bits   rank %5.1f ns   select %5.1f ns\n", name, r.ones,
+           build, 100.0 * rank_select_memory(&r) * 8 / (double)(b->bits ? b->bits : 1), rank_time / QUERIES * 1e9,
+           select_time / QUERIES * 1e9);
+    rank_select_free(&r);
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 5000000000ULL;
+    for (int k = 1; k < argc; ++k) {
+        if (k + 1 < argc && strcmp(argv[k], "-n") == 0) {
+            n = strtoull(argv[++k], NULL, 10);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[k]);
+            return 1;
+        }
+    }
+
+    int errors = 0;
+    printf("--- 1. Flags as bits ---\n");
+    Bitset column;
+    if (!bitset_init(&column, 50))
+        return 1;
+    for (int k = 0, no; k < 6; ++k) { // kolon_yaz: 6 different numbers of 1..49
+        while (bitset_test(&column, no = rand() % 49 + 1))
+            ;
+        bitset_set(&column, (size_t)no);
+    }
+    printf("column:");
+    for (size_t i = bitset_next_set(&column, 0); i < column.bits; i = bitset_next_set(&column, i + 1))
+        printf(" %zu", i);
+    printf("   (%zu numbers in %zu bytes; int numaralar[50] takes %zu)\n", bitset_count(&column),
+           column.word_count * sizeof(uint64_t), 50 * sizeof(int));
+    errors += bitset_count(&column) != 6 || bitset_test(&column, 0);
+    bitset_free(&column);
+
+    enum { MAX = 100000 };
+    Bitset drawn;
+    if (!bitset_init(&drawn, MAX))
+        return 1;
+    for (int k = 0; k < MAX - 10; ++k) { // urand until 10 values are left
+        size_t val;
+        while (bitset_test(&drawn, val = (size_t)rand() % MAX))
+            ;
+        bitset_set(&drawn, val);
+    }
+    printf("urand: %zu drawn, first left %zu, flags[MAX] %zu bytes, bit set %zu\n", bitset_count(&drawn),
+           bitset_next_clear(&drawn, 0), MAX * sizeof(int), drawn.word_count * sizeof(uint64_t));
+    errors += bitset_count(&drawn) != MAX - 10 || bitset_next_clear(&drawn, 0) == MAX;
+    bitset_free(&drawn);
+
+    Bitset x;
+    if (!bitset_init(&x, 8))
+        return 1;
+    x.words[0] = 0x5D; // 93, 0b01011101
+    printf("93: MSD %d, LSD %d, %zu bits set\n", bitset_test(&x, 7), bitset_test(&x, 0), bitset_count(&x));
+    errors += bitset_test(&x, 7) != 0 || bitset_test(&x, 0) != 1 || bitset_count(&x) != 5;
+    bitset_free(&x);
+
+    printf("\n--- 2. Checks against a char per bit ---\n");
+    int check_errors = check_all();
+    printf("%s\n", check_errors ? "MISMATCH" : "operations, counts, next, rank and select match");
+    errors += check_errors;
+
+    printf("\n--- 3. %zu bits (int flags would take %.1f GB per set), best of %d ---\n", n, n * 4.0 / 1e9, REPEAT);
+    Bitset a, b, d;
+    if (!bitset_init(&a, n) || !bitset_init(&b, n) || !bitset_init(&d, n)) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    fill_random(&a, 1); // 50%
+    fill_random(&b, 2); // 25%
+    static const char *const names[] = {"and", "or", "xor", "andnot", "count", "and_count"};
+    double bytes = (double)a.word_count * sizeof(uint64_t);
+    size_t counts[2] = {0, 0};
+    for (int op = 0; op < OP_COUNT; ++op) {
+        double best = 1e30;
+        for (int rep = 0; rep < REPEAT; ++rep) {
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            switch (op) {
+                case AND      : bitset_and(&d, &a, &b); break;
+                case OR       : bitset_or(&d, &a, &b); break;
+                case XOR      : bitset_xor(&d, &a, &b); break;
+                case ANDNOT   : bitset_andnot(&d, &a, &b); break;
+                case COUNT    : counts[0] = bitset_count(&a); break;
+                case AND_COUNT: counts[1] = bitset_and_count(&a, &b); break;
+            }
+            double t = seconds_since(t0);
+            if (t < best)
+                best = t;
+        }
+        printf("%-10s %8.2f GB/s\n", names[op], bytes / best / 1e9);
+    }
+    // d is a & ~b now; with a & b it splits a
+    errors += bitset_count(&d) + counts[1] != counts[0];
+
+    fill_random(&d, 6); // 1/64
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t members = 0;
+    for (size_t i = bitset_next_set(&d, 0); i < d.bits; i = bitset_next_set(&d, i + 1))
+        ++members;
+    double t = seconds_since(t0);
+    printf("next_set over the members of a 1/64 set: %.2f ns each\n", t / (double)(members ? members : 1) * 1e9);
+    errors += members != bitset_count(&d);
+
+    errors += bench_queries("50%", &a);
+    errors += bench_queries("1/64", &d);
+    bitset_fill(&d, 0);
+    for (size_t i = 0; i < n >> 20; ++i)
+        bitset_set(&d, xorshift64() % n);
+    errors += bench_queries("2^-20", &d);
+
+    bitset_free(&a);
+    bitset_free(&b);
+    bitset_free(&d);
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
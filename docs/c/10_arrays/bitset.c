@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "bitset.h"
+
+/*
+Bit sets (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 9_bitsets.c bitset.c -o bitsets
+*/
+
+#define BLOCK_BITS 2048
+#define BLOCK_WORDS (BLOCK_BITS / 64)
+#define BLOCKS_PER_UPPER (1ULL << (32 - 11)) // 2^32 bits of an upper entry / 2048
+#define SUBSAMPLES_PER_SAMPLE (RANK_SELECT_SAMPLE / SELECT_SUBSAMPLE)
+#define WIDE 0x80000000u // in samples: a stretch with a second level; in subsamples: spilled
+
+// ---- Vectors of words ----
+
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+#define VEC_WORDS 8
+typedef __m512i Vec;
+#define LOAD(p) _mm512_loadu_si512((const void *)(p))
+#define STORE(p, v) _mm512_storeu_si512((void *)(p), v)
+#define AND(a, b) _mm512_and_si512(a, b)
+#define OR(a, b) _mm512_or_si512(a, b)
+#define XOR(a, b) _mm512_xor_si512(a, b)
+#define ANDNOT(a, b) _mm512_andnot_si512(b, a) // a & ~b
+#define ZERO() _mm512_setzero_si512()
+
+static inline Vec popcount_add(Vec acc, Vec v) { return _mm512_add_epi64(acc, _mm512_popcnt_epi64(v)); }
+static inline size_t sum_lanes(Vec acc) { return (size_t)_mm512_reduce_add_epi64(acc); }
+#elif defined(__AVX2__)
+#define VEC_WORDS 4
+typedef __m256i Vec;
+#define LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define AND(a, b) _mm256_and_si256(a, b)
+#define OR(a, b) _mm256_or_si256(a, b)
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ANDNOT(a, b) _mm256_andnot_si256(b, a)
+#define ZERO() _mm256_setzero_si256()
+
+// The bits of each nibble from a 16-entry table, the bytes summed per 64-bit lane.
+static inline Vec popcount_add(Vec acc, Vec v) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+                                _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+    return _mm256_add_epi64(acc, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+}
+
+static inline size_t sum_lanes(Vec acc) {
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    return (size_t)(_mm_cvtsi128_si64(s) + _mm_extract_epi64(s, 1));
+}
+#endif
+
+static inline unsigned popcount64(uint64_t w) { return (unsigned)__builtin_popcountll(w); }
+
+// The position of set bit number r (from 0) of w, which has more than r.
+static inline unsigned select64(uint64_t w, unsigned r) {
+#ifdef __BMI2__
+    return (unsigned)__builtin_ctzll(_pdep_u64(1ULL << r, w));
+#else
+    unsigned at = 0;
+    for (unsigned c; r >= (c = popcount64(w & 0xFF)); w >>= 8, at += 8)
+        r -= c;
+    for (; r; --r)
+        w &= w - 1;
+    return at + (unsigned)__builtin_ctzll(w);
+#endif
+}
+
+// ---- Sets ----
+
+int bitset_init(Bitset *b, size_t bits) {
+    b->bits = bits;
+    b->word_count = (bits + 63) / 64;
+    b->words = calloc(b->word_count ? b->word_count : 1, sizeof(*b->words));
+    return b->words != NULL;
+}
+
+void bitset_free(Bitset *b) {
+    free(b->words);
+    memset(b, 0, sizeof(*b));
+}
+
+void bitset_fill(Bitset *b, int value) {
+    memset(b->words, value ? 0xFF : 0, b->word_count * sizeof(*b->words));
+    if (value && b->bits % 64)
+        b->words[b->word_count - 1] = ~0ULL >> (64 - b->bits % 64);
+}
+
+typedef enum { OP_AND, OP_OR, OP_XOR, OP_ANDNOT } Op;
+
+static inline __attribute__((always_inline)) void combine(uint64_t *d, const uint64_t *x, const uint64_t *y,
+                                                          size_t n, Op op) {
+    size_t i = 0;
+#ifdef VEC_WORDS
+    for (; i + VEC_WORDS <= n; i += VEC_WORDS) {
+        Vec u = LOAD(x + i), v = LOAD(y + i);
+        STORE(d + i, op == OP_AND ? AND(u, v) : op == OP_OR ? OR(u, v) : op == OP_XOR ? XOR(u, v) : ANDNOT(u, v));
+    }
+#endif
+    for (; i < n; ++i)
+        d[i] = op == OP_AND ? x[i] & y[i] : op == OP_OR ? x[i] | y[i] : op == OP_XOR ? x[i] ^ y[i] : x[i] & ~y[i];
+}
+
+void bitset_and(Bitset *dst, const Bitset *a, const Bitset *b) {
+    combine(dst->words, a->words, b->words, dst->word_count, OP_AND);
+}
+
+void bitset_or(Bitset *dst, const Bitset *a, const Bitset *b) {
+    combine(dst->words, a->words, b->words, dst->word_count, OP_OR);
+}
+
+void bitset_xor(Bitset *dst, const Bitset *a, const Bitset *b) {
+    combine(dst->words, a->words, b->words, dst->word_count, OP_XOR);
+}
+
+void bitset_andnot(Bitset *dst, const Bitset *a, const Bitset *b) {
+    combine(dst->words, a->words, b->words, dst->word_count, OP_ANDNOT);
+}
+
+// The set bits of x[0..n), or of x & y if y is not NULL.
+static inline __attribute__((always_inline)) size_t count_words(const uint64_t *x, const uint64_t *y, size_t n) {
+    size_t i = 0, total = 0;
+#ifdef VEC_WORDS
+    Vec acc = ZERO();
+    for (; i + VEC_WORDS <= n; i += VEC_WORDS)
+        acc = popcount_add(acc, y ? AND(LOAD(x + i), LOAD(y + i)) : LOAD(x + i));
+    total = sum_lanes(acc);
+#endif
+    for (; i < n; ++i)
+        total += popcount64(y ? x[i] & y[i] : x[i]);
+    return total;
+}
+
+size_t bitset_count(const Bitset *b) {
+    return count_words(b->words, NULL, b->word_count);
+}
+
+size_t bitset_and_count(const Bitset *a, const Bitset *b) {
+    return count_words(a->words, b->words, a->word_count);
+}
+
+size_t bitset_next_set(const Bitset *b, size_t from) {
+    if (from >= b->bits)
+        return b->bits;
+    size_t i = from / 64;
+    uint64_t w = b->words[i] & (~0ULL << (from % 64));
+    while (!w) {
+        if (++i == b->word_count)
+            return b->bits;
+        w = b->words[i];
+    }
+    return i * 64 + (size_t)__builtin_ctzll(w);
+}
+
+// The bits past the size are clear too, so the result is capped at the size.
+size_t bitset_next_clear(const Bitset *b, size_t from) {
+    if (from >= b->bits)
+        return b->bits;
+    size_t i = from / 64;
+    uint64_t w = ~b->words[i] & (~0ULL << (from % 64));
+    while (!w) {
+        if (++i == b->word_count)
+            return b->bits;
+        w = ~b->words[i];
+    }
+    size_t at = i * 64 + (size_t)__builtin_ctzll(w);
+    return at < b->bits ? at : b->bits;
+}
+
+// ---- Rank and select ----
+
+void rank_select_free(RankSelect *r) {
+    free(r->upper);
+    free(r->blocks);
+    free(r->samples);
+    free(r->stretches);
+    free(r->subsamples);
+    free(r->spilled);
+    memset(r, 0, sizeof(*r));
+}
+
+static inline uint64_t ones_before_block(const RankSelect *r, size_t j) {
+    return r->upper[j / BLOCKS_PER_UPPER] + (uint32_t)r->blocks[j];
+}
+
+static inline size_t sample_block(const RankSelect *r, size_t s) {
+    uint32_t sample = r->samples[s];
+    return sample & WIDE ? r->stretches[sample & ~WIDE].block : sample;
+}
+
+// The last block that the search from sample s may have to reach.
+static inline size_t stretch_end(const RankSelect *r, size_t s) {
+    return s + 1 < r->sample_count ? sample_block(r, s + 1) : r->block_count - 1;
+}
+
+// The position of one number k, searched a word at a time from words[*w], which has
+// *rank ones before it; *w and *rank are left at the word of the one.
+static uint64_t scan_select(const uint64_t *words, size_t *w, uint64_t *rank, uint64_t k) {
+    for (unsigned c; *rank + (c = popcount64(words[*w])) <= k; ++*w)
+        *rank += c;
+    return (uint64_t)*w * 64 + select64(words[*w], (unsigned)(k - *rank));
+}
+
+/*
+The second level of select, for a stretch (the ones from one sample to the next) whose
+blocks span SELECT_SPAN or more: an entry for every SELECT_SUBSAMPLE ones, the offset of
+the block of the first one from the block of the sample, or, if the ones spread over more
+than SELECT_SPAN blocks, where their positions start in spilled. Only the first and the
+last one of each subsample are looked up, except for the spilled ones.
+*/
+static int select_init(RankSelect *r) {
+    size_t wide = 0;
+    for (size_t s = 0; s < r->sample_count; ++s)
+        wide += stretch_end(r, s) - r->samples[s] >= SELECT_SPAN;
+    r->stretches = malloc((wide ? wide : 1) * sizeof(*r->stretches));
+    r->subsamples = malloc((wide ? wide * SUBSAMPLES_PER_SAMPLE : 1) * sizeof(*r->subsamples));
+    if (!r->stretches || !r->subsamples)
+        return 0;
+    const uint64_t *words = r->set->words;
+    size_t spilled_capacity = 0;
+    for (size_t s = 0; s < r->sample_count; ++s) {
+        size_t block = r->samples[s];
+        if (stretch_end(r, s) - block < SELECT_SPAN)
+            continue;
+        SelectStretch *st = &r->stretches[r->stretch_count];
+        st->block = block;
+        st->spilled = r->spilled_count;
+        r->samples[s] = WIDE | (uint32_t)r->stretch_count;
+        uint32_t *entry = &r->subsamples[r->stretch_count++ * SUBSAMPLES_PER_SAMPLE];
+        uint64_t end = (uint64_t)(s + 1) * RANK_SELECT_SAMPLE < r->ones ? (uint64_t)(s + 1) * RANK_SELECT_SAMPLE
+                                                                        : r->ones;
+        size_t w = block * BLOCK_WORDS;
+        uint64_t rank = ones_before_block(r, block);
+        for (uint64_t k = (uint64_t)s * RANK_SELECT_SAMPLE; k < end; k += SELECT_SUBSAMPLE, ++entry) {
+            uint64_t last = k + SELECT_SUBSAMPLE < end ? k + SELECT_SUBSAMPLE - 1 : end - 1;
+            uint64_t first_position = scan_select(words, &w, &rank, k);
+            size_t from_w = w;
+            uint64_t from_rank = rank;
+            size_t first = first_position / BLOCK_BITS, offset = first - block;
+            if (scan_select(words, &w, &rank, last) / BLOCK_BITS - first < SELECT_SPAN && offset < WIDE) {
+                *entry = (uint32_t)offset;
+                continue;
+            }
+            if (r->spilled_count + SELECT_SUBSAMPLE > spilled_capacity) {
+                size_t capacity = spilled_capacity ? spilled_capacity * 2 : 1024;
+                uint64_t *bigger = realloc(r->spilled, capacity * sizeof(*bigger));
+                if (!bigger)
+                    return 0;
+                r->spilled = bigger;
+                spilled_capacity = capacity;
+            }
+            *entry = WIDE | (uint32_t)(r->spilled_count - st->spilled);
+            for (uint64_t j = k; j <= last; ++j)
+                r->spilled[r->spilled_count++] = scan_select(words, &from_w, &from_rank, j);
+        }
+    }
+    return 1;
+}
+
+/*
+There is one block more than the bits fill, so that rank(bits) and the search in select
+always find an entry; likewise one upper entry more.
+*/
+int rank_select_init(RankSelect *r, const Bitset *b) {
+    memset(r, 0, sizeof(*r));
+    r->set = b;
+    r->ones = bitset_count(b);
+    r->block_count = b->bits / BLOCK_BITS + 1;
+    r->sample_count = (r->ones + RANK_SELECT_SAMPLE - 1) / RANK_SELECT_SAMPLE;
+    r->upper = malloc(((b->bits >> 32) + 1) * sizeof(*r->upper));
+    r->blocks = malloc(r->block_count * sizeof(*r->blocks));
+    r->samples = malloc((r->sample_count ? r->sample_count : 1) * sizeof(*r->samples));
+    if (!r->upper || !r->blocks || !r->samples) {
+        rank_select_free(r);
+        return 0;
+    }
+    uint64_t total = 0;
+    size_t sample = 0;
+    for (size_t j = 0; j < r->block_count; ++j) {
+        if (j % BLOCKS_PER_UPPER == 0)
+            r->upper[j / BLOCKS_PER_UPPER] = total;
+        uint64_t part[4] = {0, 0, 0, 0};
+        for (size_t w = j * BLOCK_WORDS; w < (j + 1) * BLOCK_WORDS && w < b->word_count; ++w)
+            part[w % BLOCK_WORDS / 8] += popcount64(b->words[w]);
+        r->blocks[j] = (total - r->upper[j / BLOCKS_PER_UPPER]) | part[0] << 32 | part[1] << 42 | part[2] << 52;
+        total += part[0] + part[1] + part[2] + part[3];
+        for (; sample < r->sample_count && (uint64_t)sample * RANK_SELECT_SAMPLE < total; ++sample)
+            r->samples[sample] = (uint32_t)j;
+    }
+    if (!select_init(r)) {
+        rank_select_free(r);
+        return 0;
+    }
+    return 1;
+}
+
+size_t rank_select_memory(const RankSelect *r) {
+    return ((r->set->bits >> 32) + 1) * sizeof(*r->upper) + r->block_count * sizeof(*r->blocks) +
+           r->sample_count * sizeof(*r->samples) +
+           r->stretch_count * (sizeof(*r->stretches) + SUBSAMPLES_PER_SAMPLE * sizeof(*r->subsamples)) +
+           r->spilled_count * sizeof(*r->spilled);
+}
+
+size_t bitset_rank(const RankSelect *r, size_t i) {
+    size_t j = i / BLOCK_BITS, part = i / 512 % 4;
+    uint64_t entry = r->blocks[j];
+    size_t rank = (size_t)(r->upper[j / BLOCKS_PER_UPPER] + (uint32_t)entry);
+    rank += (part > 0 ? (entry >> 32 & 1023) : 0) + (part > 1 ? (entry >> 42 & 1023) : 0) +
+            (part > 2 ? (entry >> 52 & 1023) : 0);
+    const uint64_t *words = r->set->words;
+    for (size_t w = i / 512 * 8; w < i / 64; ++w)
+        rank += popcount64(words[w]);
+    if (i % 64)
+        rank += popcount64(words[i / 64] & ~(~0ULL << (i % 64)));
+    return rank;
+}
+
+size_t bitset_select(const RankSelect *r, size_t k) {
+    if (k >= r->ones)
+        return r->set->bits;
+    // the last block with at most k ones before it, at most SELECT_SPAN blocks from the
+    // sample or subsample
+    size_t s = k / RANK_SELECT_SAMPLE, lo, hi;
+    uint32_t sample = r->samples[s];
+    if (sample & WIDE) {
+        size_t j = sample & ~WIDE;
+        const SelectStretch *st = &r->stretches[j];
+        uint32_t entry = r->subsamples[j * SUBSAMPLES_PER_SAMPLE + k % RANK_SELECT_SAMPLE / SELECT_SUBSAMPLE];
+        if (entry & WIDE)
+            return (size_t)r->spilled[st->spilled + (entry & ~WIDE) + k % SELECT_SUBSAMPLE];
+        lo = st->block + entry;
+        hi = lo + SELECT_SPAN - 1 < r->block_count ? lo + SELECT_SPAN - 1 : r->block_count - 1;
+    } else {
+        lo = sample;
+        hi = stretch_end(r, s);
+    }
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo + 1) / 2;
+        if (ones_before_block(r, mid) <= k)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    uint64_t entry = r->blocks[lo], left = k - ones_before_block(r, lo);
+    size_t w = lo * BLOCK_WORDS;
+    for (int part = 0; part < 3; ++part, w += 8) {
+        uint64_t c = entry >> (32 + 10 * part) & 1023;
+        if (left < c)
+            break;
+        left -= c;
+    }
+    const uint64_t *words = r->set->words;
+    for (unsigned c; left >= (c = popcount64(words[w])); ++w)
+        left -= c;
+    return w * 64 + select64(words[w], (unsigned)left);
+}
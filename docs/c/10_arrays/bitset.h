@@ -0,0 +1,93 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Bit sets (interface). The arrays chapter marks the values already drawn in int flags[MAX]
+and int numaralar[50]: 32 bits for every yes or no, so a set over the 4 billion 32-bit
+IDs would take 16 GB. 1_numbering_systems/4_check_LSD.c reads one bit with a shift and
+a mask; a Bitset does that on an array of 64-bit words and needs 512 MB for the same set.
+
+  - Bulk operations: and, or, xor, andnot of two sets of the same size, 4 words at a time
+    with AVX2. bitset_count and bitset_and_count (the size of the intersection, without
+    building it) use VPOPCNTDQ with AVX-512, otherwise the nibble lookup of Mula (two
+    PSHUFB per 32 bytes, summed with PSADBW), otherwise POPCNT.
+  - bitset_next_set, bitset_next_clear: the first set or clear bit at or after a position,
+    a word at a time; for (i = next_set(b, 0); i < bits; i = next_set(b, i + 1)) visits
+    the members in order.
+  - RankSelect: rank (the number of set bits before a position) and select (the position
+    of the k-th set bit) on a Bitset that no longer changes, in the layout of Zhou,
+    Andersen and Kaminsky ("poppy"). One 64-bit entry per 2048 bits holds the count
+    before the block and the counts of its first three 512-bit parts, 3.1% of the bits,
+    plus one 64-bit count per 2^32 bits. Rank reads that entry and at most 8 words of
+    one cache line. Select starts from a sample kept for every RANK_SELECT_SAMPLE-th one
+    (0.2% more for a half-full set) and does a binary search on at most SELECT_SPAN
+    blocks. Where the ones of a sample spread over more blocks, a second level keeps the
+    block of every SELECT_SUBSAMPLE-th one, and where even those spread too far, the
+    positions of the ones themselves: at most 3.1% more each, at densities of about 1/16
+    (the second level) and 1/2048 (the positions), and less for sparser sets. The bit
+    inside its word is found with PDEP and TZCNT (BMI2).
+The bits past the size in the last word are always 0.
+*/
+
+#define RANK_SELECT_SAMPLE 8192
+#define SELECT_SUBSAMPLE 64
+#define SELECT_SPAN 64 // blocks of 2048 bits
+
+typedef struct {
+    uint64_t *words;
+    size_t bits, word_count;
+} Bitset;
+
+typedef struct {
+    size_t block;   // of the sample
+    size_t spilled; // where the positions of the stretch start in spilled
+} SelectStretch;
+
+typedef struct {
+    const Bitset *set;
+    uint64_t *upper;    // [i >> 32]: ones before bit i & ~(2^32 - 1)
+    uint64_t *blocks;   // [i / 2048]: ones before the block in its 2^32 bits (bits 0-31) and
+                        // the ones of its 512-bit parts 0, 1, 2 (10 bits each from bit 32)
+    uint32_t *samples;  // [k]: the block of one number k * RANK_SELECT_SAMPLE (sets of up to
+                        // 2^42 bits), or with the top bit set, its stretch in stretches
+    SelectStretch *stretches; // the samples whose ones spread over SELECT_SPAN blocks or more
+    uint32_t *subsamples; // [j * RANK_SELECT_SAMPLE / SELECT_SUBSAMPLE + i] for stretch j: the
+                          // offset of the block of its one number i * SELECT_SUBSAMPLE, or with the
+                          // top bit set, where its ones start after stretches[j].spilled
+    uint64_t *spilled;    // positions of the ones of subsamples that spread over too many blocks
+    size_t ones;
+    size_t block_count, sample_count, stretch_count, spilled_count;
+} RankSelect;
+
+int bitset_init(Bitset *b, size_t bits); // all clear; returns 0 if out of memory
+void bitset_free(Bitset *b);
+void bitset_fill(Bitset *b, int value);
+
+static inline int bitset_test(const Bitset *b, size_t i) { return (int)(b->words[i / 64] >> (i % 64) & 1); }
+static inline void bitset_set(Bitset *b, size_t i) { b->words[i / 64] |= 1ULL << (i % 64); }
+static inline void bitset_clear(Bitset *b, size_t i) { b->words[i / 64] &= ~(1ULL << (i % 64)); }
+static inline void bitset_flip(Bitset *b, size_t i) { b->words[i / 64] ^= 1ULL << (i % 64); }
+
+// dst = a op b; all three have the same size, dst may be a or b. andnot: a & ~b.
+void bitset_and(Bitset *dst, const Bitset *a, const Bitset *b);
+void bitset_or(Bitset *dst, const Bitset *a, const Bitset *b);
+void bitset_xor(Bitset *dst, const Bitset *a, const Bitset *b);
+void bitset_andnot(Bitset *dst, const Bitset *a, const Bitset *b);
+
+size_t bitset_count(const Bitset *b);
+size_t bitset_and_count(const Bitset *a, const Bitset *b);
+
+// Return b->bits if there is none.
+size_t bitset_next_set(const Bitset *b, size_t from);
+size_t bitset_next_clear(const Bitset *b, size_t from);
+
+int rank_select_init(RankSelect *r, const Bitset *b); // returns 0 if out of memory
+void rank_select_free(RankSelect *r);
+size_t rank_select_memory(const RankSelect *r); // bytes of the index
+size_t bitset_rank(const RankSelect *r, size_t i); // set bits in [0, i), i <= bits
+size_t bitset_select(const RankSelect *r, size_t k); // the set bit with rank k, or bits if k >= ones
+
+#endif
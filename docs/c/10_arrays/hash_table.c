@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "hash_table.h"
+
+/*
+Hash table module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 5_hash_tables.c hash_table.c sort.c -o hash_tables
+*/
+
+#define ARENA_BLOCK_SIZE (1 << 20)
+#define PREFETCH_DISTANCE 16 // keys hashed ahead in int_table_insert_batch, a power of two
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    char data[];
+};
+
+// ---- Hashing and control bytes ----
+
+static inline uint64_t hash_u64(uint64_t x) { // murmur3 finalizer
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// 8 bytes per step; the tail is read into a zeroed word, and the length is mixed in so
+// that keys differing only in trailing '\0' bytes still differ.
+static uint64_t hash_bytes(const char *s, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+    for (; len >= 8; s += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, s, 8);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 29;
+    }
+    uint64_t w = 0;
+    memcpy(&w, s, len);
+    return hash_u64(h ^ w);
+}
+
+// Bit i is set if control byte i of the group equals c.
+static inline uint32_t group_match(const int8_t *group, int8_t c) {
+#ifdef __SSE2__
+    __m128i g = _mm_load_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HASH_GROUP; ++i)
+        mask |= (uint32_t)(group[i] == c) << i;
+    return mask;
+#endif
+}
+
+static inline int8_t hash_tag(uint64_t hash) { // the 7 bits kept in the control byte
+    return (int8_t)(hash & 0x7F);
+}
+
+static inline size_t hash_group(uint64_t hash, size_t capacity) { // first group to probe
+    return (size_t)(hash >> 7) & (capacity / HASH_GROUP - 1);
+}
+
+// Steps 1, 2, 3, ... groups: with a power-of-two group count every group is visited.
+static inline size_t next_group(size_t g, size_t step, size_t capacity) {
+    return (g + step) & (capacity / HASH_GROUP - 1);
+}
+
+static size_t capacity_for(size_t expected_size) {
+    size_t capacity = HASH_GROUP;
+    while (capacity / 8 * 7 < expected_size)
+        capacity *= 2;
+    return capacity;
+}
+
+static int8_t *alloc_ctrl(size_t capacity) {
+    int8_t *ctrl = aligned_alloc(HASH_GROUP, capacity);
+    if (ctrl)
+        memset(ctrl, HASH_EMPTY, capacity);
+    return ctrl;
+}
+
+// First empty slot on the probe path; for rehashing, where keys are known to be new.
+static size_t find_empty(const int8_t *ctrl, size_t capacity, uint64_t hash) {
+    size_t g = hash_group(hash, capacity);
+    for (size_t step = 1;; ++step) {
+        uint32_t empty = group_match(ctrl + g * HASH_GROUP, HASH_EMPTY);
+        if (empty)
+            return g * HASH_GROUP + __builtin_ctz(empty);
+        g = next_group(g, step, capacity);
+    }
+}
+
+// ---- Integer keys ----
+
+/*
+Slot of key if *found, otherwise the slot where it would be inserted. The empty slot
+found is in the first group with any empty slot, so no key further along the probe path
+can be equal (there is no erase).
+*/
+static size_t int_probe(const IntTable *t, uint64_t key, uint64_t hash, int *found) {
+    int8_t tag = hash_tag(hash);
+    size_t g = hash_group(hash, t->capacity);
+    for (size_t step = 1;; ++step) {
+        const int8_t *group = t->ctrl + g * HASH_GROUP;
+        for (uint32_t m = group_match(group, tag); m; m &= m - 1) {
+            size_t slot = g * HASH_GROUP + __builtin_ctz(m);
+            if (t->keys[slot] == key) {
+                *found = 1;
+                return slot;
+            }
+        }
+        uint32_t empty = group_match(group, HASH_EMPTY);
+        if (empty) {
+            *found = 0;
+            return g * HASH_GROUP + __builtin_ctz(empty);
+        }
+        g = next_group(g, step, t->capacity);
+    }
+}
+
+static int int_table_rehash(IntTable *t, size_t capacity) {
+    int8_t *ctrl = alloc_ctrl(capacity);
+    uint64_t *keys = malloc(capacity * sizeof(*keys));
+    uint64_t *counts = t->counts ? malloc(capacity * sizeof(*counts)) : NULL;
+    if (!ctrl || !keys || (t->counts && !counts)) {
+        free(ctrl);
+        free(keys);
+        free(counts);
+        return 0;
+    }
+    for (size_t i = 0; i < t->capacity; ++i) {
+        if (!int_table_used(t, i))
+            continue;
+        uint64_t hash = hash_u64(t->keys[i]);
+        size_t slot = find_empty(ctrl, capacity, hash);
+        ctrl[slot] = hash_tag(hash);
+        keys[slot] = t->keys[i];
+        if (counts)
+            counts[slot] = t->counts[i];
+    }
+    free(t->ctrl);
+    free(t->keys);
+    free(t->counts);
+    t->ctrl = ctrl;
+    t->keys = keys;
+    t->counts = counts;
+    t->capacity = capacity;
+    return 1;
+}
+
+int int_table_init(IntTable *t, size_t expected_size, int with_counts) {
+    t->capacity = capacity_for(expected_size);
+    t->size = 0;
+    t->ctrl = alloc_ctrl(t->capacity);
+    t->keys = malloc(t->capacity * sizeof(*t->keys));
+    t->counts = with_counts ? malloc(t->capacity * sizeof(*t->counts)) : NULL;
+    if (!t->ctrl || !t->keys || (with_counts && !t->counts)) {
+        int_table_free(t);
+        return 0;
+    }
+    return 1;
+}
+
+int int_table_reserve(IntTable *t, size_t expected_size) {
+    size_t capacity = capacity_for(expected_size);
+    return capacity <= t->capacity || int_table_rehash(t, capacity);
+}
+
+void int_table_free(IntTable *t) {
+    free(t->ctrl);
+    free(t->keys);
+    free(t->counts);
+    t->ctrl = NULL;
+    t->keys = NULL;
+    t->counts = NULL;
+    t->size = t->capacity = 0;
+}
+
+static inline int int_insert_hashed(IntTable *t, uint64_t key, uint64_t hash) {
+    if (t->size >= t->capacity / 8 * 7 && !int_table_rehash(t, 2 * t->capacity))
+        return -1;
+    int found;
+    size_t slot = int_probe(t, key, hash, &found);
+    if (found) {
+        if (t->counts)
+            t->counts[slot]++;
+        return 0;
+    }
+    t->ctrl[slot] = hash_tag(hash);
+    t->keys[slot] = key;
+    if (t->counts)
+        t->counts[slot] = 1;
+    t->size++;
+    return 1;
+}
+
+int int_table_insert(IntTable *t, uint64_t key) {
+    return int_insert_hashed(t, key, hash_u64(key));
+}
+
+// With a table larger than the cache every insert is a cache miss; hashing
+// PREFETCH_DISTANCE keys ahead lets those misses overlap.
+size_t int_table_insert_batch(IntTable *t, const uint64_t *keys, size_t n) {
+    uint64_t hashes[PREFETCH_DISTANCE];
+    size_t added = 0;
+    for (size_t i = 0; i < n && i < PREFETCH_DISTANCE; ++i)
+        hashes[i] = hash_u64(keys[i]);
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t hash = hashes[i % PREFETCH_DISTANCE];
+        if (i + PREFETCH_DISTANCE < n) {
+            uint64_t ahead = hash_u64(keys[i + PREFETCH_DISTANCE]);
+            size_t g = hash_group(ahead, t->capacity);
+            __builtin_prefetch(t->ctrl + g * HASH_GROUP);
+            __builtin_prefetch(t->keys + g * HASH_GROUP);
+            hashes[i % PREFETCH_DISTANCE] = ahead;
+        }
+        int r = int_insert_hashed(t, keys[i], hash);
+        if (r < 0)
+            return SIZE_MAX;
+        added += (size_t)r;
+    }
+    return added;
+}
+
+int int_table_contains(const IntTable *t, uint64_t key) {
+    int found;
+    int_probe(t, key, hash_u64(key), &found);
+    return found;
+}
+
+uint64_t int_table_count(const IntTable *t, uint64_t key) {
+    int found;
+    size_t slot = int_probe(t, key, hash_u64(key), &found);
+    return found && t->counts ? t->counts[slot] : 0;
+}
+
+size_t distinct_count_u64(const uint64_t *a, size_t n) {
+    IntTable t;
+    if (!int_table_init(&t, n < (1 << 16) ? n : (1 << 16), 0)) // grows as needed
+        return SIZE_MAX;
+    size_t count = int_table_insert_batch(&t, a, n);
+    int_table_free(&t);
+    return count;
+}
+
+size_t unique_only_int(const int *a, size_t n, int *out) {
+    IntTable t;
+    if (!int_table_init(&t, n < (1 << 16) ? n : (1 << 16), 1))
+        return SIZE_MAX;
+    for (size_t i = 0; i < n; ++i)
+        if (int_table_insert(&t, (uint64_t)(int64_t)a[i]) < 0) {
+            int_table_free(&t);
+            return SIZE_MAX;
+        }
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (int_table_count(&t, (uint64_t)(int64_t)a[i]) == 1)
+            out[count++] = a[i];
+    int_table_free(&t);
+    return count;
+}
+
+// ---- String keys ----
+
+// Key bytes go to 1 MB blocks; a key longer than a block gets a block of its own.
+static const char *arena_copy(StrArena *a, const char *s, size_t len) {
+    if (len == 0)
+        return "";
+    if ((size_t)(a->end - a->next) < len) {
+        size_t size = len > ARENA_BLOCK_SIZE ? len : ARENA_BLOCK_SIZE;
+        ArenaBlock *b = malloc(sizeof(*b) + size);
+        if (!b)
+            return NULL;
+        b->next = a->head;
+        a->head = b;
+        a->next = b->data;
+        a->end = b->data + size;
+    }
+    char *p = a->next;
+    memcpy(p, s, len);
+    a->next += len;
+    return p;
+}
+
+static size_t str_probe(const StrTable *t, const char *str, size_t len, uint64_t hash, int *found) {
+    int8_t tag = hash_tag(hash);
+    size_t g = hash_group(hash, t->capacity);
+    for (size_t step = 1;; ++step) {
+        const int8_t *group = t->ctrl + g * HASH_GROUP;
+        for (uint32_t m = group_match(group, tag); m; m &= m - 1) {
+            size_t slot = g * HASH_GROUP + __builtin_ctz(m);
+            const StrEntry *e = &t->entries[slot];
+            if (e->hash == hash && e->len == len && memcmp(e->str, str, len) == 0) {
+                *found = 1;
+                return slot;
+            }
+        }
+        uint32_t empty = group_match(group, HASH_EMPTY);
+        if (empty) {
+            *found = 0;
+            return g * HASH_GROUP + __builtin_ctz(empty);
+        }
+        g = next_group(g, step, t->capacity);
+    }
+}
+
+static int str_table_rehash(StrTable *t, size_t capacity) {
+    int8_t *ctrl = alloc_ctrl(capacity);
+    StrEntry *entries = malloc(capacity * sizeof(*entries));
+    if (!ctrl || !entries) {
+        free(ctrl);
+        free(entries);
+        return 0;
+    }
+    for (size_t i = 0; i < t->capacity; ++i) {
+        if (!str_table_used(t, i))
+            continue;
+        size_t slot = find_empty(ctrl, capacity, t->entries[i].hash);
+        ctrl[slot] = t->ctrl[i];
+        entries[slot] = t->entries[i];
+    }
+    free(t->ctrl);
+    free(t->entries);
+    t->ctrl = ctrl;
+    t->entries = entries;
+    t->capacity = capacity;
+    return 1;
+}
+
+int str_table_init(StrTable *t, size_t expected_size) {
+    t->capacity = capacity_for(expected_size);
+    t->size = 0;
+    t->ctrl = alloc_ctrl(t->capacity);
+    t->entries = malloc(t->capacity * sizeof(*t->entries));
+    t->arena = (StrArena){NULL, NULL, NULL};
+    if (!t->ctrl || !t->entries) {
+        str_table_free(t);
+        return 0;
+    }
+    return 1;
+}
+
+int str_table_reserve(StrTable *t, size_t expected_size) {
+    size_t capacity = capacity_for(expected_size);
+    return capacity <= t->capacity || str_table_rehash(t, capacity);
+}
+
+void str_table_free(StrTable *t) {
+    while (t->arena.head) {
+        ArenaBlock *next = t->arena.head->next;
+        free(t->arena.head);
+        t->arena.head = next;
+    }
+    free(t->ctrl);
+    free(t->entries);
+    t->ctrl = NULL;
+    t->entries = NULL;
+    t->size = t->capacity = 0;
+}
+
+StrEntry *str_table_add(StrTable *t, const char *str, size_t len) {
+    if (t->size >= t->capacity / 8 * 7 && !str_table_rehash(t, 2 * t->capacity))
+        return NULL;
+    uint64_t hash = hash_bytes(str, len);
+    int found;
+    size_t slot = str_probe(t, str, len, hash, &found);
+    StrEntry *e = &t->entries[slot];
+    if (found) {
+        e->count++;
+        return e;
+    }
+    const char *copy = arena_copy(&t->arena, str, len);
+    if (!copy)
+        return NULL;
+    *e = (StrEntry){copy, len, hash, 1};
+    t->ctrl[slot] = hash_tag(hash);
+    t->size++;
+    return e;
+}
+
+const StrEntry *str_table_find(const StrTable *t, const char *str, size_t len) {
+    int found;
+    size_t slot = str_probe(t, str, len, hash_bytes(str, len), &found);
+    return found ? &t->entries[slot] : NULL;
+}
@@ -0,0 +1,94 @@
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Hash table module (interface), replacing the quadratic "print only the unique elements"
+scan of the arrays chapter and the 26-bucket letter counter of the strings chapter.
+
+Open addressing in the style of Swiss tables: every slot has a control byte, either
+HASH_EMPTY or the low 7 bits of the key's hash. A lookup compares the 16 control bytes
+of a group with one SIMD instruction and only looks at the keys whose 7 bits match, so
+a miss usually touches no key at all. Groups are probed quadratically; the table grows
+to twice its size at 7/8 load. There is no erase, so an empty byte ends every probe.
+  - IntTable: uint64_t keys, with an optional occurrence count per key
+  - StrTable: byte-string keys with counts; the key bytes are copied into a bump arena
+    owned by the table, so the caller's buffer can be reused
+*/
+
+#define HASH_GROUP 16
+#define HASH_EMPTY ((int8_t)-128)
+
+typedef struct {
+    int8_t *ctrl;     // capacity control bytes
+    uint64_t *keys;
+    uint64_t *counts; // NULL for a plain set
+    size_t size;      // keys stored
+    size_t capacity;  // slots, a power of two >= HASH_GROUP
+} IntTable;
+
+typedef struct {
+    const char *str; // in the table's arena, not '\0'-terminated
+    size_t len;
+    uint64_t hash;   // kept so that a rehash does not read the strings again
+    uint64_t count;
+} StrEntry;
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    char *next, *end;
+} StrArena;
+
+typedef struct {
+    int8_t *ctrl;
+    StrEntry *entries;
+    size_t size;
+    size_t capacity;
+    StrArena arena;
+} StrTable;
+
+// ---- Integer keys ----
+
+// All functions returning int return 0 if they ran out of memory (the table stays valid).
+int int_table_init(IntTable *t, size_t expected_size, int with_counts);
+int int_table_reserve(IntTable *t, size_t expected_size); // rehash now, not on the way
+void int_table_free(IntTable *t);
+
+// 1 if the key was new, 0 if it was already there, -1 if out of memory.
+int int_table_insert(IntTable *t, uint64_t key);
+// Inserts n keys; the probes of upcoming keys are prefetched. Returns the number of new
+// keys, or SIZE_MAX if out of memory.
+size_t int_table_insert_batch(IntTable *t, const uint64_t *keys, size_t n);
+int int_table_contains(const IntTable *t, uint64_t key);
+uint64_t int_table_count(const IntTable *t, uint64_t key); // 0 if absent or no counts
+
+// Number of different values in a (SIZE_MAX if out of memory).
+size_t distinct_count_u64(const uint64_t *a, size_t n);
+// Copies the values that occur exactly once in a to out, in their original order, and
+// returns how many there are (SIZE_MAX if out of memory).
+size_t unique_only_int(const int *a, size_t n, int *out);
+
+// ---- String keys ----
+
+int str_table_init(StrTable *t, size_t expected_size);
+int str_table_reserve(StrTable *t, size_t expected_size);
+void str_table_free(StrTable *t);
+
+// Adds one occurrence of the key; returns its entry (NULL if out of memory).
+StrEntry *str_table_add(StrTable *t, const char *str, size_t len);
+const StrEntry *str_table_find(const StrTable *t, const char *str, size_t len);
+
+// Visits the stored entries: for (i = 0; i < t->capacity; ++i) if (str_table_used(t, i)) ...
+static inline int str_table_used(const StrTable *t, size_t slot) {
+    return t->ctrl[slot] != HASH_EMPTY;
+}
+
+static inline int int_table_used(const IntTable *t, size_t slot) {
+    return t->ctrl[slot] != HASH_EMPTY;
+}
+
+#endif
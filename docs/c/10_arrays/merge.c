@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "merge.h"
+#include "sort.h"
+
+/*
+Merge module (implementation). Uses radix_sort_i64 from the sort module for the runs,
+so compile both together and link with -pthread, e.g.:
+    gcc -O2 -march=native -pthread 4_external_merge_sort.c merge.c sort.c -o extsort
+*/
+
+#define PARALLEL_MERGE_MIN (1 << 16) // below this a single thread is faster
+#define MIN_SOURCE_BUFFER (1 << 20)  // bytes per run in a merge, keeps reads sequential
+
+// ---- Loser tree ----
+
+// node[k..3k) is scratch space for loser_tree_build.
+int loser_tree_init(LoserTree *t, int k) {
+    t->k = k;
+    t->node = malloc(3 * (size_t)k * sizeof(*t->node));
+    t->key = malloc(k * sizeof(*t->key));
+    t->live = calloc(k, 1);
+    if (!t->node || !t->key || !t->live) {
+        loser_tree_free(t);
+        return 0;
+    }
+    return 1;
+}
+
+// Plays all matches bottom-up: winners[p] is the winner below p, node[p] keeps the loser.
+void loser_tree_build(LoserTree *t) {
+    int k = t->k;
+    int *winners = t->node + k;
+    for (int i = 0; i < k; ++i)
+        winners[k + i] = i;
+    for (int p = k - 1; p > 0; --p) {
+        int x = winners[2 * p], y = winners[2 * p + 1];
+        int x_first = loser_tree_before(t, x, y);
+        winners[p] = x_first ? x : y;
+        t->node[p] = x_first ? y : x;
+    }
+    t->node[0] = k > 1 ? winners[1] : 0;
+}
+
+void loser_tree_free(LoserTree *t) {
+    free(t->node);
+    free(t->key);
+    free(t->live);
+    t->node = NULL;
+    t->key = NULL;
+    t->live = NULL;
+}
+
+// ---- In-memory merges ----
+
+// Both indices advance by comparison results only; the chapter's loop branches on every
+// element, and that branch is mispredicted about half the time on random data.
+void merge_i64(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out) {
+    size_t i = 0, j = 0;
+    while (i < na && j < nb) {
+        int take_b = b[j] < a[i];
+        *out++ = take_b ? b[j] : a[i];
+        j += take_b;
+        i += !take_b;
+    }
+    memcpy(out, a + i, (na - i) * sizeof(*a));
+    memcpy(out + (na - i), b + j, (nb - j) * sizeof(*b));
+}
+
+/*
+Number of elements of a among the first `diagonal` outputs of merge_i64(a, b).
+The path crosses the diagonal after i elements of a and diagonal - i of b, where i is
+the first position with a[i] > b[diagonal - i - 1] (a wins ties, so equal keys of a
+come first).
+*/
+size_t merge_path_split(const int64_t *a, size_t na, const int64_t *b, size_t nb, size_t diagonal) {
+    size_t lo = diagonal > nb ? diagonal - nb : 0;
+    size_t hi = diagonal < na ? diagonal : na;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] <= b[diagonal - mid - 1])
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+typedef struct {
+    const int64_t *a, *b;
+    size_t na, nb;
+    int64_t *out;
+} MergePiece;
+
+static void *merge_piece(void *arg) {
+    MergePiece *p = arg;
+    merge_i64(p->a, p->na, p->b, p->nb, p->out);
+    return NULL;
+}
+
+void parallel_merge_i64(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out,
+                        int thread_count) {
+    size_t n = na + nb;
+    MergePiece *pieces = thread_count > 1 && n >= PARALLEL_MERGE_MIN ? malloc(thread_count * sizeof(*pieces)) : NULL;
+    pthread_t *threads = pieces ? malloc(thread_count * sizeof(*threads)) : NULL;
+    int *started = threads ? calloc(thread_count, sizeof(*started)) : NULL;
+    if (!started) {
+        free(pieces);
+        free(threads);
+        merge_i64(a, na, b, nb, out);
+        return;
+    }
+    size_t prev_d = 0, prev_i = 0;
+    for (int t = 0; t < thread_count; ++t) {
+        size_t d = n * (t + 1) / thread_count;
+        size_t i = merge_path_split(a, na, b, nb, d);
+        pieces[t] = (MergePiece){a + prev_i, b + (prev_d - prev_i), i - prev_i, (d - i) - (prev_d - prev_i), out + prev_d};
+        prev_d = d;
+        prev_i = i;
+    }
+    // piece 0 runs on the calling thread; a piece whose thread cannot start does too
+    for (int t = 1; t < thread_count; ++t)
+        started[t] = pthread_create(&threads[t], NULL, merge_piece, &pieces[t]) == 0;
+    merge_piece(&pieces[0]);
+    for (int t = 1; t < thread_count; ++t) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            merge_piece(&pieces[t]);
+    }
+    free(started);
+    free(pieces);
+    free(threads);
+}
+
+int kway_merge_i64(const int64_t *const *runs, const size_t *lengths, int k, int64_t *out) {
+    if (k == 0)
+        return 1;
+    LoserTree t;
+    size_t *pos = calloc(k, sizeof(*pos));
+    if (!pos || !loser_tree_init(&t, k)) {
+        free(pos);
+        return 0;
+    }
+    for (int i = 0; i < k; ++i) {
+        t.live[i] = lengths[i] > 0;
+        t.key[i] = lengths[i] > 0 ? runs[i][0] : 0;
+        pos[i] = 1;
+    }
+    loser_tree_build(&t);
+    for (int w; t.live[w = loser_tree_winner(&t)];) {
+        *out++ = t.key[w];
+        int has_next = pos[w] < lengths[w];
+        loser_tree_replay(&t, has_next, has_next ? runs[w][pos[w]++] : 0);
+    }
+    free(pos);
+    loser_tree_free(&t);
+    return 1;
+}
+
+// ---- External merge sort ----
+
+typedef struct {
+    FILE *f;
+    int64_t *buf;
+    size_t pos, len, capacity;
+} RunReader;
+
+static double now_seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+// An anonymous read/write file in dir: removed from the directory right away, and
+// freed by the system when it is closed.
+static FILE *open_temp(const char *dir) {
+    size_t len = strlen(dir);
+    char *path = malloc(len + sizeof("/extsort_XXXXXX"));
+    if (!path)
+        return NULL;
+    memcpy(path, dir, len);
+    strcpy(path + len, "/extsort_XXXXXX");
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        unlink(path);
+    free(path);
+    FILE *f = fd >= 0 ? fdopen(fd, "w+b") : NULL;
+    if (!f && fd >= 0)
+        close(fd);
+    if (f)
+        setvbuf(f, NULL, _IONBF, 0); // every read and write is already one large block
+    return f;
+}
+
+static int refill(RunReader *r) {
+    r->pos = 0;
+    r->len = fread(r->buf, sizeof(*r->buf), r->capacity, r->f);
+    return r->len > 0 || !ferror(r->f);
+}
+
+/*
+Merges k run files (read from the start) into out. memory is split into k input buffers
+and one output buffer of equal size, so every read and write is one large sequential
+block and the disk seeks once per buffer, not once per value.
+*/
+static int merge_files(FILE **src, int k, FILE *out, int64_t *memory, size_t memory_len) {
+    if (k == 0)
+        return fflush(out) == 0;
+    size_t buf_len = memory_len / (k + 1);
+    RunReader *r = malloc(k * sizeof(*r));
+    LoserTree t;
+    if (!r || !loser_tree_init(&t, k)) {
+        free(r);
+        return 0;
+    }
+    int ok = 1;
+    for (int i = 0; i < k; ++i) {
+        r[i] = (RunReader){src[i], memory + i * buf_len, 0, 0, buf_len};
+        ok &= fseek(src[i], 0, SEEK_SET) == 0 && refill(&r[i]);
+        t.live[i] = r[i].len > 0;
+        t.key[i] = r[i].len > 0 ? r[i].buf[r[i].pos++] : 0;
+    }
+    loser_tree_build(&t);
+
+    int64_t *obuf = memory + k * buf_len;
+    size_t opos = 0;
+    for (int w; ok && t.live[w = loser_tree_winner(&t)];) {
+        obuf[opos++] = t.key[w];
+        if (opos == buf_len) {
+            ok = fwrite(obuf, sizeof(*obuf), opos, out) == opos;
+            opos = 0;
+        }
+        RunReader *s = &r[w];
+        if (s->pos == s->len)
+            ok &= refill(s);
+        int has_next = s->pos < s->len;
+        loser_tree_replay(&t, has_next, has_next ? s->buf[s->pos++] : 0);
+    }
+    if (ok && opos)
+        ok = fwrite(obuf, sizeof(*obuf), opos, out) == opos;
+    ok = ok && fflush(out) == 0;
+    free(r);
+    loser_tree_free(&t);
+    return ok;
+}
+
+static void close_all(FILE **files, int count) {
+    for (int i = 0; i < count; ++i)
+        if (files[i])
+            fclose(files[i]);
+}
+
+int external_sort_i64(const char *input_path, const char *output_path, const char *tmp_dir,
+                      size_t memory_bytes, ExternalSortStats *stats) {
+    ExternalSortStats local;
+    if (!stats)
+        stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    // phase 1 needs the run and the radix sort scratch buffer, phase 2 reuses the block
+    size_t memory_len = memory_bytes / sizeof(int64_t) / 2 * 2;
+    size_t run_len = memory_len / 2;
+    int max_fanin = (int)(memory_bytes / MIN_SOURCE_BUFFER) - 1;
+    if (max_fanin < 2)
+        max_fanin = 2;
+    if (memory_len < 2 * (size_t)(max_fanin + 1)) // too little memory for the buffers
+        return 0;
+    int64_t *memory = malloc(memory_len * sizeof(*memory));
+    FILE *in = fopen(input_path, "rb");
+    FILE **runs = NULL, *out = NULL;
+    int run_count = 0, capacity = 0, ok = 0;
+    if (!memory || !in)
+        goto done;
+    setvbuf(in, NULL, _IONBF, 0);
+
+    // ---- Phase 1: sorted runs ----
+    for (;;) {
+        double t0 = now_seconds();
+        size_t n = fread(memory, sizeof(*memory), run_len, in);
+        double t1 = now_seconds();
+        stats->read_seconds += t1 - t0;
+        if (n == 0) {
+            if (ferror(in))
+                goto done;
+            break;
+        }
+        radix_sort_i64(memory, memory + run_len, n);
+        double t2 = now_seconds();
+        stats->sort_seconds += t2 - t1;
+        if (run_count == capacity) {
+            capacity = capacity ? 2 * capacity : 16;
+            FILE **grown = realloc(runs, capacity * sizeof(*runs));
+            if (!grown)
+                goto done;
+            runs = grown;
+        }
+        FILE *f = runs[run_count] = open_temp(tmp_dir);
+        if (!f)
+            goto done;
+        run_count++;
+        if (fwrite(memory, sizeof(*memory), n, f) != n || fflush(f) != 0)
+            goto done;
+        stats->write_seconds += now_seconds() - t2;
+        stats->count += n;
+        if (n < run_len)
+            break;
+    }
+    stats->run_count = run_count;
+
+    // ---- Phase 2: merge passes ----
+    double t0 = now_seconds();
+    while (run_count > max_fanin) {
+        // groups of equal size, so the next pass gets runs of similar length
+        int groups = (run_count + max_fanin - 1) / max_fanin;
+        for (int g = 0; g < groups; ++g) {
+            int first = run_count * g / groups, last = run_count * (g + 1) / groups;
+            FILE *merged = open_temp(tmp_dir);
+            if (!merged || !merge_files(runs + first, last - first, merged, memory, memory_len)) {
+                if (merged)
+                    fclose(merged);
+                goto done;
+            }
+            close_all(runs + first, last - first);
+            for (int i = first; i < last; ++i)
+                runs[i] = NULL;
+            runs[g] = merged; // g <= first: the slot belongs to a group that is done
+        }
+        run_count = groups;
+        stats->merge_passes++;
+    }
+    out = fopen(output_path, "wb");
+    if (!out)
+        goto done;
+    setvbuf(out, NULL, _IONBF, 0);
+    ok = merge_files(runs, run_count, out, memory, memory_len);
+    stats->merge_passes++;
+    stats->merge_seconds = now_seconds() - t0;
+
+done:
+    if (out && fclose(out) != 0)
+        ok = 0;
+    if (runs)
+        close_all(runs, run_count);
+    if (in)
+        fclose(in);
+    free(runs);
+    free(memory);
+    return ok;
+}
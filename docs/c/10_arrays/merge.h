@@ -0,0 +1,91 @@
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Merge module (interface), replacing the branchy two-array merge of the arrays chapter.
+  - merge_i64: two sorted arrays, branchless loop, stable (a wins ties)
+  - parallel_merge_i64: the output is cut into thread_count equal pieces; the start of
+    each piece in a and b is found by a binary search on its merge-path diagonal, so
+    every thread merges its piece independently
+  - LoserTree / kway_merge_i64: k-way merge with log2(k) comparisons per element
+  - external_sort_i64: sorts a file of int64 values that does not fit in memory;
+    sorted runs of memory_bytes / 16 values go to temp files, then they are merged
+    with large sequential reads and writes (more than one pass if there are too many)
+*/
+
+// ---- Loser tree ----
+
+/*
+node[0] is the source holding the smallest key; node[1..k) is the loser of the match
+at that internal node (children 2p and 2p + 1, leaves at k..2k-1). Exhausted sources
+(live[i] == 0) lose every match; ties go to the lower source index.
+*/
+typedef struct {
+    int k;
+    int *node;
+    int64_t *key;        // current head of each source
+    unsigned char *live;
+} LoserTree;
+
+int loser_tree_init(LoserTree *t, int k); // returns 0 if out of memory
+void loser_tree_build(LoserTree *t);      // call after filling key[] and live[]
+void loser_tree_free(LoserTree *t);
+
+// Bitwise & and | instead of && and ||, so the replay loop compiles without branches.
+static inline int loser_tree_before(const LoserTree *t, int x, int y) {
+    int64_t kx = t->key[x], ky = t->key[y];
+    int lx = t->live[x], ly = t->live[y];
+    return lx & (!ly | (kx < ky) | ((kx == ky) & (x < y)));
+}
+
+static inline int loser_tree_winner(const LoserTree *t) {
+    return t->node[0];
+}
+
+// Gives the winning source its next key (or marks it exhausted) and replays its path.
+static inline void loser_tree_replay(LoserTree *t, int has_next, int64_t next_key) {
+    int winner = t->node[0];
+    t->key[winner] = next_key;
+    t->live[winner] = (unsigned char)has_next;
+    for (int p = (t->k + winner) / 2; p > 0; p /= 2) {
+        int loser = t->node[p];
+        int swap = loser_tree_before(t, loser, winner);
+        t->node[p] = swap ? winner : loser;
+        winner = swap ? loser : winner;
+    }
+    t->node[0] = winner;
+}
+
+// ---- In-memory merges ----
+
+void merge_i64(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out);
+size_t merge_path_split(const int64_t *a, size_t na, const int64_t *b, size_t nb, size_t diagonal);
+void parallel_merge_i64(const int64_t *a, size_t na, const int64_t *b, size_t nb, int64_t *out,
+                        int thread_count);
+// Returns 0 if out of memory.
+int kway_merge_i64(const int64_t *const *runs, const size_t *lengths, int k, int64_t *out);
+
+// ---- External merge sort ----
+
+typedef struct {
+    uint64_t count;        // values sorted
+    int run_count;         // sorted runs written in phase 1
+    int merge_passes;      // passes over the data in phase 2 (the last one writes the output)
+    double read_seconds;   // phase 1: reading the input
+    double sort_seconds;   // phase 1: sorting the runs in memory
+    double write_seconds;  // phase 1: writing the runs
+    double merge_seconds;  // phase 2: all merge passes
+} ExternalSortStats;
+
+/*
+Returns 0 on failure (file, memory or disk-full error; errno is left as set by the
+failing call). tmp_dir holds the run files; they are unlinked as soon as they are
+created, so nothing is left behind even if the program is killed. stats may be NULL.
+*/
+int external_sort_i64(const char *input_path, const char *output_path, const char *tmp_dir,
+                      size_t memory_bytes, ExternalSortStats *stats);
+
+#endif
@@ -0,0 +1,354 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <pthread.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "reduce.h"
+
+/*
+Reduction module (implementation).
+Compile together with the program that uses it and link with -pthread, e.g.:
+    gcc -O2 -march=native -pthread 6_reductions.c reduce.c -o reductions
+*/
+
+#define BLOCK (1 << 24) // elements per block: lane indices and counts stay below 2^21
+
+// ---- Scalar building blocks: tails, folding the lanes, merging results ----
+
+static const MinMax minmax_empty = {INT_MAX, INT_MIN, SIZE_MAX, SIZE_MAX};
+static const Top2 top2_empty = {INT_MIN, INT_MIN};
+
+// Ties keep the lower index, so the result does not depend on the order of folding.
+static inline void take_min(MinMax *m, int v, size_t i) {
+    if (v < m->min || (v == m->min && i < m->argmin)) {
+        m->min = v;
+        m->argmin = i;
+    }
+}
+
+static inline void take_max(MinMax *m, int v, size_t i) {
+    if (v > m->max || (v == m->max && i < m->argmax)) {
+        m->max = v;
+        m->argmax = i;
+    }
+}
+
+// The chapter's max1/max2 update.
+static inline void top2_add(Top2 *t, int v) {
+    if (v > t->max1) {
+        t->max2 = t->max1;
+        t->max1 = v;
+    } else if (v > t->max2)
+        t->max2 = v;
+}
+
+static inline int predicate_test(Predicate p, int x) {
+    switch (p.kind) {
+        case PRED_ODD : return x & 1;
+        case PRED_EVEN: return !(x & 1);
+        default       : return p.lo <= x && x <= p.hi;
+    }
+}
+
+// ---- AVX2 lane states ----
+
+#ifdef __AVX2__
+static inline __m256i load8(const int *p) {
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+
+// Adds the 8 ints of x to the 4 int64 lanes of acc.
+static inline __m256i add_widened(__m256i acc, __m256i x) {
+    __m256i lo = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x));
+    __m256i hi = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1));
+    return _mm256_add_epi64(acc, _mm256_add_epi64(lo, hi));
+}
+
+static inline int64_t hsum_i64(__m256i v) {
+    int64_t t[4];
+    _mm256_storeu_si256((__m256i *)t, v);
+    return t[0] + t[1] + t[2] + t[3];
+}
+
+static inline int64_t hsum_i32(__m256i v) {
+    int32_t t[8];
+    _mm256_storeu_si256((__m256i *)t, v);
+    int64_t sum = 0;
+    for (int l = 0; l < 8; ++l)
+        sum += t[l];
+    return sum;
+}
+
+// Per-lane min/max and where they were seen, relative to the start of the block.
+typedef struct {
+    __m256i min, max, argmin, argmax, index;
+} ArgLanes;
+
+static inline ArgLanes arg_lanes_init(__m256i first) {
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    return (ArgLanes){first, first, index, index, index};
+}
+
+// Strict compares: a lane keeps the first position of its min/max.
+static inline void arg_lanes_step(ArgLanes *s, __m256i x) {
+    s->index = _mm256_add_epi32(s->index, _mm256_set1_epi32(8));
+    __m256i lt = _mm256_cmpgt_epi32(s->min, x);
+    __m256i gt = _mm256_cmpgt_epi32(x, s->max);
+    s->min = _mm256_min_epi32(s->min, x);
+    s->max = _mm256_max_epi32(s->max, x);
+    s->argmin = _mm256_blendv_epi8(s->argmin, s->index, lt);
+    s->argmax = _mm256_blendv_epi8(s->argmax, s->index, gt);
+}
+
+static void arg_lanes_fold(const ArgLanes *s, size_t base, MinMax *m) {
+    int32_t min[8], max[8], argmin[8], argmax[8];
+    _mm256_storeu_si256((__m256i *)min, s->min);
+    _mm256_storeu_si256((__m256i *)max, s->max);
+    _mm256_storeu_si256((__m256i *)argmin, s->argmin);
+    _mm256_storeu_si256((__m256i *)argmax, s->argmax);
+    for (int l = 0; l < 8; ++l) {
+        take_min(m, min[l], base + (size_t)argmin[l]);
+        take_max(m, max[l], base + (size_t)argmax[l]);
+    }
+}
+
+// The max1/max2 update without branches: max2 takes the smaller of (max1, x).
+typedef struct {
+    __m256i max1, max2;
+} Top2Lanes;
+
+static inline Top2Lanes top2_lanes_init(void) {
+    return (Top2Lanes){_mm256_set1_epi32(INT_MIN), _mm256_set1_epi32(INT_MIN)};
+}
+
+static inline void top2_lanes_step(Top2Lanes *s, __m256i x) {
+    s->max2 = _mm256_max_epi32(s->max2, _mm256_min_epi32(s->max1, x));
+    s->max1 = _mm256_max_epi32(s->max1, x);
+}
+
+static void top2_lanes_fold(const Top2Lanes *s, Top2 *t) {
+    int32_t max1[8], max2[8];
+    _mm256_storeu_si256((__m256i *)max1, s->max1);
+    _mm256_storeu_si256((__m256i *)max2, s->max2);
+    for (int l = 0; l < 8; ++l) {
+        top2_add(t, max1[l]);
+        top2_add(t, max2[l]);
+    }
+}
+
+// All-ones in the lanes where the predicate holds. Inlined with a constant kind, the
+// switch disappears from the loop.
+static inline __attribute__((always_inline)) __m256i predicate_mask(Predicate p, __m256i x) {
+    __m256i odd = _mm256_srai_epi32(_mm256_slli_epi32(x, 31), 31);
+    switch (p.kind) {
+        case PRED_ODD : return odd;
+        case PRED_EVEN: return _mm256_xor_si256(odd, _mm256_set1_epi32(-1));
+        default: {
+            __m256i out = _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(p.lo), x),
+                                          _mm256_cmpgt_epi32(x, _mm256_set1_epi32(p.hi)));
+            return _mm256_xor_si256(out, _mm256_set1_epi32(-1));
+        }
+    }
+}
+
+// Masked sum in int64 lanes; the count subtracts the -1 masks in int32 lanes.
+typedef struct {
+    __m256i sum, count;
+} MaskedLanes;
+
+static inline void masked_lanes_step(MaskedLanes *s, __m256i x, __m256i mask) {
+    s->sum = add_widened(s->sum, _mm256_and_si256(x, mask));
+    s->count = _mm256_sub_epi32(s->count, mask);
+}
+#endif
+
+// ---- Kernels ----
+
+int64_t sum_i32(const int *a, size_t n) {
+    int64_t sum = 0;
+    size_t i = 0;
+#ifdef __AVX2__
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) { // two accumulators hide the latency of the adds
+        acc0 = add_widened(acc0, load8(a + i));
+        acc1 = add_widened(acc1, load8(a + i + 8));
+    }
+    sum = hsum_i64(_mm256_add_epi64(acc0, acc1));
+#endif
+    for (; i < n; ++i)
+        sum += a[i];
+    return sum;
+}
+
+MinMax minmax_i32(const int *a, size_t n) {
+    MinMax m = minmax_empty;
+    size_t i = 0;
+#ifdef __AVX2__
+    while (i + 8 <= n) {
+        size_t base = i, end = n - i > BLOCK ? i + BLOCK : n;
+        ArgLanes s = arg_lanes_init(load8(a + i));
+        for (i += 8; i + 8 <= end; i += 8)
+            arg_lanes_step(&s, load8(a + i));
+        arg_lanes_fold(&s, base, &m);
+    }
+#endif
+    for (; i < n; ++i) {
+        take_min(&m, a[i], i);
+        take_max(&m, a[i], i);
+    }
+    return m;
+}
+
+Top2 top2_i32(const int *a, size_t n) {
+    Top2 t = top2_empty;
+    size_t i = 0;
+#ifdef __AVX2__
+    Top2Lanes s = top2_lanes_init();
+    for (; i + 8 <= n; i += 8)
+        top2_lanes_step(&s, load8(a + i));
+    top2_lanes_fold(&s, &t);
+#endif
+    for (; i < n; ++i)
+        top2_add(&t, a[i]);
+    return t;
+}
+
+static inline __attribute__((always_inline)) SumCount masked_kernel(const int *a, size_t n, Predicate p) {
+    SumCount r = {0, 0};
+    size_t i = 0;
+#ifdef __AVX2__
+    while (i + 8 <= n) {
+        size_t end = n - i > BLOCK ? i + BLOCK : n;
+        MaskedLanes s = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+        for (; i + 8 <= end; i += 8) {
+            __m256i x = load8(a + i);
+            masked_lanes_step(&s, x, predicate_mask(p, x));
+        }
+        r.sum += hsum_i64(s.sum);
+        r.count += (size_t)hsum_i32(s.count);
+    }
+#endif
+    for (; i < n; ++i)
+        if (predicate_test(p, a[i])) {
+            r.sum += a[i];
+            r.count++;
+        }
+    return r;
+}
+
+SumCount masked_sum_i32(const int *a, size_t n, Predicate p) {
+    switch (p.kind) {
+        case PRED_ODD : return masked_kernel(a, n, (Predicate){PRED_ODD, 0, 0});
+        case PRED_EVEN: return masked_kernel(a, n, (Predicate){PRED_EVEN, 0, 0});
+        default       : return masked_kernel(a, n, (Predicate){PRED_RANGE, p.lo, p.hi});
+    }
+}
+
+/*
+One pass for everything: each vector feeds the sum, the min/max lanes, the top-2 lanes
+and the odd-element lanes. The loop does more arithmetic per byte than any single
+kernel, but on large arrays it is still limited by memory bandwidth, so it costs about
+as much as one of them instead of four.
+*/
+ArrayStats array_stats_i32(const int *a, size_t n) {
+    ArrayStats st = {n, 0, minmax_empty, top2_empty, {0, 0}};
+    size_t i = 0;
+#ifdef __AVX2__
+    const Predicate odd = {PRED_ODD, 0, 0};
+    __m256i sum = _mm256_setzero_si256();
+    Top2Lanes top = top2_lanes_init();
+    while (i + 8 <= n) {
+        size_t base = i, end = n - i > BLOCK ? i + BLOCK : n;
+        __m256i x = load8(a + i);
+        ArgLanes arg = arg_lanes_init(x);
+        MaskedLanes odd_lanes = {_mm256_setzero_si256(), _mm256_setzero_si256()};
+        for (;;) {
+            sum = add_widened(sum, x);
+            top2_lanes_step(&top, x);
+            masked_lanes_step(&odd_lanes, x, predicate_mask(odd, x));
+            if ((i += 8) + 8 > end)
+                break;
+            x = load8(a + i);
+            arg_lanes_step(&arg, x);
+        }
+        arg_lanes_fold(&arg, base, &st.minmax);
+        st.odd.sum += hsum_i64(odd_lanes.sum);
+        st.odd.count += (size_t)hsum_i32(odd_lanes.count);
+    }
+    st.sum = hsum_i64(sum);
+    top2_lanes_fold(&top, &st.top2);
+#endif
+    for (; i < n; ++i) {
+        st.sum += a[i];
+        take_min(&st.minmax, a[i], i);
+        take_max(&st.minmax, a[i], i);
+        top2_add(&st.top2, a[i]);
+        if (a[i] & 1) {
+            st.odd.sum += a[i];
+            st.odd.count++;
+        }
+    }
+    return st;
+}
+
+void array_stats_merge(ArrayStats *into, const ArrayStats *part, size_t offset) {
+    if (part->n == 0)
+        return;
+    into->n += part->n;
+    into->sum += part->sum;
+    take_min(&into->minmax, part->minmax.min, part->minmax.argmin + offset);
+    take_max(&into->minmax, part->minmax.max, part->minmax.argmax + offset);
+    top2_add(&into->top2, part->top2.max1);
+    top2_add(&into->top2, part->top2.max2);
+    into->odd.sum += part->odd.sum;
+    into->odd.count += part->odd.count;
+}
+
+// ---- Parallel driver ----
+
+typedef struct {
+    const int *a;
+    size_t n;
+    ArrayStats stats;
+} StatsTask;
+
+static void *stats_task(void *arg) {
+    StatsTask *t = arg;
+    t->stats = array_stats_i32(t->a, t->n);
+    return NULL;
+}
+
+ArrayStats array_stats_parallel_i32(const int *a, size_t n, int thread_count) {
+    StatsTask *tasks = thread_count > 1 ? malloc(thread_count * sizeof(*tasks)) : NULL;
+    pthread_t *threads = tasks ? malloc(thread_count * sizeof(*threads)) : NULL;
+    int *started = threads ? calloc(thread_count, sizeof(*started)) : NULL;
+    if (!started) {
+        free(tasks);
+        free(threads);
+        return array_stats_i32(a, n);
+    }
+    // chunks start at multiples of 16 ints, on cache line borders if a is 64-byte aligned
+    for (int t = 0; t < thread_count; ++t) {
+        size_t first = n * t / thread_count / 16 * 16;
+        size_t last = t + 1 == thread_count ? n : n * (t + 1) / thread_count / 16 * 16;
+        tasks[t] = (StatsTask){a + first, last - first, {0}};
+    }
+    for (int t = 1; t < thread_count; ++t)
+        started[t] = pthread_create(&threads[t], NULL, stats_task, &tasks[t]) == 0;
+    stats_task(&tasks[0]);
+    ArrayStats st = tasks[0].stats;
+    size_t offset = tasks[0].n;
+    for (int t = 1; t < thread_count; ++t) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            stats_task(&tasks[t]);
+        array_stats_merge(&st, &tasks[t].stats, offset);
+        offset += tasks[t].n;
+    }
+    free(tasks);
+    free(threads);
+    free(started);
+    return st;
+}
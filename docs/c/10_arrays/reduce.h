@@ -0,0 +1,61 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Reduction module (interface), replacing the separate scalar loops of the arrays chapter
+(sum, minimum, second largest with max1/max2, averages of odd and even elements).
+
+Every kernel reads the array once with AVX2 (8 ints per step, one accumulator per lane,
+no data-dependent branches) and has a scalar fallback. Sums are accumulated in 64 bits,
+so they do not overflow like the chapter's int sums. Indices are kept per lane in 32
+bits, so the kernels work on blocks of 2^24 elements and fold the lanes into the result
+after each block.
+  - sum_i32, minmax_i32 (with argmin/argmax), top2_i32, masked_sum_i32
+  - array_stats_i32: all of the above in one fused pass
+  - array_stats_parallel_i32: one chunk per thread, results merged at the end
+*/
+
+typedef struct {
+    int min, max;
+    size_t argmin, argmax; // first position of min/max; SIZE_MAX for an empty array
+} MinMax;
+
+typedef struct {
+    int max1, max2; // largest and second largest, duplicates counted: {5, 5} gives 5, 5
+} Top2;             // INT_MIN where the array has too few elements
+
+typedef enum { PRED_ODD, PRED_EVEN, PRED_RANGE } PredicateKind;
+
+typedef struct {
+    PredicateKind kind;
+    int lo, hi; // PRED_RANGE: lo <= x && x <= hi
+} Predicate;
+
+typedef struct {
+    int64_t sum;
+    size_t count;
+} SumCount;
+
+typedef struct {
+    size_t n;
+    int64_t sum;
+    MinMax minmax;
+    Top2 top2;
+    SumCount odd; // the even sum and count are sum - odd.sum and n - odd.count
+} ArrayStats;
+
+int64_t sum_i32(const int *a, size_t n);
+MinMax minmax_i32(const int *a, size_t n);
+Top2 top2_i32(const int *a, size_t n);
+SumCount masked_sum_i32(const int *a, size_t n, Predicate p);
+
+ArrayStats array_stats_i32(const int *a, size_t n);
+// Runs on the calling thread if threads cannot be created.
+ArrayStats array_stats_parallel_i32(const int *a, size_t n, int thread_count);
+// Combines the statistics of a[0..) and the following part, whose indices start at offset.
+void array_stats_merge(ArrayStats *into, const ArrayStats *part, size_t offset);
+
+#endif
@@ -0,0 +1,307 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sketch.h"
+#include "sort.h"
+
+/*
+Streaming summaries (implementation). Uses radix_sort_double from the sort module, so
+compile both together, e.g.:
+    gcc -O2 -march=native -pthread 7_streaming_quantiles.c sketch.c sort.c ../9_random_numbers/prng.c -o quantiles -lm
+*/
+
+// ---- Bounded heap ----
+
+int topk_init(TopK *t, size_t k) {
+    t->k = k;
+    t->size = 0;
+    t->heap = malloc((k ? k : 1) * sizeof(*t->heap));
+    return t->heap != NULL;
+}
+
+static void sift_down(double *h, size_t n, size_t root) {
+    double x = h[root];
+    for (size_t child; (child = 2 * root + 1) < n; root = child) {
+        if (child + 1 < n && h[child + 1] < h[child])
+            child++;
+        if (!(h[child] < x))
+            break;
+        h[root] = h[child];
+    }
+    h[root] = x;
+}
+
+void topk_insert(TopK *t, double x) {
+    if (t->k == 0)
+        return;
+    if (t->size < t->k) { // sift up
+        size_t i = t->size++;
+        for (; i > 0 && x < t->heap[(i - 1) / 2]; i = (i - 1) / 2)
+            t->heap[i] = t->heap[(i - 1) / 2];
+        t->heap[i] = x;
+    } else if (x > t->heap[0]) {
+        t->heap[0] = x;
+        sift_down(t->heap, t->size, 0);
+    }
+}
+
+void topk_merge(TopK *into, const TopK *other) {
+    for (size_t i = 0; i < other->size; ++i)
+        topk_push(into, other->heap[i]);
+}
+
+// Heapsort of a copy: pop the minimum to the back, so out[] ends up largest first.
+size_t topk_sorted(const TopK *t, double *out) {
+    memcpy(out, t->heap, t->size * sizeof(*out));
+    for (size_t n = t->size; n > 1; --n) {
+        double min = out[0];
+        out[0] = out[n - 1];
+        out[n - 1] = min;
+        sift_down(out, n - 1, 0);
+    }
+    return t->size;
+}
+
+void topk_free(TopK *t) {
+    free(t->heap);
+    t->heap = NULL;
+    t->size = 0;
+}
+
+// ---- Quickselect ----
+
+static inline void swap_double(double *a, double *b) {
+    double temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+/*
+Descending Hoare-style partition around the median of first/middle/last; the loop keeps
+only the side that contains position k - 1. Below 16 elements an insertion sort ends it.
+*/
+void top_k_select(double *a, size_t n, size_t k) {
+    if (k == 0 || k >= n)
+        return;
+    size_t lo = 0, hi = n - 1, target = k - 1;
+    while (hi - lo >= 16) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] > a[lo])
+            swap_double(&a[mid], &a[lo]);
+        if (a[hi] > a[lo])
+            swap_double(&a[hi], &a[lo]);
+        if (a[hi] > a[mid])
+            swap_double(&a[hi], &a[mid]);
+        double pivot = a[mid]; // a[lo] >= pivot >= a[hi]
+        size_t i = lo, j = hi;
+        for (;;) {
+            while (a[++i] > pivot)
+                ;
+            while (a[--j] < pivot)
+                ;
+            if (i >= j)
+                break;
+            swap_double(&a[i], &a[j]);
+        }
+        // a[lo..j] >= pivot >= a[j + 1..hi]
+        if (target <= j)
+            hi = j;
+        else
+            lo = j + 1;
+    }
+    for (size_t i = lo + 1; i <= hi; ++i) {
+        double x = a[i];
+        size_t m = i;
+        for (; m > lo && a[m - 1] < x; --m)
+            a[m] = a[m - 1];
+        a[m] = x;
+    }
+}
+
+// ---- Buffered top-k ----
+
+int topk_buffer_init(TopKBuffer *t, size_t k) {
+    t->k = k ? k : 1;
+    t->size = 0;
+    t->full = 0;
+    t->threshold = 0;
+    t->buf = malloc(2 * t->k * sizeof(*t->buf));
+    return t->buf != NULL;
+}
+
+void topk_buffer_compact(TopKBuffer *t) {
+    if (t->size < t->k)
+        return;
+    top_k_select(t->buf, t->size, t->k);
+    t->size = t->k;
+    t->threshold = t->buf[t->k - 1];
+    t->full = 1;
+}
+
+void topk_buffer_merge(TopKBuffer *into, const TopKBuffer *other) {
+    for (size_t i = 0; i < other->size; ++i)
+        topk_buffer_push(into, other->buf[i]);
+}
+
+size_t topk_buffer_sorted(TopKBuffer *t, double *out) {
+    topk_buffer_compact(t);
+    size_t n = t->size < t->k ? t->size : t->k;
+    memcpy(out, t->buf, n * sizeof(*out));
+    for (size_t i = 1; i < n; ++i) { // k is small compared to the stream
+        double x = out[i];
+        size_t m = i;
+        for (; m > 0 && out[m - 1] < x; --m)
+            out[m] = out[m - 1];
+        out[m] = x;
+    }
+    return n;
+}
+
+void topk_buffer_free(TopKBuffer *t) {
+    free(t->buf);
+    t->buf = NULL;
+    t->size = 0;
+}
+
+// ---- t-digest ----
+
+/*
+k1 scale: k(q) = compression / (2 pi) * asin(2q - 1). A centroid may only grow while
+it spans at most 1 unit of k, so centroids near the tails hold few samples. Adjacent
+centroids always span more than 1 unit together, so at most compression + 1 remain.
+*/
+static double k_scale(double q, double compression) {
+    return compression / (2 * M_PI) * asin(2 * q - 1);
+}
+
+static double q_limit(double k, double compression) {
+    if (k >= compression / 4) // k(1)
+        return 1;
+    return (sin(k * 2 * M_PI / compression) + 1) / 2;
+}
+
+static size_t centroid_capacity(double compression) {
+    return (size_t)ceil(compression) + 2;
+}
+
+// Greedy merge of sorted centroids, in place (out may equal in).
+static size_t compress(const Centroid *in, size_t n, double total, double compression, Centroid *out) {
+    if (n == 0)
+        return 0;
+    Centroid current = in[0];
+    double before = 0; // weight of the centroids already written
+    double limit = q_limit(k_scale(0, compression) + 1, compression) * total;
+    size_t m = 0;
+    for (size_t i = 1; i < n; ++i) {
+        if (before + current.weight + in[i].weight <= limit) {
+            double w = current.weight + in[i].weight;
+            current.mean += (in[i].mean - current.mean) * in[i].weight / w;
+            current.weight = w;
+        } else {
+            before += current.weight;
+            out[m++] = current;
+            limit = q_limit(k_scale(before / total, compression) + 1, compression) * total;
+            current = in[i];
+        }
+    }
+    out[m++] = current;
+    return m;
+}
+
+int tdigest_init(TDigest *d, double compression) {
+    size_t capacity = centroid_capacity(compression);
+    d->compression = compression;
+    d->count = 0;
+    d->buffered = 0;
+    d->buffer_capacity = 5 * capacity;
+    d->total_weight = 0;
+    d->min = INFINITY;
+    d->max = -INFINITY;
+    d->centroids = malloc(capacity * sizeof(*d->centroids));
+    d->scratch = malloc(2 * (capacity + d->buffer_capacity) * sizeof(*d->scratch));
+    d->buffer = malloc(d->buffer_capacity * sizeof(*d->buffer));
+    d->sort_tmp = malloc(d->buffer_capacity * sizeof(*d->sort_tmp));
+    if (!d->centroids || !d->scratch || !d->buffer || !d->sort_tmp) {
+        tdigest_free(d);
+        return 0;
+    }
+    return 1;
+}
+
+// Both inputs are sorted by mean; the output goes to scratch.
+static size_t merge_centroids(const Centroid *a, size_t na, const Centroid *b, size_t nb, Centroid *out) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb)
+        out[k++] = b[j].mean < a[i].mean ? b[j++] : a[i++];
+    while (i < na)
+        out[k++] = a[i++];
+    while (j < nb)
+        out[k++] = b[j++];
+    return k;
+}
+
+void tdigest_flush(TDigest *d) {
+    if (d->buffered == 0)
+        return;
+    radix_sort_double(d->buffer, d->sort_tmp, d->buffered);
+    // the sorted samples become weight-1 centroids, merged with the old ones after them
+    Centroid *samples = d->scratch;
+    for (size_t i = 0; i < d->buffered; ++i)
+        samples[i] = (Centroid){d->buffer[i], 1};
+    Centroid *merged = d->scratch + d->buffer_capacity;
+    size_t n = merge_centroids(d->centroids, d->count, samples, d->buffered, merged);
+    d->total_weight += (double)d->buffered;
+    d->count = compress(merged, n, d->total_weight, d->compression, d->centroids);
+    d->buffered = 0;
+}
+
+void tdigest_merge(TDigest *into, TDigest *other) {
+    tdigest_flush(into);
+    tdigest_flush(other);
+    size_t n = merge_centroids(into->centroids, into->count, other->centroids, other->count, into->scratch);
+    into->total_weight += other->total_weight;
+    into->count = compress(into->scratch, n, into->total_weight, into->compression, into->centroids);
+    into->min = other->min < into->min ? other->min : into->min;
+    into->max = other->max > into->max ? other->max : into->max;
+}
+
+/*
+Each centroid's mean is taken to sit at the middle of its weight; between two middles
+the value is interpolated linearly, and the first/last half-centroids are interpolated
+towards the exact min/max.
+*/
+double tdigest_quantile(TDigest *d, double q) {
+    tdigest_flush(d);
+    if (d->count == 0)
+        return NAN;
+    if (q <= 0)
+        return d->min;
+    if (q >= 1)
+        return d->max;
+    const Centroid *c = d->centroids;
+    double target = q * d->total_weight;
+    double first_mid = c[0].weight / 2;
+    if (target < first_mid)
+        return d->min + (c[0].mean - d->min) * target / first_mid;
+    double cumulative = 0;
+    for (size_t i = 0; i + 1 < d->count; ++i) {
+        double mid = cumulative + c[i].weight / 2;
+        double next_mid = cumulative + c[i].weight + c[i + 1].weight / 2;
+        if (target < next_mid)
+            return c[i].mean + (c[i + 1].mean - c[i].mean) * (target - mid) / (next_mid - mid);
+        cumulative += c[i].weight;
+    }
+    const Centroid *last = &c[d->count - 1];
+    double last_mid = d->total_weight - last->weight / 2;
+    return last->mean + (d->max - last->mean) * (target - last_mid) / (d->total_weight - last_mid);
+}
+
+void tdigest_free(TDigest *d) {
+    free(d->centroids);
+    free(d->scratch);
+    free(d->buffer);
+    free(d->sort_tmp);
+    d->centroids = d->scratch = NULL;
+    d->buffer = d->sort_tmp = NULL;
+    d->count = d->buffered = 0;
+}
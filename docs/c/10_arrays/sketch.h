@@ -0,0 +1,95 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stddef.h>
+
+/*
+Streaming summaries (interface). The chapter's second-largest search needs the whole
+array and does not extend past k = 2; these keep a bounded amount of state for a stream
+of any length, and two summaries of different streams can be merged, so every thread
+can keep its own and they are combined at the end.
+  - TopK: min-heap of the k largest values, O(log k) per value that gets in
+  - TopKBuffer: 2k buffer, cut back to the k largest with quickselect when full,
+    O(1) amortized per value; better for large k
+  - top_k_select: quickselect on an array in memory
+  - TDigest: quantile sketch (merging t-digest with the k1 scale function); clusters
+    are small near q = 0 and q = 1, so p99 and p999 stay accurate
+Values are doubles (ints convert exactly up to 2^53); NaNs are not allowed.
+*/
+
+// ---- Top-k ----
+
+typedef struct {
+    double *heap; // heap[0] is the smallest of the k largest
+    size_t k, size;
+} TopK;
+
+typedef struct {
+    double *buf;      // 2k slots
+    size_t k, size;
+    double threshold; // once k values are kept, values <= threshold cannot get in
+    int full;
+} TopKBuffer;
+
+int topk_init(TopK *t, size_t k); // returns 0 if out of memory
+void topk_insert(TopK *t, double x);
+void topk_merge(TopK *into, const TopK *other);
+size_t topk_sorted(const TopK *t, double *out); // largest first; returns the count
+void topk_free(TopK *t);
+
+// Most values of a long stream are rejected by the first compare.
+static inline void topk_push(TopK *t, double x) {
+    if (t->size < t->k || x > t->heap[0])
+        topk_insert(t, x);
+}
+
+int topk_buffer_init(TopKBuffer *t, size_t k);
+void topk_buffer_compact(TopKBuffer *t);
+void topk_buffer_merge(TopKBuffer *into, const TopKBuffer *other);
+size_t topk_buffer_sorted(TopKBuffer *t, double *out);
+void topk_buffer_free(TopKBuffer *t);
+
+static inline void topk_buffer_push(TopKBuffer *t, double x) {
+    if (t->full && !(x > t->threshold))
+        return;
+    t->buf[t->size++] = x;
+    if (t->size == 2 * t->k)
+        topk_buffer_compact(t);
+}
+
+// Reorders a so that a[0..k) are the k largest values and a[k - 1] is the k-th largest.
+void top_k_select(double *a, size_t n, size_t k);
+
+// ---- t-digest ----
+
+typedef struct {
+    double mean, weight;
+} Centroid;
+
+typedef struct {
+    double compression;     // at most compression + 1 centroids are kept; 100..500
+    Centroid *centroids;    // sorted by mean
+    size_t count;
+    Centroid *scratch;      // merge space
+    double *buffer;         // samples not merged yet
+    double *sort_tmp;
+    size_t buffered, buffer_capacity;
+    double total_weight, min, max;
+} TDigest;
+
+// All memory is allocated here; adding and merging never allocate.
+int tdigest_init(TDigest *d, double compression); // returns 0 if out of memory
+void tdigest_flush(TDigest *d);                    // merges the buffer into the centroids
+void tdigest_merge(TDigest *into, TDigest *other); // other is flushed, not changed otherwise
+double tdigest_quantile(TDigest *d, double q);     // NAN if empty
+void tdigest_free(TDigest *d);
+
+static inline void tdigest_add(TDigest *d, double x) {
+    if (d->buffered == d->buffer_capacity)
+        tdigest_flush(d);
+    d->buffer[d->buffered++] = x;
+    d->min = x < d->min ? x : d->min;
+    d->max = x > d->max ? x : d->max;
+}
+
+#endif
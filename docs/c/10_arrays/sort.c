@@ -0,0 +1,360 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "sort.h"
+
+/*
+Sorting module (implementation).
+Compile together with the program that uses it and link with -pthread, e.g.:
+    gcc -O2 -march=native -pthread 2_sorting_benchmark.c sort.c -o sort_bench
+*/
+
+#define INSERTION_CUTOFF 24
+
+// ---- Introsort, generated once per key type by a macro ----
+
+/*
+LESS(x, y) is the ordering expression. Every generated function also receives `less`;
+the native versions pass NULL and never use it, the callback version calls it.
+
+Partition (Lomuto, branchless): a[0..i) < pivot and a[i..j) >= pivot. Each element is
+swapped to position i unconditionally and i advances by the comparison result, so the
+loop has no branch that depends on the data.
+
+If the pivot equals the element just left of the range (which is <= every element in
+the range), the range is split into "== pivot" and "> pivot" instead, and the equal part
+is dropped. This keeps inputs with few distinct keys at O(n log k).
+*/
+#define DEFINE_INTROSORT(NAME, T, LESS)                                                      \
+    static void NAME##_insertion(T *a, size_t n, int (*less)(T, T)) {                      \
+        (void)less;                                                                          \
+        for (size_t i = 1; i < n; ++i) {                                                     \
+            T temp = a[i];                                                                   \
+            size_t k = i;                                                                    \
+            for (; k > 0 && LESS(temp, a[k - 1]); --k)                                       \
+                a[k] = a[k - 1];                                                             \
+            a[k] = temp;                                                                     \
+        }                                                                                    \
+    }                                                                                        \
+                                                                                             \
+    static void NAME##_sift_down(T *a, size_t root, size_t n, int (*less)(T, T)) {         \
+        (void)less;                                                                          \
+        T temp = a[root];                                                                    \
+        for (size_t child; (child = 2 * root + 1) < n; root = child) {                       \
+            if (child + 1 < n && LESS(a[child], a[child + 1]))                               \
+                child++;                                                                     \
+            if (!LESS(temp, a[child]))                                                       \
+                break;                                                                       \
+            a[root] = a[child];                                                              \
+        }                                                                                    \
+        a[root] = temp;                                                                      \
+    }                                                                                        \
+                                                                                             \
+    static void NAME##_heapsort(T *a, size_t n, int (*less)(T, T)) {                       \
+        for (size_t i = n / 2; i-- > 0;)                                                     \
+            NAME##_sift_down(a, i, n, less);                                                 \
+        for (size_t i = n - 1; i > 0; --i) {                                                 \
+            T temp = a[0];                                                                   \
+            a[0] = a[i];                                                                     \
+            a[i] = temp;                                                                     \
+            NAME##_sift_down(a, 0, i, less);                                                 \
+        }                                                                                    \
+    }                                                                                        \
+                                                                                             \
+    static void NAME##_sort3(T *a, size_t x, size_t y, size_t z, int (*less)(T, T)) {      \
+        (void)less;                                                                          \
+        T temp;                                                                              \
+        if (LESS(a[y], a[x])) { temp = a[y]; a[y] = a[x]; a[x] = temp; }                     \
+        if (LESS(a[z], a[y])) { temp = a[z]; a[z] = a[y]; a[y] = temp; }                     \
+        if (LESS(a[y], a[x])) { temp = a[y]; a[y] = a[x]; a[x] = temp; }                     \
+    }                                                                                        \
+                                                                                             \
+    /* median of the elements at n/4, n/2, 3n/4 (for large ranges the median of three  */ \
+    /* medians, Tukey's ninther); sampling away from the ends keeps sorted, reversed   */ \
+    /* and organ-pipe inputs balanced. The pivot is moved to a[n - 1].                 */ \
+    static void NAME##_pivot_to_end(T *a, size_t n, int (*less)(T, T)) {                   \
+        size_t q1 = n / 4, m = n / 2, q3 = n - n / 4;                                        \
+        if (n > 128) {                                                                       \
+            NAME##_sort3(a, q1 - 1, q1, q1 + 1, less);                                       \
+            NAME##_sort3(a, m - 1, m, m + 1, less);                                          \
+            NAME##_sort3(a, q3 - 1, q3, q3 + 1, less);                                       \
+        }                                                                                    \
+        NAME##_sort3(a, q1, m, q3, less);                                                    \
+        T temp = a[m];                                                                       \
+        a[m] = a[n - 1];                                                                     \
+        a[n - 1] = temp;                                                                     \
+    }                                                                                        \
+                                                                                             \
+    static void NAME##_loop(T *a, size_t n, int depth, const T *pred, int (*less)(T, T)) { \
+        (void)less;                                                                          \
+        while (n > INSERTION_CUTOFF) {                                                       \
+            if (depth-- == 0) {                                                              \
+                NAME##_heapsort(a, n, less);                                                 \
+                return;                                                                      \
+            }                                                                                \
+            NAME##_pivot_to_end(a, n, less);                                                \
+            T pivot = a[n - 1];                                                              \
+            size_t i = 0;                                                                    \
+            if (pred && !LESS(*pred, pivot)) {                                               \
+                for (size_t j = 0; j < n - 1; ++j) {                                         \
+                    T t = a[j];                                                              \
+                    a[j] = a[i];                                                             \
+                    a[i] = t;                                                                \
+                    i += !LESS(pivot, t);                                                    \
+                }                                                                            \
+                a[n - 1] = a[i];                                                             \
+                a[i] = pivot;                                                                \
+                a += i + 1; /* a[0..i] are all equal to the pivot */                         \
+                n -= i + 1;                                                                  \
+                continue;                                                                    \
+            }                                                                                \
+            for (size_t j = 0; j < n - 1; ++j) {                                             \
+                T t = a[j];                                                                  \
+                a[j] = a[i];                                                                 \
+                a[i] = t;                                                                    \
+                i += LESS(t, pivot);                                                         \
+            }                                                                                \
+            a[n - 1] = a[i];                                                                 \
+            a[i] = pivot;                                                                    \
+            /* recurse into the smaller side, loop on the larger: O(log n) stack */          \
+            if (i < n - 1 - i) {                                                             \
+                NAME##_loop(a, i, depth, pred, less);                                        \
+                pred = &a[i];                                                                \
+                a += i + 1;                                                                  \
+                n -= i + 1;                                                                  \
+            } else {                                                                         \
+                NAME##_loop(a + i + 1, n - i - 1, depth, &a[i], less);                       \
+                n = i;                                                                       \
+            }                                                                                \
+        }                                                                                    \
+        NAME##_insertion(a, n, less);                                                        \
+    }                                                                                        \
+                                                                                             \
+    static void NAME(T *a, size_t n, int (*less)(T, T)) {                                  \
+        int depth = 0;                                                                       \
+        for (size_t m = n; m > 1; m >>= 1)                                                   \
+            depth += 2;                                                                      \
+        NAME##_loop(a, n, depth, NULL, less);                                                \
+    }
+
+#define NATIVE_LESS(x, y) ((x) < (y))
+#define CALLBACK_LESS(x, y) (less((x), (y)) != 0)
+
+DEFINE_INTROSORT(introsort_int, int, NATIVE_LESS)
+DEFINE_INTROSORT(introsort_i64, int64_t, NATIVE_LESS)
+DEFINE_INTROSORT(introsort_int_by, int, CALLBACK_LESS)
+
+void sort_int(int *a, size_t n) {
+    introsort_int(a, n, NULL);
+}
+
+void sort_i64(int64_t *a, size_t n) {
+    introsort_i64(a, n, NULL);
+}
+
+void sort_int_by(int *a, size_t n, IntLess less) {
+    introsort_int_by(a, n, less);
+}
+
+// ---- LSD radix sort ----
+
+/*
+All histograms are counted in one read of the input. A pass whose digit is the same for
+every key (common for small values in wide keys) is skipped. Each remaining pass is a
+stable scatter from one buffer into the other; if the number of passes is odd the
+result is copied back into a at the end. The elements are moved as they are; KEY maps
+each one to an unsigned key of type U with the same order, computed again on every pass.
+*/
+#define DEFINE_RADIX_SORT(NAME, T, U, KEY)                                                   \
+    static void NAME(T *a, T *tmp, size_t n) {                                               \
+        enum { BYTES = sizeof(U) };                                                          \
+        size_t count[BYTES][256];                                                            \
+        memset(count, 0, sizeof(count));                                                     \
+        for (size_t i = 0; i < n; ++i) {                                                     \
+            U key = KEY(a[i]);                                                               \
+            for (int b = 0; b < BYTES; ++b)                                                  \
+                count[b][(key >> (8 * b)) & 0xFF]++;                                         \
+        }                                                                                    \
+        T *src = a, *dst = tmp;                                                              \
+        for (int b = 0; b < BYTES; ++b) {                                                    \
+            size_t *c = count[b];                                                            \
+            if (n == 0 || c[(KEY(a[0]) >> (8 * b)) & 0xFF] == n)                             \
+                continue;                                                                    \
+            size_t sum = 0;                                                                  \
+            for (int d = 0; d < 256; ++d) {                                                  \
+                size_t temp = c[d];                                                          \
+                c[d] = sum;                                                                  \
+                sum += temp;                                                                 \
+            }                                                                                \
+            for (size_t i = 0; i < n; ++i)                                                   \
+                dst[c[(KEY(src[i]) >> (8 * b)) & 0xFF]++] = src[i];                          \
+            T *temp = src;                                                                   \
+            src = dst;                                                                       \
+            dst = temp;                                                                      \
+        }                                                                                    \
+        if (src != a)                                                                        \
+            memcpy(a, src, n * sizeof(T));                                                   \
+    }
+
+/*
+Order-preserving keys:
+  signed: flip the sign bit, so INT_MIN -> 0 and INT_MAX -> UINT_MAX
+  float:  positive values flip the sign bit; negative values flip every bit, which also
+          reverses their order (a larger magnitude must sort first)
+The bits of a float are read with memcpy, which compiles to a register move.
+*/
+static inline uint32_t u32_key(uint32_t x) {
+    return x;
+}
+
+static inline uint64_t u64_key(uint64_t x) {
+    return x;
+}
+
+static inline uint32_t i32_key(int32_t x) {
+    return (uint32_t)x ^ 0x80000000u;
+}
+
+static inline uint64_t i64_key(int64_t x) {
+    return (uint64_t)x ^ 0x8000000000000000ULL;
+}
+
+static inline uint32_t float_key(float x) {
+    uint32_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u ^ ((uint32_t)((int32_t)u >> 31) | 0x80000000u);
+}
+
+static inline uint64_t double_key(double x) {
+    uint64_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u ^ ((uint64_t)((int64_t)u >> 63) | 0x8000000000000000ULL);
+}
+
+DEFINE_RADIX_SORT(radix_u32, uint32_t, uint32_t, u32_key)
+DEFINE_RADIX_SORT(radix_u64, uint64_t, uint64_t, u64_key)
+DEFINE_RADIX_SORT(radix_i32, int32_t, uint32_t, i32_key)
+DEFINE_RADIX_SORT(radix_i64, int64_t, uint64_t, i64_key)
+DEFINE_RADIX_SORT(radix_float, float, uint32_t, float_key)
+DEFINE_RADIX_SORT(radix_double, double, uint64_t, double_key)
+
+void radix_sort_u32(uint32_t *a, uint32_t *tmp, size_t n) {
+    radix_u32(a, tmp, n);
+}
+
+void radix_sort_u64(uint64_t *a, uint64_t *tmp, size_t n) {
+    radix_u64(a, tmp, n);
+}
+
+void radix_sort_i32(int32_t *a, int32_t *tmp, size_t n) {
+    radix_i32(a, tmp, n);
+}
+
+void radix_sort_i64(int64_t *a, int64_t *tmp, size_t n) {
+    radix_i64(a, tmp, n);
+}
+
+void radix_sort_float(float *a, float *tmp, size_t n) {
+    radix_float(a, tmp, n);
+}
+
+void radix_sort_double(double *a, double *tmp, size_t n) {
+    radix_double(a, tmp, n);
+}
+
+// ---- Parallel merge sort ----
+
+typedef struct {
+    int *src, *dst;
+    size_t begin, mid, end; // sort: [begin, end); merge: [begin, mid) + [mid, end)
+} MergeTask;
+
+static void *sort_chunk(void *arg) {
+    MergeTask *t = arg;
+    sort_int(t->src + t->begin, t->end - t->begin);
+    return NULL;
+}
+
+static void *merge_chunks(void *arg) {
+    MergeTask *t = arg;
+    const int *a = t->src + t->begin, *a_end = t->src + t->mid;
+    const int *b = t->src + t->mid, *b_end = t->src + t->end;
+    int *out = t->dst + t->begin;
+    while (a < a_end && b < b_end) {
+        int take_b = *b < *a; // stable: ties come from the left run
+        *out++ = take_b ? *b : *a;
+        b += take_b;
+        a += !take_b;
+    }
+    memcpy(out, a, (a_end - a) * sizeof(int));
+    out += a_end - a;
+    memcpy(out, b, (b_end - b) * sizeof(int));
+    return NULL;
+}
+
+int parallel_merge_sort_int(int *a, size_t n, int thread_count) {
+    if (thread_count < 2 || n < 2 * (size_t)thread_count) {
+        sort_int(a, n);
+        return 1;
+    }
+    int *tmp = malloc(n * sizeof(*tmp));
+    size_t *bounds = malloc((thread_count + 1) * sizeof(*bounds));
+    MergeTask *tasks = malloc(thread_count * sizeof(*tasks));
+    pthread_t *threads = malloc(thread_count * sizeof(*threads));
+    unsigned char *started = malloc(thread_count);
+    if (!tmp || !bounds || !tasks || !threads || !started) {
+        free(tmp);
+        free(bounds);
+        free(tasks);
+        free(threads);
+        free(started);
+        return 0;
+    }
+
+    int runs = thread_count;
+    for (int i = 0; i <= runs; ++i)
+        bounds[i] = n * i / runs;
+    for (int i = 0; i < runs; ++i) {
+        tasks[i] = (MergeTask){a, NULL, bounds[i], 0, bounds[i + 1]};
+        // A chunk whose thread cannot be created is sorted here instead.
+        started[i] = pthread_create(&threads[i], NULL, sort_chunk, &tasks[i]) == 0;
+        if (!started[i])
+            sort_chunk(&tasks[i]);
+    }
+    for (int i = 0; i < runs; ++i)
+        if (started[i])
+            pthread_join(threads[i], NULL);
+
+    // Each round halves the number of runs; an odd last run is copied through unchanged.
+    int *src = a, *dst = tmp;
+    while (runs > 1) {
+        int merges = runs / 2;
+        for (int i = 0; i < merges; ++i) {
+            tasks[i] = (MergeTask){src, dst, bounds[2 * i], bounds[2 * i + 1], bounds[2 * i + 2]};
+            started[i] = pthread_create(&threads[i], NULL, merge_chunks, &tasks[i]) == 0;
+            if (!started[i])
+                merge_chunks(&tasks[i]);
+        }
+        if (runs & 1)
+            memcpy(dst + bounds[runs - 1], src + bounds[runs - 1], (n - bounds[runs - 1]) * sizeof(int));
+        for (int i = 0; i < merges; ++i)
+            if (started[i])
+                pthread_join(threads[i], NULL);
+        for (int i = 0; i <= merges; ++i)
+            bounds[i] = bounds[2 * i < runs ? 2 * i : runs];
+        bounds[(runs + 1) / 2] = n;
+        runs = (runs + 1) / 2;
+        int *temp = src;
+        src = dst;
+        dst = temp;
+    }
+    if (src != a)
+        memcpy(a, src, n * sizeof(int));
+
+    free(tmp);
+    free(bounds);
+    free(tasks);
+    free(threads);
+    free(started);
+    return 1;
+}
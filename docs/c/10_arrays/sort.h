@@ -0,0 +1,36 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Sorting module (interface), replacing the O(n^2) bubble, insertion and selection sorts
+of the arrays chapter.
+  - sort_*: introsort (quicksort + heapsort fallback + insertion sort for small ranges)
+    with a branchless partition loop; equal keys are grouped so few-unique inputs stay fast
+  - sort_int_by: the same introsort with a caller-supplied "less" function, e.g. the
+    chapter's "odd values first, then evens, both ascending" ordering
+  - radix_sort_*: LSD radix sort, 8 bits per pass, needs a scratch buffer of n elements;
+    signed and floating keys are mapped to unsigned keys with the same order
+  - parallel_merge_sort_int: sorts thread_count chunks in parallel, then merges them
+    pairwise, also in parallel
+*/
+
+typedef int (*IntLess)(int a, int b); // nonzero if a must come before b
+
+void sort_int(int *a, size_t n);
+void sort_i64(int64_t *a, size_t n);
+void sort_int_by(int *a, size_t n, IntLess less);
+
+void radix_sort_u32(uint32_t *a, uint32_t *tmp, size_t n);
+void radix_sort_i32(int32_t *a, int32_t *tmp, size_t n);
+void radix_sort_u64(uint64_t *a, uint64_t *tmp, size_t n);
+void radix_sort_i64(int64_t *a, int64_t *tmp, size_t n);
+void radix_sort_float(float *a, float *tmp, size_t n);   // NaNs are placed by their bits
+void radix_sort_double(double *a, double *tmp, size_t n);
+
+// Returns 0 if the scratch buffer could not be allocated (a is left unchanged).
+int parallel_merge_sort_int(int *a, size_t n, int thread_count);
+
+#endif
@@ -0,0 +1,445 @@
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "transform.h"
+
+/*
+In-place array transforms (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 8_array_transforms.c transform.c -o transforms
+*/
+
+#define ROTATE_BUFFER 4096 // bytes on the stack for the short side of a rotation
+
+#if defined(__AVX512VBMI2__) && defined(__AVX512VBMI__) && defined(__AVX512BW__)
+#define COMPRESS_BYTES_512
+#elif defined(__SSSE3__)
+#define COMPRESS_BYTES_TABLE
+#endif
+#if defined(__AVX2__) && !defined(__AVX512F__)
+#define COMPRESS_INTS_TABLE
+#endif
+
+#if defined(COMPRESS_BYTES_TABLE) || defined(COMPRESS_INTS_TABLE)
+// Byte k of compress_table[m] is the position of the k-th set bit of m; the rest are 0.
+static const uint64_t compress_table[256] = {
+    0x0000000000000000, 0x0000000000000000, 0x0000000000000001, 0x0000000000000100,
+    0x0000000000000002, 0x0000000000000200, 0x0000000000000201, 0x0000000000020100,
+    0x0000000000000003, 0x0000000000000300, 0x0000000000000301, 0x0000000000030100,
+    0x0000000000000302, 0x0000000000030200, 0x0000000000030201, 0x0000000003020100,
+    0x0000000000000004, 0x0000000000000400, 0x0000000000000401, 0x0000000000040100,
+    0x0000000000000402, 0x0000000000040200, 0x0000000000040201, 0x0000000004020100,
+    0x0000000000000403, 0x0000000000040300, 0x0000000000040301, 0x0000000004030100,
+    0x0000000000040302, 0x0000000004030200, 0x0000000004030201, 0x0000000403020100,
+    0x0000000000000005, 0x0000000000000500, 0x0000000000000501, 0x0000000000050100,
+    0x0000000000000502, 0x0000000000050200, 0x0000000000050201, 0x0000000005020100,
+    0x0000000000000503, 0x0000000000050300, 0x0000000000050301, 0x0000000005030100,
+    0x0000000000050302, 0x0000000005030200, 0x0000000005030201, 0x0000000503020100,
+    0x0000000000000504, 0x0000000000050400, 0x0000000000050401, 0x0000000005040100,
+    0x0000000000050402, 0x0000000005040200, 0x0000000005040201, 0x0000000504020100,
+    0x0000000000050403, 0x0000000005040300, 0x0000000005040301, 0x0000000504030100,
+    0x0000000005040302, 0x0000000504030200, 0x0000000504030201, 0x0000050403020100,
+    0x0000000000000006, 0x0000000000000600, 0x0000000000000601, 0x0000000000060100,
+    0x0000000000000602, 0x0000000000060200, 0x0000000000060201, 0x0000000006020100,
+    0x0000000000000603, 0x0000000000060300, 0x0000000000060301, 0x0000000006030100,
+    0x0000000000060302, 0x0000000006030200, 0x0000000006030201, 0x0000000603020100,
+    0x0000000000000604, 0x0000000000060400, 0x0000000000060401, 0x0000000006040100,
+    0x0000000000060402, 0x0000000006040200, 0x0000000006040201, 0x0000000604020100,
+    0x0000000000060403, 0x0000000006040300, 0x0000000006040301, 0x0000000604030100,
+    0x0000000006040302, 0x0000000604030200, 0x0000000604030201, 0x0000060403020100,
+    0x0000000000000605, 0x0000000000060500, 0x0000000000060501, 0x0000000006050100,
+    0x0000000000060502, 0x0000000006050200, 0x0000000006050201, 0x0000000605020100,
+    0x0000000000060503, 0x0000000006050300, 0x0000000006050301, 0x0000000605030100,
+    0x0000000006050302, 0x0000000605030200, 0x0000000605030201, 0x0000060503020100,
+    0x0000000000060504, 0x0000000006050400, 0x0000000006050401, 0x0000000605040100,
+    0x0000000006050402, 0x0000000605040200, 0x0000000605040201, 0x0000060504020100,
+    0x0000000006050403, 0x0000000605040300, 0x0000000605040301, 0x0000060504030100,
+    0x0000000605040302, 0x0000060504030200, 0x0000060504030201, 0x0006050403020100,
+    0x0000000000000007, 0x0000000000000700, 0x0000000000000701, 0x0000000000070100,
+    0x0000000000000702, 0x0000000000070200, 0x0000000000070201, 0x0000000007020100,
+    0x0000000000000703, 0x0000000000070300, 0x0000000000070301, 0x0000000007030100,
+    0x0000000000070302, 0x0000000007030200, 0x0000000007030201, 0x0000000703020100,
+    0x0000000000000704, 0x0000000000070400, 0x0000000000070401, 0x0000000007040100,
+    0x0000000000070402, 0x0000000007040200, 0x0000000007040201, 0x0000000704020100,
+    0x0000000000070403, 0x0000000007040300, 0x0000000007040301, 0x0000000704030100,
+    0x0000000007040302, 0x0000000704030200, 0x0000000704030201, 0x0000070403020100,
+    0x0000000000000705, 0x0000000000070500, 0x0000000000070501, 0x0000000007050100,
+    0x0000000000070502, 0x0000000007050200, 0x0000000007050201, 0x0000000705020100,
+    0x0000000000070503, 0x0000000007050300, 0x0000000007050301, 0x0000000705030100,
+    0x0000000007050302, 0x0000000705030200, 0x0000000705030201, 0x0000070503020100,
+    0x0000000000070504, 0x0000000007050400, 0x0000000007050401, 0x0000000705040100,
+    0x0000000007050402, 0x0000000705040200, 0x0000000705040201, 0x0000070504020100,
+    0x0000000007050403, 0x0000000705040300, 0x0000000705040301, 0x0000070504030100,
+    0x0000000705040302, 0x0000070504030200, 0x0000070504030201, 0x0007050403020100,
+    0x0000000000000706, 0x0000000000070600, 0x0000000000070601, 0x0000000007060100,
+    0x0000000000070602, 0x0000000007060200, 0x0000000007060201, 0x0000000706020100,
+    0x0000000000070603, 0x0000000007060300, 0x0000000007060301, 0x0000000706030100,
+    0x0000000007060302, 0x0000000706030200, 0x0000000706030201, 0x0000070603020100,
+    0x0000000000070604, 0x0000000007060400, 0x0000000007060401, 0x0000000706040100,
+    0x0000000007060402, 0x0000000706040200, 0x0000000706040201, 0x0000070604020100,
+    0x0000000007060403, 0x0000000706040300, 0x0000000706040301, 0x0000070604030100,
+    0x0000000706040302, 0x0000070604030200, 0x0000070604030201, 0x0007060403020100,
+    0x0000000000070605, 0x0000000007060500, 0x0000000007060501, 0x0000000706050100,
+    0x0000000007060502, 0x0000000706050200, 0x0000000706050201, 0x0000070605020100,
+    0x0000000007060503, 0x0000000706050300, 0x0000000706050301, 0x0000070605030100,
+    0x0000000706050302, 0x0000070605030200, 0x0000070605030201, 0x0007060503020100,
+    0x0000000007060504, 0x0000000706050400, 0x0000000706050401, 0x0000070605040100,
+    0x0000000706050402, 0x0000070605040200, 0x0000070605040201, 0x0007060504020100,
+    0x0000000706050403, 0x0000070605040300, 0x0000070605040301, 0x0007060504030100,
+    0x0000070605040302, 0x0007060504030200, 0x0007060504030201, 0x0706050403020100,
+};
+#endif
+
+// ---- Reverse ----
+
+void reverse_u8(unsigned char *a, size_t n) {
+    size_t i = 0, j = n; // a[i..j) is still to be reversed
+#ifdef __AVX2__
+    const __m256i mirror = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                            15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for (; j - i >= 64; i += 32, j -= 32) {
+        __m256i front = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i back = _mm256_loadu_si256((const __m256i *)(a + j - 32));
+        // pshufb reverses each 16-byte half, the permute swaps the halves
+        front = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(front, mirror), 0x4E);
+        back = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(back, mirror), 0x4E);
+        _mm256_storeu_si256((__m256i *)(a + i), back);
+        _mm256_storeu_si256((__m256i *)(a + j - 32), front);
+    }
+#endif
+#ifdef __SSSE3__
+    const __m128i mirror16 = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for (; j - i >= 32; i += 16, j -= 16) {
+        __m128i front = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i back = _mm_loadu_si128((const __m128i *)(a + j - 16));
+        _mm_storeu_si128((__m128i *)(a + i), _mm_shuffle_epi8(back, mirror16));
+        _mm_storeu_si128((__m128i *)(a + j - 16), _mm_shuffle_epi8(front, mirror16));
+    }
+#endif
+    for (; j - i >= 2; ++i, --j) {
+        unsigned char temp = a[i];
+        a[i] = a[j - 1];
+        a[j - 1] = temp;
+    }
+}
+
+void reverse_i32(int *a, size_t n) {
+    size_t i = 0, j = n;
+#ifdef __AVX2__
+    const __m256i mirror = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    for (; j - i >= 16; i += 8, j -= 8) {
+        __m256i front = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i back = _mm256_loadu_si256((const __m256i *)(a + j - 8));
+        _mm256_storeu_si256((__m256i *)(a + i), _mm256_permutevar8x32_epi32(back, mirror));
+        _mm256_storeu_si256((__m256i *)(a + j - 8), _mm256_permutevar8x32_epi32(front, mirror));
+    }
+#endif
+#ifdef __SSE2__
+    for (; j - i >= 8; i += 4, j -= 4) {
+        __m128i front = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i back = _mm_loadu_si128((const __m128i *)(a + j - 4));
+        _mm_storeu_si128((__m128i *)(a + i), _mm_shuffle_epi32(back, 0x1B));
+        _mm_storeu_si128((__m128i *)(a + j - 4), _mm_shuffle_epi32(front, 0x1B));
+    }
+#endif
+    for (; j - i >= 2; ++i, --j) {
+        int temp = a[i];
+        a[i] = a[j - 1];
+        a[j - 1] = temp;
+    }
+}
+
+// ---- Rotate ----
+
+// a holds left_bytes followed by right_bytes; swaps the two parts if the shorter one
+// fits in the buffer. Returns 0 if it does not.
+static int rotate_buffered(unsigned char *a, size_t left_bytes, size_t right_bytes) {
+    unsigned char buffer[ROTATE_BUFFER];
+    if (left_bytes <= ROTATE_BUFFER) {
+        memcpy(buffer, a, left_bytes);
+        memmove(a, a + left_bytes, right_bytes);
+        memcpy(a + right_bytes, buffer, left_bytes);
+    } else if (right_bytes <= ROTATE_BUFFER) {
+        memcpy(buffer, a + left_bytes, right_bytes);
+        memmove(a + right_bytes, a, left_bytes);
+        memcpy(a, buffer, right_bytes);
+    } else
+        return 0;
+    return 1;
+}
+
+void rotate_left_u8(unsigned char *a, size_t n, size_t k) {
+    if (n == 0 || (k %= n) == 0)
+        return;
+    if (rotate_buffered(a, k, n - k))
+        return;
+    reverse_u8(a, k);
+    reverse_u8(a + k, n - k);
+    reverse_u8(a, n);
+}
+
+void rotate_left_i32(int *a, size_t n, size_t k) {
+    if (n == 0 || (k %= n) == 0)
+        return;
+    if (rotate_buffered((unsigned char *)a, k * sizeof(*a), (n - k) * sizeof(*a)))
+        return;
+    reverse_i32(a, k);
+    reverse_i32(a + k, n - k);
+    reverse_i32(a, n);
+}
+
+// ---- Prefix sums ----
+
+#ifdef __AVX2__
+// Inclusive scan of the 8 lanes: two shifted adds per 16-byte half, then the last lane
+// of the lower half is added to the upper half.
+static inline __m256i scan8(__m256i x) {
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    __m256i low_total = _mm256_shuffle_epi32(x, 0xFF);
+    return _mm256_add_epi32(x, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+}
+#elif defined(__SSE2__)
+static inline __m128i scan4(__m128i x) {
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    return _mm_add_epi32(x, _mm_slli_si128(x, 8));
+}
+#endif
+
+// The sums are kept unsigned so that overflow wraps instead of being undefined.
+void prefix_sum_i32(int *dst, const int *src, size_t n) {
+    size_t i = 0;
+    uint32_t sum = 0;
+#ifdef __AVX2__
+    const __m256i last = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_add_epi32(scan8(_mm256_loadu_si256((const __m256i *)(src + i))), carry);
+        _mm256_storeu_si256((__m256i *)(dst + i), x);
+        carry = _mm256_permutevar8x32_epi32(x, last);
+    }
+    sum = (uint32_t)_mm256_cvtsi256_si32(carry);
+#elif defined(__SSE2__)
+    __m128i carry = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_add_epi32(scan4(_mm_loadu_si128((const __m128i *)(src + i))), carry);
+        _mm_storeu_si128((__m128i *)(dst + i), x);
+        carry = _mm_shuffle_epi32(x, 0xFF);
+    }
+    sum = (uint32_t)_mm_cvtsi128_si32(carry);
+#endif
+    for (; i < n; ++i) {
+        sum += (uint32_t)src[i];
+        dst[i] = (int)sum;
+    }
+}
+
+int exclusive_prefix_sum_i32(int *dst, const int *src, size_t n) {
+    size_t i = 0;
+    uint32_t sum = 0;
+#ifdef __AVX2__
+    const __m256i last = _mm256_set1_epi32(7);
+    __m256i carry = _mm256_setzero_si256();
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i inclusive = _mm256_add_epi32(scan8(x), carry);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_sub_epi32(inclusive, x));
+        carry = _mm256_permutevar8x32_epi32(inclusive, last);
+    }
+    sum = (uint32_t)_mm256_cvtsi256_si32(carry);
+#elif defined(__SSE2__)
+    __m128i carry = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i inclusive = _mm_add_epi32(scan4(x), carry);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_sub_epi32(inclusive, x));
+        carry = _mm_shuffle_epi32(inclusive, 0xFF);
+    }
+    sum = (uint32_t)_mm_cvtsi128_si32(carry);
+#endif
+    for (; i < n; ++i) {
+        uint32_t x = (uint32_t)src[i]; // read before dst[i] is written when dst == src
+        dst[i] = (int)sum;
+        sum += x;
+    }
+    return (int)sum;
+}
+
+// ---- Stream compaction ----
+
+/*
+Every kernel loads a vector, turns the predicate into a bit mask and writes the kept
+elements packed at dst + w, advancing w by the popcount. A full vector is always stored;
+the lanes past the kept ones are overwritten by the next store. Since w <= i, the store
+only covers elements that were already loaded, so dst == src is safe.
+*/
+
+#ifdef COMPRESS_BYTES_TABLE
+// Packs the bytes of x selected by the 16-bit mask m to dst; each 8-byte half is
+// shuffled with its table entry and stored right after the previous one.
+static inline size_t compress16_u8(unsigned char *dst, __m128i x, unsigned m) {
+    unsigned low = m & 0xFF, high = m >> 8;
+    __m128i shuffle = _mm_set_epi64x((long long)(compress_table[high] + 0x0808080808080808ULL),
+                                     (long long)compress_table[low]);
+    __m128i packed = _mm_shuffle_epi8(x, shuffle);
+    size_t low_count = (size_t)__builtin_popcount(low);
+    _mm_storel_epi64((__m128i *)dst, packed);
+    _mm_storel_epi64((__m128i *)(dst + low_count), _mm_unpackhi_epi64(packed, packed));
+    return low_count + (size_t)__builtin_popcount(high);
+}
+#endif
+
+#ifdef COMPRESS_INTS_TABLE
+static inline size_t compress8_i32(int *dst, __m256i x, unsigned m) {
+    __m256i shuffle = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)compress_table[m]));
+    _mm256_storeu_si256((__m256i *)dst, _mm256_permutevar8x32_epi32(x, shuffle));
+    return (size_t)__builtin_popcount(m);
+}
+#endif
+
+size_t filter_range_u8(unsigned char *dst, const unsigned char *src, size_t n, unsigned char lo,
+                       unsigned char hi, int keep) {
+    if (lo > hi) { // empty range
+        if (keep)
+            return 0;
+        memmove(dst, src, n);
+        return n;
+    }
+    keep = keep != 0;
+    unsigned char span = (unsigned char)(hi - lo); // lo <= x <= hi  <=>  (unsigned)(x - lo) <= span
+    size_t i = 0, w = 0;
+#ifdef COMPRESS_BYTES_512
+    const __m512i vlo = _mm512_set1_epi8((char)lo), vspan = _mm512_set1_epi8((char)span);
+    for (; i + 64 <= n; i += 64) {
+        __m512i x = _mm512_loadu_si512(src + i);
+        __mmask64 inside = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, vlo), vspan);
+        __mmask64 m = keep ? inside : ~inside;
+        _mm512_storeu_si512(dst + w, _mm512_maskz_compress_epi8(m, x));
+        w += (size_t)__builtin_popcountll(m);
+    }
+#elif defined(__SSSE3__)
+    const __m128i vlo = _mm_set1_epi8((char)lo), vspan = _mm_set1_epi8((char)span);
+    const unsigned flip = keep ? 0 : 0xFFFF;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_sub_epi8(x, vlo);
+        __m128i inside = _mm_cmpeq_epi8(_mm_min_epu8(d, vspan), d);
+        w += compress16_u8(dst + w, x, (unsigned)_mm_movemask_epi8(inside) ^ flip);
+    }
+#endif
+    for (; i < n; ++i) {
+        unsigned char x = src[i];
+        dst[w] = x;
+        w += ((unsigned char)(x - lo) <= span) == keep;
+    }
+    return w;
+}
+
+size_t filter_range_i32(int *dst, const int *src, size_t n, int lo, int hi, int keep) {
+    keep = keep != 0;
+    size_t i = 0, w = 0;
+#ifdef __AVX512F__
+    const __m512i vlo = _mm512_set1_epi32(lo), vhi = _mm512_set1_epi32(hi);
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512(src + i);
+        __mmask16 inside = _mm512_cmpge_epi32_mask(x, vlo) & _mm512_cmple_epi32_mask(x, vhi);
+        __mmask16 m = keep ? inside : (__mmask16)~inside;
+        _mm512_storeu_si512(dst + w, _mm512_maskz_compress_epi32(m, x));
+        w += (size_t)__builtin_popcount(m);
+    }
+#elif defined(__AVX2__)
+    const __m256i vlo = _mm256_set1_epi32(lo), vhi = _mm256_set1_epi32(hi);
+    const unsigned flip = keep ? 0xFF : 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(vlo, x), _mm256_cmpgt_epi32(x, vhi));
+        unsigned m = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(outside)) ^ flip;
+        w += compress8_i32(dst + w, x, m);
+    }
+#endif
+    for (; i < n; ++i) {
+        int x = src[i];
+        dst[w] = x;
+        w += (lo <= x && x <= hi) == keep;
+    }
+    return w;
+}
+
+size_t squeeze_u8(unsigned char *dst, const unsigned char *src, size_t n) {
+    if (n == 0)
+        return 0;
+    size_t i = 0, w = 0;
+    unsigned char prev = (unsigned char)~src[0]; // differs from src[0], which is always kept
+#ifdef COMPRESS_BYTES_512
+    // the previous byte of every lane; lane 0 takes the last byte of the previous vector,
+    // because with dst == src that byte may already be overwritten in memory
+    const __m512i shift = _mm512_set_epi8(62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49, 48, 47,
+                                          46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33, 32, 31,
+                                          30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15,
+                                          14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 127);
+    __m512i last = _mm512_set1_epi8((char)prev);
+    for (; i + 64 <= n; i += 64) {
+        __m512i x = _mm512_loadu_si512(src + i);
+        prev = src[i + 63];
+        __mmask64 m = _mm512_cmpneq_epi8_mask(x, _mm512_permutex2var_epi8(x, shift, last));
+        last = x;
+        _mm512_storeu_si512(dst + w, _mm512_maskz_compress_epi8(m, x));
+        w += (size_t)__builtin_popcountll(m);
+    }
+#elif defined(__SSSE3__)
+    __m128i last = _mm_set1_epi8((char)prev);
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        prev = src[i + 15];
+        __m128i equal = _mm_cmpeq_epi8(x, _mm_alignr_epi8(x, last, 15));
+        last = x;
+        w += compress16_u8(dst + w, x, (unsigned)_mm_movemask_epi8(equal) ^ 0xFFFF);
+    }
+#endif
+    for (; i < n; ++i) {
+        unsigned char x = src[i];
+        dst[w] = x;
+        w += x != prev;
+        prev = x;
+    }
+    return w;
+}
+
+size_t squeeze_i32(int *dst, const int *src, size_t n) {
+    if (n == 0)
+        return 0;
+    size_t i = 0, w = 0;
+    int prev = ~src[0];
+#ifdef __AVX512F__
+    __m512i last = _mm512_set1_epi32(prev);
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512(src + i);
+        prev = src[i + 15];
+        __mmask16 m = _mm512_cmpneq_epi32_mask(x, _mm512_alignr_epi32(x, last, 15));
+        last = x;
+        _mm512_storeu_si512(dst + w, _mm512_maskz_compress_epi32(m, x));
+        w += (size_t)__builtin_popcount(m);
+    }
+#elif defined(__AVX2__)
+    __m256i last = _mm256_set1_epi32(prev);
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        prev = src[i + 7];
+        // [last[7], x[0..6]]: alignr works per 16-byte half, so its lower input is
+        // [upper half of last, lower half of x]
+        __m256i shifted = _mm256_alignr_epi8(x, _mm256_permute2x128_si256(last, x, 0x21), 12);
+        __m256i equal = _mm256_cmpeq_epi32(x, shifted);
+        last = x;
+        w += compress8_i32(dst + w, x, (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(equal)) ^ 0xFF);
+    }
+#endif
+    for (; i < n; ++i) {
+        int x = src[i];
+        dst[w] = x;
+        w += x != prev;
+        prev = x;
+    }
+    return w;
+}
@@ -0,0 +1,49 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <stddef.h>
+
+/*
+In-place array transforms (interface), replacing the one-element-per-iteration loops of
+the arrays and strings chapters: reversing an array or a string, deleting the digit
+characters of a string, and squeezing runs of equal characters to one.
+  - reverse_*: both ends are loaded a vector at a time, reversed with a shuffle and
+    stored crosswise
+  - rotate_left_*: a short side is parked in a stack buffer and the rest moved with
+    memmove; otherwise three reversals. Both read and write the array sequentially,
+    unlike the cycle-following rotation, which jumps around the whole array.
+  - prefix_sum_*: inclusive and exclusive running sums, shifted and added inside the
+    vector, with the carry broadcast from the last lane
+  - filter_range_*, squeeze_*: branchless stream compaction. A compare gives one bit per
+    element; with AVX-512 (VBMI2 for bytes) the compress instructions pack the kept
+    elements, otherwise a 256-entry table turns every 8 bits into a pshufb or
+    permutevar8x32 shuffle.
+Bytes need SSSE3, ints need AVX2; everything has a scalar fallback. The compaction and
+prefix sum functions take dst and src, which may be the same array (the chapter's in-place
+form); otherwise they must not overlap. They return the number of elements written.
+*/
+
+void reverse_u8(unsigned char *a, size_t n);
+void reverse_i32(int *a, size_t n);
+
+// Moves a[k] to a[0]; k may be larger than n.
+void rotate_left_u8(unsigned char *a, size_t n, size_t k);
+void rotate_left_i32(int *a, size_t n, size_t k);
+
+// dst[i] = src[0] + ... + src[i] (exclusive: up to src[i - 1], dst[0] = 0), wrapping
+// like unsigned addition. The exclusive form returns the total.
+void prefix_sum_i32(int *dst, const int *src, size_t n);
+int exclusive_prefix_sum_i32(int *dst, const int *src, size_t n);
+
+// keep != 0 keeps the elements with lo <= x <= hi, keep == 0 drops them:
+// filter_range_u8(s, s, len, '0', '9', 0) deletes the digits of s.
+size_t filter_range_u8(unsigned char *dst, const unsigned char *src, size_t n, unsigned char lo,
+                       unsigned char hi, int keep);
+size_t filter_range_i32(int *dst, const int *src, size_t n, int lo, int hi, int keep);
+
+// Keeps the first element of every run of equal elements: "aaabcc" -> "abc". On a sorted
+// array this removes the duplicates.
+size_t squeeze_u8(unsigned char *dst, const unsigned char *src, size_t n);
+size_t squeeze_i32(int *dst, const int *src, size_t n);
+
+#endif
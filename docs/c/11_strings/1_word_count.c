@@ -0,0 +1,221 @@
+// gcc -O2 -march=native -pthread 1_word_count.c wordcount.c -o wc
+// ./wc [-t thread_count] [-s separators] [-w] [file ...]   (-w: only whitespace separates words, as in wc)
+// ./wc [-t thread_count] [-n bytes]                        (no files: checks and benchmark)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "wordcount.h"
+
+/*
+With file names: prints lines, words and bytes of every file (and the total), like wc.
+Without:
+  1. the chapter's sentence counted by the chapter's loop and by the module
+  2. the module against the chapter's loop: all lengths up to CHECK_LENGTH, text cut
+     into random pieces and merged, every thread count up to 8, a separator set too
+     large for the nibble tables
+  3. speed on n bytes of generated text
+*/
+
+#define OUTWORD 0
+#define INWORD 1
+#define CHECK_LENGTH 300
+#define REPEAT 3
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- The chapter's version, with the separator string as a parameter ----
+
+const char *seps = WC_DEFAULT_SEPARATORS;
+
+int is_sep(int ch) {
+    for (int k = 0; seps[k] != '\0'; ++k)
+        if (ch == seps[k])
+            return 1;
+    return 0;
+}
+
+WordCounts chapter_count(const char *str, size_t n) {
+    WordCounts c = {0, 0, n, 0, 0};
+    int word_flag = OUTWORD;
+    for (size_t k = 0; k < n; ++k) {
+        if (str[k] == '\n')
+            c.lines++;
+        if (is_sep(str[k]))
+            word_flag = OUTWORD;
+        else if (word_flag == OUTWORD) {
+            word_flag = INWORD;
+            c.words++;
+        }
+    }
+    return c;
+}
+
+// Words of 1..8 letters (some with Turkish letters in UTF-8) between runs of separators.
+void fill_text(char *s, size_t n) {
+    static const char *const pieces[] = {" ", " ", "  ", ", ", ".\n", "\n", "\t", "; ", "?! ", "\xC5\x9F", "\xC4\x9F"};
+    size_t i = 0;
+    while (i < n) {
+        uint64_t r = xorshift64();
+        for (int len = 1 + r % 8; len > 0 && i < n; --len)
+            s[i++] = (char)('a' + (r >> (8 + len)) % 26);
+        const char *p = pieces[(r >> 40) % 11];
+        while (*p && i < n)
+            s[i++] = *p++;
+    }
+}
+
+int same_counts(const WordCounts *a, const WordCounts *b) {
+    return a->words == b->words && a->lines == b->lines && a->bytes == b->bytes;
+}
+
+int run_checks(void) {
+    char text[CHECK_LENGTH];
+    SepSet s, many;
+    sep_set_init(&s, seps);
+    // bytes with 10 different high nibbles (some of them UTF-8 bytes): scalar path only
+    const char *many_seps = " \t\n0123456789@Z_`z~\x80\x9F\xC4\xC5";
+    sep_set_init(&many, many_seps);
+    int errors = many.nibble_ok;
+    const char *own_seps = seps;
+    for (size_t len = 0; len < CHECK_LENGTH; ++len) {
+        fill_text(text, len);
+        WordCounts ref = chapter_count(text, len);
+        WordCounts scalar = count_words_scalar(text, len, &s), simd = count_words(text, len, &s);
+        errors += !same_counts(&ref, &scalar) || !same_counts(&ref, &simd);
+        for (int threads = 1; threads <= 8; ++threads) {
+            WordCounts par = count_words_parallel(text, len, &s, threads);
+            errors += !same_counts(&ref, &par);
+        }
+        // random cuts, merged in order
+        WordCounts merged = {0};
+        for (size_t i = 0; i < len;) {
+            size_t piece = 1 + xorshift64() % 80;
+            if (piece > len - i)
+                piece = len - i;
+            WordCounts part = count_words(text + i, piece, &s);
+            word_counts_merge(&merged, &part);
+            i += piece;
+        }
+        errors += !same_counts(&ref, &merged);
+
+        seps = many_seps;
+        ref = chapter_count(text, len);
+        simd = count_words(text, len, &many);
+        errors += !same_counts(&ref, &simd);
+        seps = own_seps;
+    }
+    return errors;
+}
+
+void print_counts(const WordCounts *c, const char *name) {
+    printf("%8llu %8llu %10llu %s\n", (unsigned long long)c->lines, (unsigned long long)c->words,
+           (unsigned long long)c->bytes, name);
+}
+
+int main(int argc, char *argv[]) {
+    int thread_count = 4;
+    size_t n = 200000000;
+    int first_file = 1;
+    for (; first_file < argc && argv[first_file][0] == '-' && argv[first_file][1] != '\0'; ++first_file) {
+        const char *opt = argv[first_file];
+        if (strcmp(opt, "-w") == 0)
+            seps = WC_WHITESPACE;
+        else if (first_file + 1 < argc && strcmp(opt, "-t") == 0)
+            thread_count = atoi(argv[++first_file]);
+        else if (first_file + 1 < argc && strcmp(opt, "-s") == 0)
+            seps = argv[++first_file];
+        else if (first_file + 1 < argc && strcmp(opt, "-n") == 0)
+            n = strtoull(argv[++first_file], NULL, 10);
+        else {
+            fprintf(stderr, "unknown option %s\n", opt);
+            return 1;
+        }
+    }
+    if (thread_count < 1)
+        thread_count = 1;
+    SepSet s;
+    sep_set_init(&s, seps);
+
+    if (first_file < argc) {
+        WordCounts total = {0};
+        int failed = 0;
+        for (int f = first_file; f < argc; ++f) {
+            WordCounts c;
+            if (!count_file(argv[f], &s, thread_count, &c)) {
+                fprintf(stderr, "%s: %s\n", argv[f], strerror(errno));
+                failed = 1;
+                continue;
+            }
+            print_counts(&c, argv[f]);
+            total.words += c.words; // files are separate texts: no word crosses over
+            total.lines += c.lines;
+            total.bytes += c.bytes;
+        }
+        if (argc - first_file > 1)
+            print_counts(&total, "total");
+        return failed;
+    }
+
+    int errors = 0;
+    printf("--- 1. Chapter sentence ---\n");
+    const char *str = "Hello world;this is,C.  Are you sure?!yes";
+    WordCounts ref = chapter_count(str, strlen(str)), c = count_words(str, strlen(str), &s);
+    printf("total %llu words! (chapter loop: %llu)\n", (unsigned long long)c.words, (unsigned long long)ref.words);
+    errors += c.words != ref.words || (strcmp(seps, WC_DEFAULT_SEPARATORS) == 0 && c.words != 9);
+
+    printf("\n--- 2. Checks against the chapter's loop ---\n");
+    int check_errors = run_checks();
+    printf("%s\n", check_errors ? "MISMATCH" : "all counts match");
+    errors += check_errors;
+
+    printf("\n--- 3. n = %zu bytes of text, %d threads, best of %d ---\n", n, thread_count, REPEAT);
+    char *text = malloc(n);
+    if (!text) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    fill_text(text, n);
+    enum { CHAPTER, TABLE, SIMD, PARALLEL, METHOD_COUNT };
+    static const char *const names[] = {"chapter (is_sep scan)", "256-entry table", "nibble lookup + popcount",
+                                        "parallel"};
+    for (int m = 0; m < METHOD_COUNT; ++m) {
+        double best = 1e30;
+        for (int r = 0; r < REPEAT; ++r) {
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            switch (m) {
+                case CHAPTER : c = chapter_count(text, n); break;
+                case TABLE   : c = count_words_scalar(text, n, &s); break;
+                case SIMD    : c = count_words(text, n, &s); break;
+                case PARALLEL: c = count_words_parallel(text, n, &s, thread_count); break;
+            }
+            double t = seconds_since(t0);
+            if (t < best)
+                best = t;
+        }
+        if (m == CHAPTER)
+            ref = c;
+        errors += !same_counts(&ref, &c);
+        printf("%-26s %8.4f s %7.2f GB/s   %llu words, %llu lines\n", names[m], best, n / best / 1e9,
+               (unsigned long long)c.words, (unsigned long long)c.lines);
+    }
+    free(text);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,277 @@
+// gcc -O2 -march=native -pthread 2_letter_histogram.c histogram.c -o histogram
+// ./histogram [-t thread_count] [-b] [file ...]   (-b: also the most frequent letter pairs)
+// ./histogram [-t thread_count] [-n bytes]        (no files: checks and benchmark)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include "histogram.h"
+
+/*
+With file names: letter frequencies of all files together, in the chapter's format.
+Without:
+  1. the chapter's letter counter next to the module on one sentence
+  2. the module against a plain one-table count: all lengths up to CHECK_LENGTH, text
+     cut into pieces, every thread count up to 8, and a temporary file read in small
+     units by several threads
+  3. speed on n bytes of text and on n bytes of long letter runs, where the chapter's
+     single counter table stalls
+*/
+
+#define CHECK_LENGTH 300
+#define CHECK_FILE_SIZE 100003
+#define REPEAT 3
+#define TOP_PAIRS 20
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// The chapter's loop, on a length instead of the '\0'.
+void chapter_letters(const char *str, size_t n, uint64_t letter_counter[26]) {
+    for (size_t k = 0; k < n; ++k)
+        if (isalpha((unsigned char)str[k]))
+            letter_counter[toupper((unsigned char)str[k]) - 'A']++;
+}
+
+// One table, one increment per byte: the reference for the checks.
+void plain_histogram(const unsigned char *p, size_t n, Histogram *h) {
+    for (size_t k = 0; k < n; ++k) {
+        h->bytes[p[k]]++;
+        if (h->with_bigrams && k > 0)
+            h->bigrams[letter_class(p[k - 1])][letter_class(p[k])]++;
+    }
+}
+
+int same_histogram(const Histogram *a, const Histogram *b) {
+    return memcmp(a->bytes, b->bytes, sizeof(a->bytes)) == 0 &&
+           memcmp(a->bigrams, b->bigrams, sizeof(a->bigrams)) == 0;
+}
+
+// Words of mixed case with spaces and punctuation, some bytes of UTF-8 letters.
+void fill_text(unsigned char *s, size_t n) {
+    static const char *const pieces[] = {" ", " ", ", ", ".\n", " \xC5\x9F", "\xC4\x9F "};
+    size_t i = 0;
+    while (i < n) {
+        uint64_t r = xorshift64();
+        for (int len = 1 + r % 8; len > 0 && i < n; --len)
+            s[i++] = (unsigned char)((r >> 60 ? 'a' : 'A') + (r >> (8 + 2 * len)) % 26);
+        const char *p = pieces[(r >> 40) % 6];
+        while (*p && i < n)
+            s[i++] = (unsigned char)*p++;
+    }
+}
+
+// Runs of 1..1000 copies of one letter.
+void fill_runs(unsigned char *s, size_t n) {
+    for (size_t i = 0; i < n;) {
+        uint64_t r = xorshift64();
+        for (size_t len = 1 + r % 1000; len > 0 && i < n; --len)
+            s[i++] = (unsigned char)('a' + (r >> 32) % 26);
+    }
+}
+
+int run_checks(void) {
+    unsigned char text[CHECK_LENGTH];
+    static Histogram ref, h; // static: a few KB each
+    int errors = 0;
+    for (size_t len = 0; len < CHECK_LENGTH; ++len) {
+        fill_text(text, len);
+        histogram_clear(&ref, 1);
+        plain_histogram(text, len, &ref);
+        histogram_clear(&h, 1);
+        histogram_add(&h, text, len);
+        errors += !same_histogram(&ref, &h);
+        for (int threads = 1; threads <= 8; ++threads) {
+            histogram_clear(&h, 1);
+            histogram_add_parallel(&h, text, len, threads);
+            errors += !same_histogram(&ref, &h);
+        }
+        histogram_clear(&h, 1);
+        for (size_t i = 0; i < len;) {
+            size_t piece = 1 + xorshift64() % 50;
+            if (piece > len - i)
+                piece = len - i;
+            histogram_add(&h, text + i, piece);
+            if (i > 0)
+                histogram_add_pair(&h, text[i - 1], text[i]);
+            i += piece;
+        }
+        errors += !same_histogram(&ref, &h);
+    }
+
+    // a file in units of one or two pages, next to a file that does not exist
+    char path[] = "/tmp/histogramXXXXXX";
+    int fd = mkstemp(path);
+    unsigned char *data = malloc(CHECK_FILE_SIZE);
+    if (fd < 0 || !data)
+        return errors + 1;
+    fill_text(data, CHECK_FILE_SIZE);
+    errors += write(fd, data, CHECK_FILE_SIZE) != CHECK_FILE_SIZE;
+    close(fd);
+    histogram_clear(&ref, 1);
+    plain_histogram(data, CHECK_FILE_SIZE, &ref);
+    plain_histogram(data, CHECK_FILE_SIZE, &ref);
+    const char *paths[] = {path, "/nonexistent/file", path};
+    for (int threads = 1; threads <= 4; ++threads) {
+        int file_errors[3];
+        histogram_clear(&h, 1);
+        int failed = histogram_files(&h, paths, 3, threads, threads * 4096 - 100, file_errors);
+        errors += failed != 1 || file_errors[0] || !file_errors[1] || file_errors[2] || !same_histogram(&ref, &h);
+    }
+    unlink(path);
+    free(data);
+    return errors;
+}
+
+void print_letters(const Histogram *h) {
+    uint64_t letters[26], total = 0;
+    histogram_letters(h, letters);
+    for (int k = 0; k < 26; ++k)
+        total += letters[k];
+    for (int k = 0; k < 26; ++k)
+        if (letters[k])
+            printf("%10llu of %c  %5.2f%%\n", (unsigned long long)letters[k], 'A' + k, 100.0 * letters[k] / total);
+}
+
+void print_top_pairs(const Histogram *h) {
+    uint64_t seen[TOP_PAIRS] = {0};
+    int first[TOP_PAIRS], second[TOP_PAIRS], count = 0;
+    // insertion into a short sorted list; only letter pairs are shown
+    for (int a = 0; a < 26; ++a)
+        for (int b = 0; b < 26; ++b) {
+            uint64_t x = h->bigrams[a][b];
+            if (x == 0 || (count == TOP_PAIRS && x <= seen[count - 1]))
+                continue;
+            int k = count < TOP_PAIRS ? count++ : count - 1;
+            for (; k > 0 && seen[k - 1] < x; --k) {
+                seen[k] = seen[k - 1];
+                first[k] = first[k - 1];
+                second[k] = second[k - 1];
+            }
+            seen[k] = x;
+            first[k] = a;
+            second[k] = b;
+        }
+    for (int k = 0; k < count; ++k)
+        printf("%c%c %10llu\n", 'A' + first[k], 'A' + second[k], (unsigned long long)seen[k]);
+}
+
+int main(int argc, char *argv[]) {
+    int thread_count = 4, with_bigrams = 0;
+    size_t n = 200000000;
+    int first_file = 1;
+    for (; first_file < argc && argv[first_file][0] == '-' && argv[first_file][1] != '\0'; ++first_file) {
+        const char *opt = argv[first_file];
+        if (strcmp(opt, "-b") == 0)
+            with_bigrams = 1;
+        else if (first_file + 1 < argc && strcmp(opt, "-t") == 0)
+            thread_count = atoi(argv[++first_file]);
+        else if (first_file + 1 < argc && strcmp(opt, "-n") == 0)
+            n = strtoull(argv[++first_file], NULL, 10);
+        else {
+            fprintf(stderr, "unknown option %s\n", opt);
+            return 1;
+        }
+    }
+    if (thread_count < 1)
+        thread_count = 1;
+    static Histogram h;
+
+    if (first_file < argc) {
+        int path_count = argc - first_file;
+        int *file_errors = malloc(path_count * sizeof(*file_errors));
+        histogram_clear(&h, with_bigrams);
+        int failed = histogram_files(&h, (const char *const *)argv + first_file, path_count, thread_count, 0,
+                                     file_errors);
+        for (int f = 0; f < path_count && file_errors; ++f)
+            if (file_errors[f])
+                fprintf(stderr, "%s: %s\n", argv[first_file + f], strerror(file_errors[f]));
+        printf("%llu bytes\n", (unsigned long long)histogram_total(&h));
+        print_letters(&h);
+        if (with_bigrams)
+            print_top_pairs(&h);
+        free(file_errors);
+        return failed != 0;
+    }
+
+    int errors = 0;
+    printf("--- 1. Chapter sentence ---\n");
+    const char *str = "The quick brown fox jumps over the lazy dog, said Zeynep. Aaaah!";
+    uint64_t chapter[26] = {0}, expected[26], letters[26];
+    chapter_letters(str, strlen(str), chapter);
+    histogram_clear(&h, 1);
+    histogram_add(&h, str, strlen(str));
+    histogram_letters(&h, letters);
+    print_letters(&h);
+    errors += memcmp(chapter, letters, sizeof(letters)) != 0;
+    printf("pairs: th %llu, aa %llu\n", (unsigned long long)h.bigrams['t' - 'a']['h' - 'a'],
+           (unsigned long long)h.bigrams[0][0]);
+    errors += h.bigrams['t' - 'a']['h' - 'a'] != 2 || h.bigrams[0][0] != 3;
+
+    printf("\n--- 2. Checks against a plain count ---\n");
+    int check_errors = run_checks();
+    printf("%s\n", check_errors ? "MISMATCH" : "all histograms match");
+    errors += check_errors;
+
+    unsigned char *text = malloc(n);
+    if (!text) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    enum { CHAPTER, ONE_TABLE, SUB_TABLES, WITH_PAIRS, PARALLEL, METHOD_COUNT };
+    static const char *const names[] = {"chapter (isalpha, toupper)", "one table", "4 sub-tables",
+                                        "4 sub-tables + pairs", "parallel + pairs"};
+    static Histogram ref;
+    for (int data = 0; data < 2; ++data) {
+        printf("\n--- 3.%d n = %zu bytes of %s, %d threads, best of %d ---\n", data + 1, n,
+               data ? "letter runs" : "text", thread_count, REPEAT);
+        (data ? fill_runs : fill_text)(text, n);
+        for (int m = 0; m < METHOD_COUNT; ++m) {
+            double best = 1e30;
+            for (int r = 0; r < REPEAT; ++r) {
+                memset(chapter, 0, sizeof(chapter));
+                histogram_clear(&h, m >= WITH_PAIRS);
+                struct timespec t0;
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                switch (m) {
+                    case CHAPTER   : chapter_letters((const char *)text, n, chapter); break;
+                    case ONE_TABLE : plain_histogram(text, n, &h); break;
+                    case SUB_TABLES:
+                    case WITH_PAIRS: histogram_add(&h, text, n); break;
+                    case PARALLEL  : histogram_add_parallel(&h, text, n, thread_count); break;
+                }
+                double t = seconds_since(t0);
+                if (t < best)
+                    best = t;
+            }
+            histogram_letters(&h, letters);
+            if (m == CHAPTER)
+                memcpy(expected, chapter, sizeof(chapter));
+            else
+                errors += memcmp(letters, expected, sizeof(letters)) != 0;
+            if (m == WITH_PAIRS)
+                ref = h;
+            if (m == PARALLEL)
+                errors += !same_histogram(&ref, &h);
+            printf("%-28s %8.4f s %7.2f GB/s\n", names[m], best, n / best / 1e9);
+        }
+    }
+    free(text);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,361 @@
+// gcc -O2 -march=native -pthread 3_utf8_case.c utf8.c -o utf8_case
+// ./utf8_case (-u | -l | -t) [-T] file ...   (upper, lower or toggled case to stdout; -T: Turkish i; "-": stdin)
+// ./utf8_case [-n bytes]                      (no files: checks and benchmark)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <time.h>
+#include "utf8.h"
+
+/*
+With file names: checks that every file is UTF-8 and writes it converted to stdout.
+Without:
+  1. the chapter's toggle loop and the module on Turkish text
+  2. validation: known invalid sequences at every offset around the 32-byte blocks, all
+     sequences of two and three bytes, random text with random damage; the AVX2 version
+     against the scalar one, the error offsets too
+  3. conversion: random text of ASCII, two-, three- and four-byte characters and invalid
+     bytes, every length up to CHECK_LENGTH, all operations, with and without Turkish;
+     the fast version against the scalar one, in place too, and the output is still UTF-8
+  4. speed on n bytes of mostly ASCII text with about 1% Turkish letters
+*/
+
+#define CHECK_LENGTH 300
+#define REPEAT 3
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// The chapter's loop, on a length instead of the '\0'.
+void chapter_toggle(char *str, size_t n) {
+    for (size_t k = 0; k < n; ++k)
+        str[k] = isupper((unsigned char)str[k]) ? tolower((unsigned char)str[k]) : toupper((unsigned char)str[k]);
+}
+
+// ---- Checks ----
+
+// Random characters: mostly ASCII, Turkish and other two-byte letters, a few of three and
+// four bytes; with damage != 0 also random bytes.
+void fill_mixed(char *s, size_t n, int damage) {
+    static const char *const pieces[] = {"\xC5\x9F", "\xC5\x9E", "\xC4\x9F", "\xC4\x9E", "\xC4\xB1", "\xC4\xB0",
+                                         "\xC3\xA7", "\xC3\x96", "\xC3\xBF", "\xC5\xBF", "\xCE\xA3", "\xCF\x82",
+                                         "\xCE\xAC", "\xD0\x96", "\xD1\x91", "\xC2\xB5", "\xE2\x82\xAC",
+                                         "\xF0\x9F\x98\x80", "i", "I"};
+    size_t i = 0;
+    while (i < n) {
+        uint64_t r = xorshift64();
+        if (damage && r % 16 == 0)
+            s[i++] = (char)(r >> 8);
+        else if (r % 4 == 0) {
+            const char *p = pieces[(r >> 8) % (sizeof(pieces) / sizeof(pieces[0]))];
+            size_t len = strlen(p);
+            if (len > n - i)
+                len = n - i; // a character cut at the end: invalid
+            memcpy(s + i, p, len);
+            i += len;
+        } else
+            s[i++] = (char)(' ' + (r >> 8) % 95);
+    }
+}
+
+int same_validation(const char *s, size_t n) {
+    size_t offset_1 = (size_t)-1, offset_2 = (size_t)-1;
+    int valid_1 = utf8_validate(s, n, &offset_1);
+    int valid_2 = utf8_validate_scalar(s, n, &offset_2);
+    return valid_1 == valid_2 && offset_1 == offset_2;
+}
+
+int check_validation(void) {
+    static const struct {
+        const char *bytes;
+        size_t error_at; // offset of the invalid character in bytes
+    } invalid[] = {
+        {"\x80", 0},             // continuation byte without a lead
+        {"\xC0\x80", 0},         // overlong '\0'
+        {"\xC1\xBF", 0},         // overlong
+        {"\xE0\x80\xAF", 0},     // overlong
+        {"\xED\xA0\x80", 0},     // surrogate
+        {"\xF0\x80\x80\x80", 0}, // overlong
+        {"\xF4\x90\x80\x80", 0}, // above U+10FFFF
+        {"\xF5\x80\x80\x80", 0}, // never a lead
+        {"\xFF", 0},             // never a lead
+        {"\xC5", 0},             // cut
+        {"\xE2\x82", 0},         // cut
+        {"\xF0\x9F\x98", 0},     // cut
+        {"\xE2\x82\x41", 0},     // ASCII inside
+        {"\xC5\x9F\x9F", 2},     // one continuation byte too many
+    };
+    char buf[100];
+    int errors = 0;
+    for (size_t k = 0; k < sizeof(invalid) / sizeof(invalid[0]); ++k) {
+        size_t len = strlen(invalid[k].bytes);
+        for (size_t at = 0; at + len <= sizeof(buf); ++at)
+            for (int end = 0; end < 2; ++end) { // followed by ASCII, or the end of the text
+                memset(buf, 'a', sizeof(buf));
+                memcpy(buf + at, invalid[k].bytes, len);
+                size_t n = end ? at + len : sizeof(buf), offset = (size_t)-1;
+                errors += utf8_validate(buf, n, &offset) || offset != at + invalid[k].error_at;
+                errors += !same_validation(buf, n);
+            }
+    }
+    // every pair and triple of bytes, across a block boundary and at the end
+    for (int at = 29; at <= 31; ++at)
+        for (uint32_t v = 0; v < 1 << 24; v += at == 30 ? 1 : 1 << 8) {
+            memset(buf, 'a', 40);
+            buf[at] = (char)(v >> 16);
+            buf[at + 1] = (char)(v >> 8);
+            buf[at + 2] = (char)v;
+            errors += !same_validation(buf, 40) + !same_validation(buf, at + 3);
+        }
+    for (int round = 0; round < 20000; ++round) {
+        char text[CHECK_LENGTH];
+        size_t n = xorshift64() % CHECK_LENGTH;
+        fill_mixed(text, n, round % 4 == 0);
+        if (round % 4 == 1 && n > 0) // one damaged byte in otherwise valid text
+            text[xorshift64() % n] ^= (char)(1 << xorshift64() % 8);
+        errors += !same_validation(text, n);
+    }
+    return errors;
+}
+
+int check_conversion(void) {
+    char text[CHECK_LENGTH], out_1[2 * CHECK_LENGTH], out_2[2 * CHECK_LENGTH], in_place[CHECK_LENGTH];
+    int errors = 0;
+    for (int round = 0; round < 4; ++round)
+        for (size_t n = 0; n < CHECK_LENGTH; ++n) {
+            fill_mixed(text, n, round == 3);
+            int valid = utf8_validate(text, n, NULL);
+            for (int op = CASE_UPPER; op <= CASE_TOGGLE; ++op)
+                for (int turkish = 0; turkish < 2; ++turkish) {
+                    size_t len_1 = utf8_convert_case(out_1, text, n, op, turkish);
+                    size_t len_2 = utf8_convert_case_scalar(out_2, text, n, op, turkish);
+                    errors += len_1 != len_2 || memcmp(out_1, out_2, len_1) != 0;
+                    errors += turkish ? len_1 > 2 * n : len_1 > n;
+                    if (valid)
+                        errors += !utf8_validate(out_1, len_1, NULL);
+                    if (!turkish) {
+                        memcpy(in_place, text, n);
+                        size_t len = utf8_convert_case(in_place, in_place, n, op, 0);
+                        errors += len != len_1 || memcmp(in_place, out_1, len) != 0;
+                    }
+                }
+        }
+    // every two-byte character alone: the result is one character again
+    for (unsigned c = 0x80; c < 0x800; ++c) {
+        char one[2] = {(char)(0xC0 | c >> 6), (char)(0x80 | (c & 0x3F))};
+        for (int op = CASE_UPPER; op <= CASE_TOGGLE; ++op) {
+            size_t len = utf8_convert_case(out_1, one, 2, op, 0);
+            errors += !utf8_validate(out_1, len, NULL) || (len == 1 && (unsigned char)out_1[0] >= 0x80);
+        }
+    }
+    return errors;
+}
+
+// Prints what the module makes of str and compares it with expected.
+int show(const char *title, const char *str, CaseOp op, int turkish, const char *expected) {
+    char out[200];
+    size_t len = utf8_convert_case(out, str, strlen(str), op, turkish);
+    out[len] = '\0';
+    printf("%-22s (%s)\n", title, out);
+    return strcmp(out, expected) != 0;
+}
+
+// ---- Files ----
+
+// Reads the whole file; returns NULL and sets errno on failure.
+char *read_all(const char *path, size_t *size) {
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!f)
+        return NULL;
+    size_t capacity = 1 << 16, n = 0, got;
+    char *data = malloc(capacity);
+    while (data && (got = fread(data + n, 1, capacity - n, f)) > 0) {
+        n += got;
+        if (n == capacity) {
+            char *bigger = realloc(data, capacity *= 2);
+            if (!bigger)
+                free(data);
+            data = bigger;
+        }
+    }
+    int failed = !data || ferror(f);
+    if (f != stdin)
+        fclose(f);
+    if (failed) {
+        free(data);
+        errno = data ? EIO : ENOMEM;
+        return NULL;
+    }
+    *size = n;
+    return data;
+}
+
+int convert_files(char **paths, int path_count, CaseOp op, int turkish) {
+    int failed = 0;
+    for (int f = 0; f < path_count; ++f) {
+        size_t n, offset;
+        char *data = read_all(paths[f], &n), *out;
+        if (!data) {
+            fprintf(stderr, "%s: %s\n", paths[f], strerror(errno));
+            ++failed;
+            continue;
+        }
+        if (!utf8_validate(data, n, &offset)) {
+            fprintf(stderr, "%s: not UTF-8 at byte %zu, invalid bytes are copied\n", paths[f], offset);
+            ++failed;
+        }
+        if (turkish && (out = malloc(2 * n + 1)) != NULL) {
+            fwrite(out, 1, utf8_convert_case(out, data, n, op, 1), stdout);
+            free(out);
+        } else if (!turkish)
+            fwrite(data, 1, utf8_convert_case(data, data, n, op, 0), stdout);
+        else {
+            fprintf(stderr, "%s: out of memory\n", paths[f]);
+            ++failed;
+        }
+        free(data);
+    }
+    return failed != 0;
+}
+
+// ---- Benchmark ----
+
+// Words of ASCII letters, every hundredth letter a Turkish one.
+void fill_text(char *s, size_t n) {
+    static const char *const turkish[] = {"\xC5\x9F", "\xC4\x9F", "\xC3\xBC", "\xC3\xB6", "\xC3\xA7", "\xC4\xB1",
+                                          "\xC4\xB0", "\xC5\x9E"};
+    size_t i = 0;
+    while (i < n) {
+        uint64_t r = xorshift64();
+        if (r % 100 == 0 && i + 2 <= n) {
+            memcpy(s + i, turkish[(r >> 8) % 8], 2);
+            i += 2;
+        } else
+            s[i++] = r % 7 == 0 ? ' ' : (char)((r >> 32) % 3 ? 'a' : 'A') + (r >> 40) % 26;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int op = -1, turkish = 0;
+    size_t n = 100000000;
+    int first_file = 1;
+    for (; first_file < argc && argv[first_file][0] == '-' && argv[first_file][1] != '\0'; ++first_file) {
+        const char *opt = argv[first_file];
+        if (strcmp(opt, "-u") == 0)
+            op = CASE_UPPER;
+        else if (strcmp(opt, "-l") == 0)
+            op = CASE_LOWER;
+        else if (strcmp(opt, "-t") == 0)
+            op = CASE_TOGGLE;
+        else if (strcmp(opt, "-T") == 0)
+            turkish = 1;
+        else if (first_file + 1 < argc && strcmp(opt, "-n") == 0)
+            n = strtoull(argv[++first_file], NULL, 10);
+        else {
+            fprintf(stderr, "unknown option %s\n", opt);
+            return 1;
+        }
+    }
+    if (first_file < argc) {
+        if (op < 0) {
+            fprintf(stderr, "one of -u, -l, -t is needed\n");
+            return 1;
+        }
+        return convert_files(argv + first_file, argc - first_file, op, turkish);
+    }
+
+    int errors = 0;
+    printf("--- 1. Chapter's toggle loop ---\n");
+    const char *str = "Istanbul'da \xC5\x9E" "eker ve \xC3\xA7" "ay, I\xC4\x9F" "d\xC4\xB1r'da ka\xC5\x9F" "ar";
+    char chapter[100];
+    strcpy(chapter, str);
+    chapter_toggle(chapter, strlen(chapter));
+    printf("%-22s (%s)\n", "string", str);
+    printf("%-22s (%s)\n", "chapter", chapter);
+    errors += show("toggle", str, CASE_TOGGLE, 0, "iSTANBUL'DA \xC5\x9F" "EKER VE \xC3\x87" "AY, i\xC4\x9E" "DIR'DA KA\xC5\x9E" "AR");
+    errors += show("toggle, Turkish", str, CASE_TOGGLE, 1,
+                   "\xC4\xB1STANBUL'DA \xC5\x9F" "EKER VE \xC3\x87" "AY, \xC4\xB1\xC4\x9E" "DIR'DA KA\xC5\x9E" "AR");
+    errors += show("upper, Turkish", "\xC4\xB1\xC4\x9F" "d\xC4\xB1r \xC4\xB0stanbul i\xC5\x9F", CASE_UPPER, 1,
+                   "I\xC4\x9E" "DIR \xC4\xB0STANBUL \xC4\xB0\xC5\x9E");
+    errors += show("lower, Turkish", "ISPARTA \xC4\xB0ZM\xC4\xB0R", CASE_LOWER, 1,
+                   "\xC4\xB1sparta izmir");
+    errors += show("lower", "ISPARTA \xC4\xB0ZM\xC4\xB0R", CASE_LOWER, 0, "isparta izmir");
+    errors += show("upper", "\xCE\xBA\xCF\x8C\xCF\x83\xCE\xBC\xCE\xBF\xCF\x82 \xD0\xBC\xD0\xB8\xD1\x80", CASE_UPPER,
+                   0, "\xCE\x9A\xCE\x8C\xCE\xA3\xCE\x9C\xCE\x9F\xCE\xA3 \xD0\x9C\xD0\x98\xD0\xA0");
+
+    printf("\n--- 2. Validation against the scalar version ---\n");
+    int check_errors = check_validation();
+    printf("%s\n", check_errors ? "MISMATCH" : "all results and offsets match");
+    errors += check_errors;
+
+    printf("\n--- 3. Conversion against the scalar version ---\n");
+    check_errors = check_conversion();
+    printf("%s\n", check_errors ? "MISMATCH" : "all conversions match");
+    errors += check_errors;
+
+    char *text = malloc(n), *out = malloc(2 * n), *ref = malloc(2 * n);
+    if (!text || !out || !ref) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    fill_text(text, n);
+    printf("\n--- 4. n = %zu bytes of text, best of %d ---\n", n, REPEAT);
+    enum { CHAPTER, TOGGLE_SCALAR, TOGGLE, UPPER_TURKISH_SCALAR, UPPER_TURKISH, VALIDATE_SCALAR, VALIDATE,
+           METHOD_COUNT };
+    static const char *const names[] = {"chapter toggle (ctype)", "toggle, scalar", "toggle",
+                                        "upper Turkish, scalar", "upper Turkish", "validate, scalar",
+                                        "validate"};
+    size_t ref_len = 0;
+    for (int m = 0; m < METHOD_COUNT; ++m) {
+        double best = 1e30;
+        size_t len = n;
+        int valid = 0;
+        for (int r = 0; r < REPEAT; ++r) {
+            if (m == CHAPTER)
+                memcpy(out, text, n);
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            switch (m) {
+                case CHAPTER             : chapter_toggle(out, n); break;
+                case TOGGLE_SCALAR       : len = utf8_convert_case_scalar(out, text, n, CASE_TOGGLE, 0); break;
+                case TOGGLE              : len = utf8_convert_case(out, text, n, CASE_TOGGLE, 0); break;
+                case UPPER_TURKISH_SCALAR: len = utf8_convert_case_scalar(out, text, n, CASE_UPPER, 1); break;
+                case UPPER_TURKISH       : len = utf8_convert_case(out, text, n, CASE_UPPER, 1); break;
+                case VALIDATE_SCALAR     : valid = utf8_validate_scalar(text, n, NULL); break;
+                case VALIDATE            : valid = utf8_validate(text, n, NULL); break;
+            }
+            double t = seconds_since(t0);
+            if (t < best)
+                best = t;
+        }
+        if (m == TOGGLE_SCALAR || m == UPPER_TURKISH_SCALAR) {
+            memcpy(ref, out, len);
+            ref_len = len;
+        } else if (m == TOGGLE || m == UPPER_TURKISH)
+            errors += len != ref_len || memcmp(ref, out, len) != 0;
+        else if (m >= VALIDATE_SCALAR)
+            errors += !valid;
+        printf("%-24s %8.4f s %7.2f GB/s\n", names[m], best, n / best / 1e9);
+    }
+    free(text);
+    free(out);
+    free(ref);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
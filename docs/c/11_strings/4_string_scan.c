@@ -0,0 +1,286 @@
+// gcc -O2 -march=native 4_string_scan.c strscan.c -o string_scan
+// ./string_scan
+#define _GNU_SOURCE // memrchr
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "strscan.h"
+
+/*
+  1. the chapter's length loop and a sentence cut into words with scan_strspn and
+     scan_strcspn on the word counter's separators
+  2. every function against the C library: all alignments of the start, all lengths up
+     to CHECK_LENGTH, the character at every position; byte sets with bytes above 127;
+     strings that end at the last byte before an unmapped page or start at the first
+     byte after one
+  3. nanoseconds per call for lengths from 1 byte to 1 MB: the byte loop, the C library
+     and the module
+*/
+
+#define CHECK_LENGTH 600
+#define REPEAT 3
+#define WORK (8u << 20) // bytes scanned per measurement
+#define SEPARATORS " \t\n\v\f\r.,;:?!"
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- The byte loops ----
+
+// gcc turns this loop into a call to strlen unless told not to.
+__attribute__((optimize("no-tree-loop-distribute-patterns"))) size_t loop_strlen(const char *str) {
+    size_t i = 0;
+    while (str[i] != '\0')
+        i++;
+    return i;
+}
+
+const char *loop_strchr(const char *str, int c) {
+    for (size_t k = 0;; ++k) {
+        if (str[k] == (char)c)
+            return str + k;
+        if (str[k] == '\0')
+            return NULL;
+    }
+}
+
+const char *loop_strrchr(const char *str, int c) {
+    const char *last = NULL;
+    for (size_t k = 0;; ++k) {
+        if (str[k] == (char)c)
+            last = str + k;
+        if (str[k] == '\0')
+            return last;
+    }
+}
+
+const void *loop_memchr(const void *s, int c, size_t n) {
+    const unsigned char *p = s;
+    for (size_t k = 0; k < n; ++k)
+        if (p[k] == (unsigned char)c)
+            return p + k;
+    return NULL;
+}
+
+// The word counter's is_sep.
+int is_sep(int ch) {
+    const char *seps = SEPARATORS;
+    for (int k = 0; seps[k] != '\0'; ++k)
+        if (ch == seps[k])
+            return 1;
+    return 0;
+}
+
+size_t loop_strcspn(const char *str) {
+    size_t k = 0;
+    while (str[k] != '\0' && !is_sep(str[k]))
+        ++k;
+    return k;
+}
+
+size_t loop_length_find(const char *str, int c, size_t *first) {
+    const char *p = loop_strchr(str, c);
+    size_t length = loop_strlen(str);
+    *first = p ? (size_t)(p - str) : length;
+    return length;
+}
+
+size_t libc_length_find(const char *str, int c, size_t *first) {
+    const char *p = strchr(str, c);
+    size_t length = strlen(str);
+    *first = p ? (size_t)(p - str) : length;
+    return length;
+}
+
+// ---- Checks ----
+
+int check_string(const char *s, const ByteSet *set, const char *set_chars) {
+    int errors = 0;
+    size_t n = strlen(s);
+    errors += scan_strlen(s) != n;
+    errors += scan_strspn(s, set) != strspn(s, set_chars);
+    errors += scan_strcspn(s, set) != strcspn(s, set_chars);
+    for (int k = 0; k < 4; ++k) {
+        // a byte of the string, the terminator, a byte that is not there
+        int c = k == 0 ? (n ? (unsigned char)s[xorshift64() % n] : 'x') : k == 1 ? 0 : k == 2 ? 0xA5 : '#';
+        size_t first, length = scan_length_find(s, c, &first);
+        const char *p = strchr(s, c);
+        errors += length != n || first != (p && c ? (size_t)(p - s) : n);
+        errors += scan_strchr(s, c) != p;
+        errors += scan_strrchr(s, c) != strrchr(s, c);
+        errors += scan_memchr(s, c, n) != memchr(s, c, n);
+        errors += scan_memrchr(s, c, n) != memrchr(s, c, n);
+    }
+    return errors;
+}
+
+void random_string(char *s, size_t n) {
+    static const char chars[] = "abcdefghij ,.!\xA5\xC5\x9F";
+    for (size_t k = 0; k < n; ++k)
+        s[k] = chars[xorshift64() % (sizeof(chars) - 1)];
+    s[n] = '\0';
+}
+
+int run_checks(void) {
+    static const char *const sets[] = {SEPARATORS, "abc", "\xA5\xC5\x9F x", "#"};
+    char buf[64 + CHECK_LENGTH + 1];
+    int errors = 0;
+    for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); ++s) {
+        ByteSet set;
+        byte_set_init(&set, sets[s]);
+        for (size_t offset = 0; offset < 64; ++offset)
+            for (size_t n = 0; n <= CHECK_LENGTH; n += offset < 4 ? 1 : 7) {
+                random_string(buf + offset, n);
+                errors += check_string(buf + offset, &set, sets[s]);
+            }
+    }
+
+    // next to unmapped pages: a string ending at the last byte of a page, one starting
+    // at the first byte
+    long page = sysconf(_SC_PAGESIZE);
+    char *area = mmap(NULL, 3 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED)
+        return errors + 1;
+    mprotect(area, page, PROT_NONE);
+    mprotect(area + 2 * page, page, PROT_NONE);
+    ByteSet set;
+    byte_set_init(&set, SEPARATORS);
+    for (size_t n = 0; n < 100; ++n) {
+        random_string(area + 2 * page - 1 - n, n);
+        errors += check_string(area + 2 * page - 1 - n, &set, SEPARATORS);
+        random_string(area + page, n);
+        errors += check_string(area + page, &set, SEPARATORS);
+        errors += scan_memrchr(area + page, 'z', n) != NULL;
+        memset(area + 2 * page - n, 'z', n); // memchr ends at the page, without a '\0'
+        errors += scan_memchr(area + 2 * page - n, 'y', n) != NULL || scan_memrchr(area + 2 * page - n, 'y', n);
+    }
+    munmap(area, 3 * page);
+    return errors;
+}
+
+// ---- Benchmark ----
+
+enum { STRLEN, STRCHR, STRRCHR, MEMCHR, STRCSPN, LENGTH_FIND, FUNCTION_COUNT };
+enum { LOOP, LIBC, MODULE, METHOD_COUNT };
+
+static volatile size_t sink;
+
+// Calls the function on the strings in turn; every string is scanned to its end.
+double measure(int function, int method, char *const *strings, int count, size_t n, const ByteSet *set) {
+    size_t calls = WORK / (n + 1) + 16, sum = 0, first;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t k = 0; k < calls; ++k) {
+        const char *s = strings[k % count];
+        switch (function * METHOD_COUNT + method) {
+            case STRLEN * METHOD_COUNT + LOOP          : sum += loop_strlen(s); break;
+            case STRLEN * METHOD_COUNT + LIBC          : sum += strlen(s); break;
+            case STRLEN * METHOD_COUNT + MODULE        : sum += scan_strlen(s); break;
+            case STRCHR * METHOD_COUNT + LOOP          : sum += loop_strchr(s, '#') != NULL; break;
+            case STRCHR * METHOD_COUNT + LIBC          : sum += strchr(s, '#') != NULL; break;
+            case STRCHR * METHOD_COUNT + MODULE        : sum += scan_strchr(s, '#') != NULL; break;
+            case STRRCHR * METHOD_COUNT + LOOP         : sum += loop_strrchr(s, 'e') != NULL; break;
+            case STRRCHR * METHOD_COUNT + LIBC         : sum += strrchr(s, 'e') != NULL; break;
+            case STRRCHR * METHOD_COUNT + MODULE       : sum += scan_strrchr(s, 'e') != NULL; break;
+            case MEMCHR * METHOD_COUNT + LOOP          : sum += loop_memchr(s, '#', n) != NULL; break;
+            case MEMCHR * METHOD_COUNT + LIBC          : sum += memchr(s, '#', n) != NULL; break;
+            case MEMCHR * METHOD_COUNT + MODULE        : sum += scan_memchr(s, '#', n) != NULL; break;
+            case STRCSPN * METHOD_COUNT + LOOP         : sum += loop_strcspn(s); break;
+            case STRCSPN * METHOD_COUNT + LIBC         : sum += strcspn(s, SEPARATORS); break;
+            case STRCSPN * METHOD_COUNT + MODULE       : sum += scan_strcspn(s, set); break;
+            case LENGTH_FIND * METHOD_COUNT + LOOP     : sum += loop_length_find(s, 'z', &first) + first; break;
+            case LENGTH_FIND * METHOD_COUNT + LIBC     : sum += libc_length_find(s, 'z', &first) + first; break;
+            case LENGTH_FIND * METHOD_COUNT + MODULE   : sum += scan_length_find(s, 'z', &first) + first; break;
+        }
+    }
+    double t = seconds_since(t0);
+    sink = sum;
+    return t / calls * 1e9;
+}
+
+int main(void) {
+    int errors = 0;
+    printf("--- 1. Chapter string ---\n");
+    char str[] = "C dili";
+    printf("length of (%s): loop %zu, scan_strlen %zu\n", str, loop_strlen(str), scan_strlen(str));
+    errors += scan_strlen(str) != loop_strlen(str);
+    const char *sentence = "The quick brown fox, jumps over... the lazy dog!";
+    ByteSet seps;
+    byte_set_init(&seps, SEPARATORS);
+    int words = 0;
+    printf("words:");
+    for (const char *p = sentence + scan_strspn(sentence, &seps); *p != '\0';) {
+        size_t len = scan_strcspn(p, &seps);
+        printf(" (%.*s)", (int)len, p);
+        errors += len != loop_strcspn(p);
+        ++words;
+        p += len;
+        p += scan_strspn(p, &seps);
+    }
+    printf("\n");
+    errors += words != 9;
+
+    printf("\n--- 2. Checks against the C library ---\n");
+    int check_errors = run_checks();
+    printf("%s\n", check_errors ? "MISMATCH" : "all results match");
+    errors += check_errors;
+
+    printf("\n--- 3. ns per call, best of %d ---\n", REPEAT);
+    // strings of letters without '#', 'z' or separators; several copies at different
+    // alignments so that no call sees the same address twice in a row
+    static const size_t lengths[] = {1, 4, 16, 64, 256, 1024, 4096, 65536, 1 << 20};
+    static const char *const functions[] = {"strlen", "strchr", "strrchr", "memchr", "strcspn", "length+find"};
+    static const char *const methods[] = {"loop", "libc", "module"};
+    printf("%-12s %8s", "", "bytes");
+    for (int m = 0; m < METHOD_COUNT; ++m)
+        printf(" %10s", methods[m]);
+    printf("\n");
+    enum { COPIES = 8 };
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+        size_t n = lengths[l];
+        char *area = malloc(COPIES * (n + 64)), *strings[COPIES];
+        if (!area) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        for (int c = 0; c < COPIES; ++c) {
+            strings[c] = area + c * (n + 64) + c * 7 % 64;
+            for (size_t k = 0; k < n; ++k)
+                strings[c][k] = (char)('a' + xorshift64() % 25); // no 'z'
+            strings[c][n] = '\0';
+        }
+        for (int f = 0; f < FUNCTION_COUNT; ++f) {
+            printf("%-12s %8zu", functions[f], n);
+            for (int m = 0; m < METHOD_COUNT; ++m) {
+                double best = 1e30;
+                for (int r = 0; r < REPEAT; ++r) {
+                    double t = measure(f, m, strings, COPIES, n, &seps);
+                    if (t < best)
+                        best = t;
+                }
+                printf(" %10.1f", best);
+            }
+            printf("\n");
+        }
+        free(area);
+    }
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
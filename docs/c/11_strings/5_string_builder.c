@@ -0,0 +1,416 @@
+// gcc -O2 -march=native 5_string_builder.c builder.c arena.c -o string_builder
+// ./string_builder
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "builder.h"
+#include "arena.h"
+
+/*
+  1. the concatenation of 6_functions/20_stdlib_demo.c with a builder, and a text that
+     would not fit in its char buf[64]
+  2. checks: random appends of every kind against a plain buffer, with and without an
+     arena, through the change from inline to allocated storage; sb_printf results
+     longer than the free space; arena marks, blocks of their own, alignment, builders
+     that grow across nested marks and releases
+  3. a report of many short fragments: strcat, memcpy at a tracked end, the builder with
+     malloc and with an arena; formatted fragments with snprintf into a temporary and
+     with sb_printf; the small strings of many requests with malloc/free and with an
+     arena that is reset after every request
+*/
+
+#define REPEAT 3
+#define CHECK_STEPS 20000
+#define STRCAT_LIMIT 20000 // strcat is quadratic: longer reports take too long
+#define REQUESTS 100000
+#define STRINGS_PER_REQUEST 20
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static const char *const words[] = {"item", "count", "price", "total", "C", "dili", "rapor", "satir",
+                                    "x", "kalem", "toplam", "ortalama", ";", "\n", "=", "stok"};
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+// ---- Checks ----
+
+// One random operation on the builder and the same text appended to ref.
+void random_append(StringBuilder *b, char *ref, size_t *ref_length) {
+    char text[128];
+    size_t n;
+    switch (xorshift64() % 5) {
+        case 0:
+            n = xorshift64() % 100;
+            for (size_t k = 0; k < n; ++k)
+                text[k] = (char)('a' + k % 26);
+            sb_append(b, text, n);
+            break;
+        case 1:
+            strcpy(text, words[xorshift64() % WORD_COUNT]);
+            n = strlen(text);
+            sb_append_str(b, text);
+            break;
+        case 2:
+            text[0] = (char)('A' + xorshift64() % 26);
+            n = 1;
+            sb_append_char(b, text[0]);
+            break;
+        case 3: {
+            int64_t v = (int64_t)xorshift64() >> (xorshift64() % 64);
+            if (xorshift64() % 16 == 0)
+                v = INT64_MIN;
+            n = (size_t)snprintf(text, sizeof(text), "%" PRId64, v);
+            sb_append_int(b, v);
+            break;
+        }
+        default: {
+            int width = (int)(xorshift64() % 90), v = (int)(xorshift64() % 1000);
+            double d = (double)(xorshift64() % 100000) / 7;
+            n = (size_t)snprintf(text, sizeof(text), "[%*d|%.3f|%s]", width, v, d, "fmt");
+            sb_printf(b, "[%*d|%.3f|%s]", width, v, d, "fmt");
+            break;
+        }
+    }
+    memcpy(ref + *ref_length, text, n);
+    *ref_length += n;
+}
+
+int check_builder(Arena *arena) {
+    int errors = 0;
+    char *ref = malloc(CHECK_STEPS * 128);
+    if (!ref)
+        return 1;
+    for (int round = 0; round < 20; ++round) {
+        StringBuilder b;
+        sb_init(&b, arena);
+        size_t ref_length = 0;
+        int steps = round < 10 ? round * 3 : CHECK_STEPS / 10 * (round - 9);
+        for (int s = 0; s < steps; ++s) {
+            random_append(&b, ref, &ref_length);
+            errors += b.length != ref_length || b.data[b.length] != '\0' || b.capacity <= b.length;
+        }
+        errors += b.failed || memcmp(sb_cstr(&b), ref, ref_length) != 0;
+        errors += ref_length < SB_INLINE && b.data != b.small; // short texts stay inline
+        if (!arena) {
+            char *s = sb_detach(&b);
+            errors += !s || strlen(s) != ref_length || memcmp(s, ref, ref_length) != 0;
+            errors += b.length != 0 || b.data != b.small;
+            free(s);
+        }
+        sb_free(&b);
+        if (arena && round % 4 == 0)
+            arena_reset(arena);
+    }
+    free(ref);
+    return errors;
+}
+
+int check_printf(Arena *arena) {
+    int errors = 0;
+    char expected[1200];
+    StringBuilder b;
+    sb_init(&b, arena);
+    for (int width = 0; width < 1000; width += 37) {
+        sb_clear(&b);
+        sb_append_str(&b, "abc");
+        sb_printf(&b, "%0*d/%s", width, width, "end");
+        snprintf(expected, sizeof(expected), "abc%0*d/%s", width, width, "end");
+        errors += strcmp(sb_cstr(&b), expected) != 0 || b.length != strlen(expected);
+    }
+    sb_free(&b);
+    return errors;
+}
+
+int check_arena(void) {
+    int errors = 0;
+    Arena a;
+    arena_init(&a, 4096);
+    for (size_t align = 1; align <= 64; align *= 2)
+        for (int k = 0; k < 50; ++k) {
+            char *p = arena_alloc(&a, xorshift64() % 300 + 1, align);
+            errors += !p || (uintptr_t)p % align != 0;
+            arena_alloc(&a, xorshift64() % 7, 1); // put the next one off alignment
+        }
+    char *kept = arena_strndup(&a, "kept across the release", 23);
+    size_t used = arena_used(&a);
+    ArenaMark mark = arena_mark(&a);
+    for (int k = 0; k < 200; ++k) {
+        char *p = arena_alloc(&a, k % 10 == 0 ? 5000 : 100, 8); // some get a block of their own
+        if (p)
+            memset(p, 0xAB, k % 10 == 0 ? 5000 : 100);
+        errors += !p;
+    }
+    errors += arena_used(&a) <= used;
+    arena_release(&a, mark);
+    errors += arena_used(&a) != used || strcmp(kept, "kept across the release") != 0;
+    char *after = arena_alloc(&a, 1, 1);
+    errors += after != kept + 24; // the space after the mark is handed out again
+
+    // growing the last allocation in place, and a block of its own with realloc
+    char *p = arena_alloc(&a, 10, 1);
+    errors += arena_grow(&a, p, 10, 100) != p;
+    char *big = arena_alloc(&a, 3000, 1);
+    memset(big, 'q', 3000);
+    big = arena_grow(&a, big, 3000, 30000);
+    errors += !big || big[0] != 'q' || big[2999] != 'q';
+
+    // a block of its own older than a mark is not moved: the mark still points to it
+    ArenaMark before_big = arena_mark(&a);
+    char *moved = arena_grow(&a, big, 30000, 60000);
+    errors += !moved || moved == big || moved[2999] != 'q' || big[2999] != 'q';
+    arena_release(&a, before_big);
+    errors += big[0] != 'q';
+
+    // builders that grow across marks and releases: inline, in place and in a block of its
+    // own when the mark is taken, each keeps its text after the release
+    char expected[8000];
+    for (int start = 0; start < 3; ++start) {
+        StringBuilder b;
+        sb_init(&b, &a);
+        size_t length = start == 0 ? 10 : start == 1 ? 200 : 3500;
+        for (size_t k = 0; k < length; ++k)
+            sb_append_char(&b, (char)('a' + k % 26));
+        ArenaMark outer = arena_mark(&a);
+        StringBuilder inner;
+        sb_init(&inner, &a);
+        for (int round = 0; round < 3; ++round) {
+            ArenaMark m = arena_mark(&a);
+            for (int k = 0; k < 100; ++k) {
+                sb_append(&b, "0123456789", 10);
+                sb_append(&inner, "xy", 2);
+                arena_alloc(&a, 50, 1); // other allocations of the request
+            }
+            arena_release(&a, m);
+            arena_alloc(&a, 300, 1); // reuses the released space
+        }
+        arena_release(&a, outer);
+        for (size_t k = 0; k < length; ++k)
+            expected[k] = (char)('a' + k % 26);
+        for (int k = 0; k < 300; ++k)
+            memcpy(expected + length + 10 * k, "0123456789", 10);
+        arena_alloc(&a, 5000, 1);
+        errors += b.failed || b.length != length + 3000 || memcmp(sb_cstr(&b), expected, b.length) != 0;
+    }
+
+    arena_reset(&a);
+    errors += arena_used(&a) != 4096;
+    arena_free(&a);
+    errors += arena_used(&a) != 0;
+    return errors;
+}
+
+// ---- Benchmark ----
+
+static volatile size_t sink;
+
+enum { STRCAT, TRACKED_END, BUILDER, BUILDER_ARENA, METHOD_COUNT };
+
+// Seconds to build a report of count fragments.
+double build_report(int method, const int *order, int count, char *buf) {
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t length = 0;
+    if (method == STRCAT) {
+        buf[0] = '\0';
+        for (int k = 0; k < count; ++k)
+            strcat(buf, words[order[k]]);
+        length = strlen(buf);
+    } else if (method == TRACKED_END) { // right only because buf is known to be large enough
+        char *end = buf;
+        for (int k = 0; k < count; ++k) {
+            size_t n = strlen(words[order[k]]);
+            memcpy(end, words[order[k]], n);
+            end += n;
+        }
+        *end = '\0';
+        length = (size_t)(end - buf);
+    } else {
+        Arena arena;
+        arena_init(&arena, 0);
+        StringBuilder b;
+        sb_init(&b, method == BUILDER_ARENA ? &arena : NULL);
+        for (int k = 0; k < count; ++k)
+            sb_append_str(&b, words[order[k]]);
+        length = b.length + (size_t)b.failed;
+        sb_free(&b);
+        arena_free(&arena);
+    }
+    double t = seconds_since(t0);
+    sink = length;
+    return t;
+}
+
+enum { SNPRINTF_TEMP, SB_PRINTF, SB_APPEND_PARTS, FORMAT_COUNT };
+
+double build_formatted(int method, int count) {
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    StringBuilder b;
+    sb_init(&b, NULL);
+    for (int k = 0; k < count; ++k) {
+        const char *name = words[k % WORD_COUNT];
+        if (method == SNPRINTF_TEMP) {
+            char temp[64];
+            int n = snprintf(temp, sizeof(temp), "%s=%d;", name, k);
+            sb_append(&b, temp, (size_t)n);
+        } else if (method == SB_PRINTF) {
+            sb_printf(&b, "%s=%d;", name, k);
+        } else {
+            sb_append_str(&b, name);
+            sb_append_char(&b, '=');
+            sb_append_int(&b, k);
+            sb_append_char(&b, ';');
+        }
+    }
+    double t = seconds_since(t0);
+    sink = b.length;
+    sb_free(&b);
+    return t;
+}
+
+// Every request makes STRINGS_PER_REQUEST short strings and drops them at its end.
+double run_requests(int use_arena, const unsigned char *lengths) {
+    static char text[80] = "request text, request text, request text, request text, request text.";
+    char *strings[STRINGS_PER_REQUEST];
+    Arena arena;
+    arena_init(&arena, 0);
+    size_t sum = 0;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < REQUESTS; ++r) {
+        for (int k = 0; k < STRINGS_PER_REQUEST; ++k) {
+            size_t n = lengths[(r + k) & 1023];
+            if (use_arena) {
+                strings[k] = arena_strndup(&arena, text, n);
+            } else {
+                strings[k] = malloc(n + 1);
+                if (strings[k]) {
+                    memcpy(strings[k], text, n);
+                    strings[k][n] = '\0';
+                }
+            }
+            sum += strings[k] != NULL;
+        }
+        if (use_arena) {
+            arena_reset(&arena);
+        } else {
+            for (int k = 0; k < STRINGS_PER_REQUEST; ++k)
+                free(strings[k]);
+        }
+    }
+    double t = seconds_since(t0);
+    arena_free(&arena);
+    sink = sum;
+    return t;
+}
+
+int main(void) {
+    int errors = 0;
+    printf("--- 1. Chapter concatenation ---\n");
+    StringBuilder b;
+    sb_init(&b, NULL);
+    sb_append_str(&b, "C");
+    sb_append_str(&b, " Programlama");
+    printf("Birleştirme: %s (length %zu, capacity %zu, inline %s)\n", sb_cstr(&b), b.length, b.capacity,
+           b.data == b.small ? "yes" : "no");
+    errors += strcmp(sb_cstr(&b), "C Programlama") != 0;
+    for (int k = 0; k < 10; ++k)
+        sb_printf(&b, " %d. bölüm", k + 1);
+    printf("%s\n(length %zu: %zu bytes more than char buf[64] holds; capacity %zu, inline %s)\n",
+           sb_cstr(&b), b.length, b.length + 1 - 64, b.capacity, b.data == b.small ? "yes" : "no");
+    errors += b.length <= 64 || b.failed;
+    sb_free(&b);
+
+    printf("\n--- 2. Checks ---\n");
+    Arena arena;
+    arena_init(&arena, 1024);
+    int builder_errors = check_builder(NULL), arena_builder_errors = check_builder(&arena);
+    int printf_errors = check_printf(NULL) + check_printf(&arena);
+    arena_free(&arena);
+    int arena_errors = check_arena();
+    printf("builder with malloc: %s\n", builder_errors ? "MISMATCH" : "ok");
+    printf("builder in an arena: %s\n", arena_builder_errors ? "MISMATCH" : "ok");
+    printf("sb_printf longer than the free space: %s\n", printf_errors ? "MISMATCH" : "ok");
+    printf("arena marks, large blocks, alignment: %s\n", arena_errors ? "MISMATCH" : "ok");
+    errors += builder_errors + arena_builder_errors + printf_errors + arena_errors;
+
+    printf("\n--- 3. Speed, best of %d ---\n", REPEAT);
+    static const int counts[] = {1000, 10000, 100000, 1000000};
+    static const char *const methods[] = {"strcat", "end pointer", "builder", "builder+arena"};
+    int max_count = counts[sizeof(counts) / sizeof(counts[0]) - 1];
+    int *order = malloc(max_count * sizeof(*order));
+    char *buf = malloc((size_t)max_count * 8 + 1); // no word is longer than 8 bytes
+    if (!order || !buf) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (int k = 0; k < max_count; ++k)
+        order[k] = (int)(xorshift64() % WORD_COUNT);
+    printf("report of short fragments, ns per fragment\n%10s", "fragments");
+    for (int m = 0; m < METHOD_COUNT; ++m)
+        printf(" %14s", methods[m]);
+    printf("\n");
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        printf("%10d", counts[c]);
+        for (int m = 0; m < METHOD_COUNT; ++m) {
+            if (m == STRCAT && counts[c] > STRCAT_LIMIT) {
+                printf(" %14s", "-");
+                continue;
+            }
+            double best = 1e30;
+            for (int r = 0; r < REPEAT; ++r) {
+                double t = build_report(m, order, counts[c], buf);
+                if (t < best)
+                    best = t;
+            }
+            printf(" %14.2f", best / counts[c] * 1e9);
+        }
+        printf("\n");
+    }
+    free(order);
+    free(buf);
+
+    static const char *const formats[] = {"snprintf + append", "sb_printf", "append str/int"};
+    printf("\n%d formatted fragments \"%%s=%%d;\", ns per fragment\n", max_count);
+    for (int m = 0; m < FORMAT_COUNT; ++m) {
+        double best = 1e30;
+        for (int r = 0; r < REPEAT; ++r) {
+            double t = build_formatted(m, max_count);
+            if (t < best)
+                best = t;
+        }
+        printf("%-20s %8.2f\n", formats[m], best / max_count * 1e9);
+    }
+
+    unsigned char lengths[1024];
+    for (int k = 0; k < 1024; ++k)
+        lengths[k] = (unsigned char)(8 + xorshift64() % 57);
+    printf("\n%d requests of %d strings of 8 to 64 bytes, ns per string\n", REQUESTS, STRINGS_PER_REQUEST);
+    for (int use_arena = 0; use_arena < 2; ++use_arena) {
+        double best = 1e30;
+        for (int r = 0; r < REPEAT; ++r) {
+            double t = run_requests(use_arena, lengths);
+            if (t < best)
+                best = t;
+        }
+        printf("%-20s %8.2f\n", use_arena ? "arena + reset" : "malloc + free", best / REQUESTS / STRINGS_PER_REQUEST * 1e9);
+    }
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,477 @@
+// gcc -O2 -march=native 6_multi_match.c matcher.c -o multi_match
+// ./multi_match -p pattern [-p pattern ...] [-f pattern_file] [file ...]   (offset and pattern of every match; no file or "-": stdin)
+// ./multi_match [-n bytes]                                                 (no patterns: checks and benchmark; -n 10000000000 for 10 GB)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include "matcher.h"
+
+/*
+With patterns: reads the files in blocks and prints file:offset:pattern for every match.
+Without:
+  1. the "xyz" loop of the loop statements chapter against the matcher, byte by byte as
+     from the keyboard, on inputs with overlapping prefixes
+  2. checks: random pattern sets (repeated patterns, patterns inside others) on text of
+     few letters, both methods, fed in blocks of random size, against a position by
+     position search
+  3. n bytes of generated log lines (a buffer scanned again and again, in blocks of
+     BLOCK bytes, as from a file) with 1 to 10000 patterns: the prefilter, the automaton,
+     and strstr once per pattern
+*/
+
+#define BLOCK (64 * 1024)
+#define BUFFER_SIZE (16u << 20)
+#define STRSTR_WORK (256u << 20) // pattern bytes x text bytes for strstr, which is slow with many patterns
+#define MAX_MATCHES 100000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- The chapter's loop ----
+
+// The loop of the chapter, reading from a string instead of the keyboard; returns the
+// number of characters read until "xyz", or 0 if it was not seen.
+size_t chapter_xyz(const char *input) {
+    size_t read = 0;
+    int total = 0;
+    while (total < 3) {
+        char ch = input[read];
+        if (ch == '\0')
+            return 0;
+        ++read;
+        if (ch == 'x' && total == 0)
+            total++;
+        else if (ch == 'y' && total == 1)
+            total++;
+        else if (ch == 'z' && total == 2)
+            total++;
+        else
+            total = 0;
+    }
+    return read;
+}
+
+int stop_at_match(void *context, size_t pattern, uint64_t offset) {
+    (void)context, (void)pattern, (void)offset;
+    return 1;
+}
+
+size_t matcher_xyz(const Matcher *m, const char *input) {
+    MatchStream s;
+    match_stream_init(&s, m);
+    for (size_t k = 0; input[k] != '\0'; ++k)
+        if (!match_stream_feed(&s, input + k, 1, stop_at_match, NULL))
+            return k + 1;
+    return 0;
+}
+
+// ---- Printing matches ----
+
+typedef struct {
+    const char *name;
+    const Matcher *m;
+    char *const *patterns;
+} PrintContext;
+
+int print_match(void *context, size_t pattern, uint64_t offset) {
+    const PrintContext *c = context;
+    printf("%s:%" PRIu64 ":%.*s\n", c->name, offset, (int)c->m->lengths[pattern], c->patterns[pattern]);
+    return 0;
+}
+
+int match_files(char **patterns, size_t count, char **files, int file_count) {
+    Matcher m;
+    if (!matcher_init(&m, (const char *const *)patterns, NULL, count, MATCHER_AUTO)) {
+        fprintf(stderr, "cannot build the matcher (empty pattern or out of memory)\n");
+        return 1;
+    }
+    static char block[BLOCK];
+    int errors = 0;
+    for (int f = 0; f < (file_count ? file_count : 1); ++f) {
+        const char *name = file_count ? files[f] : "-";
+        FILE *in = strcmp(name, "-") == 0 ? stdin : fopen(name, "rb");
+        if (!in) {
+            perror(name);
+            ++errors;
+            continue;
+        }
+        PrintContext context = {name, &m, patterns};
+        MatchStream s;
+        match_stream_init(&s, &m);
+        size_t n;
+        while ((n = fread(block, 1, sizeof(block), in)) > 0)
+            match_stream_feed(&s, block, n, print_match, &context);
+        if (ferror(in)) {
+            perror(name);
+            ++errors;
+        }
+        if (in != stdin)
+            fclose(in);
+    }
+    matcher_free(&m);
+    return errors != 0;
+}
+
+// One pattern per line; the lines are kept in *text, which the caller frees.
+char **read_pattern_file(const char *name, char **text, size_t *count) {
+    FILE *in = fopen(name, "rb");
+    if (!in)
+        return NULL;
+    size_t size = 0, capacity = 4096;
+    char *buf = malloc(capacity);
+    size_t n;
+    while (buf && (n = fread(buf + size, 1, capacity - size - 1, in)) > 0) {
+        size += n;
+        if (size + 1 == capacity) {
+            char *bigger = realloc(buf, capacity *= 2);
+            if (!bigger)
+                free(buf);
+            buf = bigger;
+        }
+    }
+    fclose(in);
+    if (!buf)
+        return NULL;
+    buf[size] = '\0';
+    size_t lines = 1;
+    for (size_t k = 0; k < size; ++k)
+        lines += buf[k] == '\n';
+    char **patterns = malloc(lines * sizeof(*patterns));
+    if (!patterns) {
+        free(buf);
+        return NULL;
+    }
+    *count = 0;
+    for (char *line = strtok(buf, "\r\n"); line; line = strtok(NULL, "\r\n"))
+        patterns[(*count)++] = line;
+    *text = buf;
+    return patterns;
+}
+
+// ---- Checks ----
+
+typedef struct {
+    uint64_t offset;
+    size_t pattern;
+} Match;
+
+typedef struct {
+    Match *matches;
+    size_t count;
+} MatchList;
+
+int collect_match(void *context, size_t pattern, uint64_t offset) {
+    MatchList *list = context;
+    if (list->count < MAX_MATCHES)
+        list->matches[list->count] = (Match){offset, pattern};
+    list->count++;
+    return 0;
+}
+
+int compare_matches(const void *a, const void *b) {
+    const Match *x = a, *y = b;
+    if (x->offset != y->offset)
+        return x->offset < y->offset ? -1 : 1;
+    return (x->pattern > y->pattern) - (x->pattern < y->pattern);
+}
+
+int check_set(char **patterns, const size_t *lengths, size_t count, const char *text, size_t n, Match *expected,
+              Match *found) {
+    int errors = 0;
+    MatchList reference = {expected, 0};
+    for (size_t i = 0; i < n; ++i)
+        for (size_t p = 0; p < count; ++p)
+            if (i + lengths[p] <= n && memcmp(text + i, patterns[p], lengths[p]) == 0)
+                collect_match(&reference, p, i);
+    for (int mode = MATCHER_AUTOMATON; mode <= MATCHER_PREFILTER; ++mode) {
+        Matcher m;
+        if (!matcher_init(&m, (const char *const *)patterns, lengths, count, (MatcherMode)mode))
+            return errors + 1;
+        for (int blocks = 0; blocks < 3; ++blocks) { // one block, small blocks, single bytes and large blocks
+            MatchList list = {found, 0};
+            MatchStream s;
+            match_stream_init(&s, &m);
+            for (size_t i = 0; i < n;) {
+                size_t len = blocks == 0 ? n : blocks == 1 ? 1 + xorshift64() % 40 : xorshift64() % 2 ? 1 : 100;
+                if (len > n - i)
+                    len = n - i;
+                match_stream_feed(&s, text + i, len, collect_match, &list);
+                i += len;
+            }
+            errors += list.count != reference.count;
+            if (list.count == reference.count && list.count <= MAX_MATCHES) {
+                qsort(list.matches, list.count, sizeof(Match), compare_matches);
+                errors += memcmp(list.matches, expected, list.count * sizeof(Match)) != 0;
+            }
+        }
+        matcher_free(&m);
+    }
+    return errors;
+}
+
+int stop_at_third(void *context, size_t pattern, uint64_t offset) {
+    (void)pattern, (void)offset;
+    return ++*(int *)context == 3;
+}
+
+int run_checks(void) {
+    enum { TEXT = 9000, MAX_PATTERNS = 100 };
+    static char text[TEXT], pattern_bytes[MAX_PATTERNS][40];
+    static Match expected[MAX_MATCHES], found[MAX_MATCHES];
+    char *patterns[MAX_PATTERNS];
+    size_t lengths[MAX_PATTERNS];
+    int errors = 0;
+    for (int round = 0; round < 300; ++round) {
+        int letters = 2 + round % 3;
+        size_t n = xorshift64() % TEXT;
+        for (size_t k = 0; k < n; ++k)
+            text[k] = xorshift64() % 64 == 0 ? (char)xorshift64() : (char)('a' + xorshift64() % letters);
+        size_t count = round % 4 == 3 ? 1 + xorshift64() % MAX_PATTERNS : 1 + xorshift64() % MATCHER_PREFILTER_COUNT;
+        for (size_t p = 0; p < count; ++p) {
+            patterns[p] = pattern_bytes[p];
+            if (p > 0 && xorshift64() % 4 == 0) { // a repeated pattern or a piece of an earlier one
+                size_t q = xorshift64() % p;
+                lengths[p] = 1 + xorshift64() % lengths[q];
+                memcpy(patterns[p], patterns[q] + (lengths[q] - lengths[p]) * (xorshift64() % 2), lengths[p]);
+            } else if (n > 0 && xorshift64() % 2) { // a piece of the text
+                size_t start = xorshift64() % n;
+                lengths[p] = 1 + xorshift64() % (round % 2 ? 8 : MATCHER_PREFILTER_LENGTH);
+                if (lengths[p] > n - start)
+                    lengths[p] = n - start;
+                memcpy(patterns[p], text + start, lengths[p]);
+            } else {
+                lengths[p] = 1 + xorshift64() % (round % 2 ? 6 : 36);
+                for (size_t k = 0; k < lengths[p]; ++k)
+                    patterns[p][k] = (char)('a' + xorshift64() % letters);
+            }
+        }
+        errors += check_set(patterns, lengths, count, text, n, expected, found);
+    }
+
+    // a stop ends the scan at once
+    const char *const ab[] = {"a", "ab"};
+    for (int mode = MATCHER_AUTOMATON; mode <= MATCHER_PREFILTER; ++mode) {
+        Matcher m;
+        if (!matcher_init(&m, ab, NULL, 2, (MatcherMode)mode))
+            return errors + 1;
+        MatchStream s;
+        match_stream_init(&s, &m);
+        int calls = 0;
+        errors += match_stream_feed(&s, "xxabab", 6, stop_at_third, &calls) != 0 || calls != 3;
+        matcher_free(&m);
+    }
+    return errors;
+}
+
+// ---- Benchmark ----
+
+// Lines of a web server log.
+void fill_log(char *buf, size_t size) {
+    static const char *const levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+    static const char *const resources[] = {"items", "orders", "users", "carts", "search", "login"};
+    size_t n = 0;
+    while (n < size) {
+        char line[200];
+        int len = snprintf(line, sizeof(line),
+                           "2026-%02d-%02d %02d:%02d:%02d %-5s [worker-%d] user=%u path=/api/v%d/%s/%u status=%d "
+                           "time=%ums\n",
+                           (int)(1 + xorshift64() % 12), (int)(1 + xorshift64() % 28), (int)(xorshift64() % 24),
+                           (int)(xorshift64() % 60), (int)(xorshift64() % 60), levels[xorshift64() % 6],
+                           (int)(xorshift64() % 32), (unsigned)(xorshift64() % 1000000), (int)(1 + xorshift64() % 3),
+                           resources[xorshift64() % 6], (unsigned)(xorshift64() % 100000),
+                           xorshift64() % 10 ? 200 : 404 + (int)(xorshift64() % 100), (unsigned)(xorshift64() % 2000));
+        size_t copy = (size_t)len < size - n ? (size_t)len : size - n;
+        memcpy(buf + n, line, copy);
+        n += copy;
+    }
+}
+
+int count_match(void *context, size_t pattern, uint64_t offset) {
+    (void)pattern, (void)offset;
+    ++*(uint64_t *)context;
+    return 0;
+}
+
+// Seconds to scan total bytes: the buffer again and again, in blocks.
+double scan_log(const Matcher *m, const char *buf, size_t size, uint64_t total, uint64_t *matches) {
+    MatchStream s;
+    match_stream_init(&s, m);
+    *matches = 0;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t at = 0;
+    for (uint64_t done = 0; done < total;) {
+        size_t len = BLOCK;
+        if (len > size - at)
+            len = size - at;
+        if (len > total - done)
+            len = (size_t)(total - done);
+        match_stream_feed(&s, buf + at, len, count_match, matches);
+        done += len;
+        at = at + len == size ? 0 : at + len;
+    }
+    return seconds_since(t0);
+}
+
+// Seconds for strstr over buf[0..size) (which ends with '\0') once per pattern.
+double scan_strstr(char *const *patterns, size_t count, const char *buf, uint64_t *matches) {
+    *matches = 0;
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t p = 0; p < count; ++p)
+        for (const char *at = strstr(buf, patterns[p]); at; at = strstr(at + 1, patterns[p]))
+            ++*matches;
+    return seconds_since(t0);
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t n = 256u << 20;
+    char **patterns = NULL, *pattern_text = NULL;
+    size_t count = 0;
+    int first_file = 1;
+    for (; first_file < argc && argv[first_file][0] == '-' && argv[first_file][1] != '\0'; ++first_file) {
+        const char *opt = argv[first_file];
+        if (first_file + 1 < argc && strcmp(opt, "-p") == 0) {
+            char **more = realloc(patterns, (count + 1) * sizeof(*patterns));
+            if (!more)
+                return 1;
+            patterns = more;
+            patterns[count++] = argv[++first_file];
+        } else if (first_file + 1 < argc && strcmp(opt, "-f") == 0 && !pattern_text) {
+            size_t file_count;
+            char **from_file = read_pattern_file(argv[++first_file], &pattern_text, &file_count);
+            char **more = from_file ? realloc(patterns, (count + file_count + 1) * sizeof(*patterns)) : NULL;
+            if (!more) {
+                perror(argv[first_file]);
+                return 1;
+            }
+            patterns = more;
+            memcpy(patterns + count, from_file, file_count * sizeof(*patterns));
+            count += file_count;
+            free(from_file);
+        } else if (first_file + 1 < argc && strcmp(opt, "-n") == 0) {
+            n = strtoull(argv[++first_file], NULL, 10);
+        } else {
+            fprintf(stderr, "unknown option %s\n", opt);
+            return 1;
+        }
+    }
+    if (count) {
+        int status = match_files(patterns, count, argv + first_file, argc - first_file);
+        free(patterns);
+        free(pattern_text);
+        return status;
+    }
+
+    int errors = 0;
+    printf("--- 1. Chapter's \"xyz\" loop ---\n");
+    Matcher xyz;
+    const char *const xyz_pattern[] = {"xyz"};
+    if (!matcher_init(&xyz, xyz_pattern, NULL, 1, MATCHER_AUTO))
+        return 1;
+    static const char *const inputs[] = {"abxyzab", "xxyz", "xyxyz", "xxxyyz", "zyxxyzz"};
+    static const size_t expected[] = {5, 4, 5, 0, 6};
+    printf("%-10s %18s %18s\n", "input", "chapter stops at", "matcher stops at");
+    for (size_t k = 0; k < sizeof(inputs) / sizeof(inputs[0]); ++k) {
+        size_t chapter = chapter_xyz(inputs[k]), matcher = matcher_xyz(&xyz, inputs[k]);
+        printf("%-10s %18zu %18zu\n", inputs[k], chapter, matcher);
+        errors += matcher != expected[k];
+    }
+    printf("(0: never stops)\n");
+    matcher_free(&xyz);
+
+    printf("\n--- 2. Checks against a search at every position ---\n");
+    int check_errors = run_checks();
+    printf("%s\n", check_errors ? "MISMATCH" : "all matches found");
+    errors += check_errors;
+
+    size_t size = n < BUFFER_SIZE ? (size_t)n : BUFFER_SIZE;
+    char *buf = malloc(size + 1);
+    static char pattern_bytes[10000][24];
+    static char *bench_patterns[10000];
+    if (!buf || size < 64) {
+        fprintf(stderr, "need memory for n = %" PRIu64 " bytes, and n >= 64\n", n);
+        return 1;
+    }
+    fill_log(buf, size);
+    buf[size] = '\0';
+    // what one looks for in a log: users, paths and times, most of them rare; every hundredth a
+    // piece of a line, half of those with one letter changed
+    for (int p = 0; p < 10000; ++p) {
+        if (p % 100 == 99) {
+            size_t len = 6 + xorshift64() % 16, start = xorshift64() % (size - len);
+            memcpy(pattern_bytes[p], buf + start, len);
+            if (p % 200 == 99)
+                pattern_bytes[p][xorshift64() % len] = (char)('a' + xorshift64() % 26);
+            pattern_bytes[p][len] = '\0';
+        } else if (p % 3 == 0) {
+            snprintf(pattern_bytes[p], sizeof(pattern_bytes[p]), "user=%u ", (unsigned)(xorshift64() % 1000000));
+        } else if (p % 3 == 1) {
+            snprintf(pattern_bytes[p], sizeof(pattern_bytes[p]), "/orders/%u ", (unsigned)(xorshift64() % 100000));
+        } else {
+            snprintf(pattern_bytes[p], sizeof(pattern_bytes[p]), "%02d:%02d:%02d", (int)(xorshift64() % 24),
+                     (int)(xorshift64() % 60), (int)(xorshift64() % 60));
+        }
+        bench_patterns[p] = pattern_bytes[p];
+    }
+    strcpy(pattern_bytes[0], "status=500"); // a single search for the errors
+
+    printf("\n--- 3. %" PRIu64 " bytes of log lines, GB/s ---\n", n);
+    printf("%8s %12s %10s %10s %10s %12s\n", "patterns", "matches", "prefilter", "automaton", "strstr", "table KB");
+    static const size_t counts[] = {1, 4, 8, 10, 100, 1000, 10000};
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        size_t k = counts[c];
+        uint64_t matches[2] = {0, 0};
+        double speed[2] = {0, 0};
+        size_t memory = 0;
+        for (int mode = MATCHER_AUTOMATON; mode <= MATCHER_PREFILTER; ++mode) {
+            Matcher m;
+            if (!matcher_init(&m, (const char *const *)bench_patterns, NULL, k, (MatcherMode)mode)) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+            if ((int)m.mode == mode) {
+                double t = scan_log(&m, buf, size, n, &matches[mode - 1]);
+                speed[mode - 1] = (double)n / t / 1e9;
+            }
+            if (mode == MATCHER_AUTOMATON)
+                memory = matcher_memory(&m);
+            matcher_free(&m);
+        }
+        errors += speed[1] > 0 && matches[0] != matches[1];
+
+        // strstr on a slice small enough to take about as long as the rest
+        size_t slice = STRSTR_WORK / k < size ? STRSTR_WORK / k : size;
+        char saved = buf[slice];
+        buf[slice] = '\0';
+        uint64_t strstr_matches;
+        double t = scan_strstr(bench_patterns, k, buf, &strstr_matches);
+        buf[slice] = saved;
+
+        printf("%8zu %12" PRIu64, k, matches[0]);
+        if (speed[1] > 0)
+            printf(" %10.2f", speed[1]);
+        else
+            printf(" %10s", "-");
+        printf(" %10.2f %10.3f %12.1f\n", speed[0], (double)slice / t / 1e9, memory / 1024.0);
+    }
+    free(buf);
+
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,314 @@
+// gcc -O2 -march=native 7_string_sort.c strpool.c -o string_sort
+// ./string_sort [-n count]   (count strings in the benchmark, default 10000000; 100000000 needs about 10 GB)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "strpool.h"
+
+/*
+  1. names in char arrays, as in the chapter, put into a pool, sorted and interned
+  2. checks against qsort with a full comparison: random strings of few letters, strings
+     with '\0' inside, long common prefixes, many repeats, all lengths of STR_POOL_SMALL
+     and around it; the ids of interning and the result of str_pool_unique; nested
+     prefixes "a", "aa", ... of NESTED_COUNT strings (8 MB), and strings equal in 1 MB
+  3. n short strings, a quarter of them distinct: qsort with strcmp on separately
+     allocated strings, qsort on the handles of a pool, str_pool_sort; duplicates
+     removed by sorting or by interning
+*/
+
+#define REPEAT 3
+#define CHECK_COUNT 3000
+#define NESTED_COUNT 4000   // strings "a" to NESTED_COUNT times "a"
+#define LONG_PREFIX 1000000 // bytes that the long strings have in common
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// qsort has no context argument.
+static const StrPool *compared_pool;
+
+int compare_refs(const void *a, const void *b) {
+    return str_ref_compare(compared_pool, *(const StrRef *)a, *(const StrRef *)b);
+}
+
+int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// ---- Checks ----
+
+// Fills s with a random string of the given kind and returns its length.
+size_t random_string(char *s, int kind) {
+    size_t n;
+    switch (kind) {
+        case 0: // few letters, short
+            n = xorshift64() % 12;
+            for (size_t k = 0; k < n; ++k)
+                s[k] = (char)('a' + xorshift64() % 3);
+            break;
+        case 1: // '\0' and bytes above 127 inside
+            n = xorshift64() % 20;
+            for (size_t k = 0; k < n; ++k)
+                s[k] = (char)(xorshift64() % 4 == 0 ? 0 : xorshift64() % 3 == 0 ? 0xC5 : 'x');
+            break;
+        case 2: // a long common prefix
+            n = 40 + xorshift64() % 60;
+            memset(s, 'p', n);
+            for (int k = 0; k < 2; ++k)
+                s[30 + xorshift64() % (n - 30)] = (char)('a' + xorshift64() % 4);
+            break;
+        default: // one of a few
+            n = 5 + xorshift64() % 3;
+            memset(s, 'a' + xorshift64() % 4, n);
+            break;
+    }
+    return n;
+}
+
+int check_sort(void) {
+    static char s[128];
+    static StrRef refs[CHECK_COUNT], expected[CHECK_COUNT];
+    int errors = 0;
+    for (int round = 0; round < 200; ++round) {
+        StrPool p;
+        if (!str_pool_init(&p, 0, 0))
+            return errors + 1;
+        size_t n = round < 4 * STR_POOL_SMALL ? (size_t)round : xorshift64() % CHECK_COUNT;
+        int kinds = 1 + round % 4;
+        for (size_t k = 0; k < n; ++k) {
+            size_t len = random_string(s, (int)(xorshift64() % kinds));
+            errors += str_pool_add(&p, s, len) != k;
+        }
+        memcpy(refs, p.refs, n * sizeof(*refs));
+        memcpy(expected, p.refs, n * sizeof(*refs));
+        compared_pool = &p;
+        qsort(expected, n, sizeof(*expected), compare_refs);
+        errors += !str_pool_sort(&p, refs, n);
+        for (size_t k = 0; k < n; ++k) // equal strings may be in another order: compare the strings
+            errors += str_ref_compare(&p, refs[k], expected[k]) != 0;
+
+        size_t unique = str_pool_unique(&p, refs, n);
+        size_t distinct = 0;
+        for (size_t k = 0; k < n; ++k)
+            distinct += k == 0 || str_ref_compare(&p, expected[k - 1], expected[k]) != 0;
+        errors += unique != distinct;
+        for (size_t k = 1; k < unique; ++k)
+            errors += str_ref_compare(&p, refs[k - 1], refs[k]) >= 0;
+
+        // interning every string again gives the first copy of each, and only distinct
+        // strings get a new id
+        StrPool q;
+        if (!str_pool_init(&q, 0, 0))
+            return errors + 1;
+        for (size_t k = 0; k < n; ++k) {
+            StrRef r = p.refs[k];
+            uint32_t id = str_pool_intern(&q, str_pool_get(&p, r), r.length);
+            StrRef copy = q.refs[id];
+            errors += copy.length != r.length || memcmp(str_pool_get(&q, copy), str_pool_get(&p, r), r.length) != 0;
+        }
+        errors += q.count != distinct;
+        str_pool_free(&q);
+        str_pool_free(&p);
+    }
+    return errors;
+}
+
+// Every string but one equal to the others in the next byte, at every depth: the sort
+// must not need a stack frame per byte.
+int check_nested_prefixes(void) {
+    int errors = 0;
+    StrPool p;
+    char *s = malloc(LONG_PREFIX + 1);
+    StrRef *refs = malloc(NESTED_COUNT * sizeof(*refs));
+    if (!s || !refs || !str_pool_init(&p, 0, 0)) {
+        free(s);
+        free(refs);
+        return 1;
+    }
+    memset(s, 'a', NESTED_COUNT);
+    for (size_t k = 0; k < NESTED_COUNT; ++k) // in a shuffled order
+        str_pool_add(&p, s, 1 + (k * 1237) % NESTED_COUNT);
+    memcpy(refs, p.refs, NESTED_COUNT * sizeof(*refs));
+    errors += !str_pool_sort(&p, refs, NESTED_COUNT);
+    for (size_t k = 0; k < NESTED_COUNT; ++k)
+        errors += refs[k].length != k + 1;
+    str_pool_free(&p);
+
+    // a few strings equal in LONG_PREFIX bytes, then different
+    if (!str_pool_init(&p, 0, 0)) {
+        free(s);
+        free(refs);
+        return errors + 1;
+    }
+    memset(s, 'p', LONG_PREFIX);
+    for (int k = 0; k < 20; ++k) {
+        s[LONG_PREFIX] = (char)('a' + k * 7 % 20);
+        str_pool_add(&p, s, LONG_PREFIX + 1);
+    }
+    memcpy(refs, p.refs, 20 * sizeof(*refs));
+    errors += !str_pool_sort(&p, refs, 20);
+    for (int k = 0; k < 20; ++k)
+        errors += str_pool_get(&p, refs[k])[LONG_PREFIX] != 'a' + k;
+    str_pool_free(&p);
+    free(s);
+    free(refs);
+    return errors;
+}
+
+// ---- Benchmark ----
+
+// Short strings like user names or words: 5 to 14 letters, from a vocabulary of n / 4.
+char *next_word(char *s, uint64_t id) {
+    uint64_t x = id * 0x9E3779B97F4A7C15ULL;
+    size_t n = 5 + x % 10;
+    for (size_t k = 0; k < n; ++k) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        s[k] = (char)('a' + (x >> 59) % 26);
+    }
+    s[n] = '\0';
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 10000000;
+    for (int k = 1; k < argc; ++k) {
+        if (k + 1 < argc && strcmp(argv[k], "-n") == 0) {
+            n = strtoull(argv[++k], NULL, 10);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[k]);
+            return 1;
+        }
+    }
+
+    int errors = 0;
+    printf("--- 1. Character arrays ---\n");
+    char names[6][20] = {"Veli", "Ali", "Selami", "Ayse", "Ali", "Veli Can"};
+    StrPool p;
+    if (!str_pool_init(&p, 0, 0))
+        return 1;
+    for (int k = 0; k < 6; ++k)
+        str_pool_intern(&p, names[k], strlen(names[k]));
+    StrRef sorted[6];
+    memcpy(sorted, p.refs, p.count * sizeof(*sorted));
+    str_pool_sort(&p, sorted, p.count);
+    printf("%zu names, %zu distinct, sorted:", (size_t)6, p.count);
+    for (size_t k = 0; k < p.count; ++k)
+        printf(" %s", str_pool_get(&p, sorted[k]));
+    printf("\n");
+    errors += p.count != 5 || strcmp(str_pool_get(&p, sorted[1]), "Ayse") != 0 ||
+              strcmp(str_pool_get(&p, sorted[4]), "Veli Can") != 0;
+    str_pool_free(&p);
+
+    printf("\n--- 2. Checks against qsort ---\n");
+    int check_errors = check_sort();
+    printf("%s\n", check_errors ? "MISMATCH" : "all orders, unique counts and ids match");
+    errors += check_errors;
+    check_errors = check_nested_prefixes();
+    printf("%s\n", check_errors ? "MISMATCH" : "nested prefixes and 1 MB common prefixes are sorted");
+    errors += check_errors;
+
+    printf("\n--- 3. %zu short strings, seconds, best of %d ---\n", n, REPEAT);
+    char **strings = malloc((n ? n : 1) * sizeof(*strings));
+    char **by_qsort = malloc((n ? n : 1) * sizeof(*by_qsort));
+    StrRef *copy = malloc((n ? n : 1) * sizeof(*copy));
+    if (!strings || !by_qsort || !copy || !str_pool_init(&p, n * 11, n)) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    uint64_t vocabulary = n / 4 + 1;
+    for (size_t k = 0; k < n; ++k) {
+        char word[16];
+        next_word(word, xorshift64() % vocabulary);
+        size_t len = strlen(word);
+        strings[k] = malloc(len + 1); // as separate allocations, the usual array of char *
+        if (!strings[k] || str_pool_add(&p, word, len) == STR_POOL_FAILED) {
+            fprintf(stderr, "out of memory for n = %zu\n", n);
+            return 1;
+        }
+        memcpy(strings[k], word, len + 1);
+    }
+    // the allocations in a random order, as after a program has run for a while
+    for (size_t k = n; k > 1; --k) {
+        size_t j = xorshift64() % k;
+        char *t = strings[k - 1];
+        strings[k - 1] = strings[j];
+        strings[j] = t;
+        StrRef r = p.refs[k - 1];
+        p.refs[k - 1] = p.refs[j];
+        p.refs[j] = r;
+    }
+
+    enum { QSORT_POINTERS, QSORT_HANDLES, RADIX, SORT_UNIQUE, INTERN, METHOD_COUNT };
+    static const char *const names_of[] = {"qsort + strcmp, char *", "qsort, pool handles", "str_pool_sort",
+                                           "sort + unique", "intern"};
+    char **pointers = malloc((n ? n : 1) * sizeof(*pointers));
+    if (!pointers)
+        return 1;
+    size_t distinct[METHOD_COUNT] = {0};
+    for (int m = 0; m < METHOD_COUNT; ++m) {
+        double best = 1e30;
+        for (int r = 0; r < REPEAT; ++r) {
+            memcpy(pointers, strings, n * sizeof(*pointers));
+            memcpy(copy, p.refs, n * sizeof(*copy));
+            compared_pool = &p;
+            StrPool interned;
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            switch (m) {
+                case QSORT_POINTERS: qsort(pointers, n, sizeof(*pointers), compare_strings); break;
+                case QSORT_HANDLES : qsort(copy, n, sizeof(*copy), compare_refs); break;
+                case RADIX         : errors += !str_pool_sort(&p, copy, n); break;
+                case SORT_UNIQUE   :
+                    errors += !str_pool_sort(&p, copy, n);
+                    distinct[m] = str_pool_unique(&p, copy, n);
+                    break;
+                case INTERN:
+                    if (!str_pool_init(&interned, 0, 0))
+                        return 1;
+                    for (size_t k = 0; k < n; ++k)
+                        str_pool_intern(&interned, str_pool_get(&p, p.refs[k]), p.refs[k].length);
+                    distinct[m] = interned.count;
+                    break;
+            }
+            double t = seconds_since(t0);
+            if (m == INTERN)
+                str_pool_free(&interned);
+            if (t < best)
+                best = t;
+            if (m == QSORT_POINTERS)
+                memcpy(by_qsort, pointers, n * sizeof(*pointers));
+            else if (m == RADIX)
+                for (size_t k = 0; k < n; ++k)
+                    errors += strcmp(by_qsort[k], str_pool_get(&p, copy[k])) != 0;
+        }
+        printf("%-24s %8.3f", names_of[m], best);
+        if (m >= SORT_UNIQUE)
+            printf("   %zu distinct", distinct[m]);
+        printf("\n");
+    }
+    errors += distinct[SORT_UNIQUE] != distinct[INTERN];
+
+    for (size_t k = 0; k < n; ++k)
+        free(strings[k]);
+    free(strings);
+    free(pointers);
+    free(by_qsort);
+    free(copy);
+    str_pool_free(&p);
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,184 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+/*
+Arena allocator (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 5_string_builder.c builder.c arena.c -o string_builder
+*/
+
+struct ArenaBlock {
+    ArenaBlock *next; // the older block
+    size_t size;
+    _Alignas(16) char data[];
+};
+
+void arena_init(Arena *a, size_t block_size) {
+    a->head = a->large = a->kept = NULL;
+    a->next = a->end = NULL;
+    a->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+    a->mark_head = a->mark_large = NULL;
+    a->mark_next = NULL;
+    a->mark_serial = a->serial = 0;
+}
+
+// Frees the blocks from b on, up to (not including) stop.
+static void free_blocks(ArenaBlock *b, ArenaBlock *stop) {
+    while (b != stop) {
+        ArenaBlock *older = b->next;
+        free(b);
+        b = older;
+    }
+}
+
+void arena_free(Arena *a) {
+    free_blocks(a->head, NULL);
+    free_blocks(a->large, NULL);
+    free_blocks(a->kept, NULL);
+    arena_init(a, a->block_size);
+}
+
+static inline char *align_up(char *p, size_t align) {
+    return (char *)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+}
+
+static void *new_block(Arena *a, size_t size, size_t align) {
+    int own = size > a->block_size / 4;
+    size_t data_size = own ? size + align : a->block_size;
+    ArenaBlock *b = malloc(sizeof(*b) + data_size);
+    if (!b)
+        return NULL;
+    b->size = data_size;
+    char *p = align_up(b->data, align);
+    if (own) {
+        b->next = a->large;
+        a->large = b;
+        return p;
+    }
+    b->next = a->head;
+    a->head = b;
+    a->next = p + size;
+    a->end = b->data + data_size;
+    return p;
+}
+
+void *arena_alloc(Arena *a, size_t size, size_t align) {
+    char *p = align_up(a->next, align);
+    size_t room = (size_t)(a->end - a->next);
+    if (a->head && size <= room && (size_t)(p - a->next) <= room - size) {
+        a->next = p + size;
+        return p;
+    }
+    return new_block(a, size, align);
+}
+
+void *arena_grow(Arena *a, void *p, size_t old_size, size_t new_size) {
+    char *c = p;
+    // Only what was allocated after the newest mark may grow in place or move: the mark
+    // points to the blocks before it, and its release rewinds to mark_next.
+    if (c && c + old_size == a->next && (a->head != a->mark_head || c >= a->mark_next) && new_size - old_size <= (size_t)(a->end - a->next)) {
+        a->next = c + new_size; // the last allocation: it just gets longer
+        return p;
+    }
+    if (c && a->large && a->large != a->mark_large && c == a->large->data) { // the newest block of its own
+        ArenaBlock *b = realloc(a->large, sizeof(*b) + new_size);
+        if (!b)
+            return NULL;
+        b->size = new_size;
+        a->large = b;
+        return b->data;
+    }
+    void *q = arena_alloc(a, new_size, 1);
+    if (q && old_size)
+        memcpy(q, p, old_size < new_size ? old_size : new_size);
+    return q;
+}
+
+void *arena_grow_kept(Arena *a, void *p, size_t old_size, size_t new_size) {
+    ArenaBlock *b;
+    if (p && a->kept && p == a->kept->data) { // no mark points into the kept list
+        b = realloc(a->kept, sizeof(*b) + new_size);
+        if (!b)
+            return NULL;
+        b->size = new_size;
+        a->kept = b;
+        return b->data;
+    }
+    b = malloc(sizeof(*b) + new_size);
+    if (!b)
+        return NULL;
+    b->size = new_size;
+    b->next = a->kept;
+    a->kept = b;
+    if (p && old_size)
+        memcpy(b->data, p, old_size < new_size ? old_size : new_size);
+    return b->data;
+}
+
+char *arena_strndup(Arena *a, const char *s, size_t n) {
+    char *p = arena_alloc(a, n + 1, 1);
+    if (p) {
+        memcpy(p, s, n);
+        p[n] = '\0';
+    }
+    return p;
+}
+
+// Keeps only the newest ordinary block, empty.
+static void rewind_blocks(Arena *a) {
+    if (!a->head)
+        return;
+    free_blocks(a->head->next, NULL);
+    a->head->next = NULL;
+    a->next = a->head->data;
+    a->end = a->head->data + a->head->size;
+}
+
+void arena_reset(Arena *a) {
+    free_blocks(a->large, NULL);
+    free_blocks(a->kept, NULL);
+    a->large = a->kept = NULL;
+    rewind_blocks(a);
+    a->mark_head = a->mark_large = NULL; // every mark is gone
+    a->mark_next = NULL;
+    a->mark_serial = 0;
+}
+
+ArenaMark arena_mark(Arena *a) {
+    ArenaMark mark = {a->head, a->large, a->next, a->mark_head, a->mark_large, a->mark_next, a->mark_serial};
+    a->mark_head = a->head;
+    a->mark_large = a->large;
+    a->mark_next = a->next;
+    a->mark_serial = ++a->serial;
+    return mark;
+}
+
+void arena_release(Arena *a, ArenaMark mark) {
+    free_blocks(a->large, mark.large);
+    a->large = mark.large;
+    if (mark.head) {
+        free_blocks(a->head, mark.head);
+        a->head = mark.head;
+        a->next = mark.next;
+        a->end = mark.head->data + mark.head->size;
+    } else {
+        rewind_blocks(a);
+    }
+    a->mark_head = mark.outer_head;
+    a->mark_large = mark.outer_large;
+    a->mark_next = mark.outer_next;
+    a->mark_serial = mark.outer_serial;
+}
+
+size_t arena_used(const Arena *a) {
+    size_t total = 0;
+    for (const ArenaBlock *b = a->head; b; b = b->next)
+        total += b->size;
+    for (const ArenaBlock *b = a->large; b; b = b->next)
+        total += b->size;
+    for (const ArenaBlock *b = a->kept; b; b = b->next)
+        total += b->size;
+    return total;
+}
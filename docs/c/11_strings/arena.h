@@ -0,0 +1,67 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+Arena allocator (interface). Memory is handed out from large blocks by moving a pointer
+(a bump allocator), and given back all at once: arena_reset after a request, or
+arena_release to a mark taken earlier. There is no free of a single allocation, and no
+header per allocation, so thousands of small strings cost one malloc per block.
+
+A request larger than a quarter block gets a block of its own, kept in a second list so
+the free space of the current block stays in use. arena_reset keeps the newest ordinary
+block for the next round, so a loop that resets after every request does not call
+malloc once it is warmed up. arena_grow extends the last allocation in place when there
+is room behind it, and reallocates a block of its own; this is how a string builder in
+an arena grows.
+
+Marks nest: arena_release gives back everything allocated after its mark, and the
+arena remembers the newest live mark so that nothing older than it moves or grows
+into space the release reclaims. An allocation made before that mark is grown with
+arena_grow_kept instead, into a block of its own in a third list that arena_release
+leaves alone (arena_reset and arena_free free it); a string builder started before
+the mark does this by itself.
+*/
+
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;  // newest block, which next and end point into
+    ArenaBlock *large; // blocks of one allocation each, newest first
+    ArenaBlock *kept;  // blocks of arena_grow_kept, newest first
+    char *next, *end;
+    size_t block_size;
+    // the newest live mark (all 0 if none), and the number of marks taken so far
+    ArenaBlock *mark_head, *mark_large;
+    char *mark_next;
+    unsigned long mark_serial, serial;
+} Arena;
+
+typedef struct {
+    ArenaBlock *head, *large;
+    char *next;
+    // the mark that was the newest before this one
+    ArenaBlock *outer_head, *outer_large;
+    char *outer_next;
+    unsigned long outer_serial;
+} ArenaMark;
+
+void arena_init(Arena *a, size_t block_size); // 0: ARENA_DEFAULT_BLOCK
+void arena_free(Arena *a);
+
+// All return NULL if malloc fails. align must be a power of two.
+void *arena_alloc(Arena *a, size_t size, size_t align);
+void *arena_grow(Arena *a, void *p, size_t old_size, size_t new_size); // p: from arena_alloc with align 1
+// For p allocated before the newest mark (or NULL): storage that survives arena_release.
+void *arena_grow_kept(Arena *a, void *p, size_t old_size, size_t new_size);
+char *arena_strndup(Arena *a, const char *s, size_t n);                 // n bytes and a '\0'
+
+void arena_reset(Arena *a);
+ArenaMark arena_mark(Arena *a);
+void arena_release(Arena *a, ArenaMark mark); // frees everything allocated after the mark but kept blocks
+size_t arena_used(const Arena *a);            // bytes in blocks, for statistics
+
+#endif
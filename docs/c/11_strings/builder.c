@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "builder.h"
+
+/*
+String builder module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 5_string_builder.c builder.c arena.c -o string_builder
+*/
+
+#define MIN_HEAP_CAPACITY 64
+
+void sb_init(StringBuilder *b, Arena *arena) {
+    b->data = b->small;
+    b->data[0] = '\0';
+    b->length = 0;
+    b->capacity = SB_INLINE;
+    b->arena = arena;
+    b->arena_serial = arena ? arena->serial : 0;
+    b->failed = 0;
+}
+
+void sb_free(StringBuilder *b) {
+    if (b->data != b->small && !b->arena)
+        free(b->data);
+    sb_init(b, b->arena);
+}
+
+// The slow part of sb_reserve: at least double the capacity.
+static int grow(StringBuilder *b, size_t needed) {
+    if (b->failed)
+        return 0;
+    size_t capacity = b->capacity * 2;
+    if (capacity < needed)
+        capacity = needed;
+    if (capacity < MIN_HEAP_CAPACITY)
+        capacity = MIN_HEAP_CAPACITY;
+    char *p;
+    Arena *a = b->arena;
+    int kept = a && a->mark_serial > b->arena_serial; // a mark taken after the builder started
+    if (b->data == b->small) {
+        p = !a ? malloc(capacity) : kept ? arena_grow_kept(a, NULL, 0, capacity) : arena_alloc(a, capacity, 1);
+        if (p)
+            memcpy(p, b->small, b->length + 1);
+    } else {
+        p = !a ? realloc(b->data, capacity)
+            : kept ? arena_grow_kept(a, b->data, b->capacity, capacity)
+                   : arena_grow(a, b->data, b->capacity, capacity);
+    }
+    if (!p) {
+        b->failed = 1;
+        return 0;
+    }
+    b->data = p;
+    b->capacity = capacity;
+    return 1;
+}
+
+int sb_reserve(StringBuilder *b, size_t extra) {
+    if (extra < b->capacity - b->length)
+        return !b->failed;
+    if (extra > SIZE_MAX / 2 - b->length) {
+        b->failed = 1;
+        return 0;
+    }
+    return grow(b, b->length + extra + 1);
+}
+
+void sb_append(StringBuilder *b, const char *s, size_t n) {
+    if (!sb_reserve(b, n))
+        return;
+    memcpy(b->data + b->length, s, n);
+    b->length += n;
+    b->data[b->length] = '\0';
+}
+
+void sb_append_str(StringBuilder *b, const char *s) {
+    sb_append(b, s, strlen(s));
+}
+
+void sb_append_char(StringBuilder *b, char c) {
+    if (!sb_reserve(b, 1))
+        return;
+    b->data[b->length++] = c;
+    b->data[b->length] = '\0';
+}
+
+void sb_append_int(StringBuilder *b, int64_t value) {
+    char digits[20];
+    int n = 0;
+    uint64_t u = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    do {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (!sb_reserve(b, (size_t)n + 1))
+        return;
+    char *p = b->data + b->length;
+    if (value < 0)
+        *p++ = '-';
+    while (n)
+        *p++ = digits[--n];
+    *p = '\0';
+    b->length = (size_t)(p - b->data);
+}
+
+void sb_vprintf(StringBuilder *b, const char *format, va_list args) {
+    if (b->failed)
+        return;
+    va_list again;
+    va_copy(again, args);
+    size_t room = b->capacity - b->length;
+    int n = vsnprintf(b->data + b->length, room, format, args);
+    if (n >= 0 && (size_t)n >= room) { // did not fit: grow to the exact size, format again
+        b->data[b->length] = '\0';
+        if (sb_reserve(b, (size_t)n))
+            vsnprintf(b->data + b->length, (size_t)n + 1, format, again);
+    }
+    va_end(again);
+    if (n < 0)
+        b->failed = 1;
+    else if (!b->failed)
+        b->length += (size_t)n;
+    b->data[b->length] = '\0';
+}
+
+void sb_printf(StringBuilder *b, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    sb_vprintf(b, format, args);
+    va_end(args);
+}
+
+char *sb_detach(StringBuilder *b) {
+    char *s = NULL;
+    if (!b->failed && !b->arena) {
+        if (b->data != b->small) {
+            s = b->data;
+            b->data = b->small;
+        } else if ((s = malloc(b->length + 1)) != NULL) {
+            memcpy(s, b->small, b->length + 1);
+        }
+    }
+    sb_free(b);
+    return s;
+}
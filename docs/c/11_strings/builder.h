@@ -0,0 +1,61 @@
+#ifndef BUILDER_H
+#define BUILDER_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+
+/*
+String builder module (interface). 6_functions/20_stdlib_demo.c appends with strcat into
+char buf[64]: nothing checks that the result fits, and every strcat walks the whole
+string again to find its end, so n appends cost O(n^2).
+
+A StringBuilder knows its length and capacity. An append is a memcpy to data + length;
+when the text does not fit, the capacity doubles, so n bytes cost O(n) copies in total.
+The first SB_INLINE bytes live in the builder itself and need no allocation at all.
+sb_printf formats straight into the free space behind the text; only if that is too
+small does it grow to the exact size and format again, and no temporary buffer is used.
+
+With an arena, the storage comes from the arena and grows with arena_grow, which
+usually extends it in place; nothing is freed separately, arena_reset or arena_release
+frees it together with the rest of the request. A builder started before the newest
+arena_mark grows with arena_grow_kept instead, so that releasing the mark does not take
+its text along. Without an arena the storage comes from malloc.
+
+If an allocation fails the builder keeps its text, ignores later appends and sets
+failed; check it once at the end instead of after every call. data points into the
+builder while the text is inline, so a StringBuilder must not be copied by value.
+*/
+
+#define SB_INLINE 48
+
+typedef struct {
+    char *data;       // always '\0'-terminated
+    size_t length;
+    size_t capacity;  // bytes at data, including the one for the '\0'
+    Arena *arena;     // NULL: malloc
+    unsigned long arena_serial; // marks taken in the arena before sb_init
+    int failed;
+    char small[SB_INLINE];
+} StringBuilder;
+
+void sb_init(StringBuilder *b, Arena *arena);
+void sb_free(StringBuilder *b); // frees malloc storage; arena storage goes with the arena
+
+int sb_reserve(StringBuilder *b, size_t extra); // room for extra more bytes; 0 on failure
+void sb_append(StringBuilder *b, const char *s, size_t n);
+void sb_append_str(StringBuilder *b, const char *s);
+void sb_append_char(StringBuilder *b, char c);
+void sb_append_int(StringBuilder *b, int64_t value);
+void sb_printf(StringBuilder *b, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void sb_vprintf(StringBuilder *b, const char *format, va_list args);
+
+static inline const char *sb_cstr(const StringBuilder *b) { return b->data; }
+static inline void sb_clear(StringBuilder *b) { b->length = 0; b->data[0] = '\0'; }
+
+// Hands the text over as a string for free(), and leaves the builder empty. Only for a
+// builder without an arena; returns NULL if it failed or the copy cannot be made.
+char *sb_detach(StringBuilder *b);
+
+#endif
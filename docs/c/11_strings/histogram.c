@@ -0,0 +1,354 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "histogram.h"
+
+/*
+Byte histogram module (implementation).
+Compile together with the program that uses it and link with -pthread, e.g.:
+    gcc -O2 -march=native -pthread 2_letter_histogram.c histogram.c -o histogram
+*/
+
+#define SUB_TABLES 4
+#define BLOCK (1 << 30)         // bytes per block: a 32-bit sub-table counter cannot overflow
+#define DEFAULT_UNIT (64 << 20) // bytes per work unit of histogram_files
+#define READ_BLOCK (1 << 20)    // bytes per read() for pipes and terminals
+
+typedef struct {
+    uint32_t bytes[SUB_TABLES][256];
+    uint32_t pairs[SUB_TABLES][LETTER_CLASSES * LETTER_CLASSES];
+} SubTables;
+
+// The class in the low 8 bits and class * LETTER_CLASSES above them: the index of the
+// pair (a, b) is (pair_code[a] >> 8) + (pair_code[b] & 0xFF).
+static unsigned pair_code[256];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void init_tables(void) {
+    for (int c = 0; c < 256; ++c) {
+        int k = OTHER_CLASS;
+        if (c >= 'a' && c <= 'z')
+            k = c - 'a';
+        else if (c >= 'A' && c <= 'Z')
+            k = c - 'A';
+        pair_code[c] = (unsigned)(k * LETTER_CLASSES) << 8 | (unsigned)k;
+    }
+}
+
+int letter_class(unsigned char c) {
+    pthread_once(&tables_once, init_tables);
+    return (int)(pair_code[c] & 0xFF);
+}
+
+void histogram_clear(Histogram *h, int with_bigrams) {
+    memset(h, 0, sizeof(*h));
+    h->with_bigrams = with_bigrams;
+    pthread_once(&tables_once, init_tables);
+}
+
+// ---- Kernels ----
+
+static void count_bytes(SubTables *t, const unsigned char *p, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        t->bytes[0][w & 0xFF]++;
+        t->bytes[1][(w >> 8) & 0xFF]++;
+        t->bytes[2][(w >> 16) & 0xFF]++;
+        t->bytes[3][(w >> 24) & 0xFF]++;
+        t->bytes[0][(w >> 32) & 0xFF]++;
+        t->bytes[1][(w >> 40) & 0xFF]++;
+        t->bytes[2][(w >> 48) & 0xFF]++;
+        t->bytes[3][w >> 56]++;
+    }
+    for (; i < n; ++i)
+        t->bytes[i % SUB_TABLES][p[i]]++;
+}
+
+// Pair i is (p[i - 1], p[i]). Both bytes are looked up again instead of carrying the class
+// of the previous byte, so no lookup waits for another one.
+static void count_pairs(SubTables *t, const unsigned char *p, size_t n) {
+    size_t i = 1;
+    for (; i + 4 <= n; i += 4) {
+        t->pairs[0][(pair_code[p[i - 1]] >> 8) + (pair_code[p[i]] & 0xFF)]++;
+        t->pairs[1][(pair_code[p[i]] >> 8) + (pair_code[p[i + 1]] & 0xFF)]++;
+        t->pairs[2][(pair_code[p[i + 1]] >> 8) + (pair_code[p[i + 2]] & 0xFF)]++;
+        t->pairs[3][(pair_code[p[i + 2]] >> 8) + (pair_code[p[i + 3]] & 0xFF)]++;
+    }
+    for (; i < n; ++i)
+        t->pairs[i % SUB_TABLES][(pair_code[p[i - 1]] >> 8) + (pair_code[p[i]] & 0xFF)]++;
+}
+
+static void fold(Histogram *h, const SubTables *t) {
+    for (int c = 0; c < 256; ++c)
+        h->bytes[c] += (uint64_t)t->bytes[0][c] + t->bytes[1][c] + t->bytes[2][c] + t->bytes[3][c];
+    if (h->with_bigrams) {
+        uint64_t *pairs = &h->bigrams[0][0];
+        for (int k = 0; k < LETTER_CLASSES * LETTER_CLASSES; ++k)
+            pairs[k] += (uint64_t)t->pairs[0][k] + t->pairs[1][k] + t->pairs[2][k] + t->pairs[3][k];
+    }
+}
+
+void histogram_add(Histogram *h, const void *data, size_t n) {
+    const unsigned char *p = data;
+    SubTables t;
+    for (size_t done = 0; done < n;) {
+        size_t len = n - done < BLOCK ? n - done : BLOCK;
+        memset(t.bytes, 0, sizeof(t.bytes));
+        count_bytes(&t, p + done, len);
+        if (h->with_bigrams) { // a second pass: fused with the byte counts it is slower
+            memset(t.pairs, 0, sizeof(t.pairs));
+            count_pairs(&t, p + done, len);
+        }
+        fold(h, &t);
+        done += len;
+        if (done < n) // the pair across the block border
+            histogram_add_pair(h, p[done - 1], p[done]);
+    }
+}
+
+void histogram_add_pair(Histogram *h, unsigned char first, unsigned char second) {
+    if (h->with_bigrams)
+        h->bigrams[pair_code[first] & 0xFF][pair_code[second] & 0xFF]++;
+}
+
+void histogram_merge(Histogram *into, const Histogram *other) {
+    for (int c = 0; c < 256; ++c)
+        into->bytes[c] += other->bytes[c];
+    if (into->with_bigrams && other->with_bigrams)
+        for (int a = 0; a < LETTER_CLASSES; ++a)
+            for (int b = 0; b < LETTER_CLASSES; ++b)
+                into->bigrams[a][b] += other->bigrams[a][b];
+}
+
+void histogram_letters(const Histogram *h, uint64_t letters[26]) {
+    for (int k = 0; k < 26; ++k)
+        letters[k] = h->bytes['A' + k] + h->bytes['a' + k];
+}
+
+uint64_t histogram_total(const Histogram *h) {
+    uint64_t total = 0;
+    for (int c = 0; c < 256; ++c)
+        total += h->bytes[c];
+    return total;
+}
+
+// ---- Parallel driver over memory ----
+
+typedef struct {
+    const unsigned char *p;
+    size_t n;
+    Histogram h;
+} ChunkTask;
+
+static void *chunk_task(void *arg) {
+    ChunkTask *t = arg;
+    histogram_add(&t->h, t->p, t->n);
+    return NULL;
+}
+
+void histogram_add_parallel(Histogram *h, const void *data, size_t n, int thread_count) {
+    ChunkTask *tasks = thread_count > 1 ? malloc(thread_count * sizeof(*tasks)) : NULL;
+    pthread_t *threads = tasks ? malloc(thread_count * sizeof(*threads)) : NULL;
+    int *started = threads ? calloc(thread_count, sizeof(*started)) : NULL;
+    if (!started) {
+        free(tasks);
+        free(threads);
+        histogram_add(h, data, n);
+        return;
+    }
+    const unsigned char *p = data;
+    for (int t = 0; t < thread_count; ++t) {
+        size_t first = n / thread_count * t / 64 * 64;
+        size_t last = t + 1 == thread_count ? n : n / thread_count * (t + 1) / 64 * 64;
+        tasks[t].p = p + first;
+        tasks[t].n = last - first;
+        histogram_clear(&tasks[t].h, h->with_bigrams);
+    }
+    for (int t = 1; t < thread_count; ++t)
+        started[t] = pthread_create(&threads[t], NULL, chunk_task, &tasks[t]) == 0;
+    chunk_task(&tasks[0]);
+    for (int t = 0; t < thread_count; ++t) {
+        if (t > 0 && started[t])
+            pthread_join(threads[t], NULL);
+        else if (t > 0)
+            chunk_task(&tasks[t]);
+        histogram_merge(h, &tasks[t].h);
+        if (t > 0 && tasks[t].n > 0 && tasks[t].p > p)
+            histogram_add_pair(h, tasks[t].p[-1], tasks[t].p[0]);
+    }
+    free(tasks);
+    free(threads);
+    free(started);
+}
+
+// ---- Files ----
+
+typedef struct {
+    int file;
+    off_t offset;
+    size_t n;
+    int error;
+} Unit;
+
+typedef struct {
+    const char *const *paths;
+    Unit *units;
+    size_t unit_count;
+    atomic_size_t next_unit;
+    size_t page;
+} UnitQueue;
+
+typedef struct {
+    UnitQueue *queue;
+    Histogram h;
+} FileWorker;
+
+// Maps the unit, starting one page early if it does not start the file, so that the
+// pair with the byte before it can be counted too.
+static int count_unit(Histogram *h, const char *path, const Unit *u, size_t page) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return errno;
+    size_t before = u->offset > 0 ? page : 0;
+    unsigned char *map = mmap(NULL, u->n + before, PROT_READ, MAP_PRIVATE, fd, u->offset - (off_t)before);
+    int error = map == MAP_FAILED ? errno : 0;
+    close(fd);
+    if (error)
+        return error;
+    madvise(map, u->n + before, MADV_SEQUENTIAL);
+    histogram_add(h, map + before, u->n);
+    if (before)
+        histogram_add_pair(h, map[before - 1], map[before]);
+    munmap(map, u->n + before);
+    return 0;
+}
+
+static void *file_worker(void *arg) {
+    FileWorker *w = arg;
+    UnitQueue *q = w->queue;
+    for (;;) {
+        size_t k = atomic_fetch_add_explicit(&q->next_unit, 1, memory_order_relaxed);
+        if (k >= q->unit_count)
+            break;
+        Unit *u = &q->units[k];
+        u->error = count_unit(&w->h, q->paths[u->file], u, q->page);
+    }
+    return NULL;
+}
+
+// Reads a pipe, a terminal or a file that cannot be mapped; returns 0 or an errno.
+static int count_stream(Histogram *h, int fd) {
+    unsigned char *block = malloc(READ_BLOCK);
+    if (!block)
+        return ENOMEM;
+    int have_last = 0;
+    unsigned char last = 0;
+    for (;;) {
+        ssize_t got = read(fd, block, READ_BLOCK);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0) {
+            int error = got < 0 ? errno : 0;
+            free(block);
+            return error;
+        }
+        histogram_add(h, block, (size_t)got);
+        if (have_last)
+            histogram_add_pair(h, last, block[0]);
+        last = block[got - 1];
+        have_last = 1;
+    }
+}
+
+int histogram_files(Histogram *h, const char *const *paths, int path_count, int thread_count, size_t unit_size,
+                    int *errors) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    unit_size = unit_size ? (unit_size + page - 1) / page * page : DEFAULT_UNIT;
+    if (thread_count < 1)
+        thread_count = 1;
+    int *error = calloc(path_count, sizeof(*error));
+    off_t *sizes = calloc(path_count, sizeof(*sizes));
+    if (!error || !sizes) {
+        free(error);
+        free(sizes);
+        for (int f = 0; f < path_count && errors; ++f)
+            errors[f] = ENOMEM;
+        return path_count;
+    }
+
+    // regular files become units; the others are read here, one after the other
+    size_t unit_count = 0;
+    for (int f = 0; f < path_count; ++f) {
+        struct stat st;
+        sizes[f] = -1;
+        if (strcmp(paths[f], "-") == 0)
+            error[f] = count_stream(h, STDIN_FILENO);
+        else if (stat(paths[f], &st) != 0)
+            error[f] = errno;
+        else if (S_ISREG(st.st_mode)) {
+            sizes[f] = st.st_size;
+            unit_count += ((size_t)st.st_size + unit_size - 1) / unit_size;
+        } else {
+            int fd = open(paths[f], O_RDONLY);
+            error[f] = fd < 0 ? errno : count_stream(h, fd);
+            if (fd >= 0)
+                close(fd);
+        }
+    }
+    UnitQueue queue = {paths, malloc((unit_count ? unit_count : 1) * sizeof(Unit)), unit_count, 0, page};
+    FileWorker *workers = calloc(thread_count, sizeof(*workers));
+    pthread_t *threads = malloc(thread_count * sizeof(*threads));
+    int *started = calloc(thread_count, sizeof(*started));
+    if (!queue.units || !workers || !threads || !started) {
+        for (int f = 0; f < path_count; ++f)
+            if (sizes[f] >= 0)
+                error[f] = ENOMEM;
+        queue.unit_count = 0;
+        thread_count = workers ? 1 : 0;
+    }
+    size_t k = 0;
+    for (int f = 0; f < path_count && queue.unit_count; ++f)
+        for (off_t offset = 0; offset < sizes[f]; offset += (off_t)unit_size) {
+            size_t rest = (size_t)(sizes[f] - offset);
+            queue.units[k++] = (Unit){f, offset, rest < unit_size ? rest : unit_size, 0};
+        }
+
+    for (int t = 0; t < thread_count; ++t) {
+        workers[t].queue = &queue;
+        histogram_clear(&workers[t].h, h->with_bigrams);
+    }
+    for (int t = 1; t < thread_count; ++t)
+        started[t] = pthread_create(&threads[t], NULL, file_worker, &workers[t]) == 0;
+    if (thread_count > 0)
+        file_worker(&workers[0]); // also takes the units of threads that did not start
+    for (int t = 0; t < thread_count; ++t) {
+        if (t > 0 && started[t])
+            pthread_join(threads[t], NULL);
+        histogram_merge(h, &workers[t].h);
+    }
+    for (size_t u = 0; u < queue.unit_count; ++u)
+        if (queue.units[u].error && !error[queue.units[u].file])
+            error[queue.units[u].file] = queue.units[u].error;
+
+    int failed = 0;
+    for (int f = 0; f < path_count; ++f) {
+        failed += error[f] != 0;
+        if (errors)
+            errors[f] = error[f];
+    }
+    free(queue.units);
+    free(workers);
+    free(threads);
+    free(started);
+    free(error);
+    free(sizes);
+    return failed;
+}
@@ -0,0 +1,63 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Byte histogram module (interface), replacing the strings chapter's letter counter, which
+does isalpha + toupper + letter_counter[...]++ for every character. When the same letter
+comes again before the previous increment is stored, the next increment has to wait for
+it; a run like "aaaa" becomes a chain of dependent load-add-stores.
+
+Here every byte is counted, 8 bytes per load, into 4 interleaved 32-bit sub-tables (byte
+i goes to table i % 4), so neighbouring equal bytes update different counters; the
+sub-tables are added into the 64-bit counts after every block. The case-folded letter
+counts are derived from the 256 byte counts afterwards (letters[k] = bytes['A' + k] +
+bytes['a' + k]), and the chapter's isalpha/toupper work disappears from the loop.
+
+Optionally the same pass counts bigrams of letter classes: 'a'..'z' with 'A'..'Z'
+folded onto them, and one class for every other byte, so "Ab" and "aB" are the same
+pair and "a." is letter a followed by a non-letter.
+
+Histograms of different pieces are added; the pair that spans two consecutive pieces
+is added separately (histogram_add_pair), so text can be cut anywhere and counted in
+parallel.
+*/
+
+#define LETTER_CLASSES 27 // 26 letters, then everything else
+#define OTHER_CLASS 26
+
+typedef struct {
+    uint64_t bytes[256];
+    uint64_t bigrams[LETTER_CLASSES][LETTER_CLASSES]; // [first][second]
+    int with_bigrams;
+} Histogram;
+
+void histogram_clear(Histogram *h, int with_bigrams);
+int letter_class(unsigned char c); // 0..25 for letters, OTHER_CLASS otherwise
+
+// Adds the bytes of data and the pairs inside it (not a pair with the byte before data).
+void histogram_add(Histogram *h, const void *data, size_t n);
+void histogram_add_pair(Histogram *h, unsigned char first, unsigned char second);
+void histogram_merge(Histogram *into, const Histogram *other);
+void histogram_letters(const Histogram *h, uint64_t letters[26]);
+uint64_t histogram_total(const Histogram *h);
+
+// Cuts data into one chunk per thread and adds everything, the border pairs too.
+// Runs on the calling thread if threads cannot be created.
+void histogram_add_parallel(Histogram *h, const void *data, size_t n, int thread_count);
+
+/*
+Adds the contents of files, each counted separately (no pair spans two files). Regular
+files are split into units of unit_size bytes (0: 64 MB; rounded up to whole pages) and
+the threads take the next unit from a shared counter, so a few large files and many
+small ones both keep all threads busy; every unit is mapped into memory on its own.
+"-" and other files that cannot be mapped are read in blocks on the calling thread.
+Returns the number of files that could not be read; if errors is not NULL, errors[f]
+is the errno of file f, or 0.
+*/
+int histogram_files(Histogram *h, const char *const *paths, int path_count, int thread_count, size_t unit_size,
+                    int *errors);
+
+#endif
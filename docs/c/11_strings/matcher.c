@@ -0,0 +1,352 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "matcher.h"
+
+/*
+Multi-pattern matcher module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 6_multi_match.c matcher.c -o multi_match
+*/
+
+#define FINAL 0x80000000u // flag of a transition into a state where a pattern ends
+#define ROW_MASK 0x7FFFFFFFu
+#define LANES 4
+#define LANE_BYTES 1024
+
+#if defined(__AVX2__)
+#define VEC 32
+typedef __m256i Vec;
+#define LOADU(p) _mm256_loadu_si256((const __m256i *)(p))
+#define SPLAT(c) _mm256_set1_epi8((char)(c))
+#define CMPEQ(x, y) _mm256_cmpeq_epi8(x, y)
+#define AND(x, y) _mm256_and_si256(x, y)
+#define MASK(x) ((uint32_t)_mm256_movemask_epi8(x))
+#elif defined(__SSE2__)
+#define VEC 16
+typedef __m128i Vec;
+#define LOADU(p) _mm_loadu_si128((const __m128i *)(p))
+#define SPLAT(c) _mm_set1_epi8((char)(c))
+#define CMPEQ(x, y) _mm_cmpeq_epi8(x, y)
+#define AND(x, y) _mm_and_si128(x, y)
+#define MASK(x) ((uint32_t)_mm_movemask_epi8(x))
+#endif
+
+// ---- Building ----
+
+static int build_automaton(Matcher *m) {
+    unsigned char used[256] = {0};
+    size_t total = 0;
+    for (size_t p = 0; p < m->count; ++p) {
+        for (size_t k = 0; k < m->lengths[p]; ++k)
+            used[m->bytes[m->starts[p] + k]] = 1;
+        total += m->lengths[p];
+    }
+    uint32_t columns = 1; // class 0: the bytes in no pattern
+    for (int c = 0; c < 256; ++c)
+        columns += used[c];
+    if (columns > 256) { // every byte is used: no class to share
+        for (int c = 0; c < 256; ++c)
+            m->byte_class[c] = (uint8_t)c;
+        columns = 256;
+    } else {
+        uint32_t next_class = 1;
+        for (int c = 0; c < 256; ++c)
+            m->byte_class[c] = used[c] ? (uint8_t)next_class++ : 0;
+    }
+    if ((uint64_t)(total + 1) * columns > ROW_MASK)
+        return 0;
+    m->columns = columns;
+    size_t max_states = total + 1;
+    uint32_t *next = calloc(max_states * columns, sizeof(*next));
+    uint32_t *fail = malloc(max_states * sizeof(*fail)), *queue = malloc(max_states * sizeof(*queue));
+    m->first = malloc(max_states * sizeof(*m->first));
+    m->same = malloc((m->count ? m->count : 1) * sizeof(*m->same));
+    m->dict = calloc(max_states, sizeof(*m->dict));
+    if (!next || !fail || !queue || !m->first || !m->same || !m->dict) {
+        free(next);
+        free(fail);
+        free(queue);
+        return 0;
+    }
+    for (size_t s = 0; s < max_states; ++s)
+        m->first[s] = -1;
+
+    // the trie; the patterns go in from the last, so the list of equal ones is ascending
+    uint32_t states = 1;
+    for (size_t p = m->count; p-- > 0;) {
+        uint32_t s = 0;
+        for (size_t k = 0; k < m->lengths[p]; ++k) {
+            uint32_t *edge = &next[(size_t)s * columns + m->byte_class[m->bytes[m->starts[p] + k]]];
+            if (!*edge)
+                *edge = states++;
+            s = *edge;
+        }
+        m->same[p] = m->first[s];
+        m->first[s] = (int32_t)p;
+    }
+
+    // failure links breadth first; a missing edge becomes the edge of the failure state,
+    // whose row is already complete because it is less deep
+    size_t head = 0, tail = 0;
+    for (uint32_t c = 0; c < columns; ++c)
+        if (next[c]) {
+            fail[next[c]] = 0;
+            queue[tail++] = next[c];
+        }
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        uint32_t *row = &next[(size_t)s * columns];
+        const uint32_t *fail_row = &next[(size_t)fail[s] * columns];
+        for (uint32_t c = 0; c < columns; ++c) {
+            uint32_t t = row[c];
+            if (t) {
+                uint32_t f = fail_row[c];
+                fail[t] = f;
+                m->dict[t] = m->first[f] >= 0 ? f : m->dict[f];
+                queue[tail++] = t;
+            } else {
+                row[c] = fail_row[c];
+            }
+        }
+    }
+    free(fail);
+    free(queue);
+
+    for (size_t k = 0; k < (size_t)states * columns; ++k) {
+        uint32_t t = next[k];
+        next[k] = t * columns | (m->first[t] >= 0 || m->dict[t] ? FINAL : 0);
+    }
+    uint32_t *shrunk = realloc(next, (size_t)states * columns * sizeof(*next));
+    m->next = shrunk ? shrunk : next;
+    m->states = states;
+    return 1;
+}
+
+int matcher_init(Matcher *m, const char *const *patterns, const size_t *lengths, size_t count, MatcherMode mode) {
+    memset(m, 0, sizeof(*m));
+    m->count = count;
+    m->lengths = malloc((count ? count : 1) * sizeof(*m->lengths));
+    m->starts = malloc((count ? count : 1) * sizeof(*m->starts));
+    if (!m->lengths || !m->starts) {
+        matcher_free(m);
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t p = 0; p < count; ++p) {
+        size_t n = lengths ? lengths[p] : strlen(patterns[p]);
+        if (n == 0) {
+            matcher_free(m);
+            return 0;
+        }
+        m->lengths[p] = n;
+        m->starts[p] = total;
+        total += n;
+        if (n > m->max_length)
+            m->max_length = n;
+    }
+    m->bytes = malloc(total ? total : 1);
+    if (!m->bytes) {
+        matcher_free(m);
+        return 0;
+    }
+    for (size_t p = 0; p < count; ++p)
+        memcpy(m->bytes + m->starts[p], patterns[p], m->lengths[p]);
+
+    int fits = count > 0 && count <= MATCHER_PREFILTER_COUNT && m->max_length <= MATCHER_PREFILTER_LENGTH;
+    if (fits && mode != MATCHER_AUTOMATON) {
+        m->mode = MATCHER_PREFILTER;
+        return 1;
+    }
+    m->mode = MATCHER_AUTOMATON;
+    if (!build_automaton(m)) {
+        matcher_free(m);
+        return 0;
+    }
+    return 1;
+}
+
+void matcher_free(Matcher *m) {
+    free(m->lengths);
+    free(m->starts);
+    free(m->bytes);
+    free(m->next);
+    free(m->first);
+    free(m->same);
+    free(m->dict);
+    memset(m, 0, sizeof(*m));
+}
+
+size_t matcher_memory(const Matcher *m) {
+    size_t bytes = m->count * 2 * sizeof(size_t) + (m->count ? m->starts[m->count - 1] + m->lengths[m->count - 1] : 0);
+    if (m->mode == MATCHER_AUTOMATON)
+        bytes += (size_t)m->states * (m->columns * sizeof(*m->next) + sizeof(*m->first) + sizeof(*m->dict)) +
+                 m->count * sizeof(*m->same);
+    return bytes;
+}
+
+// ---- Scanning ----
+
+void match_stream_init(MatchStream *s, const Matcher *m) {
+    s->m = m;
+    s->offset = 0;
+    s->row = 0;
+    s->tail_length = 0;
+}
+
+// Reports the patterns that end in state at the offset end.
+static int report_state(const Matcher *m, uint32_t state, uint64_t end, MatchCallback callback, void *context) {
+    for (; state; state = m->dict[state])
+        for (int32_t p = m->first[state]; p >= 0; p = m->same[p])
+            if (callback(context, (size_t)p, end - m->lengths[p]))
+                return 0;
+    return 1;
+}
+
+// One block of LANES * LANE_BYTES bytes in LANES pieces scanned side by side: the chain
+// of dependent loads of one piece leaves the core idle most of the time. Every piece but
+// the first starts at the root max_length bytes early, which is enough to reach the
+// right state, since a state is never deeper than the longest pattern. The final states
+// are noted and reported afterwards in the order of the text.
+static int feed_lanes(MatchStream *s, const unsigned char *b, uint64_t offset, MatchCallback callback,
+                      void *context) {
+    const Matcher *m = s->m;
+    const uint32_t *next = m->next;
+    const uint8_t *byte_class = m->byte_class;
+    uint32_t hit_row[LANES][LANE_BYTES];
+    uint16_t hit_at[LANES][LANE_BYTES];
+    size_t hits[LANES] = {0};
+    const unsigned char *p0 = b, *p1 = b + LANE_BYTES, *p2 = b + 2 * LANE_BYTES, *p3 = b + 3 * LANE_BYTES;
+    uint32_t row0 = s->row, row1 = 0, row2 = 0, row3 = 0, t0, t1, t2, t3;
+    for (ptrdiff_t k = -(ptrdiff_t)m->max_length; k < 0; ++k) {
+        row1 = next[row1 + byte_class[p1[k]]] & ROW_MASK;
+        row2 = next[row2 + byte_class[p2[k]]] & ROW_MASK;
+        row3 = next[row3 + byte_class[p3[k]]] & ROW_MASK;
+    }
+#define STEP(j)                                  \
+    t##j = next[row##j + byte_class[p##j[k]]];   \
+    row##j = t##j & ROW_MASK;                    \
+    if (t##j & FINAL) {                          \
+        hit_row[j][hits[j]] = row##j;            \
+        hit_at[j][hits[j]++] = (uint16_t)k;      \
+    }
+    for (size_t k = 0; k < LANE_BYTES; ++k) {
+        STEP(0)
+        STEP(1)
+        STEP(2)
+        STEP(3)
+    }
+#undef STEP
+    s->row = row3;
+    for (int j = 0; j < LANES; ++j)
+        for (size_t h = 0; h < hits[j]; ++h)
+            if (!report_state(m, hit_row[j][h] / m->columns, offset + j * LANE_BYTES + hit_at[j][h] + 1, callback,
+                              context))
+                return 0;
+    return 1;
+}
+
+static int feed_automaton(MatchStream *s, const unsigned char *b, size_t n, MatchCallback callback, void *context) {
+    const Matcher *m = s->m;
+    size_t i = 0;
+    if (m->max_length <= LANE_BYTES / 8)
+        for (; n - i >= LANES * LANE_BYTES; i += LANES * LANE_BYTES)
+            if (!feed_lanes(s, b + i, s->offset + i, callback, context))
+                return 0;
+    const uint32_t *next = m->next;
+    const uint8_t *byte_class = m->byte_class;
+    uint32_t row = s->row;
+    for (; i < n; ++i) {
+        uint32_t t = next[row + byte_class[b[i]]];
+        row = t & ROW_MASK;
+        if (t & FINAL) {
+            if (!report_state(m, row / m->columns, s->offset + i + 1, callback, context))
+                return 0;
+        }
+    }
+    s->row = row;
+    return 1;
+}
+
+static inline int matches_at(const Matcher *m, size_t p, const unsigned char *b) {
+    return memcmp(b, m->bytes + m->starts[p], m->lengths[p]) == 0;
+}
+
+// Every pattern at every start from..to-1 of b that ends in b[0..n); base is the offset of b.
+static int scan_positions(const Matcher *m, const unsigned char *b, size_t from, size_t to, size_t n, uint64_t base,
+                          MatchCallback callback, void *context) {
+    for (size_t i = from; i < to; ++i)
+        for (size_t p = 0; p < m->count; ++p)
+            if (i + m->lengths[p] <= n && b[i] == m->bytes[m->starts[p]] && matches_at(m, p, b + i))
+                if (callback(context, p, base + i))
+                    return 0;
+    return 1;
+}
+
+static int feed_prefilter(MatchStream *s, const unsigned char *b, size_t n, MatchCallback callback, void *context) {
+    const Matcher *m = s->m;
+    size_t keep = m->max_length - 1;
+
+    // the matches that start in the tail and end in b
+    if (s->tail_length) {
+        unsigned char joined[2 * MATCHER_PREFILTER_LENGTH];
+        size_t t = s->tail_length, extra = n < keep ? n : keep;
+        memcpy(joined, s->tail, t);
+        memcpy(joined + t, b, extra);
+        uint64_t base = s->offset - t;
+        for (size_t i = 0; i < t; ++i)
+            for (size_t p = 0; p < m->count; ++p) {
+                size_t end = i + m->lengths[p];
+                if (end > t && end <= t + extra && matches_at(m, p, joined + i))
+                    if (callback(context, p, base + i))
+                        return 0;
+            }
+    }
+
+    size_t i = 0;
+#ifdef VEC
+    Vec first[MATCHER_PREFILTER_COUNT], middle[MATCHER_PREFILTER_COUNT], last[MATCHER_PREFILTER_COUNT];
+    for (size_t p = 0; p < m->count; ++p) {
+        const unsigned char *pattern = m->bytes + m->starts[p];
+        first[p] = SPLAT(pattern[0]);
+        middle[p] = SPLAT(pattern[m->lengths[p] / 2]);
+        last[p] = SPLAT(pattern[m->lengths[p] - 1]);
+    }
+    for (; i + VEC + keep <= n; i += VEC) {
+        uint32_t mask = 0;
+        for (size_t p = 0; p < m->count; ++p) {
+            Vec both = AND(CMPEQ(LOADU(b + i), first[p]), CMPEQ(LOADU(b + i + m->lengths[p] - 1), last[p]));
+            mask |= MASK(AND(both, CMPEQ(LOADU(b + i + m->lengths[p] / 2), middle[p])));
+        }
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (!scan_positions(m, b, at, at + 1, n, s->offset, callback, context))
+                return 0;
+        }
+    }
+#endif
+    if (!scan_positions(m, b, i, n, n, s->offset, callback, context))
+        return 0;
+
+    // the last keep bytes of everything fed so far
+    if (n >= keep) {
+        memcpy(s->tail, b + n - keep, keep);
+        s->tail_length = keep;
+    } else {
+        size_t old = s->tail_length + n > keep ? keep - n : s->tail_length;
+        memmove(s->tail, s->tail + s->tail_length - old, old);
+        memcpy(s->tail + old, b, n);
+        s->tail_length = old + n;
+    }
+    return 1;
+}
+
+int match_stream_feed(MatchStream *s, const void *data, size_t n, MatchCallback callback, void *context) {
+    int go_on = s->m->mode == MATCHER_PREFILTER ? feed_prefilter(s, data, n, callback, context)
+                                                 : feed_automaton(s, data, n, callback, context);
+    s->offset += n;
+    return go_on;
+}
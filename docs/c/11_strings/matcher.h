@@ -0,0 +1,83 @@
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Multi-pattern matcher module (interface). The loop statements chapter stops reading
+when "xyz" is typed: a counter of matched characters that goes back to 0 on any other
+character. On "xxyz" the second x sends it back to 0 although that x starts the pattern,
+so the input is missed; for one pattern the counter would have to go back to the
+longest prefix that is still matched, and for many patterns that is what Aho-Corasick
+computes ahead of time.
+
+  - Automaton: a trie of the patterns with every missing edge filled in from the failure
+    links, so every input byte is one table lookup and the scan never goes back. Bytes
+    that occur in no pattern share one column (byte classes), which keeps the table
+    small. An entry holds the row of the next state, premultiplied by the number of
+    columns, and a flag bit for states where a pattern ends; a flagged state walks its
+    dictionary links to report every pattern that ends there. Every load depends on the
+    one before, so a long buffer is cut into four pieces that are scanned side by side.
+  - Prefilter: for at most MATCHER_PREFILTER_COUNT patterns of at most
+    MATCHER_PREFILTER_LENGTH bytes. For 32 positions at a time (AVX2; 16 with SSE2) it
+    compares the first byte of a pattern at the position, its last byte len - 1 further
+    and its middle byte; only the positions where all three match are compared in full.
+    The middle byte costs little and keeps out most of the positions where a space or
+    a digit matched at both ends.
+
+A MatchStream scans the text in blocks of any size, e.g. as it is read from stdin, and
+finds the matches that cross the blocks: the automaton keeps its state, the prefilter
+the last bytes where a match may still start. All matches are reported, overlapping ones
+too, each when its last byte arrives. Within a block the automaton reports them in the
+order of their end, the prefilter in the order of their start.
+*/
+
+#define MATCHER_PREFILTER_COUNT 8
+#define MATCHER_PREFILTER_LENGTH 32
+
+typedef enum { MATCHER_AUTO, MATCHER_AUTOMATON, MATCHER_PREFILTER } MatcherMode;
+
+typedef struct {
+    MatcherMode mode;   // AUTOMATON or PREFILTER after matcher_init
+    size_t count;
+    size_t *lengths;
+    size_t *starts;     // of the patterns in bytes
+    unsigned char *bytes;
+    size_t max_length;
+    // automaton
+    uint32_t columns;   // byte classes
+    uint32_t states;
+    uint8_t byte_class[256];
+    uint32_t *next;     // [state * columns + class]: next state * columns, | flag
+    int32_t *first;     // [state]: the pattern ending here with the lowest index, or -1
+    int32_t *same;      // [pattern]: the next pattern equal to it, or -1
+    uint32_t *dict;     // [state]: the nearest state on the failure path with a pattern, or 0
+} Matcher;
+
+typedef struct {
+    const Matcher *m;
+    uint64_t offset;    // bytes fed so far
+    uint32_t row;       // automaton state * columns
+    size_t tail_length; // prefilter: the end of the text fed so far
+    unsigned char tail[MATCHER_PREFILTER_LENGTH];
+} MatchStream;
+
+// Called with the index of the pattern and the offset of its first byte in the stream;
+// a nonzero return stops the scan.
+typedef int (*MatchCallback)(void *context, size_t pattern, uint64_t offset);
+
+/*
+lengths may be NULL for '\0'-terminated patterns. Patterns may repeat and overlap, but
+must not be empty. MATCHER_PREFILTER is only used if the patterns fit it; MATCHER_AUTO
+chooses it when they do. Returns 0 if a pattern is empty or memory runs out.
+*/
+int matcher_init(Matcher *m, const char *const *patterns, const size_t *lengths, size_t count, MatcherMode mode);
+void matcher_free(Matcher *m);
+size_t matcher_memory(const Matcher *m); // bytes of tables
+
+void match_stream_init(MatchStream *s, const Matcher *m);
+// Returns 0 if the callback stopped the scan; the stream must not be fed after that.
+int match_stream_feed(MatchStream *s, const void *data, size_t n, MatchCallback callback, void *context);
+
+#endif
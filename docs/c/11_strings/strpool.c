@@ -0,0 +1,324 @@
+#include <stdlib.h>
+#include <string.h>
+#include "strpool.h"
+
+/*
+String pool module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 7_string_sort.c strpool.c -o string_sort
+*/
+
+#define SLACK 8 // bytes behind the last string, so that a key is always one 8-byte load
+
+// ---- Adding and interning ----
+
+int str_pool_init(StrPool *p, size_t expected_bytes, size_t expected_count) {
+    memset(p, 0, sizeof(*p));
+    p->capacity = expected_bytes + SLACK;
+    p->ref_capacity = expected_count ? expected_count : 16;
+    p->bytes = malloc(p->capacity);
+    p->refs = malloc(p->ref_capacity * sizeof(*p->refs));
+    if (!p->bytes || !p->refs) {
+        str_pool_free(p);
+        return 0;
+    }
+    return 1;
+}
+
+void str_pool_free(StrPool *p) {
+    free(p->bytes);
+    free(p->refs);
+    free(p->slots);
+    memset(p, 0, sizeof(*p));
+}
+
+uint32_t str_pool_add(StrPool *p, const char *s, size_t n) {
+    if (n + 1 > UINT32_MAX - p->size || p->count >= STR_POOL_FAILED - 1)
+        return STR_POOL_FAILED;
+    if (p->size + n + 1 + SLACK > p->capacity) {
+        size_t capacity = p->capacity * 2 > p->size + n + 1 + SLACK ? p->capacity * 2 : p->size + n + 1 + SLACK;
+        char *bytes = realloc(p->bytes, capacity);
+        if (!bytes)
+            return STR_POOL_FAILED;
+        p->bytes = bytes;
+        p->capacity = capacity;
+    }
+    if (p->count == p->ref_capacity) {
+        StrRef *refs = realloc(p->refs, p->ref_capacity * 2 * sizeof(*refs));
+        if (!refs)
+            return STR_POOL_FAILED;
+        p->refs = refs;
+        p->ref_capacity *= 2;
+    }
+    memcpy(p->bytes + p->size, s, n);
+    p->bytes[p->size + n] = '\0';
+    p->refs[p->count] = (StrRef){(uint32_t)p->size, (uint32_t)n};
+    p->size += n + 1;
+    return (uint32_t)p->count++;
+}
+
+static inline uint64_t hash_u64(uint64_t x) { // murmur3 finalizer
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// The hash of 10_arrays/hash_table.c: 8 bytes per step, the length mixed in.
+static uint64_t hash_bytes(const char *s, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len;
+    for (; len >= 8; s += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, s, 8);
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 29;
+    }
+    uint64_t w = 0;
+    memcpy(&w, s, len);
+    return hash_u64(h ^ w);
+}
+
+// The slot index comes from the stored 32 bits, so a rehash needs no string.
+static int grow_slots(StrPool *p) {
+    size_t count = p->slot_count ? p->slot_count * 2 : 1024;
+    InternSlot *slots = calloc(count, sizeof(*slots));
+    if (!slots)
+        return 0;
+    for (size_t k = 0; k < p->slot_count; ++k)
+        if (p->slots[k].id) {
+            size_t i = p->slots[k].hash & (count - 1);
+            while (slots[i].id)
+                i = (i + 1) & (count - 1);
+            slots[i] = p->slots[k];
+        }
+    free(p->slots);
+    p->slots = slots;
+    p->slot_count = count;
+    return 1;
+}
+
+uint32_t str_pool_intern(StrPool *p, const char *s, size_t n) {
+    if (p->interned + 1 > p->slot_count / 4 * 3 && !grow_slots(p))
+        return STR_POOL_FAILED;
+    uint32_t hash = (uint32_t)(hash_bytes(s, n) >> 32);
+    size_t mask = p->slot_count - 1, i = hash & mask;
+    for (; p->slots[i].id; i = (i + 1) & mask) {
+        const InternSlot *slot = &p->slots[i];
+        if (slot->hash == hash && slot->ref.length == n && memcmp(p->bytes + slot->ref.offset, s, n) == 0)
+            return slot->id - 1;
+    }
+    uint32_t id = str_pool_add(p, s, n);
+    if (id != STR_POOL_FAILED) {
+        p->slots[i] = (InternSlot){hash, id + 1, p->refs[id]};
+        p->interned++;
+    }
+    return id;
+}
+
+// ---- Comparing ----
+
+// a and b are equal in their first depth bytes (with zeros after the end).
+static int compare_from(const char *bytes, StrRef a, StrRef b, size_t depth) {
+    size_t la = a.length > depth ? a.length - depth : 0, lb = b.length > depth ? b.length - depth : 0;
+    int r = memcmp(bytes + a.offset + (la ? depth : a.length), bytes + b.offset + (lb ? depth : b.length),
+                   la < lb ? la : lb);
+    if (r)
+        return r;
+    return (a.length > b.length) - (a.length < b.length);
+}
+
+int str_ref_compare(const StrPool *p, StrRef a, StrRef b) {
+    return compare_from(p->bytes, a, b, 0);
+}
+
+size_t str_pool_unique(const StrPool *p, StrRef *refs, size_t n) {
+    size_t w = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (w == 0 || refs[i].length != refs[w - 1].length ||
+            memcmp(p->bytes + refs[i].offset, p->bytes + refs[w - 1].offset, refs[i].length) != 0)
+            refs[w++] = refs[i];
+    return w;
+}
+
+// ---- Sorting ----
+
+typedef struct {
+    const char *bytes;
+    StrRef *refs, *ref_tmp; // ref_tmp[k] is the scratch place of refs[k]
+    uint64_t *key_tmp;
+} Sorter;
+
+// Bytes depth..depth+7 of the string, big-endian, zeros after its end.
+static inline uint64_t load_key(const char *bytes, StrRef r, size_t depth) {
+    if (depth >= r.length)
+        return 0;
+    uint64_t w;
+    memcpy(&w, bytes + r.offset + depth, 8);
+    w = __builtin_bswap64(w);
+    size_t left = r.length - depth;
+    return left >= 8 ? w : w & ~(~0ULL >> (8 * left));
+}
+
+static void sort_group(const Sorter *s, StrRef *refs, uint64_t *keys, size_t n, size_t depth);
+static int load_group(const Sorter *s, StrRef *refs, uint64_t *keys, size_t n, size_t depth);
+
+static inline void swap2(StrRef *refs, uint64_t *keys, size_t i, size_t j) {
+    StrRef r = refs[i];
+    refs[i] = refs[j];
+    refs[j] = r;
+    uint64_t k = keys[i];
+    keys[i] = keys[j];
+    keys[j] = k;
+}
+
+// Multikey quicksort with 8-byte characters: a three-way partition on the keys; the
+// middle part is equal in 8 more bytes and goes on at depth + 8.
+static void multikey_quicksort(const Sorter *s, StrRef *refs, uint64_t *keys, size_t n, size_t depth) {
+    while (n > 1) {
+        if (n < 8) {
+            for (size_t i = 1; i < n; ++i)
+                for (size_t j = i; j > 0; --j) {
+                    int c = keys[j - 1] != keys[j] ? (keys[j - 1] > keys[j] ? 1 : -1)
+                                                   : compare_from(s->bytes, refs[j - 1], refs[j], depth + 8);
+                    if (c <= 0)
+                        break;
+                    swap2(refs, keys, j - 1, j);
+                }
+            return;
+        }
+        uint64_t a = keys[0], b = keys[n / 2], c = keys[n - 1];
+        uint64_t pivot = a < b ? (b < c ? b : a < c ? c : a) : (a < c ? a : b < c ? c : b);
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt) {
+            if (keys[i] < pivot)
+                swap2(refs, keys, lt++, i++);
+            else if (keys[i] > pivot)
+                swap2(refs, keys, i, --gt);
+            else
+                ++i;
+        }
+        if (lt == 0 && gt == n) { // all equal in 8 more bytes: go on without recursion
+            depth += 8;
+            if (!load_group(s, refs, keys, n, depth))
+                return;
+            continue;
+        }
+        multikey_quicksort(s, refs, keys, lt, depth);
+        sort_group(s, refs + lt, keys + lt, gt - lt, depth + 8);
+        refs += gt;
+        keys += gt;
+        n -= gt;
+    }
+}
+
+static int compare_length(const void *a, const void *b) {
+    const StrRef *x = a, *y = b;
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+// For strings that are equal in their first depth bytes: loads their keys at depth and
+// returns 1, or returns 0 if all have ended, after putting them in order of length
+// (they can only differ in '\0' bytes at the end).
+static int load_group(const Sorter *s, StrRef *refs, uint64_t *keys, size_t n, size_t depth) {
+    uint32_t shortest = refs[0].length, longest = refs[0].length;
+    for (size_t i = 1; i < n; ++i) {
+        if (refs[i].length < shortest)
+            shortest = refs[i].length;
+        if (refs[i].length > longest)
+            longest = refs[i].length;
+    }
+    if (longest <= depth) {
+        if (shortest < longest)
+            qsort(refs, n, sizeof(*refs), compare_length);
+        return 0;
+    }
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = load_key(s->bytes, refs[i], depth);
+    return 1;
+}
+
+// Radix passes on byte `byte` of the keys (0: the most significant) and on. Every bucket
+// but the largest is sorted by recursion, and the loop goes on with the largest, so a
+// recursive call gets at most half the strings and the stack holds at most log2(n)
+// frames of counters, however long the common prefixes are (nested prefixes such as
+// "a", "aa", "aaa", ... put all but one string into the same bucket at every depth).
+static void radix_pass(const Sorter *s, StrRef *refs, uint64_t *keys, size_t n, size_t depth, int byte) {
+    size_t count[256], start[256];
+    for (;;) {
+        if (n <= STR_POOL_SMALL) {
+            multikey_quicksort(s, refs, keys, n, depth);
+            return;
+        }
+        int shift = 56 - 8 * byte;
+        memset(count, 0, sizeof(count));
+        for (size_t i = 0; i < n; ++i)
+            count[(keys[i] >> shift) & 0xFF]++;
+        if (count[(keys[0] >> shift) & 0xFF] < n) {
+            size_t sum = 0;
+            for (int b = 0; b < 256; ++b) {
+                start[b] = sum;
+                sum += count[b];
+            }
+            StrRef *ref_tmp = s->ref_tmp + (refs - s->refs);
+            uint64_t *key_tmp = s->key_tmp + (refs - s->refs);
+            for (size_t i = 0; i < n; ++i) {
+                size_t at = start[(keys[i] >> shift) & 0xFF]++;
+                ref_tmp[at] = refs[i];
+                key_tmp[at] = keys[i];
+            }
+            memcpy(refs, ref_tmp, n * sizeof(*refs));
+            memcpy(keys, key_tmp, n * sizeof(*keys));
+            size_t largest = 0, largest_at = 0;
+            for (size_t b = 0, at = 0; b < 256; at += count[b++])
+                if (count[b] > count[largest]) {
+                    largest = b;
+                    largest_at = at;
+                }
+            for (size_t b = 0, at = 0; b < 256; at += count[b++]) {
+                if (b == largest || count[b] < 2)
+                    continue;
+                if (byte < 7)
+                    radix_pass(s, refs + at, keys + at, count[b], depth, byte + 1);
+                else
+                    sort_group(s, refs + at, keys + at, count[b], depth + 8);
+            }
+            if (count[largest] < 2)
+                return;
+            refs += largest_at;
+            keys += largest_at;
+            n = count[largest];
+        }
+        // The n strings left are equal in this byte.
+        if (++byte == 8) {
+            depth += 8;
+            byte = 0;
+            if (!load_group(s, refs, keys, n, depth))
+                return;
+        }
+    }
+}
+
+// Sorts strings that are equal in their first depth bytes.
+static void sort_group(const Sorter *s, StrRef *refs, uint64_t *keys, size_t n, size_t depth) {
+    if (n >= 2 && load_group(s, refs, keys, n, depth))
+        radix_pass(s, refs, keys, n, depth, 0);
+}
+
+int str_pool_sort(const StrPool *p, StrRef *refs, size_t n) {
+    uint64_t *keys = malloc((n ? n : 1) * sizeof(*keys)), *key_tmp = malloc((n ? n : 1) * sizeof(*key_tmp));
+    StrRef *ref_tmp = malloc((n ? n : 1) * sizeof(*ref_tmp));
+    if (!keys || !key_tmp || !ref_tmp) {
+        free(keys);
+        free(key_tmp);
+        free(ref_tmp);
+        return 0;
+    }
+    Sorter s = {p->bytes, refs, ref_tmp, key_tmp};
+    sort_group(&s, refs, keys, n, 0);
+    free(keys);
+    free(key_tmp);
+    free(ref_tmp);
+    return 1;
+}
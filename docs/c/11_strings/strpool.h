@@ -0,0 +1,68 @@
+#ifndef STRPOOL_H
+#define STRPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+String pool module (interface). The chapter on character arrays keeps every string in a
+char array of its own; many strings that way, or as an array of char * to separate
+mallocs, are scattered over the heap, and sorting them with qsort and strcmp follows a
+pointer to a new cache line at nearly every comparison.
+
+A StrPool keeps all its strings one after the other in one buffer, each with a '\0'
+behind it, and hands out StrRef handles: offset and length, 8 bytes. A handle stays
+valid when the buffer grows; a pointer from str_pool_get only until the next add.
+
+  - str_pool_sort: MSD radix sort on cached keys. The next 8 bytes of every string at
+    the current depth are loaded once into an array of uint64_t (big-endian, so that
+    comparing the numbers compares the bytes), and the radix passes and partitions
+    work on that array and the handles, both read sequentially; the strings are
+    visited again only when a group is still equal after 8 bytes. A range of at most
+    STR_POOL_SMALL strings goes to multikey quicksort on the same keys instead of
+    another radix pass, whose 256 counters cost more than the range itself.
+  - str_pool_intern: adds a string only if it is not there yet, and returns the id of
+    the copy. A slot of the table holds 32 bits of the hash and the handle, so a probe
+    touches the pool only when the hashes match.
+  - str_pool_unique: removes the repeated strings of a sorted array of handles.
+
+The order is that of memcmp, a shorter string before a longer one that starts with it;
+strings may contain '\0'. A pool holds up to 4 GB and UINT32_MAX - 1 strings.
+*/
+
+#define STR_POOL_SMALL 64
+#define STR_POOL_FAILED UINT32_MAX
+
+typedef struct {
+    uint32_t offset, length;
+} StrRef;
+
+typedef struct {
+    uint32_t hash;      // the high 32 bits
+    uint32_t id;        // + 1; 0: empty
+    StrRef ref;         // a copy of refs[id], which saves a cache miss per probe
+} InternSlot;
+
+typedef struct {
+    char *bytes;        // the strings, each followed by '\0'
+    size_t size, capacity;
+    StrRef *refs;       // [id]
+    size_t count, ref_capacity;
+    InternSlot *slots;  // intern table, open addressing with linear probing
+    size_t slot_count;  // a power of two, or 0
+    size_t interned;
+} StrPool;
+
+// Return 0 or STR_POOL_FAILED if memory runs out or the pool is full.
+int str_pool_init(StrPool *p, size_t expected_bytes, size_t expected_count);
+void str_pool_free(StrPool *p);
+uint32_t str_pool_add(StrPool *p, const char *s, size_t n);    // always a new copy
+uint32_t str_pool_intern(StrPool *p, const char *s, size_t n); // sees the strings added by intern only
+
+static inline const char *str_pool_get(const StrPool *p, StrRef r) { return p->bytes + r.offset; }
+
+int str_ref_compare(const StrPool *p, StrRef a, StrRef b); // < 0, 0, > 0 like memcmp
+int str_pool_sort(const StrPool *p, StrRef *refs, size_t n); // 0 if the scratch space could not be allocated
+size_t str_pool_unique(const StrPool *p, StrRef *refs, size_t n); // refs sorted; returns the new n
+
+#endif
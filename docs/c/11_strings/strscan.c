@@ -0,0 +1,325 @@
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "strscan.h"
+
+/*
+String scanning module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 4_string_scan.c strscan.c -o string_scan
+*/
+
+// The aligned loads read bytes outside the string, never outside its pages; the address
+// sanitizer cannot know that and would stop the program.
+#define PAGE_SAFE __attribute__((no_sanitize_address))
+
+#if defined(__AVX2__)
+#define VEC 32
+#define ALL_BITS 0xFFFFFFFFu
+typedef __m256i Vec;
+#define LOAD(p) _mm256_load_si256((const __m256i *)(p))
+#define SPLAT(c) _mm256_set1_epi8((char)(c))
+#define CMPEQ(x, y) _mm256_cmpeq_epi8(x, y)
+#define MASK(x) ((uint32_t)_mm256_movemask_epi8(x))
+#define EQ(x, y) MASK(CMPEQ(x, y))
+#define MIN(x, y) _mm256_min_epu8(x, y)
+#define OR(x, y) _mm256_or_si256(x, y)
+#define XOR(x, y) _mm256_xor_si256(x, y)
+#define HAVE_SET_LOOKUP
+
+static inline Vec table16(const unsigned char t[16]) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)t));
+}
+
+static inline uint32_t members(Vec x, Vec rows_low, Vec rows_high) {
+    const Vec nibble = _mm256_set1_epi8(0x0F), top = _mm256_set1_epi8((char)0x80);
+    const Vec bit = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16,
+                                     32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    // an index with the top bit set makes pshufb return 0: each table answers for its half
+    Vec low = _mm256_and_si256(x, nibble), half = _mm256_and_si256(x, top);
+    Vec row = _mm256_or_si256(_mm256_shuffle_epi8(rows_low, _mm256_or_si256(low, half)),
+                              _mm256_shuffle_epi8(rows_high, _mm256_or_si256(low, _mm256_xor_si256(half, top))));
+    Vec mask = _mm256_shuffle_epi8(bit, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+    return EQ(_mm256_and_si256(row, mask), mask);
+}
+#elif defined(__SSE2__)
+#define VEC 16
+#define ALL_BITS 0xFFFFu
+typedef __m128i Vec;
+#define LOAD(p) _mm_load_si128((const __m128i *)(p))
+#define SPLAT(c) _mm_set1_epi8((char)(c))
+#define CMPEQ(x, y) _mm_cmpeq_epi8(x, y)
+#define MASK(x) ((uint32_t)_mm_movemask_epi8(x))
+#define EQ(x, y) MASK(CMPEQ(x, y))
+#define MIN(x, y) _mm_min_epu8(x, y)
+#define OR(x, y) _mm_or_si128(x, y)
+#define XOR(x, y) _mm_xor_si128(x, y)
+#ifdef __SSSE3__
+#define HAVE_SET_LOOKUP
+
+static inline Vec table16(const unsigned char t[16]) {
+    return _mm_loadu_si128((const __m128i *)t);
+}
+
+static inline uint32_t members(Vec x, Vec rows_low, Vec rows_high) {
+    const Vec nibble = _mm_set1_epi8(0x0F), top = _mm_set1_epi8((char)0x80);
+    const Vec bit = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    Vec low = _mm_and_si128(x, nibble), half = _mm_and_si128(x, top);
+    Vec row = _mm_or_si128(_mm_shuffle_epi8(rows_low, _mm_or_si128(low, half)),
+                           _mm_shuffle_epi8(rows_high, _mm_or_si128(low, _mm_xor_si128(half, top))));
+    Vec mask = _mm_shuffle_epi8(bit, _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+    return EQ(_mm_and_si128(row, mask), mask);
+}
+#endif
+#endif
+
+#ifdef VEC
+#define GROUP (4 * VEC) // the long loops load four blocks; an aligned group is in one page
+
+static inline const unsigned char *align_down(const void *s) {
+    return (const unsigned char *)((uintptr_t)s & ~(uintptr_t)(VEC - 1));
+}
+
+// Bits of the first block that belong to the string starting at s.
+static inline uint32_t first_bits(const void *s) {
+    return (ALL_BITS << ((uintptr_t)s & (VEC - 1))) & ALL_BITS;
+}
+
+// The first hit in a group, given the compare results of its blocks; there must be one.
+static inline const unsigned char *first_in_group(const unsigned char *p, Vec x0, Vec x1, Vec x2, Vec x3) {
+    uint32_t m;
+    if ((m = MASK(x0)) != 0)
+        return p + __builtin_ctz(m);
+    if ((m = MASK(x1)) != 0)
+        return p + VEC + __builtin_ctz(m);
+    if ((m = MASK(x2)) != 0)
+        return p + 2 * VEC + __builtin_ctz(m);
+    return p + 3 * VEC + __builtin_ctz(MASK(x3));
+}
+
+// The first byte at or after s that is c or '\0'. The minimum of x and x ^ c is 0
+// exactly there, so one compare with zero finds both.
+PAGE_SAFE static inline __attribute__((always_inline)) const unsigned char *find_zero_or(const char *s, int c) {
+    const unsigned char *p = align_down(s);
+    const Vec zero = SPLAT(0), target = SPLAT(c);
+    Vec x = LOAD(p);
+    uint32_t m = EQ(MIN(x, XOR(x, target)), zero) & first_bits(s);
+    // single blocks up to the first group
+    for (p += VEC; m == 0 && ((uintptr_t)p & (GROUP - 1)) != 0; p += VEC) {
+        x = LOAD(p);
+        m = EQ(MIN(x, XOR(x, target)), zero);
+    }
+    if (m)
+        return p - VEC + __builtin_ctz(m);
+    for (;; p += GROUP) {
+        Vec x0 = LOAD(p), x1 = LOAD(p + VEC), x2 = LOAD(p + 2 * VEC), x3 = LOAD(p + 3 * VEC);
+        x0 = MIN(x0, XOR(x0, target));
+        x1 = MIN(x1, XOR(x1, target));
+        x2 = MIN(x2, XOR(x2, target));
+        x3 = MIN(x3, XOR(x3, target));
+        if (EQ(MIN(MIN(x0, x1), MIN(x2, x3)), zero) != 0)
+            return first_in_group(p, CMPEQ(x0, zero), CMPEQ(x1, zero), CMPEQ(x2, zero), CMPEQ(x3, zero));
+    }
+}
+#endif
+
+void byte_set_init(ByteSet *set, const char *chars) {
+    memset(set, 0, sizeof(*set));
+    for (const unsigned char *p = (const unsigned char *)chars; *p != '\0'; ++p) {
+        set->member[*p] = 1;
+        if (*p < 0x80)
+            set->rows_low[*p & 15] |= (unsigned char)(1 << (*p >> 4));
+        else
+            set->rows_high[*p & 15] |= (unsigned char)(1 << ((*p >> 4) - 8));
+    }
+}
+
+PAGE_SAFE size_t scan_strlen(const char *s) {
+#ifdef VEC
+    return (size_t)(find_zero_or(s, 0) - (const unsigned char *)s);
+#else
+    size_t i = 0;
+    while (s[i] != '\0')
+        ++i;
+    return i;
+#endif
+}
+
+PAGE_SAFE const char *scan_strchr(const char *s, int c) {
+#ifdef VEC
+    const unsigned char *p = find_zero_or(s, c);
+    return *p == (unsigned char)c ? (const char *)p : NULL;
+#else
+    for (;; ++s) {
+        if (*s == (char)c)
+            return s;
+        if (*s == '\0')
+            return NULL;
+    }
+#endif
+}
+
+PAGE_SAFE const char *scan_strrchr(const char *s, int c) {
+    if ((unsigned char)c == 0)
+        return s + scan_strlen(s);
+#ifdef VEC
+    const unsigned char *p = align_down(s), *last = NULL, *last_group = NULL;
+    const Vec zero = SPLAT(0), target = SPLAT(c);
+    uint32_t valid = first_bits(s);
+    // single blocks up to the first group, then groups up to the one with the end,
+    // remembering only the last group with a c; then that group block by block
+    for (;;) {
+        Vec x = LOAD(p);
+        uint32_t z = EQ(x, zero) & valid, m = EQ(x, target) & valid;
+        if (z)
+            m &= z ^ (z - 1); // up to the end of the string
+        if (m)
+            last = p + 31 - __builtin_clz(m);
+        if (z)
+            return (const char *)last;
+        p += VEC;
+        valid = ALL_BITS;
+        if (((uintptr_t)p & (GROUP - 1)) == 0)
+            break;
+    }
+    for (;; p += GROUP) {
+        Vec x0 = LOAD(p), x1 = LOAD(p + VEC), x2 = LOAD(p + 2 * VEC), x3 = LOAD(p + 3 * VEC);
+        if (EQ(MIN(MIN(x0, x1), MIN(x2, x3)), zero) != 0)
+            break;
+        Vec hits = OR(OR(CMPEQ(x0, target), CMPEQ(x1, target)), OR(CMPEQ(x2, target), CMPEQ(x3, target)));
+        if (MASK(hits))
+            last_group = p;
+    }
+    for (;; p += VEC) {
+        Vec x = LOAD(p);
+        uint32_t z = EQ(x, zero), m = EQ(x, target);
+        if (z)
+            m &= z ^ (z - 1);
+        if (m)
+            last = p + 31 - __builtin_clz(m);
+        if (z)
+            break;
+    }
+    // the answer is in the last group, or there was no c after the single blocks
+    if (!last_group || (last && last >= p - ((uintptr_t)p & (GROUP - 1))))
+        return (const char *)last;
+    for (p = last_group + 3 * VEC;; p -= VEC) {
+        uint32_t m = EQ(LOAD(p), target);
+        if (m)
+            return (const char *)p + 31 - __builtin_clz(m);
+    }
+#else
+    const char *last = NULL;
+    for (; *s != '\0'; ++s)
+        if (*s == (char)c)
+            last = s;
+    return last;
+#endif
+}
+
+PAGE_SAFE const void *scan_memchr(const void *s, int c, size_t n) {
+    if (n == 0)
+        return NULL;
+#ifdef VEC
+    const unsigned char *p = align_down(s), *end = (const unsigned char *)s + n, *hit = NULL;
+    const Vec target = SPLAT(c);
+    uint32_t m = EQ(LOAD(p), target) & first_bits(s);
+    for (p += VEC; m == 0 && p < end && ((uintptr_t)p & (GROUP - 1)) != 0; p += VEC)
+        m = EQ(LOAD(p), target);
+    if (m)
+        hit = p - VEC + __builtin_ctz(m);
+    for (; !hit && p < end; p += GROUP) {
+        Vec x0 = CMPEQ(LOAD(p), target), x1 = CMPEQ(LOAD(p + VEC), target);
+        Vec x2 = CMPEQ(LOAD(p + 2 * VEC), target), x3 = CMPEQ(LOAD(p + 3 * VEC), target);
+        if (MASK(OR(OR(x0, x1), OR(x2, x3))) != 0)
+            hit = first_in_group(p, x0, x1, x2, x3);
+    }
+    return hit < end ? hit : NULL;
+#else
+    for (const unsigned char *p = s; n > 0; ++p, --n)
+        if (*p == (unsigned char)c)
+            return p;
+    return NULL;
+#endif
+}
+
+PAGE_SAFE const void *scan_memrchr(const void *s, int c, size_t n) {
+    if (n == 0)
+        return NULL;
+#ifdef VEC
+    const unsigned char *start = s, *p = align_down(start + n - 1);
+    const Vec target = SPLAT(c);
+    uint32_t m = EQ(LOAD(p), target) & (uint32_t)((2ull << (start + n - 1 - p)) - 1); // up to the last byte
+    for (;;) {
+        if (p < start)
+            m &= ~0u << (start - p);
+        if (m)
+            return p + 31 - __builtin_clz(m);
+        if (p <= start)
+            return NULL;
+        p -= VEC;
+        m = EQ(LOAD(p), target);
+    }
+#else
+    for (const unsigned char *p = (const unsigned char *)s + n; p-- != (const unsigned char *)s;)
+        if (*p == (unsigned char)c)
+            return p;
+    return NULL;
+#endif
+}
+
+PAGE_SAFE size_t scan_strspn(const char *s, const ByteSet *accept) {
+#ifdef HAVE_SET_LOOKUP
+    const unsigned char *p = align_down(s);
+    const Vec rows_low = table16(accept->rows_low), rows_high = table16(accept->rows_high);
+    uint32_t valid = first_bits(s);
+    for (;; p += VEC, valid = ALL_BITS) {
+        uint32_t m = ~members(LOAD(p), rows_low, rows_high) & valid; // '\0' is not a member
+        if (m)
+            return (size_t)(p - (const unsigned char *)s) + __builtin_ctz(m);
+    }
+#else
+    size_t i = 0;
+    while (accept->member[(unsigned char)s[i]])
+        ++i;
+    return i;
+#endif
+}
+
+PAGE_SAFE size_t scan_strcspn(const char *s, const ByteSet *reject) {
+#ifdef HAVE_SET_LOOKUP
+    const unsigned char *p = align_down(s);
+    const Vec rows_low = table16(reject->rows_low), rows_high = table16(reject->rows_high), zero = SPLAT(0);
+    uint32_t valid = first_bits(s);
+    for (;; p += VEC, valid = ALL_BITS) {
+        Vec x = LOAD(p);
+        uint32_t m = (members(x, rows_low, rows_high) | EQ(x, zero)) & valid;
+        if (m)
+            return (size_t)(p - (const unsigned char *)s) + __builtin_ctz(m);
+    }
+#else
+    size_t i = 0;
+    while (s[i] != '\0' && !reject->member[(unsigned char)s[i]])
+        ++i;
+    return i;
+#endif
+}
+
+PAGE_SAFE size_t scan_length_find(const char *s, int c, size_t *first) {
+#ifdef VEC
+    // up to the first c or the end, then a plain strlen from there: each byte once
+    size_t at = (size_t)(find_zero_or(s, c) - (const unsigned char *)s);
+    *first = at;
+    return s[at] == '\0' ? at : at + 1 + scan_strlen(s + at + 1);
+#else
+    size_t i = 0;
+    while (s[i] != '\0' && s[i] != (char)c)
+        ++i;
+    *first = i;
+    while (s[i] != '\0')
+        ++i;
+    return i;
+#endif
+}
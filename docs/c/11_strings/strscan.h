@@ -0,0 +1,48 @@
+#ifndef STRSCAN_H
+#define STRSCAN_H
+
+#include <stddef.h>
+
+/*
+String scanning module (interface). The strings chapter and 6_functions/18_string.c
+find the length of a string with while (str[i] != '\0') ++i, and the word counter
+tests every character against its separators with is_sep; one byte per step.
+
+Here every function looks at 32 bytes per step (AVX2; 16 with SSE2 only), and the long
+loops at four such blocks. The loads are aligned, so a load never crosses a page
+boundary: a string that ends just before an unmapped page is read safely, although the
+loads may see bytes before the start and after the end of the string (those are masked
+out). The first load starts at the aligned address below the string and drops the bytes
+in front of it; single blocks follow up to an address aligned to four blocks, from where
+the groups of four stay inside one page as well. strchr looks for c and '\0' with one
+compare: min(x, x ^ c) is zero exactly at both.
+
+A ByteSet is built once from a set of characters. Membership of 16 or 32 bytes is two
+table lookups with pshufb: the low nibble of a byte picks a row of the 16x16 bitmap
+and the high nibble picks the bit, so any set works, not only sets of punctuation.
+
+The scan_ names keep away from the names starting with str and mem, which belong to
+the C library. The results are those of the library functions of the same name.
+*/
+
+typedef struct {
+    unsigned char member[256];  // for the scalar path
+    unsigned char rows_low[16]; // [low nibble]: bit h set if the byte h * 16 + low is in the set, h < 8
+    unsigned char rows_high[16]; // the same for h >= 8
+} ByteSet;
+
+void byte_set_init(ByteSet *set, const char *chars); // '\0' is never a member
+
+size_t scan_strlen(const char *s);
+const char *scan_strchr(const char *s, int c);
+const char *scan_strrchr(const char *s, int c);
+const void *scan_memchr(const void *s, int c, size_t n);
+const void *scan_memrchr(const void *s, int c, size_t n);
+size_t scan_strspn(const char *s, const ByteSet *accept);  // length of the prefix of members
+size_t scan_strcspn(const char *s, const ByteSet *reject); // length of the prefix of non-members
+
+// Length and search in one pass: returns strlen(s) and stores in *first the index of the
+// first c, or the length if c does not occur.
+size_t scan_length_find(const char *s, int c, size_t *first);
+
+#endif
@@ -0,0 +1,361 @@
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "utf8.h"
+
+/*
+UTF-8 module (implementation).
+Compile together with the program that uses it and link with -pthread, e.g.:
+    gcc -O2 -march=native -pthread 3_utf8_case.c utf8.c -o utf8_case
+*/
+
+#define TABLE_SIZE 0x800 // code points of one and two bytes
+
+// ---- Validation ----
+
+static int is_continuation(unsigned char c) {
+    return (c & 0xC0) == 0x80;
+}
+
+int utf8_validate_scalar(const char *s, size_t n, size_t *error_offset) {
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i = 0;
+    while (i < n) {
+        if (i + 8 <= n) { // 8 ASCII bytes at once
+            uint64_t w;
+            memcpy(&w, p + i, 8);
+            if ((w & 0x8080808080808080ULL) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+        unsigned c = p[i];
+        size_t len;
+        unsigned lo = 0x80, hi = 0xBF; // range of the second byte
+        if (c < 0x80)
+            len = 1;
+        else if (c >= 0xC2 && c <= 0xDF)
+            len = 2;
+        else if (c >= 0xE0 && c <= 0xEF) {
+            len = 3;
+            if (c == 0xE0)
+                lo = 0xA0; // overlong
+            else if (c == 0xED)
+                hi = 0x9F; // surrogates
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            len = 4;
+            if (c == 0xF0)
+                lo = 0x90; // overlong
+            else if (c == 0xF4)
+                hi = 0x8F; // above U+10FFFF
+        } else
+            break;
+        if (len > 1) {
+            if (i + len > n || p[i + 1] < lo || p[i + 1] > hi)
+                break;
+            if ((len > 2 && !is_continuation(p[i + 2])) || (len > 3 && !is_continuation(p[i + 3])))
+                break;
+        }
+        i += len;
+    }
+    if (i < n && error_offset)
+        *error_offset = i;
+    return i >= n;
+}
+
+#ifdef __AVX2__
+// Error bits of the lookup tables: every invalid pair of neighbouring bytes sets at least
+// one bit in all three lookups.
+enum {
+    TOO_SHORT = 1 << 0,  // lead byte followed by a lead byte or ASCII
+    TOO_LONG = 1 << 1,   // ASCII followed by a continuation byte
+    OVERLONG_3 = 1 << 2, // E0 80..9F
+    TOO_LARGE = 1 << 3,  // F4 90..BF, F5..FF
+    SURROGATE = 1 << 4,  // ED A0..BF
+    OVERLONG_2 = 1 << 5, // C0, C1
+    TOO_LARGE_1000 = 1 << 6,
+    OVERLONG_4 = 1 << 6, // F0 80..8F
+    TWO_CONTS = 1 << 7,  // two continuation bytes: an error unless it is the 3rd or 4th byte
+    CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS,
+};
+
+static inline __m256i table16(char e0, char e1, char e2, char e3, char e4, char e5, char e6, char e7, char e8,
+                              char e9, char e10, char e11, char e12, char e13, char e14, char e15) {
+    return _mm256_setr_epi8(e0, e1, e2, e3, e4, e5, e6, e7, e8, e9, e10, e11, e12, e13, e14, e15, e0, e1, e2, e3,
+                            e4, e5, e6, e7, e8, e9, e10, e11, e12, e13, e14, e15);
+}
+
+// The bytes of input shifted by n positions, the first n taken from the end of prev.
+#define PREV(input, prev, n) _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+static inline __m256i check_block(__m256i input, __m256i prev_input) {
+    const __m256i byte_1_high = table16(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TWO_CONTS, TWO_CONTS,
+        TWO_CONTS, TWO_CONTS, TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const char large = CARRY | TOO_LARGE | TOO_LARGE_1000;
+    const __m256i byte_1_low = table16(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, CARRY | OVERLONG_2, CARRY,
+                                       CARRY, CARRY | TOO_LARGE, large, large, large, large, large, large, large,
+                                       large, large | SURROGATE, large, large);
+    const char cont_8 = TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4;
+    const char cont_9 = TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE;
+    const char cont_ab = TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE;
+    const __m256i byte_2_high =
+        table16(TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, cont_8,
+                cont_9, cont_ab, cont_ab, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+    __m256i prev1 = PREV(input, prev_input, 1);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                         _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+        _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+    // a continuation byte two after an E0..FF or three after an F0..FF lead must be there;
+    // the subtractions leave the top bit set exactly for those positions
+    __m256i third = _mm256_subs_epu8(PREV(input, prev_input, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(PREV(input, prev_input, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+    return _mm256_xor_si256(must_continue, special);
+}
+
+#endif
+
+int utf8_validate(const char *s, size_t n, size_t *error_offset) {
+#ifdef __AVX2__
+    const unsigned char *p = (const unsigned char *)s;
+    __m256i prev_input = _mm256_setzero_si256();
+    size_t i = 0;
+    for (;; i += 32) {
+        __m256i input;
+        if (i + 32 <= n)
+            input = _mm256_loadu_si256((const __m256i *)(p + i));
+        else { // the tail, padded with '\0', which ends any character still open
+            unsigned char tail[32] = {0};
+            memcpy(tail, p + i, n - i);
+            input = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        __m256i error = check_block(input, prev_input);
+        if (!_mm256_testz_si256(error, error)) {
+            // the first error is in this block or in a character cut by its start, which
+            // begins at most 3 bytes earlier; the scalar check goes on from that character
+            size_t start = i < 3 ? 0 : i - 3;
+            while (start > 0 && is_continuation(p[start]))
+                --start;
+            if (utf8_validate_scalar(s + start, n - start, error_offset))
+                return 1;
+            if (error_offset)
+                *error_offset += start;
+            return 0;
+        }
+        if (i + 32 > n) // that was the tail
+            return 1;
+        prev_input = input;
+    }
+#else
+    return utf8_validate_scalar(s, n, error_offset);
+#endif
+}
+
+// ---- Case tables ----
+
+static uint16_t case_table[3][TABLE_SIZE]; // [CaseOp][code point]
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static unsigned simple_upper(unsigned c) {
+    if ((c >= 'a' && c <= 'z') || (c >= 0xE0 && c <= 0xFE && c != 0xF7))
+        return c - 0x20;
+    if (c == 0xB5) // micro sign
+        return 0x39C;
+    if (c == 0xFF)
+        return 0x178;
+    if (c == 0x131) // dotless i
+        return 'I';
+    if (c == 0x17F) // long s
+        return 'S';
+    // Latin Extended-A: upper and lower case alternate
+    if ((c >= 0x100 && c <= 0x137) || (c >= 0x14A && c <= 0x177))
+        return c & 1 ? c - 1 : c;
+    if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+        return c & 1 ? c : c - 1;
+    // Greek
+    if (c == 0x3AC)
+        return 0x386;
+    if (c >= 0x3AD && c <= 0x3AF)
+        return c - 37;
+    if (c == 0x3C2) // final sigma
+        return 0x3A3;
+    if (c >= 0x3B1 && c <= 0x3CB)
+        return c - 32;
+    if (c == 0x3CC)
+        return 0x38C;
+    if (c >= 0x3CD && c <= 0x3CE)
+        return c - 63;
+    // Cyrillic
+    if (c >= 0x430 && c <= 0x44F)
+        return c - 32;
+    if (c >= 0x450 && c <= 0x45F)
+        return c - 80;
+    return c;
+}
+
+static unsigned simple_lower(unsigned c) {
+    if ((c >= 'A' && c <= 'Z') || (c >= 0xC0 && c <= 0xDE && c != 0xD7))
+        return c + 0x20;
+    if (c == 0x130) // dotted capital I
+        return 'i';
+    if (c == 0x178)
+        return 0xFF;
+    if ((c >= 0x100 && c <= 0x137) || (c >= 0x14A && c <= 0x177))
+        return c & 1 ? c : c + 1;
+    if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+        return c & 1 ? c + 1 : c;
+    if (c == 0x386)
+        return 0x3AC;
+    if (c >= 0x388 && c <= 0x38A)
+        return c + 37;
+    if (c == 0x38C)
+        return 0x3CC;
+    if (c >= 0x38E && c <= 0x38F)
+        return c + 63;
+    if ((c >= 0x391 && c <= 0x3A1) || (c >= 0x3A3 && c <= 0x3AB))
+        return c + 32;
+    if (c >= 0x410 && c <= 0x42F)
+        return c + 32;
+    if (c >= 0x400 && c <= 0x40F)
+        return c + 80;
+    return c;
+}
+
+static void init_tables(void) {
+    for (unsigned c = 0; c < TABLE_SIZE; ++c) {
+        unsigned lower = simple_lower(c);
+        case_table[CASE_UPPER][c] = (uint16_t)simple_upper(c);
+        case_table[CASE_LOWER][c] = (uint16_t)lower;
+        case_table[CASE_TOGGLE][c] = (uint16_t)(lower != c ? lower : simple_upper(c)); // the chapter's rule
+    }
+}
+
+// ---- Case conversion ----
+
+// Converts the character at s[i] into d[*w...]; returns the index of the next character.
+static inline size_t convert_char(const unsigned char *s, size_t n, size_t i, unsigned char *d, size_t *w, CaseOp op,
+                                  int turkish) {
+    unsigned c = s[i];
+    size_t len = 1, o = *w; // a local o: stores to d could change *w as far as the compiler knows
+    if (c >= 0xC2 && c <= 0xDF && i + 1 < n && is_continuation(s[i + 1])) {
+        c = (c & 0x1F) << 6 | (s[i + 1] & 0x3F);
+        len = 2;
+    } else if (c >= 0x80) { // part of a longer character, or invalid: copied
+        d[o] = (unsigned char)c;
+        *w = o + 1;
+        return i + 1;
+    }
+    unsigned m = case_table[op][c];
+    if (turkish && (c == 'i' || c == 'I')) {
+        if (c == 'i' && op != CASE_LOWER)
+            m = 0x130;
+        else if (c == 'I' && op != CASE_UPPER)
+            m = 0x131;
+    }
+    if (m < 0x80)
+        d[o++] = (unsigned char)m;
+    else {
+        d[o++] = (unsigned char)(0xC0 | m >> 6);
+        d[o++] = (unsigned char)(0x80 | (m & 0x3F));
+    }
+    *w = o;
+    return i + len;
+}
+
+size_t utf8_convert_case_scalar(char *dst, const char *src, size_t n, CaseOp op, int turkish) {
+    pthread_once(&tables_once, init_tables);
+    const unsigned char *s = (const unsigned char *)src;
+    unsigned char *d = (unsigned char *)dst;
+    size_t i = 0, w = 0;
+    while (i < n)
+        i = convert_char(s, n, i, d, &w, op, turkish);
+    return w;
+}
+
+#ifdef __AVX2__
+// 'a'..'z' (or 'A'..'Z', or both) XOR 0x20. Adding 128 - first moves the letters to
+// -128..-103 as signed bytes, so one signed compare finds them; no other byte gets there.
+static inline __m256i convert_ascii32(__m256i x, CaseOp op) {
+    __m256i letters = op == CASE_TOGGLE ? _mm256_or_si256(x, _mm256_set1_epi8(0x20)) : x;
+    char first = op == CASE_LOWER ? 'A' : 'a';
+    __m256i shifted = _mm256_add_epi8(letters, _mm256_set1_epi8((char)(128 - first)));
+    __m256i is_letter = _mm256_cmpgt_epi8(_mm256_set1_epi8(-128 + 26), shifted);
+    return _mm256_xor_si256(x, _mm256_and_si256(is_letter, _mm256_set1_epi8(0x20)));
+}
+#endif
+
+size_t utf8_convert_case(char *dst, const char *src, size_t n, CaseOp op, int turkish) {
+    pthread_once(&tables_once, init_tables);
+    const unsigned char *s = (const unsigned char *)src;
+    unsigned char *d = (unsigned char *)dst;
+    size_t i = 0, w = 0;
+#ifdef __AVX2__
+    // bytes the ASCII path must leave to convert_char: with turkish the i that changes;
+    // 0x80 stands for none, such bytes stop the block anyway
+    const __m256i special_1 = _mm256_set1_epi8((char)(turkish && op != CASE_LOWER ? 'i' : 0x80));
+    const __m256i special_2 = _mm256_set1_epi8((char)(turkish && op != CASE_UPPER ? 'I' : 0x80));
+    int apart = (uintptr_t)d >= (uintptr_t)(s + n) || (uintptr_t)(d + n) <= (uintptr_t)s;
+    while (i + 32 <= n) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i y = convert_ascii32(x, op);
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(x, special_1), _mm256_cmpeq_epi8(x, special_2));
+        uint32_t stop = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(x, special));
+        if (stop == 0) {
+            _mm256_storeu_si256((__m256i *)(d + w), y);
+            i += 32;
+            w += 32;
+            continue;
+        }
+        size_t end = i + 32;
+        if (__builtin_popcount(stop) > 8) { // mostly other characters: one at a time
+            while (i < end)
+                i = convert_char(s, n, i, d, &w, op, turkish);
+            continue;
+        }
+        // the block can be stored where it belongs unless dst is src and the text has
+        // become shorter; then a store would reach bytes still to be read
+        if (apart || d + w == s + i) {
+            _mm256_storeu_si256((__m256i *)(d + w), y);
+            // the other characters are converted over their bytes of y while none of
+            // them changes its length
+            while (stop) {
+                size_t at = i + (size_t)__builtin_ctz(stop), out = w + (at - i);
+                size_t next = convert_char(s, n, at, d, &out, op, turkish);
+                if (out - w != next - i || next >= end) {
+                    if (!apart && next < end) { // dst is src: the bytes not converted yet come back
+                        unsigned char original[32];
+                        _mm256_storeu_si256((__m256i *)original, x);
+                        memcpy(d + w + (next - i), original + (next - i), end - next);
+                    }
+                    end = next;
+                    w = out - (next - i);
+                    break;
+                }
+                stop &= ~0u << (next - i);
+            }
+            w += end - i;
+            i = end;
+            continue;
+        }
+        // the ASCII bytes before the first other one, then that character
+        size_t ascii = (size_t)__builtin_ctz(stop);
+        unsigned char converted[32];
+        _mm256_storeu_si256((__m256i *)converted, y);
+        memcpy(d + w, converted, ascii);
+        i += ascii;
+        w += ascii;
+        i = convert_char(s, n, i, d, &w, op, turkish);
+    }
+#endif
+    while (i < n)
+        i = convert_char(s, n, i, d, &w, op, turkish);
+    return w;
+}
@@ -0,0 +1,43 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+
+/*
+UTF-8 module (interface). The strings chapter toggles case with isupper/tolower/toupper
+byte by byte, and 6_functions/34_write_and_read.c subtracts 32 from 'a'..'z'; both only
+know ASCII, and a byte-wise toupper can change one byte of a two-byte letter such as
+'ş' (C5 9F) into something that is no longer UTF-8.
+
+  - utf8_validate: the lookup algorithm of Keiser and Lemire with AVX2. Three 16-entry
+    tables indexed by the nibbles of every byte and of the byte before it flag every
+    invalid pair of neighbours (overlong, surrogate, too large, missing or extra
+    continuation bytes), and two shifted subtractions check the third and fourth bytes.
+    There is no branch on the data: a branch that skips ASCII blocks is mispredicted
+    all the time on text with a few letters of two bytes here and there. The scalar
+    version checks the ranges of RFC 3629; it also finds the offset once a block fails.
+  - utf8_convert_case: 32 bytes at a time while the text is ASCII (a compare and an XOR
+    with 0x20 per block); a character that is not ASCII is decoded and mapped through a
+    table of the code points below U+0800 (Latin-1, Latin Extended-A, Greek, Cyrillic),
+    over its place in the stored block as long as the length stays the same. Blocks
+    that are mostly such characters go one character at a time. Characters of three or
+    four bytes and invalid bytes are copied unchanged.
+With turkish != 0 the dotted and dotless i follow Turkish: i <-> İ and ı <-> I.
+*/
+
+typedef enum { CASE_UPPER, CASE_LOWER, CASE_TOGGLE } CaseOp;
+
+// Returns 1 if s[0..n) is valid UTF-8. Otherwise returns 0 and, if error_offset is not
+// NULL, stores the offset of the first byte of the first invalid or truncated character.
+int utf8_validate(const char *s, size_t n, size_t *error_offset);
+int utf8_validate_scalar(const char *s, size_t n, size_t *error_offset);
+
+/*
+Writes the converted text to dst and returns its length. Without turkish the length does
+not grow (only İ, ı and ſ become one-byte letters) and dst may be src. With turkish the
+i becomes two bytes: dst needs room for 2 * n bytes and must not overlap src.
+*/
+size_t utf8_convert_case(char *dst, const char *src, size_t n, CaseOp op, int turkish);
+size_t utf8_convert_case_scalar(char *dst, const char *src, size_t n, CaseOp op, int turkish);
+
+#endif
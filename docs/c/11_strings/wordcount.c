@@ -0,0 +1,243 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
+#include "wordcount.h"
+
+/*
+Word counting module (implementation).
+Compile together with the program that uses it and link with -pthread, e.g.:
+    gcc -O2 -march=native -pthread 1_word_count.c wordcount.c -o wc
+*/
+
+#define READ_BLOCK (1 << 20) // bytes per read() for pipes and terminals
+
+void sep_set_init(SepSet *s, const char *separators) {
+    memset(s, 0, sizeof(*s));
+    for (const unsigned char *p = (const unsigned char *)separators; *p; ++p)
+        s->is_sep[*p] = 1;
+    // every high nibble that occurs gets its own bit; the low nibble entry collects the
+    // bits of the high nibbles it is combined with
+    int buckets = 0;
+    s->nibble_ok = 1;
+    for (int c = 0; c < 256; ++c) {
+        if (!s->is_sep[c])
+            continue;
+        if (!s->high_nibble[c >> 4]) {
+            if (buckets == 8) {
+                s->nibble_ok = 0;
+                return;
+            }
+            s->high_nibble[c >> 4] = (unsigned char)(1 << buckets++);
+        }
+        s->low_nibble[c & 15] |= s->high_nibble[c >> 4];
+    }
+}
+
+// ---- Counting ----
+
+// Table lookups only; prev_sep tells whether the byte before p was a separator.
+static void count_scalar(const unsigned char *p, size_t n, const SepSet *s, int prev_sep, WordCounts *c) {
+    if (n == 0)
+        return;
+    // the previous byte is looked up again rather than carried, so iterations are independent
+    uint64_t words = prev_sep & !s->is_sep[p[0]], lines = p[0] == '\n';
+    for (size_t i = 1; i < n; ++i) {
+        words += s->is_sep[p[i - 1]] & !s->is_sep[p[i]];
+        lines += p[i] == '\n';
+    }
+    c->words += words;
+    c->lines += lines;
+}
+
+static void set_ends(WordCounts *c, const unsigned char *p, size_t n, const SepSet *s) {
+    c->bytes = n;
+    c->starts_in_word = n && !s->is_sep[p[0]];
+    c->ends_in_word = n && !s->is_sep[p[n - 1]];
+}
+
+WordCounts count_words_scalar(const char *text, size_t n, const SepSet *s) {
+    WordCounts c = {0};
+    count_scalar((const unsigned char *)text, n, s, 1, &c);
+    set_ends(&c, (const unsigned char *)text, n, s);
+    return c;
+}
+
+#if defined(__AVX2__)
+// Separator and newline masks of 64 bytes, bit i for p[i].
+static inline void classify64(const unsigned char *p, const SepSet *s, uint64_t *sep, uint64_t *nl) {
+    const __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)s->low_nibble));
+    const __m256i high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)s->high_nibble));
+    const __m256i nibble = _mm256_set1_epi8(0x0F), newline = _mm256_set1_epi8('\n');
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sep_bits = 0, nl_bits = 0;
+    for (int half = 0; half < 2; ++half) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + 32 * half));
+        __m256i low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(x, nibble));
+        __m256i high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+        __m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), zero);
+        sep_bits |= (uint64_t)(uint32_t)~_mm256_movemask_epi8(none) << (32 * half);
+        nl_bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, newline)) << (32 * half);
+    }
+    *sep = sep_bits;
+    *nl = nl_bits;
+}
+#define HAVE_CLASSIFY64
+#elif defined(__SSSE3__)
+static inline void classify64(const unsigned char *p, const SepSet *s, uint64_t *sep, uint64_t *nl) {
+    const __m128i low_table = _mm_loadu_si128((const __m128i *)s->low_nibble);
+    const __m128i high_table = _mm_loadu_si128((const __m128i *)s->high_nibble);
+    const __m128i nibble = _mm_set1_epi8(0x0F), newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sep_bits = 0, nl_bits = 0;
+    for (int q = 0; q < 4; ++q) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + 16 * q));
+        __m128i low = _mm_shuffle_epi8(low_table, _mm_and_si128(x, nibble));
+        __m128i high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(x, 4), nibble));
+        __m128i none = _mm_cmpeq_epi8(_mm_and_si128(low, high), zero);
+        sep_bits |= (uint64_t)(~_mm_movemask_epi8(none) & 0xFFFF) << (16 * q);
+        nl_bits |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, newline)) << (16 * q);
+    }
+    *sep = sep_bits;
+    *nl = nl_bits;
+}
+#define HAVE_CLASSIFY64
+#endif
+
+WordCounts count_words(const char *text, size_t n, const SepSet *s) {
+    const unsigned char *p = (const unsigned char *)text;
+    WordCounts c = {0};
+    size_t i = 0;
+    uint64_t carry = 1; // the byte before the text counts as a separator
+#ifdef HAVE_CLASSIFY64
+    if (s->nibble_ok)
+        for (; i + 64 <= n; i += 64) {
+            uint64_t sep, nl;
+            classify64(p + i, s, &sep, &nl);
+            c.words += (uint64_t)__builtin_popcountll(~sep & (sep << 1 | carry)); // word starts
+            c.lines += (uint64_t)__builtin_popcountll(nl);
+            carry = sep >> 63;
+        }
+#endif
+    count_scalar(p + i, n - i, s, (int)carry, &c);
+    set_ends(&c, p, n, s);
+    return c;
+}
+
+void word_counts_merge(WordCounts *into, const WordCounts *next) {
+    if (next->bytes == 0)
+        return;
+    if (into->bytes == 0) {
+        *into = *next;
+        return;
+    }
+    into->words += next->words - (into->ends_in_word && next->starts_in_word);
+    into->lines += next->lines;
+    into->bytes += next->bytes;
+    into->ends_in_word = next->ends_in_word;
+}
+
+// ---- Parallel driver ----
+
+typedef struct {
+    const char *text;
+    size_t n;
+    const SepSet *s;
+    WordCounts counts;
+} CountTask;
+
+static void *count_task(void *arg) {
+    CountTask *t = arg;
+    t->counts = count_words(t->text, t->n, t->s);
+    return NULL;
+}
+
+WordCounts count_words_parallel(const char *text, size_t n, const SepSet *s, int thread_count) {
+    CountTask *tasks = thread_count > 1 ? malloc(thread_count * sizeof(*tasks)) : NULL;
+    pthread_t *threads = tasks ? malloc(thread_count * sizeof(*threads)) : NULL;
+    int *started = threads ? calloc(thread_count, sizeof(*started)) : NULL;
+    if (!started) {
+        free(tasks);
+        free(threads);
+        return count_words(text, n, s);
+    }
+    // chunks start at multiples of 64 bytes; words cut by a border are fixed up by the merge
+    for (int t = 0; t < thread_count; ++t) {
+        size_t first = n / thread_count * t / 64 * 64;
+        size_t last = t + 1 == thread_count ? n : n / thread_count * (t + 1) / 64 * 64;
+        tasks[t] = (CountTask){text + first, last - first, s, {0}};
+    }
+    for (int t = 1; t < thread_count; ++t)
+        started[t] = pthread_create(&threads[t], NULL, count_task, &tasks[t]) == 0;
+    count_task(&tasks[0]);
+    WordCounts c = tasks[0].counts;
+    for (int t = 1; t < thread_count; ++t) {
+        if (started[t])
+            pthread_join(threads[t], NULL);
+        else
+            count_task(&tasks[t]);
+        word_counts_merge(&c, &tasks[t].counts);
+    }
+    free(tasks);
+    free(threads);
+    free(started);
+    return c;
+}
+
+// ---- Files ----
+
+static int count_fd_blocks(int fd, const SepSet *s, WordCounts *out) {
+    char *block = malloc(READ_BLOCK);
+    if (!block)
+        return 0;
+    WordCounts c = {0};
+    for (;;) {
+        ssize_t got = read(fd, block, READ_BLOCK);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            free(block);
+            return 0;
+        }
+        if (got == 0)
+            break;
+        WordCounts part = count_words(block, (size_t)got, s);
+        word_counts_merge(&c, &part);
+    }
+    free(block);
+    *out = c;
+    return 1;
+}
+
+int count_file(const char *path, const SepSet *s, int thread_count, WordCounts *out) {
+    int is_stdin = strcmp(path, "-") == 0;
+    int fd = is_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    int ok = fstat(fd, &st) == 0;
+    if (ok && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t n = (size_t)st.st_size;
+        void *text = mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text != MAP_FAILED) {
+            madvise(text, n, MADV_SEQUENTIAL);
+            *out = count_words_parallel(text, n, s, thread_count);
+            munmap(text, n);
+        } else
+            ok = count_fd_blocks(fd, s, out); // e.g. a file system without mmap
+    } else if (ok)
+        ok = count_fd_blocks(fd, s, out);
+    if (!is_stdin) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+    }
+    return ok;
+}
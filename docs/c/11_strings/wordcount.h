@@ -0,0 +1,53 @@
+#ifndef WORDCOUNT_H
+#define WORDCOUNT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Word counting module (interface), replacing the strings chapter's word counter, which
+calls is_sep() for every character and scans the separator string inside it.
+
+A SepSet is built once from the separator characters: a 256-entry table for the scalar
+path and two 16-entry nibble tables for the SIMD path (a byte is a separator if the
+entries of its low and high nibble share a bit; this works for sets whose bytes have at
+most 8 different high nibbles, which covers any ASCII punctuation set). The text is
+classified 64 bytes at a time into a separator bit mask, and the words are the 0 bits
+that follow a 1 bit: popcount(~sep & (sep << 1 | carry)). Lines are counted from a
+second mask of '\n' bytes in the same pass.
+
+Counts of consecutive pieces are merged like the chapter's word_flag: a word that runs
+across the border was counted in both pieces, once too often. So a file can be cut into
+chunks at any byte, counted by different threads and merged in order.
+*/
+
+#define WC_DEFAULT_SEPARATORS " \t\n\v\f\r.,;:?!" // the chapter's set and the line breaks
+#define WC_WHITESPACE " \t\n\v\f\r"                 // the separators of wc
+
+typedef struct {
+    unsigned char is_sep[256];
+    unsigned char low_nibble[16], high_nibble[16]; // shared bit: separator
+    int nibble_ok;                                  // 0: too many high nibbles, scalar path only
+} SepSet;
+
+typedef struct {
+    uint64_t words, lines, bytes;
+    int starts_in_word, ends_in_word; // first and last byte are not separators
+} WordCounts;
+
+void sep_set_init(SepSet *s, const char *separators);
+
+// Counts the whole range: table lookups only, or the SIMD kernel (scalar if not available).
+WordCounts count_words_scalar(const char *text, size_t n, const SepSet *s);
+WordCounts count_words(const char *text, size_t n, const SepSet *s);
+// Appends the counts of the text that follows.
+void word_counts_merge(WordCounts *into, const WordCounts *next);
+// Runs on the calling thread if threads cannot be created.
+WordCounts count_words_parallel(const char *text, size_t n, const SepSet *s, int thread_count);
+
+// Regular files are mapped into memory and counted in parallel; anything else (a pipe,
+// a terminal) is read in blocks. "-" is the standard input. Returns 0 on failure, with
+// errno set.
+int count_file(const char *path, const SepSet *s, int thread_count, WordCounts *out);
+
+#endif
@@ -0,0 +1,331 @@
+// gcc -O2 -march=native -pthread 16_varint_codec.c varint.c -o varint_codec
+// ./varint_codec [-n count]   (values per column in the benchmark, default 10000000)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "varint.h"
+
+/*
+  1. the int8_t -10 of 15_interpretting_signed_unsigned_integers_via_pattern.c as LEB128,
+     as a uint32_t and after zigzag
+  2. checks: round trips of every format and flag on the values around each byte length
+     and the extremes of int32_t and int64_t, Stream VByte with and without SSSE3,
+     truncated and overlong input, frames in a file
+  3. columns of n values: bytes per value, and encoding and decoding speed in GB/s of
+     the raw column, best of REPEAT
+*/
+
+#define REPEAT 5
+#define CHECK_COUNT 5000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void print_bytes(const char *label, const uint8_t *p, size_t n) {
+    printf("%-34s", label);
+    for (size_t k = 0; k < n; ++k)
+        printf(" %02X", p[k]);
+    printf("   (%zu byte%s)\n", n, n == 1 ? "" : "s");
+}
+
+// ---- Checks ----
+
+// A value of 1 to 64 bits, often right at the edge of a 7-bit group or of a byte.
+uint64_t edge_value(void) {
+    int bits = 1 + (int)(xorshift64() % 64);
+    uint64_t x = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    switch (xorshift64() % 4) {
+        case 0: return x;
+        case 1: return x + 1;
+        case 2: return x & xorshift64();
+        default: return -x;
+    }
+}
+
+int check_i32(const int32_t *in, size_t n, uint8_t *buffer, int32_t *out) {
+    int errors = 0;
+    for (int format = VARINT_LEB128; format <= VARINT_STREAM_VBYTE; ++format)
+        for (int flags = 0; flags <= 3; ++flags) {
+            size_t size = varint_encode_i32(in, n, buffer, (VarintFormat)format, flags);
+            errors += size > varint_max_size(n, 32, (VarintFormat)format);
+            memset(out, 0x55, n * sizeof(*out));
+            errors += varint_decode_i32(buffer, size, out, n, (VarintFormat)format, flags) != size;
+            errors += memcmp(in, out, n * sizeof(*out)) != 0;
+            // every shorter input is truncated; checking the sizes near the end suffices
+            for (size_t cut = size > 20 ? size - 20 : 0; cut < size; ++cut)
+                errors += varint_decode_i32(buffer, cut, out, n, (VarintFormat)format, flags) != VARINT_FAILED;
+        }
+    return errors;
+}
+
+int check_i64(const int64_t *in, size_t n, uint8_t *buffer, int64_t *out) {
+    int errors = 0;
+    for (int flags = 0; flags <= 3; ++flags) {
+        size_t size = varint_encode_i64(in, n, buffer, flags);
+        errors += size > varint_max_size(n, 64, VARINT_LEB128);
+        memset(out, 0x55, n * sizeof(*out));
+        errors += varint_decode_i64(buffer, size, out, n, flags) != size;
+        errors += memcmp(in, out, n * sizeof(*out)) != 0;
+        for (size_t cut = size > 20 ? size - 20 : 0; cut < size; ++cut)
+            errors += varint_decode_i64(buffer, cut, out, n, flags) != VARINT_FAILED;
+    }
+    return errors;
+}
+
+int check_round_trips(void) {
+    static int32_t in32[CHECK_COUNT], out32[CHECK_COUNT];
+    static int64_t in64[CHECK_COUNT], out64[CHECK_COUNT];
+    static uint32_t simd[CHECK_COUNT], scalar[CHECK_COUNT];
+    static uint8_t buffer[CHECK_COUNT * 10];
+    const int64_t extremes[] = {0, -1, 1, INT32_MIN, INT32_MAX, INT64_MIN, INT64_MAX, 127, 128, -64, -65};
+    int errors = 0;
+    for (int round = 0; round < 300; ++round) {
+        size_t n = round < 64 ? (size_t)round : 1 + xorshift64() % CHECK_COUNT;
+        for (size_t k = 0; k < n; ++k) {
+            int64_t x = (int64_t)edge_value();
+            if (round % 3 == 0) // sorted, small steps
+                x = k ? in64[k - 1] + (int64_t)(xorshift64() % 300) : x;
+            else if (xorshift64() % 8 == 0)
+                x = extremes[xorshift64() % (sizeof(extremes) / sizeof(*extremes))];
+            in64[k] = x;
+            in32[k] = (int32_t)(uint32_t)x;
+        }
+        errors += check_i32(in32, n, buffer, out32);
+        errors += check_i64(in64, n, buffer, out64);
+        // Stream VByte with SSSE3 (if compiled in) and without give the same values
+        size_t size = svb_encode_u32((const uint32_t *)in32, n, buffer);
+        errors += svb_decode_u32(buffer, size, simd, n) != size;
+        errors += svb_decode_u32_scalar(buffer, size, scalar, n) != size;
+        errors += memcmp(simd, scalar, n * sizeof(*simd)) != 0;
+    }
+    return errors;
+}
+
+// Values that need more bits than the type has, as the only value and then followed by
+// bytes enough for the decoder's 8-byte loads.
+int check_malformed(void) {
+    static const uint8_t too_big32[][12] = {{0x80, 0x80, 0x80, 0x80, 0x10},
+                                            {0xFF, 0xFF, 0xFF, 0xFF, 0x8F, 0x00},
+                                            {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00}};
+    static const uint8_t too_big64[][12] = {{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02},
+                                            {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00}};
+    static const size_t sizes32[] = {5, 6, 10}, sizes64[] = {10, 11};
+    uint8_t buffer[32];
+    uint32_t x32;
+    uint64_t x64;
+    int errors = 0;
+    for (size_t pad = 0; pad <= 8; pad += 8) {
+        for (int k = 0; k < 3; ++k) {
+            memset(buffer, 0, sizeof(buffer));
+            memcpy(buffer, too_big32[k], sizes32[k]);
+            errors += leb128_decode_u32(buffer, sizes32[k] + pad, &x32, 1) != VARINT_FAILED;
+        }
+        for (int k = 0; k < 2; ++k) {
+            memset(buffer, 0, sizeof(buffer));
+            memcpy(buffer, too_big64[k], sizes64[k]);
+            errors += leb128_decode_u64(buffer, sizes64[k] + pad, &x64, 1) != VARINT_FAILED;
+        }
+        // the largest values still fit
+        memset(buffer, 0, sizeof(buffer));
+        memcpy(buffer, (const uint8_t[]){0xFF, 0xFF, 0xFF, 0xFF, 0x0F}, 5);
+        errors += leb128_decode_u32(buffer, 5 + pad, &x32, 1) != 5 || x32 != UINT32_MAX;
+        memset(buffer, 0xFF, 9);
+        buffer[9] = 0x01;
+        memset(buffer + 10, 0, 10);
+        errors += leb128_decode_u64(buffer, 10 + pad, &x64, 1) != 10 || x64 != UINT64_MAX;
+    }
+    return errors;
+}
+
+int check_files(void) {
+    enum { COUNT = 3 * VARINT_FRAME + 12345 };
+    int32_t *in32 = malloc(COUNT * sizeof(*in32)), *out32 = malloc(VARINT_FRAME * sizeof(*out32));
+    int64_t *in64 = malloc(COUNT * sizeof(*in64)), *out64 = malloc(VARINT_FRAME * sizeof(*out64));
+    FILE *f = tmpfile();
+    if (!in32 || !out32 || !in64 || !out64 || !f)
+        return 1;
+    for (size_t k = 0; k < COUNT; ++k) {
+        in32[k] = k ? in32[k - 1] + (int32_t)(xorshift64() % 100) - 10 : 0;
+        in64[k] = k ? in64[k - 1] + (int64_t)(xorshift64() % 1000) : INT64_C(1700000000000);
+    }
+    int errors = 0;
+    // written in two pieces; each frame restarts the deltas
+    errors += !varint_write_i32(f, in32, 1000, VARINT_STREAM_VBYTE, VARINT_DELTA | VARINT_ZIGZAG);
+    errors += !varint_write_i32(f, in32 + 1000, COUNT - 1000, VARINT_STREAM_VBYTE, VARINT_DELTA | VARINT_ZIGZAG);
+    errors += !varint_write_i64(f, in64, COUNT, VARINT_DELTA);
+    long size = ftell(f);
+    rewind(f);
+    size_t at = 0, n;
+    while (at < COUNT && (n = varint_read_i32(f, out32, VARINT_FRAME)) != VARINT_FAILED && n) {
+        errors += at + n > COUNT || memcmp(out32, in32 + at, n * sizeof(*out32)) != 0;
+        at += n;
+    }
+    errors += at != COUNT;
+    errors += varint_read_i32(f, out32, VARINT_FRAME) != VARINT_FAILED; // a 64-bit frame
+    fseek(f, -12, SEEK_CUR);
+    for (at = 0; (n = varint_read_i64(f, out64, VARINT_FRAME)) != VARINT_FAILED && n; at += n)
+        errors += at + n > COUNT || memcmp(out64, in64 + at, n * sizeof(*out64)) != 0;
+    errors += at != COUNT || n != 0;
+    printf("%d values in %ld bytes of frames, %.2f per value\n", 2 * COUNT, size, (double)size / (2 * COUNT));
+
+    // a damaged size in the first header
+    rewind(f);
+    fseek(f, 11, SEEK_SET);
+    fputc(0xFF, f);
+    rewind(f);
+    errors += varint_read_i32(f, out32, VARINT_FRAME) != VARINT_FAILED;
+    fclose(f);
+    free(in32);
+    free(out32);
+    free(in64);
+    free(out64);
+    return errors;
+}
+
+// ---- Benchmark ----
+
+typedef struct {
+    const char *name;
+    int bits;
+    VarintFormat format;
+    int flags;
+} Method;
+
+// Encodes and decodes the column with the method, prints one line; returns the errors.
+int bench(const char *column, const void *in, size_t n, Method m, uint8_t *buffer, void *out) {
+    double best_encode = 1e30, best_decode = 1e30;
+    size_t size = 0, used = 0;
+    for (int r = 0; r < REPEAT; ++r) {
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        size = m.bits == 64 ? varint_encode_i64(in, n, buffer, m.flags)
+                            : varint_encode_i32(in, n, buffer, m.format, m.flags);
+        double t = seconds_since(t0);
+        if (t < best_encode)
+            best_encode = t;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        used = m.bits == 64 ? varint_decode_i64(buffer, size, out, n, m.flags)
+                            : varint_decode_i32(buffer, size, out, n, m.format, m.flags);
+        t = seconds_since(t0);
+        if (t < best_decode)
+            best_decode = t;
+    }
+    size_t raw = n * (size_t)m.bits / 8;
+    printf("%-18s %-26s %6.2f %6.2fx %8.2f %8.2f\n", column, m.name, (double)size / (double)(n ? n : 1),
+           (double)raw / (double)(size ? size : 1), raw / best_encode / 1e9, raw / best_decode / 1e9);
+    return used != size || memcmp(in, out, raw) != 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 10000000;
+    for (int k = 1; k < argc; ++k) {
+        if (k + 1 < argc && strcmp(argv[k], "-n") == 0) {
+            n = strtoull(argv[++k], NULL, 10);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[k]);
+            return 1;
+        }
+    }
+
+    int errors = 0;
+    printf("--- 1. -10 in a small negative int8_t ---\n");
+    int8_t signed_char_val = -10;
+    uint32_t unsigned_int_val = signed_char_val; // sign extension: 0xFFFFFFF6
+    int32_t as_int = signed_char_val;
+    uint8_t bytes[10];
+    printf("as uint32_t: %u, zigzag: %u\n", unsigned_int_val, zigzag_encode32(as_int));
+    size_t plain = leb128_encode_u32(&unsigned_int_val, 1, bytes);
+    print_bytes("LEB128 of the uint32_t:", bytes, plain);
+    uint32_t zz = zigzag_encode32(as_int);
+    size_t zigzag = leb128_encode_u32(&zz, 1, bytes);
+    print_bytes("LEB128 after zigzag:", bytes, zigzag);
+    int32_t back;
+    errors += varint_decode_i32(bytes, zigzag, &back, 1, VARINT_LEB128, VARINT_ZIGZAG) != 1 || back != -10;
+    errors += plain != 5 || zigzag != 1;
+    printf("zigzag of -3..3:");
+    for (int32_t x = -3; x <= 3; ++x)
+        printf(" %u", zigzag_encode32(x));
+    printf("\n");
+
+    printf("\n--- 2. Checks ---\n");
+    int check_errors = check_round_trips();
+    printf("%s\n", check_errors ? "MISMATCH" : "round trips of all formats and flags ok");
+    errors += check_errors;
+    check_errors = check_malformed();
+    printf("%s\n", check_errors ? "MISMATCH" : "values too large for 32 and 64 bits rejected");
+    errors += check_errors;
+    check_errors = check_files();
+    printf("%s\n", check_errors ? "MISMATCH" : "frames read back, wrong type and damaged header rejected");
+    errors += check_errors;
+
+    printf("\n--- 3. Columns of %zu values, best of %d ---\n", n, REPEAT);
+    int32_t *ids32 = malloc((n ? n : 1) * sizeof(*ids32)), *small = malloc((n ? n : 1) * sizeof(*small));
+    int32_t *random32 = malloc((n ? n : 1) * sizeof(*random32));
+    int64_t *ids64 = malloc((n ? n : 1) * sizeof(*ids64));
+    uint8_t *buffer = malloc(varint_max_size(n, 64, VARINT_LEB128) + 16);
+    int64_t *out = malloc((n ? n : 1) * sizeof(*out));
+    if (!ids32 || !small || !random32 || !ids64 || !buffer || !out) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    for (size_t k = 0; k < n; ++k) {
+        uint64_t r = xorshift64();
+        ids32[k] = (int32_t)(k ? ids32[k - 1] + 1 + (int32_t)(r % 100) : 1000000); // sorted, some IDs missing
+        ids64[k] = k ? ids64[k - 1] + (int64_t)(r >> 8 & 1023) : INT64_C(1700000000000); // time stamps in ms
+        small[k] = (int32_t)((r >> 20) % 2001) - 1000;
+        random32[k] = (int32_t)(uint32_t)(r >> 32);
+    }
+    printf("%-18s %-26s %6s %7s %8s %8s\n", "column", "method", "B/val", "ratio", "enc GB/s", "dec GB/s");
+    const Method leb = {"LEB128", 32, VARINT_LEB128, 0}, svb = {"Stream VByte", 32, VARINT_STREAM_VBYTE, 0};
+    const Method leb_delta = {"LEB128 delta", 32, VARINT_LEB128, VARINT_DELTA};
+    const Method svb_delta = {"Stream VByte delta", 32, VARINT_STREAM_VBYTE, VARINT_DELTA};
+    const Method leb_zigzag = {"LEB128 zigzag", 32, VARINT_LEB128, VARINT_ZIGZAG};
+    const Method svb_zigzag = {"Stream VByte zigzag", 32, VARINT_STREAM_VBYTE, VARINT_ZIGZAG};
+    errors += bench("sorted IDs", ids32, n, leb, buffer, out);
+    errors += bench("sorted IDs", ids32, n, leb_delta, buffer, out);
+    errors += bench("sorted IDs", ids32, n, svb_delta, buffer, out);
+    errors += bench("int64 time stamps", ids64, n, (Method){"LEB128", 64, VARINT_LEB128, 0}, buffer, out);
+    errors += bench("int64 time stamps", ids64, n, (Method){"LEB128 delta", 64, VARINT_LEB128, VARINT_DELTA}, buffer,
+                    out);
+    errors += bench("-1000..1000", small, n, leb, buffer, out);
+    errors += bench("-1000..1000", small, n, leb_zigzag, buffer, out);
+    errors += bench("-1000..1000", small, n, svb, buffer, out);
+    errors += bench("-1000..1000", small, n, svb_zigzag, buffer, out);
+    errors += bench("random uint32", random32, n, leb, buffer, out);
+    errors += bench("random uint32", random32, n, svb, buffer, out);
+
+    double best = 1e30;
+    for (int r = 0; r < REPEAT; ++r) {
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        memcpy(out, ids32, n * sizeof(*ids32));
+        double t = seconds_since(t0);
+        if (t < best)
+            best = t;
+    }
+    printf("%-18s %-26s %6.2f %7s %8s %8.2f\n", "sorted IDs", "memcpy", 4.0, "1.00x", "",
+           n * sizeof(*ids32) / best / 1e9);
+
+    free(ids32);
+    free(small);
+    free(random32);
+    free(ids64);
+    free(buffer);
+    free(out);
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,435 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__SSE2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+#include "varint.h"
+
+/*
+Variable-length integer module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native -pthread 16_varint_codec.c varint.c -o varint_codec
+*/
+
+#define CHUNK 1024 // values transformed at a time, while they are in L1
+
+size_t varint_max_size(size_t n, int bits, VarintFormat format) {
+    if (format == VARINT_STREAM_VBYTE) // + the 4-byte store of the last value
+        return (n + 3) / 4 + 4 * n + 4;
+    return n * (bits == 64 ? 10 : 5);
+}
+
+// ---- LEB128 ----
+
+static inline uint8_t *put_leb128(uint8_t *p, uint64_t x) {
+    while (x >= 0x80) {
+        *p++ = (uint8_t)(x | 0x80);
+        x >>= 7;
+    }
+    *p++ = (uint8_t)x;
+    return p;
+}
+
+size_t leb128_encode_u32(const uint32_t *in, size_t n, uint8_t *out) {
+    uint8_t *p = out;
+    for (size_t i = 0; i < n; ++i)
+        p = put_leb128(p, in[i]);
+    return (size_t)(p - out);
+}
+
+size_t leb128_encode_u64(const uint64_t *in, size_t n, uint8_t *out) {
+    uint8_t *p = out;
+    for (size_t i = 0; i < n; ++i)
+        p = put_leb128(p, in[i]);
+    return (size_t)(p - out);
+}
+
+// One value, a byte at a time. Returns NULL if it is truncated or does not fit in bits.
+static const uint8_t *get_leb128(const uint8_t *p, const uint8_t *end, uint64_t *value, int bits) {
+    uint64_t x = 0;
+    for (int shift = 0; shift < bits && p < end; shift += 7) {
+        uint64_t b = *p++;
+        if (shift + 7 > bits && (b & 0x7F) >> (bits - shift))
+            return NULL;
+        x |= (b & 0x7F) << shift;
+        if (b < 0x80) {
+            *value = x;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// The 7-bit groups of the first len bytes of w, packed together.
+static inline uint64_t pack_groups(uint64_t w, int len) {
+    uint64_t mask = 0x7F7F7F7F7F7F7F7FULL >> (64 - 8 * len);
+#ifdef __BMI2__
+    return _pext_u64(w, mask);
+#else
+    w &= mask;
+    return (w & 0x7F) | (w >> 1 & 0x3F80) | (w >> 2 & 0x1FC000) | (w >> 3 & 0xFE00000) |
+           (w >> 4 & 0x7F0000000ULL) | (w >> 5 & 0x3F800000000ULL) | (w >> 6 & 0x1FC0000000000ULL) |
+           (w >> 7 & 0xFE000000000000ULL);
+#endif
+}
+
+#define HIGH_BITS 0x8080808080808080ULL
+
+size_t leb128_decode_u32(const uint8_t *in, size_t size, uint32_t *out, size_t n) {
+    const uint8_t *p = in, *end = in + size;
+    size_t i = 0;
+    while (i < n && end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        uint64_t stops = ~w & HIGH_BITS; // the last byte of each value
+        if (stops == HIGH_BITS && n - i >= 8) { // 8 values of one byte
+            for (int k = 0; k < 8; ++k)
+                out[i + k] = p[k];
+            i += 8;
+            p += 8;
+            continue;
+        }
+        int len = stops ? __builtin_ctzll(stops) / 8 + 1 : 9;
+        uint64_t x = pack_groups(w, len < 8 ? len : 8);
+        if (len > 5 || x > UINT32_MAX)
+            return VARINT_FAILED;
+        out[i++] = (uint32_t)x;
+        p += len;
+    }
+    for (; i < n; ++i) {
+        uint64_t x;
+        if (!(p = get_leb128(p, end, &x, 32)))
+            return VARINT_FAILED;
+        out[i] = (uint32_t)x;
+    }
+    return (size_t)(p - in);
+}
+
+size_t leb128_decode_u64(const uint8_t *in, size_t size, uint64_t *out, size_t n) {
+    const uint8_t *p = in, *end = in + size;
+    size_t i = 0;
+    while (i < n && end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        uint64_t stops = ~w & HIGH_BITS;
+        if (stops == HIGH_BITS && n - i >= 8) {
+            for (int k = 0; k < 8; ++k)
+                out[i + k] = p[k];
+            i += 8;
+            p += 8;
+        } else if (stops) {
+            int len = __builtin_ctzll(stops) / 8 + 1;
+            out[i++] = pack_groups(w, len);
+            p += len;
+        } else if (!(p = get_leb128(p, end, &out[i++], 64))) { // 9 or 10 bytes
+            return VARINT_FAILED;
+        }
+    }
+    for (; i < n; ++i)
+        if (!(p = get_leb128(p, end, &out[i], 64)))
+            return VARINT_FAILED;
+    return (size_t)(p - in);
+}
+
+// ---- Stream VByte ----
+
+// Value i of a block has its length code in bits 2 * (i % 4) of control[i / 4].
+static uint8_t *svb_encode_block(const uint32_t *in, size_t n, uint8_t *control, uint8_t *data) {
+    for (size_t i = 0; i < n; i += 4) {
+        unsigned c = 0;
+        for (size_t j = 0; j < 4 && i + j < n; ++j) {
+            uint32_t x = in[i + j];
+            unsigned code = (x > 0xFF) + (x > 0xFFFF) + (x > 0xFFFFFF);
+            memcpy(data, &x, 4);
+            data += code + 1;
+            c |= code << (2 * j);
+        }
+        control[i / 4] = (uint8_t)c;
+    }
+    return data;
+}
+
+// Returns the end of the data read, or NULL if it goes past end.
+static const uint8_t *svb_decode_block_scalar(const uint8_t *control, const uint8_t *data, const uint8_t *end,
+                                              uint32_t *out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        unsigned code = (control[i / 4] >> (2 * (i % 4))) & 3;
+        uint32_t x = 0;
+        if (end - data >= 4) {
+            memcpy(&x, data, 4);
+            x &= 0xFFFFFFFFu >> (8 * (3 - code));
+        } else if ((size_t)(end - data) > code) {
+            memcpy(&x, data, code + 1);
+        } else {
+            return NULL;
+        }
+        out[i] = x;
+        data += code + 1;
+    }
+    return data;
+}
+
+#ifdef __SSSE3__
+static __m128i shuffle_table[256]; // [control byte]: where each output byte comes from, -1: zero
+static uint8_t length_table[256];  // [control byte]: data bytes of the 4 values
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void init_tables(void) {
+    for (int c = 0; c < 256; ++c) {
+        int8_t mask[16];
+        int at = 0;
+        for (int j = 0; j < 4; ++j) {
+            int len = ((c >> (2 * j)) & 3) + 1;
+            for (int b = 0; b < 4; ++b)
+                mask[4 * j + b] = (int8_t)(b < len ? at + b : -1);
+            at += len;
+        }
+        shuffle_table[c] = _mm_loadu_si128((const __m128i *)mask);
+        length_table[c] = (uint8_t)at;
+    }
+}
+
+// Whole groups of 4 while 16 bytes can be loaded, the rest in scalar code.
+static const uint8_t *svb_decode_block(const uint8_t *control, const uint8_t *data, const uint8_t *end,
+                                       uint32_t *out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n && end - data >= 16; i += 4) {
+        unsigned c = control[i / 4];
+        __m128i v = _mm_loadu_si128((const __m128i *)data);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_shuffle_epi8(v, shuffle_table[c]));
+        data += length_table[c];
+    }
+    return svb_decode_block_scalar(control + i / 4, data, end, out + i, n - i);
+}
+#else
+#define svb_decode_block svb_decode_block_scalar
+#endif
+
+size_t svb_encode_u32(const uint32_t *in, size_t n, uint8_t *out) {
+    return (size_t)(svb_encode_block(in, n, out, out + (n + 3) / 4) - out);
+}
+
+size_t svb_decode_u32(const uint8_t *in, size_t size, uint32_t *out, size_t n) {
+#ifdef __SSSE3__
+    pthread_once(&tables_once, init_tables);
+#endif
+    if ((n + 3) / 4 > size)
+        return VARINT_FAILED;
+    const uint8_t *end = svb_decode_block(in, in + (n + 3) / 4, in + size, out, n);
+    return end ? (size_t)(end - in) : VARINT_FAILED;
+}
+
+size_t svb_decode_u32_scalar(const uint8_t *in, size_t size, uint32_t *out, size_t n) {
+    if ((n + 3) / 4 > size)
+        return VARINT_FAILED;
+    const uint8_t *end = svb_decode_block_scalar(in, in + (n + 3) / 4, in + size, out, n);
+    return end ? (size_t)(end - in) : VARINT_FAILED;
+}
+
+// ---- Zigzag and delta on columns ----
+
+static uint32_t forward32(uint32_t *t, const int32_t *in, size_t n, int flags, uint32_t prev) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t x = (uint32_t)in[i], d = flags & VARINT_DELTA ? x - prev : x;
+        prev = x;
+        t[i] = flags & VARINT_ZIGZAG ? zigzag_encode32((int32_t)d) : d;
+    }
+    return prev;
+}
+
+static uint64_t forward64(uint64_t *t, const int64_t *in, size_t n, int flags, uint64_t prev) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t x = (uint64_t)in[i], d = flags & VARINT_DELTA ? x - prev : x;
+        prev = x;
+        t[i] = flags & VARINT_ZIGZAG ? zigzag_encode64((int64_t)d) : d;
+    }
+    return prev;
+}
+
+// Undoes forward32 in place. The prefix sum of 4 values: add the vector shifted by one
+// value, then by two, then the last sum of the 4 before.
+static uint32_t backward32(uint32_t *v, size_t n, int flags, uint32_t prev) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i one = _mm_set1_epi32(1), zero = _mm_setzero_si128();
+    __m128i p = _mm_set1_epi32((int)prev);
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(v + i));
+        if (flags & VARINT_ZIGZAG)
+            x = _mm_xor_si128(_mm_srli_epi32(x, 1), _mm_sub_epi32(zero, _mm_and_si128(x, one)));
+        if (flags & VARINT_DELTA) {
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi32(x, p);
+            p = _mm_shuffle_epi32(x, 0xFF);
+        }
+        _mm_storeu_si128((__m128i *)(v + i), x);
+    }
+    prev = (uint32_t)_mm_cvtsi128_si32(p);
+#endif
+    for (; i < n; ++i) {
+        uint32_t x = flags & VARINT_ZIGZAG ? (uint32_t)zigzag_decode32(v[i]) : v[i];
+        if (flags & VARINT_DELTA)
+            prev = x += prev;
+        v[i] = x;
+    }
+    return prev;
+}
+
+static uint64_t backward64(uint64_t *v, size_t n, int flags, uint64_t prev) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t x = flags & VARINT_ZIGZAG ? (uint64_t)zigzag_decode64(v[i]) : v[i];
+        if (flags & VARINT_DELTA)
+            prev = x += prev;
+        v[i] = x;
+    }
+    return prev;
+}
+
+size_t varint_encode_i32(const int32_t *in, size_t n, uint8_t *out, VarintFormat format, int flags) {
+    uint32_t t[CHUNK], prev = 0;
+    uint8_t *p = out, *data = out + (n + 3) / 4;
+    for (size_t k = 0; k < n; k += CHUNK) {
+        size_t m = n - k < CHUNK ? n - k : CHUNK;
+        prev = forward32(t, in + k, m, flags, prev);
+        if (format == VARINT_STREAM_VBYTE)
+            data = svb_encode_block(t, m, out + k / 4, data);
+        else
+            p += leb128_encode_u32(t, m, p);
+    }
+    return (size_t)((format == VARINT_STREAM_VBYTE ? data : p) - out);
+}
+
+// Decodes a chunk at a time and transforms it while it is still in L1.
+size_t varint_decode_i32(const uint8_t *in, size_t size, int32_t *out, size_t n, VarintFormat format, int flags) {
+    uint32_t *v = (uint32_t *)out, prev = 0;
+    const uint8_t *p = in, *end = in + size;
+    if (format == VARINT_STREAM_VBYTE) {
+#ifdef __SSSE3__
+        pthread_once(&tables_once, init_tables);
+#endif
+        if ((n + 3) / 4 > size)
+            return VARINT_FAILED;
+        p = in + (n + 3) / 4;
+    }
+    for (size_t k = 0; k < n; k += CHUNK) {
+        size_t m = n - k < CHUNK ? n - k : CHUNK;
+        if (format == VARINT_STREAM_VBYTE) {
+            p = svb_decode_block(in + k / 4, p, end, v + k, m);
+        } else {
+            size_t used = leb128_decode_u32(p, (size_t)(end - p), v + k, m);
+            p = used == VARINT_FAILED ? NULL : p + used;
+        }
+        if (!p)
+            return VARINT_FAILED;
+        if (flags)
+            prev = backward32(v + k, m, flags, prev);
+    }
+    return (size_t)(p - in);
+}
+
+size_t varint_encode_i64(const int64_t *in, size_t n, uint8_t *out, int flags) {
+    uint64_t t[CHUNK], prev = 0;
+    uint8_t *p = out;
+    for (size_t k = 0; k < n; k += CHUNK) {
+        size_t m = n - k < CHUNK ? n - k : CHUNK;
+        prev = forward64(t, in + k, m, flags, prev);
+        p += leb128_encode_u64(t, m, p);
+    }
+    return (size_t)(p - out);
+}
+
+size_t varint_decode_i64(const uint8_t *in, size_t size, int64_t *out, size_t n, int flags) {
+    uint64_t *v = (uint64_t *)out, prev = 0;
+    const uint8_t *p = in, *end = in + size;
+    for (size_t k = 0; k < n; k += CHUNK) {
+        size_t m = n - k < CHUNK ? n - k : CHUNK;
+        size_t used = leb128_decode_u64(p, (size_t)(end - p), v + k, m);
+        if (used == VARINT_FAILED)
+            return VARINT_FAILED;
+        p += used;
+        if (flags)
+            prev = backward64(v + k, m, flags, prev);
+    }
+    return (size_t)(p - in);
+}
+
+// ---- Files ----
+
+/*
+A frame: 'V', 'I', the bits of the values (32 or 64), the format | flags << 4, then the
+number of values and the number of bytes that follow, each as 4 bytes little-endian.
+*/
+#define HEADER 12
+
+static void put32(uint8_t *p, uint32_t x) {
+    for (int k = 0; k < 4; ++k)
+        p[k] = (uint8_t)(x >> (8 * k));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// in is int32_t or int64_t by bits.
+static int write_frames(FILE *f, const void *in, size_t n, int bits, VarintFormat format, int flags) {
+    uint8_t *buffer = malloc(HEADER + varint_max_size(VARINT_FRAME, bits, format));
+    if (!buffer)
+        return 0;
+    int ok = 1;
+    for (size_t k = 0; ok && k < n; k += VARINT_FRAME) {
+        size_t m = n - k < VARINT_FRAME ? n - k : VARINT_FRAME;
+        size_t size = bits == 64 ? varint_encode_i64((const int64_t *)in + k, m, buffer + HEADER, flags)
+                                 : varint_encode_i32((const int32_t *)in + k, m, buffer + HEADER, format, flags);
+        buffer[0] = 'V';
+        buffer[1] = 'I';
+        buffer[2] = (uint8_t)bits;
+        buffer[3] = (uint8_t)(format | flags << 4);
+        put32(buffer + 4, (uint32_t)m);
+        put32(buffer + 8, (uint32_t)size);
+        ok = fwrite(buffer, 1, HEADER + size, f) == HEADER + size;
+    }
+    free(buffer);
+    return ok;
+}
+
+int varint_write_i32(FILE *f, const int32_t *in, size_t n, VarintFormat format, int flags) {
+    return write_frames(f, in, n, 32, format, flags);
+}
+
+int varint_write_i64(FILE *f, const int64_t *in, size_t n, int flags) {
+    return write_frames(f, in, n, 64, VARINT_LEB128, flags);
+}
+
+static size_t read_frame(FILE *f, void *out, size_t max, int bits) {
+    uint8_t header[HEADER];
+    size_t got = fread(header, 1, HEADER, f);
+    if (got == 0 && feof(f))
+        return 0;
+    if (got != HEADER || header[0] != 'V' || header[1] != 'I' || header[2] != bits)
+        return VARINT_FAILED;
+    VarintFormat format = (VarintFormat)(header[3] & 15);
+    int flags = header[3] >> 4;
+    size_t count = get32(header + 4), size = get32(header + 8);
+    if (format > VARINT_STREAM_VBYTE || (bits == 64 && format != VARINT_LEB128) || flags > 3 || count == 0 ||
+        count > VARINT_FRAME || count > max || size > varint_max_size(count, bits, format))
+        return VARINT_FAILED;
+    uint8_t *bytes = malloc(size);
+    if (!bytes)
+        return VARINT_FAILED;
+    size_t used = VARINT_FAILED;
+    if (fread(bytes, 1, size, f) == size)
+        used = bits == 64 ? varint_decode_i64(bytes, size, out, count, flags)
+                          : varint_decode_i32(bytes, size, out, count, format, flags);
+    free(bytes);
+    return used == size ? count : VARINT_FAILED;
+}
+
+size_t varint_read_i32(FILE *f, int32_t *out, size_t max) {
+    return read_frame(f, out, max, 32);
+}
+
+size_t varint_read_i64(FILE *f, int64_t *out, size_t max) {
+    return read_frame(f, out, max, 64);
+}
@@ -0,0 +1,74 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+Variable-length integer module (interface). 15_interpretting_signed_unsigned_integers_via_pattern.c
+shows that -10 as an int8_t becomes 4294967286 as a uint32_t: the sign extension sets all
+the high bits. A codec that stores small numbers in few bytes therefore needs 5 bytes for
+every small negative number, unless the bits are rearranged first.
+
+  - Zigzag: 0, -1, 1, -2, 2, ... become 0, 1, 2, 3, 4, ...: the sign moves to bit 0 and
+    the other bits are inverted for negative numbers, so a small magnitude gives a small
+    number whatever the sign.
+  - Delta: each value is stored as its difference to the one before. Sorted IDs or time
+    stamps become small numbers; with zigzag too, a column that goes down now and then.
+    Decoding is a prefix sum, 4 values at a time with SSE2 (two shifted additions).
+  - LEB128: 7 bits per byte, the high bit set on every byte but the last (protobuf,
+    DWARF, WebAssembly). The decoder loads 8 bytes at a time: 8 values of one byte are
+    taken at once, otherwise the end of the value is the first byte with a clear high
+    bit and the 7-bit groups are packed together with one PEXT (BMI2) or with shifts.
+  - Stream VByte (Lemire, Kurz, Rupp), for 32-bit values only: 1 to 4 bytes per value
+    with the lengths kept apart, 2 bits each, in control bytes ahead of the data. One
+    control byte describes 4 values, and it indexes a table of 256 shuffle masks: the
+    decoder loads 16 bytes and one PSHUFB (SSSE3) puts the 4 values in place with their
+    zero bytes, without a branch on the lengths.
+
+varint_encode_i32/i64 apply the flags to a column and encode it in one format;
+varint_write_i32/i64 store a column in a file as frames of at most VARINT_FRAME values,
+each with a header and its own delta base, and varint_read_i32/i64 read it back a frame
+at a time. The byte order is that of x86, little-endian.
+*/
+
+#define VARINT_FRAME 65536
+#define VARINT_FAILED SIZE_MAX // malformed or truncated input
+
+typedef enum { VARINT_LEB128, VARINT_STREAM_VBYTE } VarintFormat;
+enum { VARINT_ZIGZAG = 1, VARINT_DELTA = 2 };
+
+static inline uint32_t zigzag_encode32(int32_t x) { return ((uint32_t)x << 1) ^ -((uint32_t)x >> 31); }
+static inline int32_t zigzag_decode32(uint32_t u) { return (int32_t)((u >> 1) ^ -(u & 1)); }
+static inline uint64_t zigzag_encode64(int64_t x) { return ((uint64_t)x << 1) ^ -((uint64_t)x >> 63); }
+static inline int64_t zigzag_decode64(uint64_t u) { return (int64_t)((u >> 1) ^ -(u & 1)); }
+
+// Room for the encoding of n values of 32 or 64 bits in the format, in the worst case.
+size_t varint_max_size(size_t n, int bits, VarintFormat format);
+
+// Encoders return the number of bytes written; decoders the number of bytes read, or
+// VARINT_FAILED if the input ends early or a value does not fit.
+size_t leb128_encode_u32(const uint32_t *in, size_t n, uint8_t *out);
+size_t leb128_encode_u64(const uint64_t *in, size_t n, uint8_t *out);
+size_t leb128_decode_u32(const uint8_t *in, size_t size, uint32_t *out, size_t n);
+size_t leb128_decode_u64(const uint8_t *in, size_t size, uint64_t *out, size_t n);
+size_t svb_encode_u32(const uint32_t *in, size_t n, uint8_t *out);
+size_t svb_decode_u32(const uint8_t *in, size_t size, uint32_t *out, size_t n);
+size_t svb_decode_u32_scalar(const uint8_t *in, size_t size, uint32_t *out, size_t n);
+
+// flags: VARINT_ZIGZAG, VARINT_DELTA or both. 64-bit columns are LEB128 only.
+size_t varint_encode_i32(const int32_t *in, size_t n, uint8_t *out, VarintFormat format, int flags);
+size_t varint_decode_i32(const uint8_t *in, size_t size, int32_t *out, size_t n, VarintFormat format, int flags);
+size_t varint_encode_i64(const int64_t *in, size_t n, uint8_t *out, int flags);
+size_t varint_decode_i64(const uint8_t *in, size_t size, int64_t *out, size_t n, int flags);
+
+// Return 0 if a write fails or memory runs out.
+int varint_write_i32(FILE *f, const int32_t *in, size_t n, VarintFormat format, int flags);
+int varint_write_i64(FILE *f, const int64_t *in, size_t n, int flags);
+// Read the next frame into out, which has room for max values (VARINT_FRAME is always
+// enough); return its number of values, 0 at the end of the file, or VARINT_FAILED.
+size_t varint_read_i32(FILE *f, int32_t *out, size_t max);
+size_t varint_read_i64(FILE *f, int64_t *out, size_t max);
+
+#endif
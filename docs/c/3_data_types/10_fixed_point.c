@@ -0,0 +1,450 @@
+// gcc -O2 -march=native 10_fixed_point.c fixed.c -o fixed_point
+// ./fixed_point [-n count]   (order lines and prices in the benchmark, default 10000000)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fixed.h"
+
+/*
+  1. 123456789.0f of 1_precision_and_speed_test.c, a price of 0.10 added ten times, 1.015
+     rounded to cents, the rounding modes on the ties, and Q15 products at the ends
+  2. checks: Q15 and Q31 arrays against the scalar versions; Decimal multiplication,
+     division and rescaling against a reference that rounds from the floor of the
+     exact quotient; addition, comparison, parsing and formatting against 128-bit and
+     printf results; fix64 addition and subtraction against 128-bit results, formatting
+     against printf and parse(format(x)) == x
+  3. Q15/Q31 arrays against float arrays of the same length, order lines with 18% tax
+     in Decimal and in double, and parsing and formatting prices against strtod and
+     printf, best of REPEAT
+*/
+
+#define REPEAT 3
+#define BLOCK 4096 // elements of the arrays in the benchmark, in L1
+#define CHECK_COUNT 300000
+
+typedef __int128 i128;
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static const char *const mode_names[] = {"half even", "half up", "down", "up", "floor", "ceiling"};
+
+// ---- Checks ----
+
+// A value of 0 to 63 bits with a random sign, or one of the ends.
+int64_t random_units(void) {
+    uint64_t r = xorshift64();
+    if (r % 50 == 0)
+        return r & 64 ? INT64_MAX : INT64_MIN;
+    int64_t x = (int64_t)(xorshift64() >> 1 >> r % 64);
+    return r & 128 ? -x : x;
+}
+
+// num / den rounded, den > 0, from the floor: below the midpoint the floor, above it the
+// ceiling, on it as the mode says.
+i128 reference_round(i128 num, i128 den, RoundMode mode) {
+    i128 f = num / den - (num % den != 0 && num < 0), rest = num - f * den;
+    if (rest == 0)
+        return f;
+    i128 c = f + 1;
+    switch (mode) {
+        case ROUND_HALF_EVEN: return 2 * rest < den ? f : 2 * rest > den ? c : (f % 2 == 0 ? f : c);
+        case ROUND_HALF_UP  : return 2 * rest < den ? f : 2 * rest > den ? c : (num < 0 ? f : c);
+        case ROUND_DOWN     : return num < 0 ? c : f;
+        case ROUND_UP       : return num < 0 ? f : c;
+        case ROUND_FLOOR    : return f;
+        default             : return c;
+    }
+}
+
+i128 pow10_i128(int k) {
+    i128 p = 1;
+    while (k-- > 0)
+        p *= 10;
+    return p;
+}
+
+int fits(i128 x) {
+    return x >= INT64_MIN && x <= INT64_MAX;
+}
+
+int check_q(void) {
+    static int16_t a16[300], b16[300], r16[300];
+    static int32_t a32[300], b32[300], r32[300];
+    const int16_t ends16[] = {INT16_MIN, INT16_MAX, 0, -1, 1, INT16_MIN + 1};
+    const int32_t ends32[] = {INT32_MIN, INT32_MAX, 0, -1, 1, INT32_MIN + 1};
+    int errors = 0;
+    for (size_t n = 0; n < 300; ++n) {
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t r = xorshift64();
+            a16[i] = r % 4 ? (int16_t)r : ends16[r % 6];
+            b16[i] = r % 3 ? (int16_t)(r >> 16) : ends16[(r >> 8) % 6];
+            a32[i] = r % 4 ? (int32_t)(r >> 32) : ends32[r % 6];
+            b32[i] = r % 3 ? (int32_t)r : ends32[(r >> 8) % 6];
+        }
+        q15_add_array(r16, a16, b16, n);
+        for (size_t i = 0; i < n; ++i)
+            errors += r16[i] != q15_add(a16[i], b16[i]);
+        q15_mul_array(r16, a16, b16, n);
+        for (size_t i = 0; i < n; ++i)
+            errors += r16[i] != q15_mul(a16[i], b16[i]);
+        q31_add_array(r32, a32, b32, n);
+        for (size_t i = 0; i < n; ++i)
+            errors += r32[i] != q31_add(a32[i], b32[i]);
+        q31_mul_array(r32, a32, b32, n);
+        for (size_t i = 0; i < n; ++i)
+            errors += r32[i] != q31_mul(a32[i], b32[i]);
+    }
+    // fix64 with 15 bits is Q15 without the saturation
+    for (int k = 0; k < 100000; ++k) {
+        int16_t x = (int16_t)xorshift64(), y = (int16_t)xorshift64();
+        if (x != INT16_MIN || y != INT16_MIN)
+            errors += fix64_mul(x, y, 15) != q15_mul(x, y);
+    }
+    return errors;
+}
+
+int check_decimal(void) {
+    int errors = 0;
+    for (int k = 0; k < CHECK_COUNT; ++k) {
+        Decimal a = {random_units(), (int)(xorshift64() % 19)}, b = {random_units(), (int)(xorshift64() % 19)};
+        if (k % 4 == 0) // small values with many ties
+            a.units %= 1000, b.units = b.units % 40 + 1;
+        int scale = (int)(xorshift64() % 19);
+        RoundMode mode = (RoundMode)(xorshift64() % 6);
+        Decimal r = {0, -1};
+
+        i128 product = (i128)a.units * b.units, expected;
+        int ok = decimal_mul(&r, a, b, scale, mode);
+        if (a.scale + b.scale >= scale) {
+            expected = reference_round(product, pow10_i128(a.scale + b.scale - scale), mode);
+            errors += ok != fits(expected) || (ok && (r.units != expected || r.scale != scale));
+        } else if (fits(product)) { // otherwise the result cannot fit either
+            expected = product * pow10_i128(scale - a.scale - b.scale);
+            errors += ok != fits(expected) || (ok && (r.units != expected || r.scale != scale));
+        } else {
+            errors += ok;
+        }
+
+        int e = scale + b.scale - a.scale;
+        if (b.units != 0 && e <= 19) {
+            i128 num = e >= 0 ? (i128)a.units * pow10_i128(e) : a.units, den = e >= 0 ? b.units : b.units * pow10_i128(-e);
+            if (den < 0)
+                num = -num, den = -den;
+            expected = reference_round(num, den, mode);
+            ok = decimal_div(&r, a, b, scale, mode);
+            errors += ok != fits(expected) || (ok && (r.units != expected || r.scale != scale));
+        }
+
+        if (scale < a.scale) {
+            expected = reference_round(a.units, pow10_i128(a.scale - scale), mode);
+            errors += !decimal_rescale(&r, a, scale, mode) || r.units != expected;
+        } else {
+            expected = (i128)a.units * pow10_i128(scale - a.scale);
+            ok = decimal_rescale(&r, a, scale, mode);
+            errors += ok != fits(expected) || (ok && r.units != expected);
+        }
+
+        int common = a.scale > b.scale ? a.scale : b.scale;
+        i128 x = (i128)a.units * pow10_i128(common - a.scale), y = (i128)b.units * pow10_i128(common - b.scale);
+        ok = decimal_add(&r, a, b);
+        errors += ok != (fits(x) && fits(y) && fits(x + y)) || (ok && (r.units != x + y || r.scale != common));
+        ok = decimal_sub(&r, a, b);
+        errors += ok != (fits(x) && fits(y) && fits(x - y)) || (ok && r.units != x - y);
+        errors += decimal_compare(a, b) != (x > y) - (x < y);
+
+        // formatting against printf of the units with the point put in, and back
+        char text[DECIMAL_TEXT], digits[40], expected_text[48];
+        size_t len = decimal_format(text, a);
+        uint64_t m = a.units < 0 ? 0 - (uint64_t)a.units : (uint64_t)a.units;
+        int d = snprintf(digits, sizeof(digits), "%0*llu", a.scale + 1, (unsigned long long)m);
+        snprintf(expected_text, sizeof(expected_text), "%s%.*s%s%s", a.units < 0 ? "-" : "", d - a.scale, digits,
+                 a.scale ? "." : "", digits + d - a.scale);
+        errors += strcmp(text, expected_text) != 0;
+        errors += decimal_parse(text, len, &r) != len || r.units != a.units || r.scale != a.scale;
+    }
+
+    static const struct {
+        const char *text;
+        size_t length; // characters read, 0: rejected
+    } inputs[] = {{"", 0}, {"-", 0}, {".", 0}, {"-.", 0}, {"+.5", 3}, {"5.", 2}, {"1e5", 1}, {"12a", 2},
+                  {"9223372036854775807", 19}, {"-9223372036854775808", 20}, {"9223372036854775808", 0},
+                  {"0.123456789012345678", 20}, {"0.1234567890123456789", 0}, {"00000000000000000000000012.5", 28},
+                  {"123456781234567812.3", 20}, {"12345678123456781234567", 0}};
+    for (size_t k = 0; k < sizeof(inputs) / sizeof(*inputs); ++k) {
+        Decimal r;
+        errors += decimal_parse(inputs[k].text, strlen(inputs[k].text), &r) != inputs[k].length;
+    }
+    return errors;
+}
+
+int check_fix64(void) {
+    int errors = 0;
+    char text[DECIMAL_TEXT], expected[64];
+    for (int k = 0; k < CHECK_COUNT; ++k) {
+        // exactly a double: printf rounds it half to even, like fix64_format
+        int frac = (int)(xorshift64() % 21), digits = (int)(xorshift64() % 10);
+        int64_t x = (int64_t)(xorshift64() >> 12) - (int64_t)(1LL << 51);
+        fix64_format(text, x, frac, digits);
+        snprintf(expected, sizeof(expected), "%.*f", digits, fix64_to_double(x, frac));
+        int minus_zero = expected[0] == '-' && strspn(expected + 1, "0.") == strlen(expected + 1);
+        errors += strcmp(text, expected + minus_zero) != 0; // printf keeps the sign of -0.00
+
+        // 10^-digits below 2^-(frac + 1) tells the values apart; the whole part below 64
+        // leaves room in the 18 digits of a Decimal
+        frac = (int)(xorshift64() % 51);
+        digits = (frac + 1) * 30103 / 100000 + 1;
+        x = (int64_t)(xorshift64() >> (58 - frac));
+        x = xorshift64() & 1 ? -x : x;
+        int64_t back = 0;
+        size_t len = fix64_format(text, x, frac, digits);
+        errors += fix64_parse(text, len, frac, &back) != len || back != x;
+    }
+    // add and sub saturate to the exact result; random operands overflow a quarter of the time
+    for (int k = 0; k < CHECK_COUNT; ++k) {
+        int64_t a = (int64_t)xorshift64(), b = (int64_t)xorshift64();
+        i128 sum = (i128)a + b, difference = (i128)a - b;
+        sum = sum > INT64_MAX ? INT64_MAX : sum < INT64_MIN ? INT64_MIN : sum;
+        difference = difference > INT64_MAX ? INT64_MAX : difference < INT64_MIN ? INT64_MIN : difference;
+        errors += fix64_add(a, b) != sum || fix64_sub(a, b) != difference;
+    }
+    errors += fix64_sub(0, INT64_MIN) != INT64_MAX || fix64_sub(-1, INT64_MIN) != INT64_MAX;
+    errors += fix64_add(INT64_MIN, -1) != INT64_MIN || fix64_add(INT64_MAX, INT64_MIN) != -1;
+    int64_t v;
+    errors += fix64_parse("-1", 2, 63 - 1, &v) != 2 || v != INT64_MIN / 2;
+    errors += fix64_parse("2", 1, 62, &v) != 0; // 2^63 does not fit
+    errors += fix64_from_double(0.5, 15) != 16384 || fix64_from_double(-1.0, 31) != INT32_MIN;
+    return errors;
+}
+
+// ---- Benchmark ----
+
+void float_add(float *dst, const float *a, const float *b, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = a[i] + b[i];
+}
+
+void float_mul(float *dst, const float *a, const float *b, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = a[i] * b[i];
+}
+
+void bench_arrays(size_t n) {
+    static int16_t a16[BLOCK], b16[BLOCK], r16[BLOCK];
+    static int32_t a32[BLOCK], b32[BLOCK], r32[BLOCK];
+    static float af[BLOCK], bf[BLOCK], rf[BLOCK];
+    for (size_t i = 0; i < BLOCK; ++i) {
+        uint64_t r = xorshift64();
+        a16[i] = (int16_t)r;
+        b16[i] = (int16_t)(r >> 16);
+        a32[i] = (int32_t)(r >> 32);
+        b32[i] = (int32_t)r;
+        af[i] = a32[i] / 2147483648.0f;
+        bf[i] = b32[i] / 2147483648.0f;
+    }
+    enum { Q15_ADD, Q15_MUL, Q31_ADD, Q31_MUL, FLOAT_ADD, FLOAT_MUL, KERNELS };
+    static const char *const names[] = {"q15_add_array", "q15_mul_array", "q31_add_array", "q31_mul_array",
+                                        "float +", "float *"};
+    size_t rounds = n / BLOCK + 1;
+    for (int kernel = 0; kernel < KERNELS; ++kernel) {
+        double best = 1e30;
+        for (int rep = 0; rep < REPEAT; ++rep) {
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (size_t r = 0; r < rounds; ++r) {
+                switch (kernel) {
+                    case Q15_ADD  : q15_add_array(r16, a16, b16, BLOCK); break;
+                    case Q15_MUL  : q15_mul_array(r16, a16, b16, BLOCK); break;
+                    case Q31_ADD  : q31_add_array(r32, a32, b32, BLOCK); break;
+                    case Q31_MUL  : q31_mul_array(r32, a32, b32, BLOCK); break;
+                    case FLOAT_ADD: float_add(rf, af, bf, BLOCK); break;
+                    case FLOAT_MUL: float_mul(rf, af, bf, BLOCK); break;
+                }
+                __asm__ volatile("" ::: "memory"); // every round is done
+            }
+            double t = seconds_since(t0);
+            if (t < best)
+                best = t;
+        }
+        printf("%-16s %7.2f G elements/s\n", names[kernel], (double)rounds * BLOCK / best / 1e9);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 10000000;
+    for (int k = 1; k < argc; ++k) {
+        if (k + 1 < argc && strcmp(argv[k], "-n") == 0) {
+            n = strtoull(argv[++k], NULL, 10);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[k]);
+            return 1;
+        }
+    }
+
+    int errors = 0;
+    char text[DECIMAL_TEXT];
+    printf("--- 1. Precision ---\n");
+    float f = 123456789.0f;
+    Decimal d;
+    decimal_parse("123456789.00", 12, &d);
+    decimal_format(text, d);
+    printf("float %.2f, Decimal %s\n", f, text);
+    errors += strcmp(text, "123456789.00") != 0;
+
+    double price = 0.10, sum = 0;
+    Decimal dprice = {10, 2}, dsum = {0, 2};
+    for (int k = 0; k < 10; ++k) {
+        sum += price;
+        decimal_add(&dsum, dsum, dprice);
+    }
+    decimal_format(text, dsum);
+    printf("0.10 ten times: double %.17g (== 1.0: %d), Decimal %s\n", sum, sum == 1.0, text);
+    errors += dsum.units != 100;
+
+    Decimal cents;
+    decimal_parse("1.015", 5, &d);
+    decimal_rescale(&cents, d, 2, ROUND_HALF_UP);
+    decimal_format(text, cents);
+    printf("1.015 to cents: printf of the double %.2f, Decimal half up %s\n", 1.015, text);
+    errors += cents.units != 102;
+
+    printf("%-10s", "to units");
+    const char *ties[] = {"-2.5", "-1.5", "-0.5", "0.5", "1.5", "2.5"};
+    for (int k = 0; k < 6; ++k)
+        printf(" %5s", ties[k]);
+    printf("\n");
+    for (int mode = 0; mode < 6; ++mode) {
+        printf("%-10s", mode_names[mode]);
+        for (int k = 0; k < 6; ++k) {
+            Decimal x, y;
+            decimal_parse(ties[k], strlen(ties[k]), &x);
+            decimal_rescale(&y, x, 0, (RoundMode)mode);
+            printf(" %5lld", (long long)y.units);
+        }
+        printf("\n");
+    }
+
+    int16_t half = 1 << 14, minus_one = INT16_MIN;
+    fix64_format(text, q15_mul(half, half), 15, 6);
+    printf("Q15: 0.5 * 0.5 = %s", text);
+    fix64_format(text, q15_mul(minus_one, minus_one), 15, 6);
+    printf(", -1 * -1 = %s (saturated)\n", text);
+    errors += q15_mul(half, half) != 1 << 13 || q15_mul(minus_one, minus_one) != INT16_MAX;
+
+    printf("\n--- 2. Checks ---\n");
+    int check_errors = check_q();
+    printf("%s\n", check_errors ? "MISMATCH" : "Q15 and Q31 arrays match the scalar versions");
+    errors += check_errors;
+    check_errors = check_decimal();
+    printf("%s\n", check_errors ? "MISMATCH" : "Decimal arithmetic, rounding, parsing and formatting match");
+    errors += check_errors;
+    check_errors = check_fix64();
+    printf("%s\n", check_errors ? "MISMATCH" : "fix64 saturates, formats like printf, parses it back");
+    errors += check_errors;
+
+    printf("\n--- 3. Speed, best of %d ---\n", REPEAT);
+    bench_arrays(n * 10);
+
+    // order lines: price 0.01..999.99, quantity 1..100, 18% tax, each line rounded to cents
+    int64_t *prices = malloc((n ? n : 1) * sizeof(*prices));
+    int *quantities = malloc((n ? n : 1) * sizeof(*quantities));
+    char *texts = malloc((n ? n : 1) * 16);
+    if (!prices || !quantities || !texts) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        prices[i] = 1 + (int64_t)(xorshift64() % 99999);
+        quantities[i] = 1 + (int)(xorshift64() % 100);
+    }
+    const Decimal tax = {118, 2};
+    double best_decimal = 1e30, best_double = 1e30;
+    Decimal total = {0, 2};
+    double total_double = 0;
+    for (int rep = 0; rep < REPEAT; ++rep) {
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        total = (Decimal){0, 2};
+        for (size_t i = 0; i < n; ++i) {
+            Decimal line;
+            decimal_mul(&line, (Decimal){prices[i] * quantities[i], 2}, tax, 2, ROUND_HALF_UP);
+            total.units += line.units; // at most 10^7 lines of 10^7 cents: no overflow
+        }
+        double t = seconds_since(t0);
+        if (t < best_decimal)
+            best_decimal = t;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        total_double = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double line = prices[i] / 100.0 * quantities[i] * 1.18;
+            total_double += (double)(int64_t)(line * 100 + 0.5) / 100;
+        }
+        t = seconds_since(t0);
+        if (t < best_double)
+            best_double = t;
+    }
+    decimal_format(text, total);
+    printf("%zu order lines: Decimal %.2f ns/line, total %s; double %.2f ns/line, total %.2f\n", n,
+           best_decimal / (double)(n ? n : 1) * 1e9, text, best_double / (double)(n ? n : 1) * 1e9, total_double);
+
+    char *p = texts;
+    for (size_t i = 0; i < n; ++i, p += 16)
+        decimal_format(p, (Decimal){prices[i], 2});
+    double best[4] = {1e30, 1e30, 1e30, 1e30};
+    volatile double sink = 0;
+    for (int rep = 0; rep < REPEAT; ++rep) {
+        for (int method = 0; method < 4; ++method) {
+            struct timespec t0;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            int64_t units = 0;
+            double value = 0;
+            char buf[64];
+            for (size_t i = 0; i < n; ++i) {
+                const char *s = texts + 16 * i;
+                switch (method) {
+                    case 0:
+                        decimal_parse(s, strlen(s), &d);
+                        units += d.units;
+                        break;
+                    case 1: value += strtod(s, NULL); break;
+                    case 2: units += (int64_t)decimal_format(buf, (Decimal){prices[i], 2}); break;
+                    case 3: units += snprintf(buf, sizeof(buf), "%.2f", prices[i] / 100.0); break;
+                }
+            }
+            double t = seconds_since(t0);
+            if (t < best[method])
+                best[method] = t;
+            sink = value + (double)units;
+            if (method == 0) {
+                int64_t expected = 0;
+                for (size_t i = 0; i < n; ++i)
+                    expected += prices[i];
+                errors += units != expected;
+            }
+        }
+    }
+    (void)sink;
+    printf("parse a price: decimal_parse %.1f ns, strtod %.1f ns; format: decimal_format %.1f ns, printf %.1f ns\n",
+           best[0] / (double)(n ? n : 1) * 1e9, best[1] / (double)(n ? n : 1) * 1e9,
+           best[2] / (double)(n ? n : 1) * 1e9, best[3] / (double)(n ? n : 1) * 1e9);
+
+    free(prices);
+    free(quantities);
+    free(texts);
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
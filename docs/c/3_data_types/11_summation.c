@@ -0,0 +1,378 @@
+// gcc -O2 -march=native 11_summation.c summation.c -o summation
+// ./summation [-n count]   (values in the benchmark, default 100000000 as ITERATIONS)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h> // INFINITY and NAN only, no -lm
+#include <time.h>
+#include "summation.h"
+
+/*
+  1. float_sum += (i * 1.0) / 10.0 of 1_precision_and_speed_test.c with every kernel,
+     a price of 0.10 added ten times, rows of 16 with 1e100, 1, -1e100 in each lane, and
+     a dot product whose terms overflow
+  2. checks: the exact kernels against 128-bit integer sums of values with 20 bits after
+     the point, the others against their error bounds (and exact where every partial
+     sum is), random values of every exponent that cancel around a known value, ties,
+     subnormals, overflow, infinities and NaNs, merging, and 2^29 additions and more
+  3. n amounts of money and the chapter's tenths: GB/s of every kernel on the whole array
+     and on 4096 values in L1, best of REPEAT, and the error in units in the last place
+*/
+
+#define REPEAT 3
+#define BLOCK 4096 // values in the L1 benchmark
+#define CHECK_MAX 4096
+#define CHECK_ROUNDS 4000
+
+typedef __int128 i128;
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+double abs_d(double x) {
+    return x < 0 ? -x : x;
+}
+
+// The chapter's loop.
+double sum_plain(const double *a, size_t n) {
+    double s = 0;
+    for (size_t i = 0; i < n; ++i)
+        s += a[i];
+    return s;
+}
+
+double dot_plain(const double *a, const double *b, size_t n) {
+    double s = 0;
+    for (size_t i = 0; i < n; ++i)
+        s += a[i] * b[i];
+    return s;
+}
+
+// |x - exact| in units of the last place of exact.
+double ulps(double x, double exact) {
+    double e = abs_d(exact), next;
+    uint64_t u;
+    memcpy(&u, &e, sizeof(u));
+    ++u;
+    memcpy(&next, &u, sizeof(next));
+    return abs_d(x - exact) / (next - e);
+}
+
+enum { PLAIN, PAIRWISE, KAHAN, NEUMAIER, EXACT, SUM_KERNELS };
+static const char *const kernel_names[] = {"plain loop", "sum_pairwise", "sum_kahan", "sum_neumaier", "sum_exact"};
+static double (*const kernels[])(const double *, size_t) = {sum_plain, sum_pairwise, sum_kahan, sum_neumaier,
+                                                            sum_exact};
+
+// ---- Checks ----
+
+// A value with 20 bits after the point and up to bits bits in all; *units is it times 2^20.
+double random_fixed(int bits, int64_t *units) {
+    int64_t v = (int64_t)(xorshift64() >> (64 - 1 - xorshift64() % bits));
+    *units = xorshift64() & 1 ? -v : v;
+    return (double)*units * 0x1p-20;
+}
+
+// Any finite double.
+double random_double(void) {
+    uint64_t u = (xorshift64() & 0x800FFFFFFFFFFFFFULL) | (xorshift64() % 2047) << 52;
+    double x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+// Sums of up to 2000 * 2^50 units fit in 128 bits and the conversion of an __int128 to
+// double rounds to nearest with ties to even, so the reference is the exact result.
+// With at most 30 bits every partial sum is exact, so every kernel must give it.
+int check_sums(void) {
+    static double a[CHECK_MAX], b[CHECK_MAX];
+    int errors = 0;
+    for (int round = 0; round < CHECK_ROUNDS; ++round) {
+        size_t n = round / 2 < 1100 ? (size_t)round / 2 : xorshift64() % CHECK_MAX;
+        int bits = round % 2 ? 50 : 30;
+        i128 sum = 0, abs_sum = 0, dot = 0;
+        for (size_t i = 0; i < n; ++i) {
+            int64_t x, y;
+            a[i] = random_fixed(bits, &x);
+            b[i] = random_fixed(bits, &y);
+            sum += x;
+            abs_sum += x < 0 ? -x : x;
+            dot += (i128)x * y;
+        }
+        double exact = (double)sum * 0x1p-20, total = (double)abs_sum * 0x1p-20;
+        errors += sum_exact(a, n) != exact || dot_exact(a, b, n) != (double)dot * 0x1p-40;
+
+        const double u = DBL_EPSILON / 2;
+        int levels = 16 + 4 + 64 - __builtin_clzll(n | 1); // lanes, tree, halves
+        double bounds[SUM_KERNELS] = {0, levels * u * total, u * abs_d(exact) + 3 * u * total,
+                                      u * abs_d(exact) + 3 * u * total, 0};
+        for (int k = PAIRWISE; k < EXACT; ++k)
+            errors += abs_d(kernels[k](a, n) - exact) > (bits == 30 ? 0 : bounds[k]);
+
+        Superaccumulator s, t;
+        superacc_init(&s);
+        superacc_init(&t);
+        size_t split = n ? xorshift64() % n : 0;
+        for (size_t i = 0; i < n; ++i)
+            superacc_add(i < split ? &s : &t, a[i]);
+        superacc_merge(&s, &t);
+        errors += superacc_round(&s) != exact;
+    }
+    return errors;
+}
+
+// Pairs x, -x of every exponent in a random order around one value: the sum is that
+// value, and the dot product with x * y and -x * y too, even where x * y overflows.
+int check_cancellation(void) {
+    static double a[2 * CHECK_MAX + 1], b[2 * CHECK_MAX + 1];
+    int errors = 0;
+    for (int round = 0; round < 300; ++round) {
+        size_t pairs = xorshift64() % CHECK_MAX, n = 2 * pairs + 1;
+        for (size_t i = 0; i < pairs; ++i) {
+            a[2 * i] = random_double();
+            a[2 * i + 1] = -a[2 * i];
+            b[2 * i] = b[2 * i + 1] = random_double();
+        }
+        double value = random_double();
+        a[n - 1] = value;
+        b[n - 1] = 1;
+        for (size_t i = n - 1; i > 0; --i) {
+            size_t j = xorshift64() % (i + 1);
+            double t = a[i];
+            a[i] = a[j];
+            a[j] = t;
+            t = b[i];
+            b[i] = b[j];
+            b[j] = t;
+        }
+        // the shuffle moved each b with its a
+        errors += dot_exact(a, b, n) != value;
+        errors += sum_exact(a, n) != value;
+    }
+    return errors;
+}
+
+int check_rounding(void) {
+    static const struct {
+        int n;
+        double v[10], expected;
+    } sums[] = {
+        {2, {1, 0x1p-53}, 1}, // a tie: to the even 1
+        {3, {1, 0x1p-53, 0x1p-1074}, 0x1.0000000000001p0},
+        {2, {0x1.0000000000001p0, 0x1p-53}, 0x1.0000000000002p0},
+        {3, {-1, -0x1p-53, -0x1p-1074}, -0x1.0000000000001p0},
+        {3, {DBL_MAX, DBL_MAX, -DBL_MAX}, DBL_MAX},
+        {2, {DBL_MAX, 0x1p970}, INFINITY}, // half an ulp above DBL_MAX
+        {3, {DBL_MAX, 0x1p970, -0x1p-1074}, DBL_MAX},
+        {3, {0x1p-1074, 0x1p-1074, 0x1p-1074}, 0x3p-1074},
+        {2, {0x1p-1022, -0x1p-1074}, 0x0.fffffffffffffp-1022},
+        {3, {1e100, 1, -1e100}, 1},
+        {10, {0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1}, 1},
+        {2, {INFINITY, 1}, INFINITY},
+        {2, {INFINITY, -INFINITY}, NAN},
+        {2, {NAN, 1}, NAN},
+        {0, {0}, 0},
+    };
+    static const struct {
+        int n;
+        double a[3], b[3], expected;
+    } dots[] = {
+        {3, {1e300, 1e300, 1}, {1e300, -1e300, 1}, 1},
+        {2, {DBL_MAX, -DBL_MAX}, {2, 2}, 0},
+        {1, {0x1p-537}, {0x1p-537}, 0x1p-1074},
+        {1, {0x1p-537}, {0x1.8p-538}, 0x1p-1074}, // 0.75 of the smallest subnormal
+        {1, {0x1p-537}, {0x1p-538}, 0},           // a tie: to the even 0
+        {1, {0x1p-600}, {0x1p-600}, 0},
+        {2, {0x1.0000001p0, -0x1.0000002p0}, {0x1.0000001p0, 1}, 0x1p-56},
+        {1, {INFINITY}, {0}, NAN},
+    };
+    int errors = 0;
+    for (size_t k = 0; k < sizeof(sums) / sizeof(*sums); ++k) {
+        double r = sum_exact(sums[k].v, (size_t)sums[k].n), e = sums[k].expected;
+        errors += e == e ? r != e : r == r;
+    }
+    for (size_t k = 0; k < sizeof(dots) / sizeof(*dots); ++k) {
+        double r = dot_exact(dots[k].a, dots[k].b, (size_t)dots[k].n), e = dots[k].expected;
+        errors += e == e ? r != e : r == r;
+    }
+
+    // more than the 2^29 additions after which the carries are propagated
+    const double x = 0x1.fffffffffffffp-1000;
+    const uint64_t count = (1ULL << 29) + 12345;
+    Superaccumulator s;
+    superacc_init(&s);
+    for (uint64_t i = 0; i < count; ++i)
+        superacc_add(&s, x);
+    errors += superacc_round(&s) != (double)((i128)count * 0x1fffffffffffff) * 0x1p-1052;
+    return errors;
+}
+
+// ---- Benchmark ----
+
+typedef struct {
+    double memory, cache; // seconds for n values, and for about n values BLOCK at a time
+} Timing;
+
+Timing time_sum(int kernel, const double *a, size_t n) {
+    Timing best = {1e30, 1e30};
+    volatile double sink = 0;
+    size_t rounds = n / BLOCK + 1;
+    for (int rep = 0; rep < REPEAT; ++rep) {
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        sink = kernels[kernel](a, n);
+        double t = seconds_since(t0);
+        if (t < best.memory)
+            best.memory = t;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t r = 0; r < rounds; ++r)
+            sink = kernels[kernel](a, BLOCK);
+        t = seconds_since(t0) / (double)rounds * (double)n / BLOCK;
+        if (t < best.cache)
+            best.cache = t;
+    }
+    (void)sink;
+    return best;
+}
+
+Timing time_dot(int exact, const double *a, const double *b, size_t n) {
+    Timing best = {1e30, 1e30};
+    volatile double sink = 0;
+    size_t rounds = n / BLOCK + 1;
+    for (int rep = 0; rep < REPEAT; ++rep) {
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        sink = exact ? dot_exact(a, b, n) : dot_plain(a, b, n);
+        double t = seconds_since(t0);
+        if (t < best.memory)
+            best.memory = t;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t r = 0; r < rounds; ++r)
+            sink = exact ? dot_exact(a, b, BLOCK) : dot_plain(a, b, BLOCK);
+        t = seconds_since(t0) / (double)rounds * (double)n / BLOCK;
+        if (t < best.cache)
+            best.cache = t;
+    }
+    (void)sink;
+    return best;
+}
+
+// A negative error is not printed.
+void print_timing(const char *name, Timing t, double bytes, size_t n, double error_a, double error_b) {
+    char a[16] = "-", b[16] = "-";
+    if (error_a >= 0)
+        snprintf(a, sizeof(a), "%.3g", error_a);
+    if (error_b >= 0)
+        snprintf(b, sizeof(b), "%.3g", error_b);
+    printf("%-14s %7.2f GB/s %6.2f ns  %7.2f GB/s %6.2f ns  %10s %10s\n", name, bytes / t.memory / 1e9,
+           t.memory / (double)n * 1e9, bytes / t.cache / 1e9, t.cache / (double)n * 1e9, a, b);
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = 100000000;
+    for (int k = 1; k < argc; ++k) {
+        if (k + 1 < argc && strcmp(argv[k], "-n") == 0) {
+            n = strtoull(argv[++k], NULL, 10);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[k]);
+            return 1;
+        }
+    }
+    if (n < BLOCK)
+        n = BLOCK;
+    double *tenths = malloc(n * sizeof(double)), *amounts = malloc(n * sizeof(double));
+    if (!tenths || !amounts) {
+        fprintf(stderr, "out of memory for n = %zu\n", n);
+        return 1;
+    }
+
+    int errors = 0;
+    printf("--- 1. Rounding errors that add up ---\n");
+    for (size_t i = 0; i < n; ++i)
+        tenths[i] = (i * 1.0) / 10.0;
+    i128 twice_ten = (i128)n * (n - 1); // the sum of i / 10 is this / 20
+    printf("sum of (i * 1.0) / 10.0 for i < %zu: %llu.%02d without rounding\n", n,
+           (unsigned long long)(twice_ten / 20), (int)(twice_ten % 20) * 5);
+    float float_sum = 0; // the error grows with n; in double it happens to stay 0 here
+    for (size_t i = 0; i < n; ++i)
+        float_sum += (float)tenths[i];
+    printf("  %-14s %.4f  in a float\n", "plain loop", float_sum);
+    double exact = sum_exact(tenths, n);
+    for (int k = 0; k < SUM_KERNELS; ++k) {
+        double r = kernels[k](tenths, n);
+        printf("  %-14s %.4f  (%+.4f, %.3g ulps from the exact sum of the doubles)\n", kernel_names[k], r, r - exact,
+               ulps(r, exact));
+    }
+
+    double prices[10] = {0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1};
+    printf("0.10 ten times:");
+    for (int k = 0; k < SUM_KERNELS; ++k)
+        printf("  %s %.17g", kernel_names[k], kernels[k](prices, 10));
+    printf("\n");
+    errors += sum_exact(prices, 10) != 1.0;
+
+    double rows[48]; // one 1e100, 1, -1e100 in each of the 16 lanes
+    for (int j = 0; j < 16; ++j) {
+        rows[j] = 1e100;
+        rows[16 + j] = 1;
+        rows[32 + j] = -1e100;
+    }
+    printf("16 rows of 1e100, 1, -1e100:");
+    for (int k = 0; k < SUM_KERNELS; ++k)
+        printf("  %s %g", kernel_names[k], kernels[k](rows, 48));
+    printf("\n");
+    errors += sum_kahan(rows, 48) != 0 || sum_neumaier(rows, 48) != 16 || sum_exact(rows, 48) != 16;
+
+    double x[3] = {1e300, 1e300, 1}, y[3] = {1e300, -1e300, 1};
+    printf("(1e300, 1e300, 1) . (1e300, -1e300, 1): plain loop %g, dot_exact %g\n", dot_plain(x, y, 3),
+           dot_exact(x, y, 3));
+    errors += dot_exact(x, y, 3) != 1;
+
+    printf("\n--- 2. Checks ---\n");
+    int check_errors = check_sums();
+    printf("%s\n", check_errors ? "MISMATCH" : "exact sums and dot products match 128-bit integers, the others their bounds");
+    errors += check_errors;
+    check_errors = check_cancellation();
+    printf("%s\n", check_errors ? "MISMATCH" : "cancelling values of every exponent leave the exact value");
+    errors += check_errors;
+    check_errors = check_rounding();
+    printf("%s\n", check_errors ? "MISMATCH" : "ties, subnormals, overflow, infinities, NaNs and carries are right");
+    errors += check_errors;
+
+    printf("\n--- 3. %zu values, best of %d ---\n", n, REPEAT);
+    for (size_t i = 0; i < n; ++i) // -50000.00 to 49999.99
+        amounts[i] = (double)((int64_t)(xorshift64() % 10000000) - 5000000) / 100;
+    double exact_tenths = sum_exact(tenths, n), exact_amounts = sum_exact(amounts, n);
+    printf("%-14s %23s  %23s  %21s\n", "", "the whole array", "4096 values in L1", "error in ulps");
+    printf("%-14s %23s  %23s  %10s %10s\n", "", "", "", "tenths", "amounts");
+    double bytes = (double)n * sizeof(double);
+    for (int k = 0; k < SUM_KERNELS; ++k) {
+        double e_tenths = ulps(kernels[k](tenths, n), exact_tenths);
+        double e_amounts = ulps(kernels[k](amounts, n), exact_amounts);
+        print_timing(kernel_names[k], time_sum(k, amounts, n), bytes, n, e_tenths, e_amounts);
+    }
+    // the amounts times quantities of 0.0, 0.1, 0.2, ...
+    double exact_dot = dot_exact(amounts, tenths, n);
+    print_timing("dot, plain", time_dot(0, amounts, tenths, n), 2 * bytes, n, -1,
+                 ulps(dot_plain(amounts, tenths, n), exact_dot));
+    print_timing("dot_exact", time_dot(1, amounts, tenths, n), 2 * bytes, n, -1,
+                 ulps(dot_exact(amounts, tenths, n), exact_dot));
+
+    free(tenths);
+    free(amounts);
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
@@ -0,0 +1,441 @@
+#include <stdio.h>
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "fixed.h"
+
+/*
+Fixed-point and decimal module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 10_fixed_point.c fixed.c -o fixed_point
+*/
+
+typedef __int128 i128;
+typedef unsigned __int128 u128;
+
+static const uint64_t pow10_table[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL,
+    10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+    1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+    10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL};
+
+// ---- Q15 and Q31 arrays ----
+
+void q15_add_array(int16_t *dst, const int16_t *a, const int16_t *b, size_t n) {
+    size_t i = 0;
+#ifdef __AVX2__
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i)), y = _mm256_loadu_si256((const __m256i *)(b + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epi16(x, y));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = q15_add(a[i], b[i]);
+}
+
+// VPMULHRSW computes (a * b + 2^14) >> 15 like q15_mul; its only result of -1 is the
+// overflow of -1 * -1, which the compare turns into 0x7FFF.
+void q15_mul_array(int16_t *dst, const int16_t *a, const int16_t *b, size_t n) {
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i minus_one = _mm256_set1_epi16(INT16_MIN);
+    for (; i + 16 <= n; i += 16) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i)), y = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i p = _mm256_mulhrs_epi16(x, y);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(p, _mm256_cmpeq_epi16(p, minus_one)));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = q15_mul(a[i], b[i]);
+}
+
+// The sum overflows if its sign differs from the signs of both a and b; the limit then
+// has the sign of a.
+void q31_add_array(int32_t *dst, const int32_t *a, const int32_t *b, size_t n) {
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i largest = _mm256_set1_epi32(INT32_MAX);
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i)), y = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i s = _mm256_add_epi32(x, y);
+        __m256i overflow = _mm256_and_si256(_mm256_xor_si256(x, s), _mm256_xor_si256(y, s));
+        __m256i limit = _mm256_xor_si256(_mm256_srai_epi32(x, 31), largest);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_blendv_epi8(s, limit, _mm256_srai_epi32(overflow, 31)));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = q31_add(a[i], b[i]);
+}
+
+// VPMULDQ multiplies the even lanes to 64 bits; the odd lanes are shifted down first.
+// Bits 31..62 of each rounded product are the result: the even ones shifted right, the
+// odd ones left into the high half, then blended. As in Q15, -2^31 only comes from -1 * -1.
+void q31_mul_array(int32_t *dst, const int32_t *a, const int32_t *b, size_t n) {
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i half = _mm256_set1_epi64x(1LL << 30), minus_one = _mm256_set1_epi32(INT32_MIN);
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i)), y = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i even = _mm256_add_epi64(_mm256_mul_epi32(x, y), half);
+        __m256i odd = _mm256_add_epi64(_mm256_mul_epi32(_mm256_srli_epi64(x, 32), _mm256_srli_epi64(y, 32)), half);
+        __m256i p = _mm256_blend_epi32(_mm256_srli_epi64(even, 31), _mm256_slli_epi64(odd, 1), 0xAA);
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(p, _mm256_cmpeq_epi32(p, minus_one)));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = q31_mul(a[i], b[i]);
+}
+
+// ---- Rounding ----
+
+static inline u128 magnitude(i128 x) {
+    return x < 0 ? -(u128)x : (u128)x;
+}
+
+static inline int fits64(i128 x) {
+    return x >= INT64_MIN && x <= INT64_MAX;
+}
+
+// q = m / d, rem = m % d; negative: the sign of the exact quotient.
+static inline u128 round_quotient(u128 q, u128 rem, u128 d, int negative, RoundMode mode) {
+    if (rem == 0)
+        return q;
+    switch (mode) {
+        case ROUND_HALF_EVEN: return q + (rem > d - rem || (rem == d - rem && (q & 1)));
+        case ROUND_HALF_UP  : return q + (rem >= d - rem);
+        case ROUND_DOWN     : return q;
+        case ROUND_UP       : return q + 1;
+        case ROUND_FLOOR    : return q + (negative != 0);
+        default             : return q + (negative == 0);
+    }
+}
+
+// u / 10^k for k <= 19, each case a division by a constant.
+static inline uint64_t div_pow10(uint64_t u, int k) {
+    switch (k) {
+        case 0 : return u;
+        case 1 : return u / 10ULL;
+        case 2 : return u / 100ULL;
+        case 3 : return u / 1000ULL;
+        case 4 : return u / 10000ULL;
+        case 5 : return u / 100000ULL;
+        case 6 : return u / 1000000ULL;
+        case 7 : return u / 10000000ULL;
+        case 8 : return u / 100000000ULL;
+        case 9 : return u / 1000000000ULL;
+        case 10: return u / 10000000000ULL;
+        case 11: return u / 100000000000ULL;
+        case 12: return u / 1000000000000ULL;
+        case 13: return u / 10000000000000ULL;
+        case 14: return u / 100000000000000ULL;
+        case 15: return u / 1000000000000000ULL;
+        case 16: return u / 10000000000000000ULL;
+        case 17: return u / 100000000000000000ULL;
+        case 18: return u / 1000000000000000000ULL;
+        default: return u / 10000000000000000000ULL;
+    }
+}
+
+static u128 pow10_128(int k) {
+    u128 p = 1;
+    while (k--)
+        p *= 10;
+    return p;
+}
+
+// x / 10^k rounded, k <= 38. A magnitude that fits in 64 bits, the usual case, is
+// divided in 64 bits.
+static i128 divide_pow10(i128 x, int k, RoundMode mode) {
+    if (k == 0)
+        return x;
+    u128 m = magnitude(x), q, d;
+    if (k <= 19 && m <= UINT64_MAX) {
+        d = pow10_table[k];
+        q = div_pow10((uint64_t)m, k);
+    } else {
+        d = pow10_128(k);
+        q = m / d;
+    }
+    q = round_quotient(q, m - q * d, d, x < 0, mode);
+    return x < 0 ? -(i128)q : (i128)q;
+}
+
+// ---- Parsing and formatting ----
+
+static inline int all_digits(uint64_t w) {
+    return ((w & 0xF0F0F0F0F0F0F0F0ULL) | (((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+// The 8 digits of w, the first in the lowest byte: pairs, then quadruples, then all 8,
+// each step one multiplication.
+static inline uint32_t eight_digits(uint64_t w) {
+    w -= 0x3030303030303030ULL;
+    w = w * 10 + (w >> 8);
+    w = ((w & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+         ((w >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+    return (uint32_t)w;
+}
+
+// Appends the digits from s[i] on to *x; sets *overflow if *x no longer fits.
+static size_t read_digits(const char *s, size_t i, size_t n, uint64_t *x, int *overflow) {
+    uint64_t v = *x, t;
+    while (n - i >= 8) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        if (!all_digits(w))
+            break;
+        if (__builtin_mul_overflow(v, 100000000ULL, &t) || __builtin_add_overflow(t, eight_digits(w), &v))
+            *overflow = 1;
+        i += 8;
+    }
+    for (; i < n && s[i] >= '0' && s[i] <= '9'; ++i)
+        if (__builtin_mul_overflow(v, 10ULL, &t) || __builtin_add_overflow(t, (uint64_t)(s[i] - '0'), &v))
+            *overflow = 1;
+    *x = v;
+    return i;
+}
+
+size_t decimal_parse(const char *s, size_t n, Decimal *out) {
+    size_t i = 0;
+    int negative = 0, overflow = 0;
+    if (i < n && (s[i] == '-' || s[i] == '+'))
+        negative = s[i++] == '-';
+    uint64_t units = 0;
+    size_t start = i;
+    i = read_digits(s, i, n, &units, &overflow);
+    size_t whole_digits = i - start, scale = 0;
+    if (i < n && s[i] == '.') {
+        size_t point = i;
+        i = read_digits(s, point + 1, n, &units, &overflow);
+        scale = i - point - 1;
+        if (whole_digits == 0 && scale == 0)
+            return 0;
+    }
+    if ((whole_digits == 0 && scale == 0) || overflow || scale > DECIMAL_MAX_SCALE ||
+        units > (uint64_t)INT64_MAX + (uint64_t)negative)
+        return 0;
+    out->units = negative ? (int64_t)(0 - units) : (int64_t)units;
+    out->scale = (int)scale;
+    return i;
+}
+
+static const char digit_pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                  "8081828384858687888990919293949596979899";
+
+// Writes the digits of x, at least min_digits of them, so that they end before end;
+// returns the first.
+static char *write_digits(char *end, uint64_t x, int min_digits) {
+    char *p = end;
+    while (x >= 100) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * (x % 100), 2);
+        x /= 100;
+    }
+    if (x >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + 2 * x, 2);
+    } else {
+        *--p = (char)('0' + x);
+    }
+    while (end - p < min_digits)
+        *--p = '0';
+    return p;
+}
+
+// sign, the digits of whole, and if digits > 0 a point and fraction with that many.
+static size_t compose(char *buf, int negative, uint64_t whole, uint64_t fraction, int digits) {
+    char tmp[DECIMAL_TEXT], *end = tmp + sizeof(tmp), *p = end;
+    if (digits > 0) {
+        p = write_digits(end, fraction, digits);
+        *--p = '.';
+    }
+    p = write_digits(p, whole, 1);
+    if (negative)
+        *--p = '-';
+    size_t len = (size_t)(end - p);
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    return len;
+}
+
+size_t decimal_format(char *buf, Decimal a) {
+    uint64_t m = a.units < 0 ? 0 - (uint64_t)a.units : (uint64_t)a.units;
+    return compose(buf, a.units < 0, m / pow10_table[a.scale], m % pow10_table[a.scale], a.scale);
+}
+
+double decimal_to_double(Decimal a) {
+    return (double)a.units / (double)pow10_table[a.scale];
+}
+
+int decimal_from_double(Decimal *r, double x, int scale) {
+    char text[400];
+    if (scale < 0 || scale > DECIMAL_MAX_SCALE || !(x - x == 0)) // NaN or infinite
+        return 0;
+    int len = snprintf(text, sizeof(text), "%.*f", scale, x);
+    Decimal d;
+    if (len <= 0 || (size_t)len >= sizeof(text) || decimal_parse(text, (size_t)len, &d) != (size_t)len)
+        return 0;
+    *r = d;
+    return 1;
+}
+
+// ---- fix64 ----
+
+int64_t fix64_mul(int64_t a, int64_t b, int frac) {
+    i128 p = (i128)a * b;
+    if (frac > 0)
+        p = (p + ((i128)1 << (frac - 1))) >> frac;
+    return p > INT64_MAX ? INT64_MAX : p < INT64_MIN ? INT64_MIN : (int64_t)p;
+}
+
+int64_t fix64_div(int64_t a, int64_t b, int frac) {
+    if (b == 0)
+        return a < 0 ? INT64_MIN : INT64_MAX;
+    i128 num = (i128)a * ((i128)1 << frac);
+    u128 m = magnitude(num), d = magnitude(b), q = m / d;
+    int negative = (num < 0) != (b < 0);
+    q = round_quotient(q, m - q * d, d, negative, ROUND_HALF_UP);
+    i128 v = negative ? -(i128)q : (i128)q;
+    return v > INT64_MAX ? INT64_MAX : v < INT64_MIN ? INT64_MIN : (int64_t)v;
+}
+
+// Ties away from zero; the difference to the truncated value is exact.
+int64_t fix64_from_double(double x, int frac) {
+    double v = x * (double)(1ULL << frac);
+    if (v != v)
+        return 0;
+    if (v >= 9223372036854775807.0)
+        return INT64_MAX;
+    if (v <= -9223372036854775808.0)
+        return INT64_MIN;
+    int64_t t = (int64_t)v;
+    double rest = v - (double)t;
+    return t + (rest >= 0.5) - (rest <= -0.5);
+}
+
+double fix64_to_double(int64_t x, int frac) {
+    return (double)x / (double)(1ULL << frac);
+}
+
+// units * 2^frac / 10^scale, rounded half to even.
+size_t fix64_parse(const char *s, size_t n, int frac, int64_t *out) {
+    Decimal d;
+    size_t len = decimal_parse(s, n, &d);
+    if (!len)
+        return 0;
+    i128 v = divide_pow10((i128)d.units * ((i128)1 << frac), d.scale, ROUND_HALF_EVEN);
+    if (!fits64(v))
+        return 0;
+    *out = (int64_t)v;
+    return len;
+}
+
+// The fraction bits times 10^digits, shifted down by frac with rounding; a carry goes
+// to the whole part.
+size_t fix64_format(char *buf, int64_t x, int frac, int digits) {
+    uint64_t m = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+    uint64_t whole = m >> frac, low = m & ((1ULL << frac) - 1);
+    u128 scaled = (u128)low * pow10_table[digits];
+    uint64_t fraction = (uint64_t)(scaled >> frac);
+    if (frac > 0) { // a tie goes to an even last digit, which is in whole when digits is 0
+        uint64_t last = digits ? fraction : whole;
+        fraction += (uint64_t)(round_quotient(last, scaled & (((u128)1 << frac) - 1), (u128)1 << frac, x < 0,
+                                              ROUND_HALF_EVEN) - last);
+    }
+    if (fraction == pow10_table[digits]) {
+        fraction = 0;
+        ++whole;
+    }
+    return compose(buf, x < 0 && (whole || fraction), whole, fraction, digits);
+}
+
+// ---- Decimal arithmetic ----
+
+int decimal_rescale(Decimal *r, Decimal a, int scale, RoundMode mode) {
+    if (scale < 0 || scale > DECIMAL_MAX_SCALE)
+        return 0;
+    int64_t units;
+    if (scale >= a.scale) {
+        if (__builtin_mul_overflow(a.units, (int64_t)pow10_table[scale - a.scale], &units))
+            return 0;
+    } else {
+        units = (int64_t)divide_pow10(a.units, a.scale - scale, mode); // smaller, so it fits
+    }
+    *r = (Decimal){units, scale};
+    return 1;
+}
+
+int decimal_add(Decimal *r, Decimal a, Decimal b) {
+    int scale = a.scale > b.scale ? a.scale : b.scale;
+    int64_t units;
+    if (!decimal_rescale(&a, a, scale, ROUND_DOWN) || !decimal_rescale(&b, b, scale, ROUND_DOWN) ||
+        __builtin_add_overflow(a.units, b.units, &units))
+        return 0;
+    *r = (Decimal){units, scale};
+    return 1;
+}
+
+int decimal_sub(Decimal *r, Decimal a, Decimal b) {
+    int scale = a.scale > b.scale ? a.scale : b.scale;
+    int64_t units;
+    if (!decimal_rescale(&a, a, scale, ROUND_DOWN) || !decimal_rescale(&b, b, scale, ROUND_DOWN) ||
+        __builtin_sub_overflow(a.units, b.units, &units))
+        return 0;
+    *r = (Decimal){units, scale};
+    return 1;
+}
+
+int decimal_mul(Decimal *r, Decimal a, Decimal b, int scale, RoundMode mode) {
+    if (scale < 0 || scale > DECIMAL_MAX_SCALE)
+        return 0;
+    i128 p = (i128)a.units * b.units;
+    int k = a.scale + b.scale - scale;
+    int64_t units;
+    if (k >= 0) {
+        p = divide_pow10(p, k, mode);
+        if (!fits64(p))
+            return 0;
+        units = (int64_t)p;
+    } else if (!fits64(p) || __builtin_mul_overflow((int64_t)p, (int64_t)pow10_table[-k], &units)) {
+        return 0;
+    }
+    *r = (Decimal){units, scale};
+    return 1;
+}
+
+// a.units * 10^(scale + b.scale - a.scale) / b.units. If the numerator does not fit in
+// 128 bits, the quotient does not fit in 64.
+int decimal_div(Decimal *r, Decimal a, Decimal b, int scale, RoundMode mode) {
+    if (scale < 0 || scale > DECIMAL_MAX_SCALE || b.units == 0)
+        return 0;
+    int e = scale + b.scale - a.scale;
+    u128 num = magnitude(a.units), den = magnitude(b.units);
+    if (e >= 0) {
+        u128 p = pow10_128(e);
+        if (num > ((u128)1 << 127) / p)
+            return 0;
+        num *= p;
+    } else {
+        den *= pow10_128(-e);
+    }
+    int negative = (a.units < 0) != (b.units < 0);
+    u128 q = num / den;
+    q = round_quotient(q, num - q * den, den, negative, mode);
+    if (q > (u128)INT64_MAX + (u128)negative)
+        return 0;
+    *r = (Decimal){negative ? (int64_t)(0 - (uint64_t)q) : (int64_t)q, scale};
+    return 1;
+}
+
+int decimal_compare(Decimal a, Decimal b) {
+    i128 x = a.units, y = b.units;
+    if (a.scale < b.scale)
+        x *= (i128)pow10_table[b.scale - a.scale];
+    else
+        y *= (i128)pow10_table[a.scale - b.scale];
+    return (x > y) - (x < y);
+}
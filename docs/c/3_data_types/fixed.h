@@ -0,0 +1,117 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Fixed-point and decimal module (interface). 1_precision_and_speed_test.c prints
+123456789.0f as 123456792.00: a float has 24 bits of mantissa, and a double, as in the
+price of ProductData in 2_defining_portable_structure.c, holds 0.10 only approximately,
+so a sum of prices drifts and 1.015 rounds down to 1.01. Both kinds here are integers
+with an agreed scale, so addition is exact and every rounding is explicit.
+
+  - Q15, Q31: int16_t and int32_t fractions in [-1, 1), the value times 2^15 or 2^31.
+    Addition and multiplication saturate at the ends instead of wrapping; the array
+    versions do 16 or 8 at a time with AVX2 (VPADDSW and VPMULHRSW for Q15; for Q31 the
+    sign of the overflow selects the limit, and the 64-bit products of the even and odd
+    lanes are shifted and blended back together).
+  - fix64: an int64_t with frac fraction bits (0..62) chosen by the caller, added and
+    subtracted with saturation like Q31, multiplied and divided through 128-bit
+    intermediates, rounded to nearest and saturated. Q15
+    and Q31 values are parsed and formatted as fix64 values with frac 15 and 31.
+  - Decimal: an int64_t count of units of 10^-scale (scale 0..18), e.g. 1999 at scale
+    2 for 19.99. Addition and subtraction are exact and return 0 on overflow;
+    multiplication, division and rescaling round to a given scale in one of the modes
+    below. Dividing by 10^k uses a switch on k, so that every case divides by a
+    constant, which the compiler turns into a multiplication.
+Parsing reads 8 digits at a time from one 8-byte load (the SWAR method of Lemire) where
+the input is long enough; formatting writes two digits at a time from a table.
+*/
+
+#define DECIMAL_MAX_SCALE 18
+#define DECIMAL_TEXT 40 // room for any formatted Decimal or fix64 and the '\0'
+
+typedef enum {
+    ROUND_HALF_EVEN, // to nearest, ties to the even neighbour (banker's rounding)
+    ROUND_HALF_UP,   // to nearest, ties away from zero (as taught at school)
+    ROUND_DOWN,      // toward zero (truncation)
+    ROUND_UP,        // away from zero
+    ROUND_FLOOR,     // toward -infinity
+    ROUND_CEILING    // toward +infinity
+} RoundMode;
+
+typedef struct {
+    int64_t units;
+    int scale;
+} Decimal;
+
+// ---- Q15 and Q31 ----
+
+static inline int16_t q15_add(int16_t a, int16_t b) {
+    int s = a + b;
+    return (int16_t)(s > INT16_MAX ? INT16_MAX : s < INT16_MIN ? INT16_MIN : s);
+}
+
+// Rounded to nearest; -1 * -1 gives the largest value below 1.
+static inline int16_t q15_mul(int16_t a, int16_t b) {
+    int p = (a * b + (1 << 14)) >> 15;
+    return (int16_t)(p > INT16_MAX ? INT16_MAX : p);
+}
+
+static inline int32_t q31_add(int32_t a, int32_t b) {
+    int32_t s;
+    return __builtin_add_overflow(a, b, &s) ? (a < 0 ? INT32_MIN : INT32_MAX) : s;
+}
+
+static inline int32_t q31_mul(int32_t a, int32_t b) {
+    int64_t p = ((int64_t)a * b + (1LL << 30)) >> 31;
+    return (int32_t)(p > INT32_MAX ? INT32_MAX : p);
+}
+
+// dst[i] = a[i] op b[i]; dst may be a or b.
+void q15_add_array(int16_t *dst, const int16_t *a, const int16_t *b, size_t n);
+void q15_mul_array(int16_t *dst, const int16_t *a, const int16_t *b, size_t n);
+void q31_add_array(int32_t *dst, const int32_t *a, const int32_t *b, size_t n);
+void q31_mul_array(int32_t *dst, const int32_t *a, const int32_t *b, size_t n);
+
+// ---- fix64 ----
+
+// Saturating; the sum of two values with the same frac bits has the same frac bits.
+static inline int64_t fix64_add(int64_t a, int64_t b) {
+    int64_t s;
+    return __builtin_add_overflow(a, b, &s) ? (a < 0 ? INT64_MIN : INT64_MAX) : s;
+}
+
+static inline int64_t fix64_sub(int64_t a, int64_t b) {
+    int64_t d;
+    return __builtin_sub_overflow(a, b, &d) ? (a < 0 ? INT64_MIN : INT64_MAX) : d;
+}
+
+int64_t fix64_mul(int64_t a, int64_t b, int frac);
+int64_t fix64_div(int64_t a, int64_t b, int frac); // b != 0
+int64_t fix64_from_double(double x, int frac);
+double fix64_to_double(int64_t x, int frac);
+// Returns the characters read, or 0 if there is no number or it does not fit.
+size_t fix64_parse(const char *s, size_t n, int frac, int64_t *out);
+// digits after the point (0..18), rounded half to even; returns the length.
+size_t fix64_format(char *buf, int64_t x, int frac, int digits);
+
+// ---- Decimal ----
+
+// [-]digits[.digits]: the scale is the number of digits after the point, at most 18;
+// the value must fit in an int64_t. Returns the characters read, or 0.
+size_t decimal_parse(const char *s, size_t n, Decimal *out);
+size_t decimal_format(char *buf, Decimal a); // e.g. "-12.50"; returns the length
+double decimal_to_double(Decimal a);
+int decimal_from_double(Decimal *r, double x, int scale); // nearest, as printf rounds
+
+// Return 0 on overflow (and for division by zero); *r is then unchanged.
+int decimal_rescale(Decimal *r, Decimal a, int scale, RoundMode mode);
+int decimal_add(Decimal *r, Decimal a, Decimal b); // at the larger scale
+int decimal_sub(Decimal *r, Decimal a, Decimal b);
+int decimal_mul(Decimal *r, Decimal a, Decimal b, int scale, RoundMode mode);
+int decimal_div(Decimal *r, Decimal a, Decimal b, int scale, RoundMode mode);
+int decimal_compare(Decimal a, Decimal b); // -1, 0, 1; 1.50 equals 1.5
+
+#endif
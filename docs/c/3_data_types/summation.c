@@ -0,0 +1,392 @@
+#include <string.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "summation.h"
+
+/*
+Summation module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 11_summation.c summation.c -o summation
+*/
+
+typedef unsigned __int128 u128;
+
+#define LANES 16 // element i of a run goes to lane i % 16, with and without AVX2
+#define PAIRWISE_BLOCK 256
+#define PROPAGATE_AFTER (1u << 29) // an addition changes a chunk by less than 2^33
+#define BIAS 2148                  // 2^-2148 is bit 0 of the superaccumulator
+
+// ---- Lane steps, shared by the scalar code and the folding of the AVX2 lanes ----
+
+static inline double abs_d(double x) {
+    return x < 0 ? -x : x;
+}
+
+static inline void kahan_add(double *s, double *c, double x) {
+    double y = x - *c, t = *s + y;
+    *c = (t - *s) - y; // what was rounded off, negated
+    *s = t;
+}
+
+static inline void neumaier_add(double *s, double *c, double x) {
+    double t = *s + x;
+    *c += abs_d(*s) >= abs_d(x) ? (*s - t) + x : (x - t) + *s;
+    *s = t;
+}
+
+// The lanes, then their compensations, added in a fixed order.
+static double fold_lanes(const double *s, const double *c) {
+    double sum = 0, comp = 0;
+    for (int j = 0; j < LANES; ++j)
+        neumaier_add(&sum, &comp, s[j]);
+    for (int j = 0; j < LANES; ++j)
+        neumaier_add(&sum, &comp, c[j]);
+    return sum + comp;
+}
+
+// ---- Pairwise, Kahan and Neumaier ----
+
+// Up to PAIRWISE_BLOCK values into the lanes, then the lanes as a tree.
+static double block_sum(const double *a, size_t n) {
+    double s[LANES] = {0};
+    size_t i = 0;
+#ifdef __AVX2__
+    __m256d v0 = _mm256_setzero_pd(), v1 = v0, v2 = v0, v3 = v0;
+    for (; i + LANES <= n; i += LANES) {
+        v0 = _mm256_add_pd(v0, _mm256_loadu_pd(a + i));
+        v1 = _mm256_add_pd(v1, _mm256_loadu_pd(a + i + 4));
+        v2 = _mm256_add_pd(v2, _mm256_loadu_pd(a + i + 8));
+        v3 = _mm256_add_pd(v3, _mm256_loadu_pd(a + i + 12));
+    }
+    _mm256_storeu_pd(s, v0);
+    _mm256_storeu_pd(s + 4, v1);
+    _mm256_storeu_pd(s + 8, v2);
+    _mm256_storeu_pd(s + 12, v3);
+#endif
+    for (; i < n; ++i)
+        s[i % LANES] += a[i];
+    for (int w = LANES / 2; w > 0; w /= 2)
+        for (int j = 0; j < w; ++j)
+            s[j] += s[j + w];
+    return s[0];
+}
+
+double sum_pairwise(const double *a, size_t n) {
+    if (n <= PAIRWISE_BLOCK)
+        return block_sum(a, n);
+    size_t half = n / 2 / LANES * LANES;
+    return sum_pairwise(a, half) + sum_pairwise(a + half, n - half);
+}
+
+#ifdef __AVX2__
+static inline void kahan_add4(__m256d *s, __m256d *c, __m256d x) {
+    __m256d y = _mm256_sub_pd(x, *c), t = _mm256_add_pd(*s, y);
+    *c = _mm256_sub_pd(_mm256_sub_pd(t, *s), y);
+    *s = t;
+}
+
+// The compare and the two blends choose the operands of the scalar ?: of neumaier_add.
+static inline void neumaier_add4(__m256d *s, __m256d *c, __m256d x) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d t = _mm256_add_pd(*s, x);
+    __m256d s_larger = _mm256_cmp_pd(_mm256_andnot_pd(sign, *s), _mm256_andnot_pd(sign, x), _CMP_GE_OQ);
+    __m256d larger = _mm256_blendv_pd(x, *s, s_larger), smaller = _mm256_blendv_pd(*s, x, s_larger);
+    *c = _mm256_add_pd(*c, _mm256_add_pd(_mm256_sub_pd(larger, t), smaller));
+    *s = t;
+}
+#endif
+
+typedef enum { KAHAN, NEUMAIER } Compensation;
+
+static inline __attribute__((always_inline)) double compensated_sum(const double *a, size_t n, Compensation kind) {
+    double s[LANES] = {0}, c[LANES] = {0};
+    size_t i = 0;
+#ifdef __AVX2__
+    __m256d s0 = _mm256_setzero_pd(), s1 = s0, s2 = s0, s3 = s0, c0 = s0, c1 = s0, c2 = s0, c3 = s0;
+    for (; i + LANES <= n; i += LANES) {
+        if (kind == KAHAN) {
+            kahan_add4(&s0, &c0, _mm256_loadu_pd(a + i));
+            kahan_add4(&s1, &c1, _mm256_loadu_pd(a + i + 4));
+            kahan_add4(&s2, &c2, _mm256_loadu_pd(a + i + 8));
+            kahan_add4(&s3, &c3, _mm256_loadu_pd(a + i + 12));
+        } else {
+            neumaier_add4(&s0, &c0, _mm256_loadu_pd(a + i));
+            neumaier_add4(&s1, &c1, _mm256_loadu_pd(a + i + 4));
+            neumaier_add4(&s2, &c2, _mm256_loadu_pd(a + i + 8));
+            neumaier_add4(&s3, &c3, _mm256_loadu_pd(a + i + 12));
+        }
+    }
+    _mm256_storeu_pd(s, s0);
+    _mm256_storeu_pd(s + 4, s1);
+    _mm256_storeu_pd(s + 8, s2);
+    _mm256_storeu_pd(s + 12, s3);
+    _mm256_storeu_pd(c, c0);
+    _mm256_storeu_pd(c + 4, c1);
+    _mm256_storeu_pd(c + 8, c2);
+    _mm256_storeu_pd(c + 12, c3);
+#endif
+    for (; i < n; ++i) {
+        if (kind == KAHAN)
+            kahan_add(&s[i % LANES], &c[i % LANES], a[i]);
+        else
+            neumaier_add(&s[i % LANES], &c[i % LANES], a[i]);
+    }
+    if (kind == KAHAN)
+        for (int j = 0; j < LANES; ++j)
+            c[j] = -c[j];
+    return fold_lanes(s, c);
+}
+
+double sum_kahan(const double *a, size_t n) {
+    return compensated_sum(a, n, KAHAN);
+}
+
+double sum_neumaier(const double *a, size_t n) {
+    return compensated_sum(a, n, NEUMAIER);
+}
+
+// ---- Superaccumulator ----
+
+static inline uint64_t bits_of(double x) {
+    uint64_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+static inline int is_special(uint64_t u) {
+    return (u >> 52 & 0x7FF) == 0x7FF;
+}
+
+// The mantissa of a finite double as an integer; *exponent is that of its lowest bit.
+static inline uint64_t mantissa_of(uint64_t u, int *exponent) {
+    int e = (int)(u >> 52 & 0x7FF);
+    *exponent = e ? e - 1075 : -1074;
+    return (u & ((1ULL << 52) - 1)) | (uint64_t)(e != 0) << 52;
+}
+
+// Adds m * 2^(pos - BIAS), negated if sign is -1, to 3 chunks from pos / 32 up.
+static inline void add_shifted(int64_t *chunks, uint64_t m, int pos, int64_t sign) {
+    int k = pos >> 5;
+    u128 v = (u128)m << (pos & 31);
+    chunks[k] += ((int64_t)(uint32_t)v ^ sign) - sign;
+    chunks[k + 1] += ((int64_t)(uint32_t)(v >> 32) ^ sign) - sign;
+    chunks[k + 2] += ((int64_t)(v >> 64) ^ sign) - sign;
+}
+
+// Moves all but the low 32 bits of every chunk into the next one; the top chunk keeps
+// the sign.
+static void propagate(Superaccumulator *s) {
+    for (int k = 0; k < SUPERACC_CHUNKS - 1; ++k) {
+        s->chunks[k + 1] += s->chunks[k] >> 32;
+        s->chunks[k] &= 0xFFFFFFFF;
+    }
+    s->pending = 0;
+}
+
+// Adds x without counting the addition.
+static inline void add_value(Superaccumulator *s, double x) {
+    uint64_t u = bits_of(x);
+    if (is_special(u)) {
+        s->special += x;
+        return;
+    }
+    int e;
+    uint64_t m = mantissa_of(u, &e);
+    add_shifted(s->chunks, m, e + BIAS, -(int64_t)(u >> 63));
+}
+
+static inline void add_product(Superaccumulator *s, double a, double b) {
+    uint64_t u = bits_of(a), v = bits_of(b);
+    if (is_special(u) || is_special(v)) {
+        s->special += a * b;
+        return;
+    }
+    int ea, eb;
+    u128 p = (u128)mantissa_of(u, &ea) * mantissa_of(v, &eb);
+    int pos = ea + eb + BIAS;
+    int64_t sign = -(int64_t)((u ^ v) >> 63);
+    add_shifted(s->chunks, (uint64_t)p, pos, sign);
+    add_shifted(s->chunks, (uint64_t)(p >> 64), pos + 64, sign);
+}
+
+static inline void count_addition(Superaccumulator *s) {
+    if (++s->pending == PROPAGATE_AFTER)
+        propagate(s);
+}
+
+void superacc_init(Superaccumulator *s) {
+    memset(s->chunks, 0, sizeof(s->chunks));
+    s->pending = 0;
+    s->special = 0;
+}
+
+void superacc_add(Superaccumulator *s, double x) {
+    add_value(s, x);
+    count_addition(s);
+}
+
+void superacc_add_product(Superaccumulator *s, double a, double b) {
+    add_product(s, a, b);
+    count_addition(s);
+}
+
+void superacc_merge(Superaccumulator *into, const Superaccumulator *from) {
+    Superaccumulator t = *from;
+    propagate(&t);
+    propagate(into);
+    for (int k = 0; k < SUPERACC_CHUNKS; ++k)
+        into->chunks[k] += t.chunks[k];
+    into->pending = 1;
+    into->special += from->special;
+}
+
+// Takes the top 3 nonzero chunks of the magnitude and whether anything is set below
+// them, and rounds to 53 bits, or fewer for a subnormal result. Building the bits as
+// (lsb exponent + 1074) << 52 plus the mantissa with its leading 1 lets a rounding up
+// to 2^53 carry into the exponent.
+double superacc_round(const Superaccumulator *s) {
+    Superaccumulator t = *s;
+    propagate(&t);
+    int64_t *c = t.chunks;
+    int negative = c[SUPERACC_CHUNKS - 1] < 0;
+    if (negative) {
+        for (int k = 0; k < SUPERACC_CHUNKS; ++k)
+            c[k] = -c[k];
+        propagate(&t);
+    }
+    int h = SUPERACC_CHUNKS - 1;
+    while (h >= 0 && c[h] == 0)
+        --h;
+    double r = 0;
+    if (h >= 0) {
+        u128 top = 0;
+        for (int k = h; k > h - 3; --k)
+            top = top << 32 | (uint64_t)(k >= 0 ? c[k] : 0);
+        int sticky = 0;
+        for (int k = h - 3; k >= 0; --k)
+            sticky |= c[k] != 0;
+        int base = 32 * (h - 2) - BIAS; // the exponent of the lowest bit of top
+        int high = base + 127 - __builtin_clzll((uint64_t)(top >> 64));
+        int lsb = high - 52 < -1074 ? -1074 : high - 52;
+        int shift = lsb - base; // at least 12, since the top chunk is not 0
+        u128 mantissa = 0;
+        if (shift <= 96) { // otherwise below half of the smallest subnormal
+            u128 rem = top & (((u128)1 << shift) - 1), half = (u128)1 << (shift - 1);
+            mantissa = top >> shift;
+            if (rem > half || (rem == half && (sticky || (mantissa & 1))))
+                ++mantissa;
+        }
+        uint64_t u;
+        if (lsb + 1074 + (int)(mantissa >> 52) >= 2047)
+            u = 0x7FF0000000000000ULL; // infinity
+        else
+            u = ((uint64_t)(lsb + 1074) << 52) + (uint64_t)mantissa;
+        u |= (uint64_t)negative << 63;
+        memcpy(&r, &u, sizeof(r));
+    }
+    return s->special != 0 ? r + s->special : r;
+}
+
+// ---- Exact sums of arrays ----
+
+// Before the chunks, the mantissas are added as integers into one int64_t per exponent
+// (the "large superaccumulator" of Neal), which takes BUCKET_BLOCK of them without
+// overflow: one addition per value and no shifts. A bit per 32 exponents records which
+// were used, and after each block only those go into the chunks. Values go to WAYS sets
+// of buckets in turn, so that values of the same exponent do not wait for each other's
+// additions. The buckets are all 0 between calls.
+#define BUCKETS 2048
+#define BUCKET_BLOCK 1024 // 1024 * (2^53 - 1) < 2^63
+#define WAYS 4
+
+static _Thread_local int64_t buckets[WAYS][BUCKETS];
+
+static inline void bucket_add(int64_t *b, uint64_t u, uint64_t *used) {
+    int e = (int)(u >> 52 & 0x7FF);
+    int64_t m = (int64_t)((u & ((1ULL << 52) - 1)) | (uint64_t)(e != 0) << 52), sign = -(int64_t)(u >> 63);
+    b[e] += (m ^ sign) - sign;
+    *used |= 1ULL << (e >> 5);
+}
+
+// Moves the used buckets of every way into the chunks and clears them.
+static void flush_buckets(Superaccumulator *s, uint64_t used) {
+    for (; used; used &= used - 1) {
+        int first = __builtin_ctzll(used) * 32;
+        for (int w = 0; w < WAYS; ++w)
+            for (int e = first; e < first + 32; ++e) {
+                int64_t v = buckets[w][e], sign = v >> 63;
+                if (v) {
+                    add_shifted(s->chunks, (uint64_t)((v ^ sign) - sign), (e ? e - 1075 : -1074) + BIAS, sign);
+                    count_addition(s);
+                    buckets[w][e] = 0;
+                }
+            }
+    }
+}
+
+double sum_exact(const double *a, size_t n) {
+    Superaccumulator s;
+    superacc_init(&s);
+    const size_t step = (size_t)WAYS * BUCKET_BLOCK;
+    for (size_t start = 0; start < n; start += step) {
+        size_t end = n - start < step ? n : start + step, i = start;
+        uint64_t used = 0;
+        for (; i + WAYS <= end; i += WAYS) {
+            bucket_add(buckets[0], bits_of(a[i]), &used);
+            bucket_add(buckets[1], bits_of(a[i + 1]), &used);
+            bucket_add(buckets[2], bits_of(a[i + 2]), &used);
+            bucket_add(buckets[3], bits_of(a[i + 3]), &used);
+        }
+        for (; i < end; ++i)
+            bucket_add(buckets[(i - start) % WAYS], bits_of(a[i]), &used);
+        if (used >> 63) { // the infinities and NaNs, which are in bucket 2047, are added apart
+            for (i = start; i < end; ++i)
+                if (is_special(bits_of(a[i])))
+                    s.special += a[i];
+            for (int w = 0; w < WAYS; ++w)
+                buckets[w][BUCKETS - 1] = 0;
+        }
+        flush_buckets(&s, used);
+    }
+    return superacc_round(&s);
+}
+
+// With FMA, a * b is p + e exactly, p = a * b rounded and e = fma(a, b, -p), unless p
+// overflows or e would be below the subnormals, which cannot happen for |p| >= 2^-969.
+// Both go into the buckets; other products, and all products without FMA, are added to
+// the chunks as 106-bit integers.
+#ifdef __FMA__
+static inline int product_add(int64_t *b, double x, double y, uint64_t *used) {
+    double p = x * y, abs_p = abs_d(p);
+    if (!(abs_p >= 0x1p-969 && abs_p <= 0x1.fffffffffffffp1023)) // also for NaN
+        return 0;
+    bucket_add(b, bits_of(p), used);
+    bucket_add(b, bits_of(__builtin_fma(x, y, -p)), used);
+    return 1;
+}
+#endif
+
+double dot_exact(const double *a, const double *b, size_t n) {
+    Superaccumulator s;
+    superacc_init(&s);
+    size_t i = 0;
+#ifdef __FMA__
+    const size_t step = (size_t)WAYS * BUCKET_BLOCK / 2;
+    for (size_t start = 0; start < n; start += step) {
+        size_t end = n - start < step ? n : start + step;
+        uint64_t used = 0;
+        for (i = start; i + WAYS <= end; i += WAYS)
+            for (int w = 0; w < WAYS; ++w)
+                if (!product_add(buckets[w], a[i + w], b[i + w], &used))
+                    superacc_add_product(&s, a[i + w], b[i + w]);
+        for (; i < end; ++i)
+            if (!product_add(buckets[(i - start) % WAYS], a[i], b[i], &used))
+                superacc_add_product(&s, a[i], b[i]);
+        flush_buckets(&s, used);
+    }
+#endif
+    for (; i < n; ++i)
+        superacc_add_product(&s, a[i], b[i]);
+    return superacc_round(&s);
+}
@@ -0,0 +1,60 @@
+#ifndef SUMMATION_H
+#define SUMMATION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Summation module (interface). The loop float_sum += (i * 1.0) / 10.0 of
+1_precision_and_speed_test.c rounds after every addition, so the error grows with the
+number of terms, and one large value followed by its negative wipes out everything
+added in between. The kernels here trade a little speed for accuracy, and the result
+depends only on the array, not on the build: the scalar code keeps the same 16 partial
+sums as the AVX2 code (4 vectors of 4 doubles) and adds them up in the same order. (This
+holds for doubles in SSE2 registers, the default on x86-64; the 80-bit x87 registers of
+-mfpmath=387 round differently.)
+
+  - sum_pairwise: blocks of 256 values are added into the 16 lanes, the lanes are added
+    as a tree, and the blocks are added by halving the array; the error bound grows with
+    log2(n) instead of n. About the speed of a plain read of the array.
+  - sum_kahan, sum_neumaier: compensated sums, one per lane. Kahan carries the part of
+    every addition that was rounded off into the next one; Neumaier's variant also
+    keeps it when the new value is larger than the sum, as in 1e100 + 1 - 1e100. The
+    error is a few units in the last place, nearly independent of n.
+  - Superaccumulator, sum_exact, dot_exact: the exact sum, rounded once to the nearest
+    double (ties to even) at the end, so it does not depend on the order of the values.
+    Every double is an integer times a power of two; the accumulator is a fixed-point
+    number of 134 chunks of 32 bits from 2^-2148 (the smallest product of two doubles)
+    upward, each chunk kept in an int64_t so that additions need no carries until 2^29
+    of them have been made (Neal's "small superaccumulator"). A product is added as the
+    exact 106-bit product of the two mantissas, so a dot product whose terms overflow
+    or underflow as doubles is still exact. sum_exact first adds the mantissas of 1024
+    values into one int64_t per exponent (Neal's "large superaccumulator"), and
+    dot_exact splits a product into a double and its rounding error with FMA first, so
+    both cost one or two integer additions per value.
+Infinities and NaNs are added as doubles next to the exact part and give the same kind
+of result as a plain loop. Do not compile with -ffast-math: it allows the compiler to
+reassociate the additions, which removes the compensation of Kahan and Neumaier.
+*/
+
+#define SUPERACC_CHUNKS 134
+
+typedef struct {
+    int64_t chunks[SUPERACC_CHUNKS]; // chunk k: 2^(32k - 2148) times its value
+    uint32_t pending;                // additions since the carries were propagated
+    double special;                  // the sum of the infinities and NaNs, or 0
+} Superaccumulator;
+
+double sum_pairwise(const double *a, size_t n);
+double sum_kahan(const double *a, size_t n);
+double sum_neumaier(const double *a, size_t n);
+double sum_exact(const double *a, size_t n);
+double dot_exact(const double *a, const double *b, size_t n);
+
+void superacc_init(Superaccumulator *s);
+void superacc_add(Superaccumulator *s, double x);
+void superacc_add_product(Superaccumulator *s, double a, double b);
+void superacc_merge(Superaccumulator *into, const Superaccumulator *from);
+double superacc_round(const Superaccumulator *s); // the sum so far, rounded to nearest
+
+#endif
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+64-bit versions of num_digit, sum_digit and get_rev_num from the loop statements chapter.
+The chapter versions divide by 10 once per digit and the int version of get_rev_num
+overflows silently. Here:
+  - digit count: count-leading-zeros + power-of-ten table, no loop at all
+  - digit sum / reverse: 4 digits per step through 10000-entry lookup tables
+  - digital root (the mystery func() of the chapter) in O(1)
+  - array (batch) variants of each kernel
+*/
+
+#define BATCH_SIZE 2000000
+
+static const uint64_t pow10_u64[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static uint8_t digit_sum4[10000];  // digit sum of 0000..9999
+static uint16_t digit_rev4[10000]; // "0012" -> 2100
+
+void init_digit_tables(void) {
+    for (int i = 0; i < 10000; ++i) {
+        int a = i / 1000, b = i / 100 % 10, c = i / 10 % 10, d = i % 10;
+        digit_sum4[i] = (uint8_t)(a + b + c + d);
+        digit_rev4[i] = (uint16_t)(d * 1000 + c * 100 + b * 10 + a);
+    }
+}
+
+// ---- Reference versions (same algorithm as the chapter, widened to 64 bits) ----
+
+int num_digit_loop(uint64_t val) {
+    int digit_counter = 0;
+    if (val == 0)
+        return 1;
+    while (val != 0) {
+        digit_counter++;
+        val /= 10;
+    }
+    return digit_counter;
+}
+
+int sum_digit_loop(uint64_t val) {
+    int digit_sum = 0;
+    while (val) {
+        digit_sum += val % 10;
+        val /= 10;
+    }
+    return digit_sum;
+}
+
+// The chapter's mystery function: it keeps folding the running sum below 11.
+int func(uint64_t val) {
+    int sum = 0;
+    while (val) {
+        sum += val % 10;
+        if (sum > 10)
+            sum = 1 + sum % 10;
+        val /= 10;
+    }
+    return sum;
+}
+
+// ---- Kernels ----
+
+// bit length * log10(2) ~= bit length * 1233 / 4096 gives the digit count or one less;
+// a single table compare fixes it. Setting the low bit never changes the digit count
+// (10^k - 1 is odd) and makes 0 behave like 1, which also keeps clz defined.
+int num_digit_u64(uint64_t val) {
+    val |= 1;
+    int bits = 64 - __builtin_clzll(val);
+    int t = (bits * 1233) >> 12;
+    return t + 1 - (val < pow10_u64[t]);
+}
+
+int sum_digit_u64(uint64_t val) {
+    int digit_sum = 0;
+    while (val >= 10000) {
+        digit_sum += digit_sum4[val % 10000]; // constant divisor: compiled to multiply + shift
+        val /= 10000;
+    }
+    return digit_sum + digit_sum4[val];
+}
+
+// Returns 1 and writes the reversed number to *rev, or returns 0 if the result does not fit
+// in 64 bits (e.g. 18446744073709551615 -> 51615590737044764481).
+int get_rev_num_u64(uint64_t val, uint64_t *rev) {
+    unsigned __int128 rev_number = 0;
+    while (val >= 10000) {
+        rev_number = rev_number * 10000 + digit_rev4[val % 10000];
+        val /= 10000;
+    }
+    // The last (most significant) chunk has 1..4 digits: its 4-digit reverse carries
+    // 4 - d trailing zeros that must be dropped.
+    int d = num_digit_u64(val);
+    rev_number = rev_number * pow10_u64[d] + digit_rev4[val] / pow10_u64[4 - d];
+    if (rev_number > UINT64_MAX)
+        return 0;
+    *rev = (uint64_t)rev_number;
+    return 1;
+}
+
+// Digital root: n mod 9 with 9 in place of 0, for n > 0.
+int digital_root_u64(uint64_t val) {
+    return val == 0 ? 0 : (int)(1 + (val - 1) % 9);
+}
+
+// ---- Batch variants ----
+
+void num_digit_array(const uint64_t *src, uint8_t *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (uint8_t)num_digit_u64(src[i]);
+}
+
+void sum_digit_array(const uint64_t *src, uint16_t *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (uint16_t)sum_digit_u64(src[i]);
+}
+
+// Returns the number of values whose reverse overflowed; their slots are set to 0.
+size_t get_rev_num_array(const uint64_t *src, uint64_t *dst, size_t n) {
+    size_t overflow_count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!get_rev_num_u64(src[i], &dst[i])) {
+            dst[i] = 0;
+            overflow_count++;
+        }
+    }
+    return overflow_count;
+}
+
+void digital_root_array(const uint64_t *src, uint8_t *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = (uint8_t)digital_root_u64(src[i]);
+}
+
+// ---- Test data and benchmark ----
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+uint64_t next_u64(void) {
+    // splitmix64
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Random values with a uniformly distributed digit count, so short numbers are tested too.
+uint64_t random_value(void) {
+    int digits = 1 + (int)(next_u64() % 20);
+    uint64_t x = next_u64();
+    return digits == 20 ? x : x % pow10_u64[digits];
+}
+
+int check_kernels(void) {
+    static const uint64_t edge[] = {0, 1, 9, 10, 99, 100, 9999, 10000, 10001, 1357,
+                                    999999999999999999ULL, 1000000000000000000ULL,
+                                    9999999999999999999ULL, 10000000000000000000ULL, UINT64_MAX};
+    int errors = 0;
+    for (size_t i = 0; i < sizeof(edge) / sizeof(edge[0]) + 1000000; ++i) {
+        uint64_t x = i < sizeof(edge) / sizeof(edge[0]) ? edge[i] : random_value();
+        if (num_digit_u64(x) != num_digit_loop(x))
+            errors++;
+        if (sum_digit_u64(x) != sum_digit_loop(x))
+            errors++;
+
+        unsigned __int128 expected = 0;
+        for (uint64_t v = x; v; v /= 10)
+            expected = expected * 10 + v % 10;
+        uint64_t rev;
+        int ok = get_rev_num_u64(x, &rev);
+        if (ok != (expected <= UINT64_MAX) || (ok && rev != (uint64_t)expected))
+            errors++;
+
+        // func() equals the digital root except when it stops at 10 (10 = 1 + 0 folded once more).
+        int f = func(x);
+        if ((f == 10 ? 1 : f) != digital_root_u64(x))
+            errors++;
+    }
+    return errors;
+}
+
+double seconds_since(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void) {
+    init_digit_tables();
+
+    printf("--- 1. Correctness against the loop versions ---\n");
+    int errors = check_kernels();
+    printf("mismatches: %d\n", errors);
+
+    uint64_t rev;
+    uint64_t x = 1357;
+    get_rev_num_u64(x, &rev);
+    printf("num_digit(%llu) = %d, sum_digit = %d, reverse = %llu, digital root = %d\n",
+           (unsigned long long)x, num_digit_u64(x), sum_digit_u64(x),
+           (unsigned long long)rev, digital_root_u64(x));
+    x = UINT64_MAX;
+    printf("reverse of %llu fits in 64 bits: %s\n", (unsigned long long)x,
+           get_rev_num_u64(x, &rev) ? "yes" : "no (overflow reported)");
+
+    printf("\n--- 2. Batch throughput (%d values) ---\n", BATCH_SIZE);
+    uint64_t *src = malloc(BATCH_SIZE * sizeof(*src));
+    uint8_t *digits = malloc(BATCH_SIZE);
+    uint16_t *sums = malloc(BATCH_SIZE * sizeof(*sums));
+    uint64_t *revs = malloc(BATCH_SIZE * sizeof(*revs));
+    if (!src || !digits || !sums || !revs) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < BATCH_SIZE; ++i)
+        src[i] = random_value();
+
+    // volatile sink keeps the reference loops from being optimized away
+    volatile uint64_t sink = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < BATCH_SIZE; ++i)
+        sink += num_digit_loop(src[i]);
+    double t_loop = seconds_since(start);
+    start = clock();
+    num_digit_array(src, digits, BATCH_SIZE);
+    double t_fast = seconds_since(start);
+    printf("num_digit : loop %.4f s, clz+table %.4f s\n", t_loop, t_fast);
+
+    start = clock();
+    for (size_t i = 0; i < BATCH_SIZE; ++i)
+        sink += sum_digit_loop(src[i]);
+    t_loop = seconds_since(start);
+    start = clock();
+    sum_digit_array(src, sums, BATCH_SIZE);
+    t_fast = seconds_since(start);
+    printf("sum_digit : loop %.4f s, 4-digit table %.4f s\n", t_loop, t_fast);
+
+    start = clock();
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        uint64_t r = 0;
+        for (uint64_t v = src[i]; v; v /= 10)
+            r = r * 10 + v % 10; // wraps on overflow, as the chapter version does
+        sink += r;
+    }
+    t_loop = seconds_since(start);
+    start = clock();
+    size_t overflows = get_rev_num_array(src, revs, BATCH_SIZE);
+    t_fast = seconds_since(start);
+    printf("reverse   : loop %.4f s, 4-digit table %.4f s (%zu overflows detected)\n",
+           t_loop, t_fast, overflows);
+
+    start = clock();
+    for (size_t i = 0; i < BATCH_SIZE; ++i)
+        sink += func(src[i]);
+    t_loop = seconds_since(start);
+    start = clock();
+    digital_root_array(src, digits, BATCH_SIZE);
+    t_fast = seconds_since(start);
+    printf("func()    : loop %.4f s, digital root O(1) %.4f s\n", t_loop, t_fast);
+
+    free(src);
+    free(digits);
+    free(sums);
+    free(revs);
+    return errors != 0;
+}
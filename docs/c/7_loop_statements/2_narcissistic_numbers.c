@@ -0,0 +1,286 @@
+// gcc -O2 -pthread 2_narcissistic_numbers.c -o narcissistic
+// ./narcissistic [max_digits (1..39)] [thread_count]
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+The loop statements chapter finds the 3-digit numbers with abc = a^3 + b^3 + c^3 by
+trying every number from 100 to 999. Such numbers are called narcissistic (Armstrong)
+numbers: an n-digit number equal to the sum of the n-th powers of its digits.
+
+The sum a^n + b^n + ... does not depend on the order of the digits, so instead of trying
+all 10^n numbers we try every digit multiset (how many 0s, 1s, ..., 9s): there are only
+C(n + 9, 9) of them. For each multiset we compute the power sum once and check whether
+the sum is made of exactly the same digits.
+
+The largest narcissistic number has 39 digits, so all sums are kept in 128-bit integers.
+For n = 39 a sum can exceed 2^128 - 1 (39 * 9^39 > 2^128); such branches are pruned,
+which only skips 39-digit numbers above 2^128 - 1 (~3.4 * 10^38).
+*/
+
+#define MAX_DIGITS 39
+#define MAX_THREADS 256
+#define MAX_RESULTS 128 // there are 88 narcissistic numbers in total
+
+typedef unsigned __int128 u128;
+
+static const u128 U128_MAX = ~(u128)0;
+static const uint64_t TEN19 = 10000000000000000000ULL;
+
+static u128 pow_table[MAX_DIGITS + 1][10]; // pow_table[n][d] = d^n
+static u128 pow10_table[MAX_DIGITS + 1];   // 10^n, saturated at U128_MAX for n = 39
+
+void init_tables(void) {
+    for (int n = 0; n <= MAX_DIGITS; ++n)
+        for (int d = 0; d < 10; ++d) {
+            u128 p = 1;
+            for (int i = 0; i < n; ++i)
+                p *= d;
+            pow_table[n][d] = p;
+        }
+    pow10_table[0] = 1;
+    for (int n = 1; n <= MAX_DIGITS; ++n)
+        pow10_table[n] = n == MAX_DIGITS ? U128_MAX : pow10_table[n - 1] * 10;
+}
+
+void u128_to_string(u128 x, char *buf) {
+    char tmp[48];
+    int len = 0;
+    do {
+        tmp[len++] = (char)('0' + (int)(x % 10));
+        x /= 10;
+    } while (x);
+    for (int i = 0; i < len; ++i)
+        buf[i] = tmp[len - 1 - i];
+    buf[len] = '\0';
+}
+
+// ---- Multiset search ----
+
+typedef struct {
+    int n;       // digit length being searched
+    u128 low;    // smallest n-digit value
+    u128 high;   // largest n-digit value (or U128_MAX)
+    u128 results[MAX_RESULTS];
+    int result_count;
+} SearchContext;
+
+// Counts the decimal digits of x. Works on 19-digit chunks so that only one 128-bit
+// division per chunk is needed; the rest is 64-bit arithmetic.
+void count_digits_u128(u128 x, int counts[10]) {
+    memset(counts, 0, 10 * sizeof(int));
+    while (x >= TEN19) {
+        uint64_t chunk = (uint64_t)(x % TEN19);
+        x /= TEN19;
+        for (int i = 0; i < 19; ++i) { // inner chunks keep their leading zeros
+            counts[chunk % 10]++;
+            chunk /= 10;
+        }
+    }
+    uint64_t rest = (uint64_t)x;
+    do {
+        counts[rest % 10]++;
+        rest /= 10;
+    } while (rest);
+}
+
+void check_multiset(SearchContext *ctx, u128 sum, const int counts[10]) {
+    if (sum < ctx->low || sum > ctx->high)
+        return;
+    int sum_counts[10];
+    count_digits_u128(sum, sum_counts);
+    if (memcmp(sum_counts, counts, sizeof(sum_counts)) == 0 && ctx->result_count < MAX_RESULTS)
+        ctx->results[ctx->result_count++] = sum;
+}
+
+// Chooses how many times `digit` occurs, from 9 down to 0. sum only grows, so a branch is
+// cut as soon as it passes `high`, and skipped while even all-`digit - 1` cannot reach `low`.
+void search_digits(SearchContext *ctx, int digit, int remaining, u128 sum, int counts[10]) {
+    const u128 *pw = pow_table[ctx->n];
+    if (digit == 0) {
+        counts[0] = remaining;
+        check_multiset(ctx, sum, counts);
+        return;
+    }
+    u128 s = sum;
+    for (int c = 0; c <= remaining; ++c) {
+        if (c > 0 && __builtin_add_overflow(s, pw[digit], &s))
+            break;
+        if (s > ctx->high)
+            break;
+        u128 best_rest = (u128)(remaining - c) * pw[digit - 1];
+        if (s + best_rest < s || s + best_rest >= ctx->low) { // overflow means "large enough"
+            counts[digit] = c;
+            search_digits(ctx, digit - 1, remaining - c, s, counts);
+        }
+    }
+    counts[digit] = 0;
+}
+
+// A task fixes the digit length and the counts of 9s and 8s; the rest is searched recursively.
+typedef struct {
+    int n, c9, c8;
+} Task;
+
+typedef struct {
+    Task *tasks;
+    int task_count;
+    atomic_int next_task;
+} TaskQueue;
+
+typedef struct {
+    TaskQueue *queue;
+    u128 results[MAX_RESULTS];
+    int result_count;
+} Worker;
+
+void *worker_main(void *arg) {
+    Worker *w = arg;
+    SearchContext ctx;
+    for (;;) {
+        int t = atomic_fetch_add_explicit(&w->queue->next_task, 1, memory_order_relaxed);
+        if (t >= w->queue->task_count)
+            break;
+        Task task = w->queue->tasks[t];
+        ctx.n = task.n;
+        ctx.low = task.n == 1 ? 1 : pow10_table[task.n - 1];
+        ctx.high = task.n == MAX_DIGITS ? U128_MAX : pow10_table[task.n] - 1;
+        ctx.result_count = 0;
+
+        const u128 *pw = pow_table[task.n];
+        u128 s9, s8, sum; // for n = 39, c9 * 9^39 wraps from c9 = 21 on
+        if (__builtin_mul_overflow((u128)task.c9, pw[9], &s9) || __builtin_mul_overflow((u128)task.c8, pw[8], &s8) ||
+            __builtin_add_overflow(s9, s8, &sum) || sum > ctx.high)
+            continue;
+        int counts[10] = {0};
+        counts[9] = task.c9;
+        counts[8] = task.c8;
+        search_digits(&ctx, 7, task.n - task.c9 - task.c8, sum, counts);
+
+        for (int i = 0; i < ctx.result_count && w->result_count < MAX_RESULTS; ++i)
+            w->results[w->result_count++] = ctx.results[i];
+    }
+    return NULL;
+}
+
+int compare_u128(const void *a, const void *b) {
+    u128 x = *(const u128 *)a, y = *(const u128 *)b;
+    return (x > y) - (x < y);
+}
+
+// Finds all narcissistic numbers with 1..max_digits digits; returns how many were found.
+int find_narcissistic(int max_digits, int thread_count, u128 *out) {
+    int task_count = 0;
+    for (int n = 1; n <= max_digits; ++n)
+        task_count += (n + 1) * (n + 2) / 2;
+    Task *tasks = malloc(task_count * sizeof(*tasks));
+    Worker *workers = calloc(thread_count, sizeof(*workers));
+    pthread_t *threads = malloc(thread_count * sizeof(*threads));
+    int *started = malloc(thread_count * sizeof(*started));
+    if (!tasks || !workers || !threads || !started) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    // Longest numbers first: they hold nearly all of the work, short tasks fill the tail.
+    int k = 0;
+    for (int n = max_digits; n >= 1; --n)
+        for (int c9 = 0; c9 <= n; ++c9)
+            for (int c8 = 0; c8 <= n - c9; ++c8)
+                tasks[k++] = (Task){n, c9, c8};
+
+    TaskQueue queue = {tasks, task_count, 0};
+    for (int i = 0; i < thread_count; ++i) {
+        workers[i].queue = &queue;
+        started[i] = pthread_create(&threads[i], NULL, worker_main, &workers[i]) == 0;
+    }
+    int found = 0;
+    for (int i = 0; i < thread_count; ++i) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            worker_main(&workers[i]); // takes whatever the other threads have not
+        for (int j = 0; j < workers[i].result_count && found < MAX_RESULTS; ++j)
+            out[found++] = workers[i].results[j];
+    }
+    qsort(out, found, sizeof(*out), compare_u128);
+
+    free(tasks);
+    free(workers);
+    free(threads);
+    free(started);
+    return found;
+}
+
+// ---- Brute force (the chapter's approach, generalized to n digits) ----
+
+int brute_force(int max_digits, uint64_t *out) {
+    int found = 0;
+    for (int n = 1; n <= max_digits; ++n) {
+        uint64_t lo = n == 1 ? 1 : (uint64_t)pow10_table[n - 1];
+        uint64_t hi = (uint64_t)pow10_table[n];
+        for (uint64_t k = lo; k < hi; ++k) {
+            uint64_t sum = 0;
+            for (uint64_t v = k; v; v /= 10)
+                sum += (uint64_t)pow_table[n][v % 10];
+            if (sum == k)
+                out[found++] = k;
+        }
+    }
+    return found;
+}
+
+double seconds_between(struct timespec a, struct timespec b) {
+    return (double)(b.tv_sec - a.tv_sec) + (double)(b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int max_digits = argc > 1 ? atoi(argv[1]) : 20;
+    int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+    if (max_digits < 1 || max_digits > MAX_DIGITS || thread_count < 1 || thread_count > MAX_THREADS) {
+        fprintf(stderr, "usage: %s [max_digits 1..%d] [threads 1..%d]\n", argv[0], MAX_DIGITS, MAX_THREADS);
+        return 1;
+    }
+    init_tables();
+
+    struct timespec t0, t1;
+    u128 results[MAX_RESULTS];
+    char buf[48];
+
+    printf("--- 1. Multiset search, 1..%d digits, %d threads ---\n", max_digits, thread_count);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int found = find_narcissistic(max_digits, thread_count, results);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (int i = 0; i < found; ++i) {
+        u128_to_string(results[i], buf);
+        printf("%2zu digits: %s\n", strlen(buf), buf);
+    }
+    printf("%d numbers found in %.3f seconds\n", found, seconds_between(t0, t1));
+
+    // Brute force is only feasible for short numbers: 7 digits = 10^7 candidates.
+    int bench_digits = 7;
+    printf("\n--- 2. Brute force vs multiset, 1..%d digits ---\n", bench_digits);
+    uint64_t brute[MAX_RESULTS];
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int brute_found = brute_force(bench_digits, brute);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double t_brute = seconds_between(t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int multi_found = find_narcissistic(bench_digits, 1, results);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double t_multi = seconds_between(t0, t1);
+
+    int same = brute_found == multi_found;
+    for (int i = 0; same && i < brute_found; ++i)
+        same = (u128)brute[i] == results[i];
+    printf("brute force : %d numbers, %.4f seconds\n", brute_found, t_brute);
+    printf("multiset    : %d numbers, %.4f seconds (1 thread)\n", multi_found, t_multi);
+    printf("results match: %s\n", same ? "yes" : "NO");
+    return !same;
+}
@@ -0,0 +1,381 @@
+// gcc -O2 -march=native -pthread 3_parallel_loops.c pool.c -o parallel_loops
+// ./parallel_loops [-n limit] [-t threads]   (primes below limit, default 5000000; 0 threads: one per CPU)
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pool.h"
+
+/*
+  1. the chapter's primes below 1000 and perfect numbers below 10000, with parallel_for
+     on a pool of every CPU, checked against the chapter's serial loops
+  2. checks: every iteration runs exactly once for many n and grains on pools of 1, 2,
+     3 and 8 threads, parallel_reduce of a count and of a struct against serial loops,
+     thousands of tiny loops back to back with pauses that let the threads park, and a
+     value that is too large
+  3. counting the primes below limit and the perfect numbers below limit / 200 (uneven
+     work: k / 2 divisions for k), a sum of ARRAY_SIZE integers, and the cost of an
+     empty loop: the serial loop against pools of 1, 2, 4, ... threads, best of REPEAT
+*/
+
+#define REPEAT 3
+#define ARRAY_SIZE (1u << 25) // uint32_t values in the sum, 128 MB
+#define EMPTY_LOOPS 20000
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+uint64_t xorshift64(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// ---- The chapter's functions ----
+
+int isprime(int number) {
+    int k;
+    if (number == 0 || number == 1)
+        return 0;
+    if (number % 2 == 0)
+        return number == 2;
+    if (number % 3 == 0)
+        return number == 3;
+    if (number % 5 == 0)
+        return number == 5;
+    for (k = 7; k * k <= number; k += 2)
+        if (number % k == 0)
+            return 0;
+    return 1;
+}
+
+int is_perfect(int number) {
+    int i;
+    int total = 1;
+    for (i = 2; i <= number / 2; ++i)
+        if (number % i == 0)
+            total += i;
+    return number == total;
+}
+
+// ---- Loop bodies ----
+
+typedef struct {
+    int (*test)(int);
+    unsigned char *found; // found[k]: test(k)
+} MarkContext;
+
+void mark_body(size_t begin, size_t end, void *ctx) {
+    MarkContext *m = ctx;
+    for (size_t k = begin; k < end; ++k)
+        m->found[k] = (unsigned char)m->test((int)k);
+}
+
+// *partial is a uint64_t count of the k with test(k); ctx points to the test.
+void count_body(size_t begin, size_t end, void *partial, void *ctx) {
+    int (*test)(int) = *(int (**)(int))ctx;
+    uint64_t count = 0;
+    for (size_t k = begin; k < end; ++k)
+        count += (uint64_t)test((int)k) != 0;
+    *(uint64_t *)partial += count;
+}
+
+void add_u64(void *into, const void *from, void *ctx) {
+    (void)ctx;
+    *(uint64_t *)into += *(const uint64_t *)from;
+}
+
+// visits[k] is incremented for every k; each runs once, so there is no race.
+void visit_body(size_t begin, size_t end, void *ctx) {
+    unsigned *visits = ctx;
+    for (size_t k = begin; k < end; ++k)
+        ++visits[k];
+}
+
+// Not inlined into the serial loop, where the known length lets -O2 vectorize it: both
+// then run the same code.
+__attribute__((noinline)) void array_sum_body(size_t begin, size_t end, void *partial, void *ctx) {
+    const uint32_t *a = ctx;
+    uint64_t sum = 0;
+    for (size_t i = begin; i < end; ++i)
+        sum += a[i];
+    *(uint64_t *)partial += sum;
+}
+
+typedef struct {
+    uint64_t min, max, sum, count;
+} Stats;
+
+void stats_body(size_t begin, size_t end, void *partial, void *ctx) {
+    const uint32_t *a = ctx;
+    Stats *s = partial;
+    for (size_t i = begin; i < end; ++i) {
+        if (a[i] < s->min)
+            s->min = a[i];
+        if (a[i] > s->max)
+            s->max = a[i];
+        s->sum += a[i];
+        s->count += a[i] % 7 == 0;
+    }
+}
+
+void stats_combine(void *into, const void *from, void *ctx) {
+    (void)ctx;
+    Stats *s = into;
+    const Stats *f = from;
+    if (f->min < s->min)
+        s->min = f->min;
+    if (f->max > s->max)
+        s->max = f->max;
+    s->sum += f->sum;
+    s->count += f->count;
+}
+
+void empty_body(size_t begin, size_t end, void *ctx) {
+    (void)begin;
+    (void)end;
+    (void)ctx;
+}
+
+// ---- Checks ----
+
+int check_visits(Pool *p) {
+    static const size_t sizes[] = {0, 1, 2, 3, 7, 16, 100, 1000, 12345, 1000003};
+    static const size_t grains[] = {0, 1, 2, 3, 64, 1000, 100000000};
+    int errors = 0;
+    unsigned *visits = malloc(1000003 * sizeof(unsigned));
+    if (!visits)
+        return 1;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+        for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g) {
+            size_t n = sizes[s];
+            memset(visits, 0, n * sizeof(unsigned));
+            parallel_for(p, n, grains[g], visit_body, visits);
+            for (size_t k = 0; k < n; ++k)
+                errors += visits[k] != 1;
+        }
+    free(visits);
+    return errors;
+}
+
+int check_reduce(Pool *p, const uint32_t *a, size_t n) {
+    int errors = 0;
+    for (size_t m = 0; m <= n; m = m * 3 + 1) {
+        uint64_t sum = 0, serial = 0;
+        for (size_t i = 0; i < m; ++i)
+            serial += a[i];
+        errors += !parallel_reduce(p, m, 0, &sum, sizeof(sum), array_sum_body, add_u64, (void *)a);
+        errors += sum != serial;
+
+        Stats s = {UINT64_MAX, 0, 0, 0}, expected = s;
+        stats_body(0, m, &expected, (void *)a);
+        errors += !parallel_reduce(p, m, m % 5, &s, sizeof(s), stats_body, stats_combine, (void *)a);
+        errors += memcmp(&s, &expected, sizeof(s)) != 0;
+    }
+    unsigned char too_large[POOL_VALUE_SIZE + 1] = {0};
+    errors += parallel_reduce(p, n, 0, too_large, sizeof(too_large), array_sum_body, add_u64, (void *)a);
+    return errors;
+}
+
+// Tiny loops back to back, and now and then a pause long enough for the threads to park.
+int check_back_to_back(Pool *p) {
+    int errors = 0;
+    unsigned visits[64];
+    for (int round = 0; round < 5000; ++round) {
+        size_t n = 1 + round % 64;
+        memset(visits, 0, sizeof(visits));
+        parallel_for(p, n, 1, visit_body, visits);
+        for (size_t k = 0; k < n; ++k)
+            errors += visits[k] != 1;
+        if (round % 1000 == 999) {
+            struct timespec pause = {0, 20000000};
+            nanosleep(&pause, NULL);
+        }
+    }
+    return errors;
+}
+
+// ---- Speed ----
+
+typedef enum { PRIMES, PERFECT, ARRAY_SUM, EMPTY, TASKS } Task;
+
+static const char *task_names[TASKS] = {"primes", "perfect numbers", "array sum", "empty loop"};
+
+// Seconds of the best of REPEAT runs; a NULL pool runs the serial loop.
+double time_task(Pool *p, Task task, size_t limit, const uint32_t *a, uint64_t *result) {
+    double best = 1e30;
+    for (int rep = 0; rep < REPEAT; ++rep) {
+        uint64_t value = 0;
+        struct timespec t0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        switch (task) {
+        case PRIMES:
+        case PERFECT: {
+            int (*test)(int) = task == PRIMES ? isprime : is_perfect;
+            size_t n = task == PRIMES ? limit : limit / 200;
+            if (p)
+                parallel_reduce(p, n, 0, &value, sizeof(value), count_body, add_u64, &test);
+            else
+                count_body(0, n, &value, &test);
+            break;
+        }
+        case ARRAY_SUM:
+            if (p)
+                parallel_reduce(p, ARRAY_SIZE, 0, &value, sizeof(value), array_sum_body, add_u64, (void *)a);
+            else
+                array_sum_body(0, ARRAY_SIZE, &value, (void *)a);
+            break;
+        default:
+            for (int k = 0; k < EMPTY_LOOPS; ++k)
+                if (p)
+                    parallel_for(p, (size_t)p->thread_count * POOL_BLOCKS_PER_THREAD, 0, empty_body, NULL);
+                else
+                    empty_body(0, 0, NULL);
+            break;
+        }
+        double t = seconds_since(t0);
+        if (t < best)
+            best = t;
+        *result = value;
+    }
+    return best;
+}
+
+void print_time(Task task, int threads, double t, double serial) {
+    char name[32] = "serial loop";
+    if (threads)
+        snprintf(name, sizeof(name), "%d thread%s", threads, threads > 1 ? "s" : "");
+    if (task == ARRAY_SUM)
+        printf("  %-12s %9.4f s  %6.2f GB/s", name, t, ARRAY_SIZE * sizeof(uint32_t) / t / 1e9);
+    else if (task == EMPTY)
+        printf("  %-12s %9.3f us per loop", name, t / EMPTY_LOOPS * 1e6);
+    else
+        printf("  %-12s %9.4f s", name, t);
+    if (threads && task != EMPTY)
+        printf("  %5.2fx", serial / t);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    size_t limit = 5000000;
+    int thread_count = 0;
+    for (int k = 1; k < argc; ++k) {
+        if (k + 1 < argc && strcmp(argv[k], "-n") == 0) {
+            limit = strtoull(argv[++k], NULL, 10);
+        } else if (k + 1 < argc && strcmp(argv[k], "-t") == 0) {
+            thread_count = atoi(argv[++k]);
+        } else {
+            fprintf(stderr, "unknown option %s\n", argv[k]);
+            return 1;
+        }
+    }
+    if (limit < 10000)
+        limit = 10000;
+    if (limit > 2000000000) // the chapter's functions take an int
+        limit = 2000000000;
+    Pool pool;
+    uint32_t *a = malloc(ARRAY_SIZE * sizeof(uint32_t));
+    unsigned char *found = malloc(10000), *expected = malloc(10000);
+    if (!a || !found || !expected || !pool_init(&pool, thread_count)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE; ++i)
+        a[i] = (uint32_t)xorshift64();
+
+    int errors = 0;
+    printf("--- 1. The chapter's loops on %d thread%s ---\n", pool.thread_count, pool.thread_count > 1 ? "s" : "");
+    MarkContext mark = {isprime, found};
+    parallel_for(&pool, 1000, 0, mark_body, &mark);
+    int prime_counter = 0;
+    for (int k = 0; k < 1000; ++k)
+        if (found[k]) {
+            if (prime_counter % 10 == 0 && prime_counter)
+                putchar('\n');
+            prime_counter++;
+            printf("%3d ", k);
+        }
+    printf("\n");
+    for (int k = 0; k < 1000; ++k)
+        expected[k] = (unsigned char)isprime(k);
+    int check_errors = memcmp(found, expected, 1000) != 0;
+    mark.test = is_perfect;
+    parallel_for(&pool, 10000, 0, mark_body, &mark);
+    for (int k = 2; k < 10000; ++k)
+        if (found[k])
+            printf("%d perfect\n", k);
+    for (int k = 2; k < 10000; ++k)
+        check_errors += found[k] != is_perfect(k);
+    printf("%s\n", check_errors ? "MISMATCH" : "same as the serial loops");
+    errors += check_errors;
+
+    printf("\n--- 2. Checks ---\n");
+    check_errors = 0;
+    static const int sizes[] = {1, 2, 3, 8};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        Pool small;
+        if (!pool_init(&small, sizes[s])) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        check_errors += check_visits(&small);
+        pool_free(&small);
+    }
+    check_errors += check_visits(&pool);
+    printf("%s\n", check_errors ? "MISMATCH" : "every iteration runs once, for every n, grain and pool size");
+    errors += check_errors;
+    check_errors = check_reduce(&pool, a, 1000000);
+    printf("%s\n", check_errors ? "MISMATCH" : "parallel_reduce of a count and of a struct match the serial loops");
+    errors += check_errors;
+    check_errors = check_back_to_back(&pool);
+    printf("%s\n", check_errors ? "MISMATCH" : "5000 tiny loops back to back, parked and not, are right");
+    errors += check_errors;
+
+    printf("\n--- 3. Speed, best of %d ---\n", REPEAT);
+    for (Task task = PRIMES; task < TASKS; ++task) {
+        if (task == PRIMES)
+            printf("%s below %zu:\n", task_names[task], limit);
+        else if (task == PERFECT)
+            printf("%s below %zu:\n", task_names[task], limit / 200);
+        else if (task == ARRAY_SUM)
+            printf("%s of %u integers:\n", task_names[task], ARRAY_SIZE);
+        else
+            printf("%s of %d blocks per thread:\n", task_names[task], POOL_BLOCKS_PER_THREAD);
+        uint64_t serial_result, result;
+        double serial = time_task(NULL, task, limit, a, &serial_result);
+        print_time(task, 0, serial, serial);
+        for (int threads = 1;; threads = threads * 2 < pool.thread_count ? threads * 2 : pool.thread_count) {
+            Pool sized;
+            Pool *p = &pool;
+            if (threads < pool.thread_count) {
+                if (!pool_init(&sized, threads)) {
+                    fprintf(stderr, "out of memory\n");
+                    return 1;
+                }
+                p = &sized;
+            }
+            print_time(task, threads, time_task(p, task, limit, a, &result), serial);
+            errors += result != serial_result;
+            if (p == &sized)
+                pool_free(&sized);
+            if (threads == pool.thread_count)
+                break;
+        }
+        if (task == PRIMES || task == PERFECT)
+            printf("  %llu found\n", (unsigned long long)serial_result);
+    }
+
+    pool_free(&pool);
+    free(a);
+    free(found);
+    free(expected);
+    printf("\nerrors: %d\n", errors);
+    return errors != 0;
+}
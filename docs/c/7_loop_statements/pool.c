@@ -0,0 +1,284 @@
+#define _GNU_SOURCE // sched_getaffinity, pthread_setaffinity_np
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+#include "pool.h"
+
+/*
+Work-stealing pool (implementation).
+Compile together with the program that uses it and link with -pthread, e.g.:
+    gcc -O2 -march=native -pthread 3_parallel_loops.c pool.c -o parallel_loops
+*/
+
+#define SPIN_ROUNDS 200  // checks of the epoch with PAUSE after a loop, before parking
+#define YIELD_ROUNDS 20  // then with sched_yield
+#define STEAL_FAILURES 64 // failed steals in a row after which a thread yields its core
+
+typedef struct {
+    _Alignas(64) atomic_int_fast64_t top; // thieves take from here
+    _Alignas(64) atomic_int_fast64_t bottom;
+    atomic_uint_fast64_t ranges[POOL_DEQUE_SIZE]; // first block << 32 | end block
+} Deque;
+
+struct PoolThread {
+    Deque deque;
+    Pool *pool;
+    int index, cpu; // cpu -1: not pinned
+    uint64_t rng;   // xorshift64 state for choosing victims
+    int started;
+    pthread_t thread;
+    _Alignas(64) unsigned char partial[POOL_VALUE_SIZE];
+};
+
+static inline void cpu_relax(void) {
+#ifdef __SSE2__
+    _mm_pause();
+#endif
+}
+
+// ---- Chase-Lev deque ----
+
+// Only the owner pushes and takes.
+static int deque_push(Deque *d, uint64_t range) {
+    int_fast64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int_fast64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    if (b - t >= POOL_DEQUE_SIZE)
+        return 0;
+    atomic_store_explicit(&d->ranges[b % POOL_DEQUE_SIZE], range, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release); // publishes the range and the loop
+    return 1;
+}
+
+// The bottom is lowered first; the fence orders that before reading the top, so that
+// a thief and the owner cannot both take the last range without one of them seeing it
+// in the compare-and-swap.
+static int deque_take(Deque *d, uint64_t *range) {
+    int_fast64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int_fast64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    if (t > b) { // empty
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return 0;
+    }
+    *range = atomic_load_explicit(&d->ranges[b % POOL_DEQUE_SIZE], memory_order_relaxed);
+    if (t < b)
+        return 1;
+    int won = atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                      memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return won;
+}
+
+static int deque_steal(Deque *d, uint64_t *range) {
+    int_fast64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int_fast64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b)
+        return 0;
+    *range = atomic_load_explicit(&d->ranges[t % POOL_DEQUE_SIZE], memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+// ---- Running a loop ----
+
+// Pushes the upper halves of blocks [first, end) for thieves and runs the one block left
+// (or more, if the deque is full).
+static void run_range(Pool *p, PoolThread *self, uint64_t first, uint64_t end) {
+    while (end - first > 1) {
+        uint64_t middle = first + (end - first) / 2;
+        if (!deque_push(&self->deque, middle << 32 | end))
+            break;
+        end = middle;
+    }
+    size_t begin = first * p->grain, stop = end * p->grain < p->n ? end * p->grain : p->n;
+    if (p->reduce_body)
+        p->reduce_body(begin, stop, self->partial, p->ctx);
+    else
+        p->body(begin, stop, p->ctx);
+    atomic_fetch_sub_explicit(&p->remaining, end - first, memory_order_release);
+}
+
+static int steal_any(Pool *p, PoolThread *self, uint64_t *range) {
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 7;
+    self->rng ^= self->rng << 17;
+    int first = (int)(self->rng % (uint64_t)p->thread_count);
+    for (int k = 0; k < p->thread_count; ++k) {
+        int victim = (first + k) % p->thread_count;
+        if (victim != self->index && deque_steal(&p->threads[victim].deque, range))
+            return 1;
+    }
+    return 0;
+}
+
+// Own ranges first, newest first; then stolen ones, until every block of the loop is
+// done.
+static void work(Pool *p, PoolThread *self) {
+    int failures = 0;
+    while (atomic_load_explicit(&p->remaining, memory_order_acquire) != 0) {
+        uint64_t range;
+        if (deque_take(&self->deque, &range) || steal_any(p, self, &range)) {
+            run_range(p, self, range >> 32, range & 0xFFFFFFFF);
+            failures = 0;
+        } else if (++failures < STEAL_FAILURES) {
+            cpu_relax();
+        } else {
+            sched_yield(); // the threads holding the work may need this core
+        }
+    }
+}
+
+// Parking: the thread counts itself in parked and then reads the epoch, the loop
+// increments the epoch and then reads parked, both sequentially consistent, so at least
+// one of them sees the other; the broadcast is sent under the lock.
+static uint_fast64_t wait_for_loop(Pool *p, uint_fast64_t seen) {
+    for (int k = 0; k < SPIN_ROUNDS + YIELD_ROUNDS; ++k) {
+        uint_fast64_t epoch = atomic_load_explicit(&p->epoch, memory_order_acquire);
+        if (epoch != seen)
+            return epoch;
+        if (k < SPIN_ROUNDS)
+            cpu_relax();
+        else
+            sched_yield();
+    }
+    pthread_mutex_lock(&p->lock);
+    atomic_fetch_add(&p->parked, 1);
+    uint_fast64_t epoch;
+    while ((epoch = atomic_load(&p->epoch)) == seen)
+        pthread_cond_wait(&p->wake, &p->lock);
+    atomic_fetch_sub(&p->parked, 1);
+    pthread_mutex_unlock(&p->lock);
+    return epoch;
+}
+
+static void *thread_main(void *arg) {
+    PoolThread *self = arg;
+    Pool *p = self->pool;
+#ifdef __linux__
+    if (self->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(self->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+    uint_fast64_t seen = 0;
+    for (;;) {
+        seen = wait_for_loop(p, seen);
+        if (atomic_load(&p->stopping))
+            return NULL;
+        work(p, self);
+    }
+}
+
+static void run_loop(Pool *p, size_t n, size_t grain) {
+    if (n == 0)
+        return;
+    size_t automatic = (size_t)p->thread_count * POOL_BLOCKS_PER_THREAD;
+    if (grain == 0)
+        grain = (n + automatic - 1) / automatic;
+    if (n / grain >= 0xFFFFFFFF) // block numbers have 32 bits
+        grain = n / 0xFFFFFFFF + 1;
+    p->n = n;
+    p->grain = grain;
+    uint64_t blocks = (n + grain - 1) / grain;
+    if (p->thread_count == 1 || blocks == 1) {
+        if (p->reduce_body)
+            p->reduce_body(0, n, p->threads[0].partial, p->ctx);
+        else
+            p->body(0, n, p->ctx);
+        return;
+    }
+    atomic_store_explicit(&p->remaining, blocks, memory_order_relaxed);
+    atomic_fetch_add(&p->epoch, 1);
+    if (atomic_load(&p->parked)) {
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_broadcast(&p->wake);
+        pthread_mutex_unlock(&p->lock);
+    }
+    run_range(p, &p->threads[0], 0, blocks);
+    work(p, &p->threads[0]);
+}
+
+// ---- Interface ----
+
+int pool_init(Pool *p, int thread_count) {
+    int cpus[CPU_SETSIZE], cpu_count = 0;
+#ifdef __linux__
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &set))
+                cpus[cpu_count++] = c;
+#endif
+    if (thread_count <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpu_count ? cpu_count : online > 0 ? (int)online : 1;
+    }
+    p->threads = aligned_alloc(64, (size_t)thread_count * sizeof(PoolThread));
+    if (!p->threads)
+        return 0;
+    memset(p->threads, 0, (size_t)thread_count * sizeof(PoolThread));
+    p->thread_count = thread_count;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    atomic_init(&p->epoch, 0);
+    atomic_init(&p->parked, 0);
+    atomic_init(&p->stopping, 0);
+    atomic_init(&p->remaining, 0);
+    for (int t = 0; t < thread_count; ++t) {
+        PoolThread *th = &p->threads[t];
+        th->pool = p;
+        th->index = t;
+        th->cpu = cpu_count ? cpus[t % cpu_count] : -1;
+        th->rng = 88172645463325252ULL + (uint64_t)t * 0x9E3779B97F4A7C15ULL;
+        atomic_init(&th->deque.top, 0);
+        atomic_init(&th->deque.bottom, 0);
+        if (t > 0)
+            th->started = pthread_create(&th->thread, NULL, thread_main, th) == 0;
+    }
+    return 1;
+}
+
+void pool_free(Pool *p) {
+    atomic_store(&p->stopping, 1);
+    atomic_fetch_add(&p->epoch, 1);
+    pthread_mutex_lock(&p->lock);
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+    for (int t = 1; t < p->thread_count; ++t)
+        if (p->threads[t].started)
+            pthread_join(p->threads[t].thread, NULL);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->wake);
+    free(p->threads);
+    p->threads = NULL;
+}
+
+void parallel_for(Pool *p, size_t n, size_t grain, PoolBody body, void *ctx) {
+    p->body = body;
+    p->reduce_body = NULL;
+    p->ctx = ctx;
+    run_loop(p, n, grain);
+}
+
+int parallel_reduce(Pool *p, size_t n, size_t grain, void *value, size_t value_size, PoolReduceBody body,
+                    PoolCombine combine, void *ctx) {
+    if (value_size > POOL_VALUE_SIZE)
+        return 0;
+    for (int t = 0; t < p->thread_count; ++t)
+        memcpy(p->threads[t].partial, value, value_size);
+    p->body = NULL;
+    p->reduce_body = body;
+    p->ctx = ctx;
+    run_loop(p, n, grain);
+    memcpy(value, p->threads[0].partial, value_size);
+    for (int t = 1; t < p->thread_count; ++t)
+        combine(value, p->threads[t].partial, ctx);
+    return 1;
+}
@@ -0,0 +1,74 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+Work-stealing pool (interface). The prime and perfect number loops of the loop
+statements chapter, and the sums of the arrays chapter, test one value after another on
+one core. parallel_for and parallel_reduce run the iterations of such a loop on all
+cores, for loops whose iterations do not depend on each other.
+
+  - The iterations 0..n-1 are cut into blocks of grain iterations (0: automatic, about
+    POOL_BLOCKS_PER_THREAD blocks per thread). A thread that holds a range of blocks
+    pushes its upper half onto its own deque and goes on with the lower half, until
+    one block is left and runs it. Idle threads steal the oldest, largest range from
+    the deque of another thread, so uneven work (testing k for a perfect number takes
+    k / 2 divisions) evens out without tuning.
+  - The deques are those of Chase and Lev, in the C11 version of Le, Pop, Cohen and
+    Zappa Nardelli: the owner pushes and takes at the bottom without a lock or an
+    atomic read-modify-write, except when one range is left; thieves take from the top
+    with a compare-and-swap. Binary splitting keeps at most log2(blocks) ranges in a
+    deque, so it has a fixed size.
+  - The calling thread takes part as thread 0; the other threads are started once by
+    pool_init and pinned to one CPU each (on Linux). Between loops they spin briefly,
+    then park on a condition variable until the next loop.
+  - parallel_reduce gives every thread its own partial value, starting as a copy of
+    the identity, and combines them in thread order at the end. The combination must
+    be associative and commutative; for floating-point sums the result can change
+    from run to run unless the partial values are exact (3_data_types/summation.h).
+The loop functions must be called from one thread at a time, and not from inside a
+body.
+*/
+
+#define POOL_DEQUE_SIZE 64       // ranges; 2^32 blocks need 32
+#define POOL_VALUE_SIZE 64       // bytes of a parallel_reduce value at most
+#define POOL_BLOCKS_PER_THREAD 16
+
+typedef void (*PoolBody)(size_t begin, size_t end, void *ctx);
+// Adds the iterations [begin, end) to *partial.
+typedef void (*PoolReduceBody)(size_t begin, size_t end, void *partial, void *ctx);
+typedef void (*PoolCombine)(void *into, const void *from, void *ctx);
+
+typedef struct PoolThread PoolThread;
+
+typedef struct {
+    int thread_count; // with the calling thread
+    PoolThread *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_uint_fast64_t epoch; // one more for every loop, and to stop
+    atomic_int parked, stopping;
+    // the current loop, set before its first range is pushed
+    size_t n, grain;
+    PoolBody body;
+    PoolReduceBody reduce_body;
+    void *ctx;
+    atomic_uint_fast64_t remaining; // blocks not done yet
+} Pool;
+
+// thread_count <= 0: one per CPU the process may run on. Returns 0 if out of memory;
+// threads that cannot be created leave their work to the others.
+int pool_init(Pool *p, int thread_count);
+void pool_free(Pool *p);
+
+void parallel_for(Pool *p, size_t n, size_t grain, PoolBody body, void *ctx);
+// *value is the identity on entry and the result on return; returns 0 if value_size
+// is above POOL_VALUE_SIZE.
+int parallel_reduce(Pool *p, size_t n, size_t grain, void *value, size_t value_size, PoolReduceBody body,
+                    PoolCombine combine, void *ctx);
+
+#endif
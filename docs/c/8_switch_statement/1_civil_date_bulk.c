@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+Bulk versions of isleap, day_of_year and display_date from the switch statement chapter.
+  - isleap without branches
+  - day_of_year from a cumulative-days table instead of the fall-through switch
+  - days_from_civil / civil_from_days: date <-> int32 day number (0 = 1 Jan 1970),
+    using only integer arithmetic and no data-dependent branches
+  - batch parsing of "dd/mm/yyyy" records and batch formatting in the display_date
+    format ("21st Jan 2024") into a caller-provided buffer, without printf
+*/
+
+#define DATE_COUNT 10000000
+#define DATE_TEXT_LEN 10 // "dd/mm/yyyy"
+#define MAX_FORMATTED_LEN 22 // "31st Dec -2147483648\n" and the '\0' of sprintf; "31st Dec 2024\n" is 14
+
+typedef struct {
+    int32_t year;
+    uint8_t month; // 1..12
+    uint8_t day;   // 1..31
+} CivilDate;
+
+// ---- Chapter versions (reference) ----
+
+int isleap_switch(int y) {
+    return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+int day_of_year_switch(int day, int month, int year) {
+    int sum = day;
+    switch (month - 1) {
+        case 11: sum += 30; // fall through
+        case 10: sum += 31; // fall through
+        case 9 : sum += 30; // fall through
+        case 8 : sum += 31; // fall through
+        case 7 : sum += 31; // fall through
+        case 6 : sum += 30; // fall through
+        case 5 : sum += 31; // fall through
+        case 4 : sum += 30; // fall through
+        case 3 : sum += 31; // fall through
+        case 2 : sum += 28 + isleap_switch(year); // fall through
+        case 1 : sum += 31;
+    }
+    return sum;
+}
+
+int display_date_snprintf(char *buf, size_t size, int day, int month, int year) {
+    static const char *const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                         "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    const char *suffix;
+    switch (day) {
+        case 1 :
+        case 21 :
+        case 31 : suffix = "st"; break;
+        case 2 :
+        case 22 : suffix = "nd"; break;
+        case 3 :
+        case 23 : suffix = "rd"; break;
+        default : suffix = "th";
+    }
+    return snprintf(buf, size, "%d%s %s %d\n", day, suffix, months[month - 1], year);
+}
+
+// ---- Scalar kernels ----
+
+// 100 = 4 * 25 and 400 = 16 * 25, so the checks reduce to masks and one modulo.
+static inline int isleap(int32_t y) {
+    return ((y & 3) == 0) & ((y % 25 != 0) | ((y & 15) == 0));
+}
+
+// cumulative_days[leap][m - 1] = days in the months before month m
+static const uint16_t cumulative_days[2][12] = {
+    {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334},
+    {0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335}
+};
+
+static inline int day_of_year(int day, int month, int32_t year) {
+    return cumulative_days[isleap(year)][month - 1] + day;
+}
+
+/*
+The year is shifted to start in March, so the leap day is the last day of the "year" and
+the month lengths 31 30 31 30 31 | 31 30 31 30 31 | 31 28/29 repeat with period 5;
+(153 * mp + 2) / 5 gives the first day of shifted month mp. A 400-year era has 146097 days.
+Years are offset by 400 * ERA_OFFSET before dividing, which keeps the operands positive for
+every int32 day number, so the divisions need no sign correction.
+*/
+#define ERA_OFFSET 15000 // 400 * 15000 years covers the whole int32 day range (~5.9M years)
+#define EPOCH_SHIFT 719468 // days from 0000-03-01 to 1970-01-01
+
+static inline int32_t days_from_civil(int32_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    uint32_t yy = (uint32_t)(y + 400 * ERA_OFFSET);
+    uint32_t era = yy / 400;
+    uint32_t yoe = yy - era * 400;                      // [0, 399]
+    uint32_t mp = (m + 9) % 12;                          // March = 0
+    uint32_t doy = (153 * mp + 2) / 5 + d - 1;          // [0, 365]
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy; // [0, 146096]
+    return (int32_t)((int64_t)era * 146097 + doe - (int64_t)ERA_OFFSET * 146097 - EPOCH_SHIFT);
+}
+
+static inline CivilDate civil_from_days(int32_t z) {
+    uint64_t zz = (uint64_t)((int64_t)z + EPOCH_SHIFT + (int64_t)ERA_OFFSET * 146097);
+    uint32_t era = (uint32_t)(zz / 146097);
+    uint32_t doe = (uint32_t)(zz - (uint64_t)era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t d = doy - (153 * mp + 2) / 5 + 1;
+    uint32_t m = mp < 10 ? mp + 3 : mp - 9; // compiles to a conditional move
+    CivilDate date;
+    date.year = (int32_t)((int64_t)yoe + (int64_t)era * 400 - 400LL * ERA_OFFSET + (m <= 2));
+    date.month = (uint8_t)m;
+    date.day = (uint8_t)d;
+    return date;
+}
+
+// ---- Batch API ----
+
+void days_from_civil_array(const CivilDate *src, int32_t *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = days_from_civil(src[i].year, src[i].month, src[i].day);
+}
+
+void civil_from_days_array(const int32_t *src, CivilDate *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = civil_from_days(src[i]);
+}
+
+static const uint8_t days_in_month[2][12] = {
+    {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31},
+    {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}
+};
+
+/*
+Parses n fixed-width "dd/mm/yyyy" records separated by one byte (e.g. '\n').
+Every digit is checked with one unsigned compare and the results are AND-ed together,
+so a valid record costs no unpredictable branch. Returns the number of records that
+failed validation; their day numbers are set to INT32_MIN.
+*/
+size_t parse_dates(const char *text, size_t n, int32_t *days) {
+    size_t bad = 0;
+    for (size_t i = 0; i < n; ++i, text += DATE_TEXT_LEN + 1) {
+        const unsigned char *p = (const unsigned char *)text;
+        unsigned d0 = p[0] - '0', d1 = p[1] - '0', m0 = p[3] - '0', m1 = p[4] - '0';
+        unsigned y0 = p[6] - '0', y1 = p[7] - '0', y2 = p[8] - '0', y3 = p[9] - '0';
+        unsigned day = d0 * 10 + d1;
+        unsigned month = m0 * 10 + m1;
+        int32_t year = (int32_t)(y0 * 1000 + y1 * 100 + y2 * 10 + y3);
+
+        unsigned digits_ok = (d0 < 10) & (d1 < 10) & (m0 < 10) & (m1 < 10) &
+                             (y0 < 10) & (y1 < 10) & (y2 < 10) & (y3 < 10);
+        unsigned sep_ok = (p[2] == '/') & (p[5] == '/');
+        unsigned month_ok = month - 1 < 12;
+        unsigned day_ok = month_ok && day - 1 < days_in_month[isleap(year)][month - 1];
+        if (digits_ok & sep_ok & day_ok) {
+            days[i] = days_from_civil(year, month, day);
+        } else {
+            days[i] = INT32_MIN;
+            bad++;
+        }
+    }
+    return bad;
+}
+
+static char two_digits[200]; // "00" "01" ... "99"
+static char day_prefix[32][8]; // "1st " "2nd " ... "31st"; [0] unused
+static uint8_t day_prefix_len[32];
+static const char month_abbr[12][4] = {
+    {'J', 'a', 'n', ' '}, {'F', 'e', 'b', ' '}, {'M', 'a', 'r', ' '}, {'A', 'p', 'r', ' '},
+    {'M', 'a', 'y', ' '}, {'J', 'u', 'n', ' '}, {'J', 'u', 'l', ' '}, {'A', 'u', 'g', ' '},
+    {'S', 'e', 'p', ' '}, {'O', 'c', 't', ' '}, {'N', 'o', 'v', ' '}, {'D', 'e', 'c', ' '}
+};
+
+void init_format_tables(void) {
+    for (int i = 0; i < 100; ++i) {
+        two_digits[2 * i] = (char)('0' + i / 10);
+        two_digits[2 * i + 1] = (char)('0' + i % 10);
+    }
+    for (int day = 1; day <= 31; ++day) {
+        const char *suffix = "th";
+        if (day == 1 || day == 21 || day == 31)
+            suffix = "st";
+        else if (day == 2 || day == 22)
+            suffix = "nd";
+        else if (day == 3 || day == 23)
+            suffix = "rd";
+        day_prefix_len[day] = (uint8_t)sprintf(day_prefix[day], "%d%s ", day, suffix);
+    }
+}
+
+/*
+Formats n day numbers as "21st Jan 2024\n" lines into out, which must hold at least
+n * MAX_FORMATTED_LEN bytes. Returns the number of bytes written (no terminating '\0').
+*/
+size_t format_dates(const int32_t *days, size_t n, char *out) {
+    char *p = out;
+    for (size_t i = 0; i < n; ++i) {
+        CivilDate date = civil_from_days(days[i]);
+        memcpy(p, day_prefix[date.day], 5); // fixed-size copy, only the real length is kept
+        p += day_prefix_len[date.day];
+        memcpy(p, month_abbr[date.month - 1], 4);
+        p += 4;
+        if (date.year >= 1000 && date.year <= 9999) {
+            memcpy(p, &two_digits[2 * (date.year / 100)], 2);
+            memcpy(p + 2, &two_digits[2 * (date.year % 100)], 2);
+            p += 4;
+        } else {
+            p += sprintf(p, "%d", (int)date.year); // rare: outside the 4-digit years
+        }
+        *p++ = '\n';
+    }
+    return (size_t)(p - out);
+}
+
+// ---- Tests and benchmark ----
+
+int check_kernels(void) {
+    int errors = 0;
+    for (int32_t y = -4800; y <= 4800; ++y) {
+        if (isleap(y) != isleap_switch(y))
+            errors++;
+        for (int m = 1; m <= 12; ++m)
+            if (day_of_year(15, m, y) != day_of_year_switch(15, m, y))
+                errors++;
+    }
+    // Every day of 1600..2400 in order must round-trip and be consecutive.
+    int32_t expected = days_from_civil(1600, 1, 1);
+    for (int32_t y = 1600; y <= 2400; ++y)
+        for (unsigned m = 1; m <= 12; ++m)
+            for (unsigned d = 1; d <= days_in_month[isleap(y)][m - 1]; ++d, ++expected) {
+                int32_t z = days_from_civil(y, m, d);
+                CivilDate c = civil_from_days(z);
+                if (z != expected || c.year != y || c.month != m || c.day != d)
+                    errors++;
+            }
+    if (days_from_civil(1970, 1, 1) != 0 || days_from_civil(2000, 3, 1) != 11017)
+        errors++;
+    // Extremes of the int32 day range must round-trip.
+    int32_t extremes[] = {INT32_MIN + 1, -1000000000, 1000000000, INT32_MAX};
+    for (size_t i = 0; i < sizeof(extremes) / sizeof(extremes[0]); ++i) {
+        CivilDate c = civil_from_days(extremes[i]);
+        if (days_from_civil(c.year, c.month, c.day) != extremes[i])
+            errors++;
+    }
+    // Their 8-digit years are the longest lines; the buffer holds exactly n of them.
+    size_t count = sizeof(extremes) / sizeof(extremes[0]);
+    char *out = malloc(count * MAX_FORMATTED_LEN), lines[4 * MAX_FORMATTED_LEN], *e = lines;
+    if (!out)
+        return errors + 1;
+    for (size_t i = 0; i < count; ++i) {
+        CivilDate c = civil_from_days(extremes[i]);
+        e += display_date_snprintf(e, MAX_FORMATTED_LEN, c.day, c.month, c.year);
+    }
+    size_t len = format_dates(extremes, count, out);
+    if (len != (size_t)(e - lines) || memcmp(out, lines, len) != 0)
+        errors++;
+    free(out);
+    return errors;
+}
+
+double seconds_between(struct timespec a, struct timespec b) {
+    return (double)(b.tv_sec - a.tv_sec) + (double)(b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+void report(const char *name, size_t n, struct timespec a, struct timespec b) {
+    double t = seconds_between(a, b);
+    printf("%-28s %.4f s, %7.1f M dates/s\n", name, t, n / t / 1e6);
+}
+
+int main(void) {
+    init_format_tables();
+
+    printf("--- 1. Correctness ---\n");
+    int errors = check_kernels();
+    printf("mismatches: %d\n", errors);
+
+    char line[64];
+    format_dates((int32_t[]){days_from_civil(2024, 1, 21)}, 1, line);
+    display_date_snprintf(line + 32, 32, 21, 1, 2024);
+    printf("format_dates: %.*s", 14, line);
+    printf("snprintf    : %s", line + 32);
+    printf("day_of_year(1, 3, 2024) = %d\n", day_of_year(1, 3, 2024));
+
+    printf("\n--- 2. Throughput (%d dates) ---\n", DATE_COUNT);
+    int32_t *days = malloc(DATE_COUNT * sizeof(*days));
+    int32_t *parsed = malloc(DATE_COUNT * sizeof(*parsed));
+    CivilDate *dates = malloc(DATE_COUNT * sizeof(*dates));
+    char *text = malloc((size_t)DATE_COUNT * (DATE_TEXT_LEN + 1) + 1); // + sprintf's final '\0'
+    char *formatted = malloc((size_t)DATE_COUNT * MAX_FORMATTED_LEN);
+    if (!days || !parsed || !dates || !text || !formatted) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    // Random dates between 1900 and 2100, written as "dd/mm/yyyy\n" records.
+    srand(12345);
+    int32_t first = days_from_civil(1900, 1, 1), span = days_from_civil(2100, 1, 1) - first;
+    for (size_t i = 0; i < DATE_COUNT; ++i) {
+        days[i] = first + (int32_t)(((uint32_t)rand() << 15 ^ (uint32_t)rand()) % (uint32_t)span);
+        CivilDate c = civil_from_days(days[i]);
+        sprintf(text + i * (DATE_TEXT_LEN + 1), "%02d/%02d/%04d\n", c.day, c.month, (int)c.year);
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    civil_from_days_array(days, dates, DATE_COUNT);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("civil_from_days_array", DATE_COUNT, t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    days_from_civil_array(dates, parsed, DATE_COUNT);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("days_from_civil_array", DATE_COUNT, t0, t1);
+    if (memcmp(parsed, days, DATE_COUNT * sizeof(*days)) != 0)
+        errors++;
+
+    volatile long sink = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t i = 0; i < DATE_COUNT; ++i)
+        sink += day_of_year_switch(dates[i].day, dates[i].month, dates[i].year);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("day_of_year (switch)", DATE_COUNT, t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t i = 0; i < DATE_COUNT; ++i)
+        sink += day_of_year(dates[i].day, dates[i].month, dates[i].year);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("day_of_year (table)", DATE_COUNT, t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t bad = parse_dates(text, DATE_COUNT, parsed);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("parse_dates", DATE_COUNT, t0, t1);
+    if (bad != 0 || memcmp(parsed, days, DATE_COUNT * sizeof(*days)) != 0)
+        errors++;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t bytes = format_dates(days, DATE_COUNT, formatted);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("format_dates", DATE_COUNT, t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    size_t ref_bytes = 0;
+    for (size_t i = 0; i < DATE_COUNT; ++i) {
+        int len = display_date_snprintf(line, sizeof(line), dates[i].day, dates[i].month, dates[i].year);
+        if (memcmp(line, formatted + ref_bytes, len) != 0)
+            errors++;
+        ref_bytes += len;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("snprintf (display_date)", DATE_COUNT, t0, t1);
+    if (ref_bytes != bytes)
+        errors++;
+
+    printf("\ntotal mismatches: %d\n", errors);
+    free(days);
+    free(parsed);
+    free(dates);
+    free(text);
+    free(formatted);
+    return errors != 0;
+}
@@ -0,0 +1,235 @@
+// gcc -O2 -march=native 1_prng_demo.c prng.c -o prng_demo
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "prng.h"
+
+/*
+Compares the chapter's rand/srand, mrand and drand with the prng module:
+correctness checks for streams and jump-ahead, modulo bias, and throughput.
+*/
+
+#define COUNT 20000000
+#define N 10 // range of the chapter's mrand
+
+// ---- Chapter versions ----
+
+#define LCG_RAND_MAX 32767
+unsigned long int next = 1;
+
+int lcg_rand(void) {
+    next = next * 1103515245 + 12345;
+    return (unsigned int)(next / 65536) % 32768;
+}
+
+void lcg_srand(unsigned int seed) {
+    next = seed;
+}
+
+int mrand(void) {
+    unsigned int x = (LCG_RAND_MAX + 1u) / N;
+    unsigned int y = x * N;
+    unsigned int r;
+    while ((r = lcg_rand()) >= y)
+        ;
+    return r / x;
+}
+
+#define PRECISION 2.82e14
+
+double drand(void) {
+    double sum = 0;
+    double denom = LCG_RAND_MAX + 1;
+    double need;
+    for (need = PRECISION; need > 1; need /= (LCG_RAND_MAX + 1.)) {
+        sum += lcg_rand() / denom;
+        denom *= LCG_RAND_MAX + 1.;
+    }
+    return sum;
+}
+
+// ---- Checks ----
+
+int check_generators(void) {
+    int errors = 0;
+
+    // Reference value: with state {1, 2, 3, 4} the first output is rotl(2 * 5, 7) * 9 = 11520.
+    Xoshiro256 x = {{1, 2, 3, 4}};
+    if (xoshiro256_next(&x) != 11520)
+        errors++;
+
+    // advance(k) must land where k single steps land.
+    Pcg64 a, b;
+    pcg64_seed(&a, 42, 7);
+    b = a;
+    for (int i = 0; i < 12345; ++i)
+        pcg64_next(&a);
+    pcg64_advance(&b, 12345);
+    if (pcg64_next(&a) != pcg64_next(&b))
+        errors++;
+
+    // Lane i of the bulk generator must reproduce the scalar generator jumped i times.
+    Xoshiro256 base, lane;
+    xoshiro256_seed(&base, 2024);
+    Xoshiro256xN bulk;
+    xoshiro256xN_init(&bulk, &base);
+    static uint64_t out[PRNG_LANES * 100];
+    xoshiro256xN_fill_u64(&bulk, out, PRNG_LANES * 100);
+    lane = base;
+    for (int i = 0; i < PRNG_LANES; ++i) {
+        Xoshiro256 g = lane;
+        for (int k = 0; k < 100; ++k)
+            if (xoshiro256_next(&g) != out[k * PRNG_LANES + i])
+                errors++;
+        xoshiro256_jump(&lane);
+    }
+
+    // Every bounded value must be in range.
+    static uint32_t dice[100000];
+    xoshiro256xN_fill_bounded(&bulk, dice, 100000, 6);
+    for (int i = 0; i < 100000; ++i)
+        if (dice[i] >= 6)
+            errors++;
+    for (int i = 0; i < 100000; ++i) {
+        int64_t r = xoshiro256_range(&base, -3, 3);
+        double d = xoshiro256_double(&base);
+        if (r < -3 || r > 3 || d < 0.0 || d >= 1.0)
+            errors++;
+    }
+    // The widest ranges: the full one takes every output, a half one stays inside.
+    int negative = 0;
+    for (int i = 0; i < 1000; ++i) {
+        negative += xoshiro256_range(&base, INT64_MIN, INT64_MAX) < 0;
+        if (xoshiro256_range(&base, INT64_MIN + 1, 0) > 0 || xoshiro256_range(&base, -1, INT64_MAX) < -1)
+            errors++;
+    }
+    if (negative < 400 || negative > 600)
+        errors++;
+    return errors;
+}
+
+// With range 20000 and 15-bit rand(), values 0..12767 have two sources and the rest one.
+void show_modulo_bias(void) {
+    const int range = 20000;
+    long low_rand = 0, low_lemire = 0;
+    Xoshiro256 g;
+    xoshiro256_seed(&g, 1);
+    lcg_srand(1);
+    for (int i = 0; i < COUNT; ++i) {
+        low_rand += lcg_rand() % range < range / 2;
+        low_lemire += xoshiro256_bounded(&g, range) < (uint64_t)range / 2;
+    }
+    printf("P(value < %d) for range %d, expected 0.5000\n", range / 2, range);
+    printf("  rand() %% range     : %.4f\n", (double)low_rand / COUNT);
+    printf("  xoshiro256_bounded : %.4f\n", (double)low_lemire / COUNT);
+}
+
+// ---- Benchmark ----
+
+double seconds_between(struct timespec a, struct timespec b) {
+    return (double)(b.tv_sec - a.tv_sec) + (double)(b.tv_nsec - a.tv_nsec) / 1e9;
+}
+
+void report(const char *name, struct timespec a, struct timespec b) {
+    double t = seconds_between(a, b);
+    printf("  %-34s %7.1f M numbers/s\n", name, COUNT / t / 1e6);
+}
+
+int main(void) {
+    printf("--- 1. Correctness ---\n");
+    int errors = check_generators();
+    printf("mismatches: %d\n", errors);
+
+    // Independent per-thread streams: stream i is i * 2^192 numbers ahead of stream 0.
+    Xoshiro256 streams[3];
+    for (unsigned i = 0; i < 3; ++i) {
+        xoshiro256_stream(&streams[i], 12345, i);
+        printf("stream %u starts with %016llx\n", i, (unsigned long long)xoshiro256_next(&streams[i]));
+    }
+
+    printf("\n--- 2. Modulo bias ---\n");
+    show_modulo_bias();
+
+    printf("\n--- 3. Throughput (%d numbers each) ---\n", COUNT);
+    uint64_t *u = malloc(COUNT * sizeof(*u));
+    double *d = malloc(COUNT * sizeof(*d));
+    uint32_t *b = malloc(COUNT * sizeof(*b));
+    if (!u || !d || !b) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    // touch the pages first so the first timed loop does not pay for page faults
+    memset(u, 0, COUNT * sizeof(*u));
+    memset(d, 0, COUNT * sizeof(*d));
+    memset(b, 0, COUNT * sizeof(*b));
+    struct timespec t0, t1;
+    Xoshiro256 x;
+    Pcg64 p;
+    Xoshiro256xN bulk;
+    xoshiro256_seed(&x, 7);
+    pcg64_seed(&p, 7, 0);
+    xoshiro256xN_init(&bulk, &x);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < COUNT; ++i)
+        b[i] = (uint32_t)lcg_rand();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("chapter rand() (15 bits)", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < COUNT; ++i)
+        u[i] = xoshiro256_next(&x);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("xoshiro256_next (64 bits)", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < COUNT; ++i)
+        u[i] = pcg64_next(&p);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("pcg64_next (64 bits)", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    xoshiro256xN_fill_u64(&bulk, u, COUNT);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("xoshiro256xN_fill_u64", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < COUNT; ++i)
+        b[i] = (uint32_t)mrand();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("chapter mrand() [0, 10)", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < COUNT; ++i)
+        b[i] = (uint32_t)xoshiro256_bounded(&x, N);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("xoshiro256_bounded [0, 10)", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    xoshiro256xN_fill_bounded(&bulk, b, COUNT, N);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("xoshiro256xN_fill_bounded [0, 10)", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < COUNT; ++i)
+        d[i] = drand();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("chapter drand()", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < COUNT; ++i)
+        d[i] = xoshiro256_double(&x);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("xoshiro256_double", t0, t1);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    xoshiro256xN_fill_double(&bulk, d, COUNT);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    report("xoshiro256xN_fill_double", t0, t1);
+
+    free(u);
+    free(d);
+    free(b);
+    return errors != 0;
+}
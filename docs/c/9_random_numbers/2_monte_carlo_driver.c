@@ -0,0 +1,249 @@
+// gcc -O2 -march=native -pthread 2_monte_carlo_driver.c prng.c -o monte_carlo -lm
+// ./monte_carlo [thread_count] [target_half_width]
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "prng.h"
+
+/*
+Parallel Monte Carlo driver for the pi estimate and the craps game of the chapter.
+
+Every worker thread owns its own generator stream (stream i is i * 2^192 numbers ahead of
+stream 0), so no random state is shared. Work is done in rounds: each worker runs a batch
+of trials and writes the batch sum and sum of squares into its own cache-line sized slot;
+then one thread adds the slots up, prints the running estimate with a 95% confidence
+interval and decides whether to stop. Nothing shared is written inside a batch.
+
+Worker 0 runs on the main thread. The others wait on the start lock until all of them are
+created, so if a thread cannot be created the barriers are sized for those that were.
+*/
+
+#define NTIMES 10000000 // the chapter's trial counts
+#define NKEZ 1000000
+// Upper limits of the runs. The default target of +-0.0005 needs about 41 M trials for
+// pi and 3.8 M games of craps, more than the chapter's counts.
+#define PI_MAX_TRIALS (NTIMES * 10L)
+#define CRAPS_MAX_TRIALS (NKEZ * 100L)
+#define BATCH_SIZE 250000 // trials per worker per round
+#define BLOCK 1024 // random numbers generated at once by the vectorized kernels
+#define MAX_THREADS 256
+#define Z_95 1.959963984540054
+
+typedef struct {
+    double sum;    // sum of the sample values
+    double sum_sq; // sum of their squares
+} BatchResult;
+
+// Aligned to a cache line, so the size is a multiple of 64 too: two workers never
+// write to the same line.
+typedef struct {
+    _Alignas(64) Xoshiro256 rng; // scalar stream (craps)
+    Xoshiro256xN lanes;          // lane streams (pi)
+    BatchResult batch;
+} WorkerState;
+
+typedef void (*TrialKernel)(WorkerState *w, long trials);
+
+// ---- Kernels ----
+
+// A sample is 4 if the point is inside the quarter circle, 0 otherwise; its mean is pi.
+// The inner loop has no branch and is vectorized; the counts are added as integers.
+void pi_kernel(WorkerState *w, long trials) {
+    double x[BLOCK], y[BLOCK];
+    long inside = 0;
+    for (long done = 0; done < trials; done += BLOCK) {
+        long n = trials - done < BLOCK ? trials - done : BLOCK;
+        xoshiro256xN_fill_double(&w->lanes, x, n);
+        xoshiro256xN_fill_double(&w->lanes, y, n);
+        long block_inside = 0;
+        for (long i = 0; i < n; ++i)
+            block_inside += x[i] * x[i] + y[i] * y[i] <= 1.0;
+        inside += block_inside;
+    }
+    w->batch.sum = 4.0 * inside;
+    w->batch.sum_sq = 16.0 * inside;
+}
+
+static inline int zar_at(Xoshiro256 *g) { // die_roll
+    return (int)xoshiro256_range(g, 1, 6) + (int)xoshiro256_range(g, 1, 6);
+}
+
+// returns 1 if player wins, 0 if player loses
+static inline int oyun(Xoshiro256 *g) { // game
+    int zar_toplam = zar_at(g);
+    switch (zar_toplam) {
+        case 7 :
+        case 11: return 1;
+        case 2 :
+        case 3 :
+        case 12: return 0;
+    }
+    for (;;) { // oyun_devami (continue_game)
+        int yeni_zar = zar_at(g);
+        if (yeni_zar == zar_toplam)
+            return 1;
+        if (yeni_zar == 7)
+            return 0;
+    }
+}
+
+void craps_kernel(WorkerState *w, long trials) {
+    Xoshiro256 g = w->rng; // local copy stays in registers
+    long wins = 0;
+    for (long i = 0; i < trials; ++i)
+        wins += oyun(&g);
+    w->rng = g;
+    w->batch.sum = (double)wins;
+    w->batch.sum_sq = (double)wins;
+}
+
+// ---- Driver ----
+
+typedef struct {
+    const char *name;
+    TrialKernel kernel;
+    double exact;           // known answer, only used for the report
+    long max_trials;
+    double target;          // stop when the 95% half-width is below this
+    int thread_count;
+    WorkerState *workers;
+    pthread_mutex_t start; // held while the threads are created
+    pthread_barrier_t batch_done, decision_done;
+    int stop;
+    long trials;
+    double sum, sum_sq;
+} Simulation;
+
+typedef struct {
+    Simulation *sim;
+    int index;
+} WorkerArg;
+
+double half_width(const Simulation *sim) {
+    double n = (double)sim->trials;
+    double mean = sim->sum / n;
+    double variance = (sim->sum_sq - n * mean * mean) / (n - 1);
+    return Z_95 * sqrt(variance / n);
+}
+
+void *simulation_worker(void *arg) {
+    WorkerArg *a = arg;
+    Simulation *sim = a->sim;
+    WorkerState *w = &sim->workers[a->index];
+    pthread_mutex_lock(&sim->start);
+    pthread_mutex_unlock(&sim->start);
+    for (;;) {
+        sim->kernel(w, BATCH_SIZE);
+        pthread_barrier_wait(&sim->batch_done);
+        if (a->index == 0) {
+            for (int i = 0; i < sim->thread_count; ++i) {
+                sim->sum += sim->workers[i].batch.sum;
+                sim->sum_sq += sim->workers[i].batch.sum_sq;
+            }
+            sim->trials += (long)BATCH_SIZE * sim->thread_count;
+            double mean = sim->sum / sim->trials, hw = half_width(sim);
+            printf("  %10ld trials: %.6f +- %.6f (error %+.6f)\n", sim->trials, mean, hw, mean - sim->exact);
+            sim->stop = hw < sim->target || sim->trials + (long)BATCH_SIZE * sim->thread_count > sim->max_trials;
+        }
+        pthread_barrier_wait(&sim->decision_done);
+        if (sim->stop)
+            return NULL;
+    }
+}
+
+double run_simulation(Simulation *sim, uint64_t seed) {
+    sim->workers = aligned_alloc(64, sizeof(WorkerState) * sim->thread_count);
+    pthread_t *threads = malloc(sizeof(*threads) * sim->thread_count);
+    WorkerArg *args = malloc(sizeof(*args) * sim->thread_count);
+    if (!sim->workers || !threads || !args) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (int i = 0; i < sim->thread_count; ++i) {
+        xoshiro256_stream(&sim->workers[i].rng, seed, (unsigned)i);
+        xoshiro256xN_init(&sim->workers[i].lanes, &sim->workers[i].rng);
+        // lanes use jumps 0..PRNG_LANES-1 of the stream; the scalar generator takes the next one
+        for (int k = 0; k < PRNG_LANES; ++k)
+            xoshiro256_jump(&sim->workers[i].rng);
+    }
+    sim->stop = 0;
+    sim->trials = 0;
+    sim->sum = sim->sum_sq = 0.0;
+    pthread_mutex_init(&sim->start, NULL);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    pthread_mutex_lock(&sim->start);
+    int started = 1;
+    for (int i = 0; i < sim->thread_count; ++i) {
+        args[i] = (WorkerArg){sim, i};
+        if (i > 0 && pthread_create(&threads[i], NULL, simulation_worker, &args[i]) != 0)
+            break;
+        started = i + 1;
+    }
+    if (started < sim->thread_count) {
+        fprintf(stderr, "  only %d of %d threads could be created\n", started, sim->thread_count);
+        sim->thread_count = started;
+    }
+    pthread_barrier_init(&sim->batch_done, NULL, sim->thread_count);
+    pthread_barrier_init(&sim->decision_done, NULL, sim->thread_count);
+    pthread_mutex_unlock(&sim->start);
+    simulation_worker(&args[0]);
+    for (int i = 1; i < sim->thread_count; ++i)
+        pthread_join(threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    pthread_barrier_destroy(&sim->batch_done);
+    pthread_barrier_destroy(&sim->decision_done);
+    pthread_mutex_destroy(&sim->start);
+    free(sim->workers);
+    free(threads);
+    free(args);
+    return seconds;
+}
+
+// ---- Chapter versions (single thread, global rand) for comparison ----
+
+double pi_rand(void) {
+    int inside_counter = 0;
+    for (int k = 0; k < NTIMES; ++k) {
+        double x = (double)rand() / RAND_MAX;
+        double y = (double)rand() / RAND_MAX;
+        if (x * x + y * y <= 1)
+            inside_counter++;
+    }
+    return 4. * inside_counter / NTIMES;
+}
+
+int main(int argc, char *argv[]) {
+    int thread_count = argc > 1 ? atoi(argv[1]) : 4;
+    double target = argc > 2 ? atof(argv[2]) : 0.0005;
+    if (thread_count < 1 || thread_count > MAX_THREADS || target <= 0) {
+        fprintf(stderr, "usage: %s [threads 1..%d] [target_half_width > 0]\n", argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    Simulation pi = {.name = "pi", .kernel = pi_kernel, .exact = 3.14159265358979323846,
+                     .max_trials = PI_MAX_TRIALS, .target = target, .thread_count = thread_count};
+    printf("--- %s, %d threads, target +-%g ---\n", pi.name, thread_count, target);
+    double t = run_simulation(&pi, 2024);
+    printf("  %.1f M trials/s\n", pi.trials / t / 1e6);
+
+    // P(win) = 244 / 495 for craps.
+    Simulation craps = {.name = "craps", .kernel = craps_kernel, .exact = 244.0 / 495.0,
+                        .max_trials = CRAPS_MAX_TRIALS, .target = target, .thread_count = thread_count};
+    printf("\n--- %s, %d threads, target +-%g ---\n", craps.name, thread_count, target);
+    t = run_simulation(&craps, 2025);
+    printf("  %.1f M games/s\n", craps.trials / t / 1e6);
+
+    printf("\n--- chapter version: pi with rand(), %d trials, 1 thread ---\n", NTIMES);
+    srand((unsigned)time(0));
+    clock_t start = clock();
+    double estimate = pi_rand();
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("  %.6f in %.3f s, %.1f M trials/s\n", estimate, seconds, NTIMES / seconds / 1e6);
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <string.h>
+#include "prng.h"
+
+/*
+Random number generator module (implementation).
+Compile together with the program that uses it, e.g.:
+    gcc -O2 -march=native 1_prng_demo.c prng.c -o prng_demo
+*/
+
+// splitmix64 spreads a 64-bit seed over the 256-bit state; xoshiro must not start at all zeros.
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Kept scalar: GCC 12 vectorizes the four splitmix64 calls with 256-bit registers and,
+// once this is inlined into xoshiro256_stream, returns through the long jumps without a
+// vzeroupper; every SSE instruction after that, as in libm's log and exp, then runs many
+// times slower.
+__attribute__((optimize("no-tree-vectorize"))) void xoshiro256_seed(Xoshiro256 *g, uint64_t seed) {
+    for (int i = 0; i < 4; ++i)
+        g->s[i] = splitmix64(&seed);
+}
+
+// Applies the jump polynomial: the result is the state after 2^128 (or 2^192) next() calls.
+static void xoshiro256_apply_jump(Xoshiro256 *g, const uint64_t poly[4]) {
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < 4; ++i)
+        for (int b = 0; b < 64; ++b) {
+            if (poly[i] & (1ULL << b)) {
+                s0 ^= g->s[0];
+                s1 ^= g->s[1];
+                s2 ^= g->s[2];
+                s3 ^= g->s[3];
+            }
+            xoshiro256_next(g);
+        }
+    g->s[0] = s0;
+    g->s[1] = s1;
+    g->s[2] = s2;
+    g->s[3] = s3;
+}
+
+void xoshiro256_jump(Xoshiro256 *g) {
+    static const uint64_t jump[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                     0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+    xoshiro256_apply_jump(g, jump);
+}
+
+void xoshiro256_long_jump(Xoshiro256 *g) {
+    static const uint64_t long_jump[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                          0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+    xoshiro256_apply_jump(g, long_jump);
+}
+
+__attribute__((optimize("no-tree-vectorize"))) void xoshiro256_stream(Xoshiro256 *g, uint64_t seed, unsigned index) {
+    xoshiro256_seed(g, seed);
+    // 2^64 long jumps apart, each stream still has 2^192 numbers before reaching the next
+    for (unsigned i = 0; i < index; ++i)
+        xoshiro256_long_jump(g);
+}
+
+void pcg64_seed(Pcg64 *g, uint64_t seed, uint64_t stream) {
+    g->state = 0;
+    g->inc = ((unsigned __int128)stream << 1) | 1;
+    pcg64_next(g);
+    g->state += seed;
+    pcg64_next(g);
+}
+
+// An LCG step is x -> a*x + c, so delta steps compose to x -> A*x + C; (A, C) is built by
+// repeated squaring of the single step, like fast exponentiation.
+void pcg64_advance(Pcg64 *g, unsigned __int128 delta) {
+    unsigned __int128 cur_mult = PCG64_MULT, cur_plus = g->inc;
+    unsigned __int128 acc_mult = 1, acc_plus = 0;
+    while (delta > 0) {
+        if (delta & 1) {
+            acc_mult *= cur_mult;
+            acc_plus = acc_plus * cur_mult + cur_plus;
+        }
+        cur_plus = (cur_mult + 1) * cur_plus;
+        cur_mult *= cur_mult;
+        delta >>= 1;
+    }
+    g->state = acc_mult * g->state + acc_plus;
+}
+
+void xoshiro256xN_init(Xoshiro256xN *g, const Xoshiro256 *base) {
+    Xoshiro256 lane = *base;
+    for (int i = 0; i < PRNG_LANES; ++i) {
+        for (int k = 0; k < 4; ++k)
+            g->s[k][i] = lane.s[k];
+        xoshiro256_jump(&lane);
+    }
+}
+
+/*
+One step of every lane. Written as plain loops over the lanes so the compiler turns each
+line into vector instructions; the multiplications by 5 and 9 are shifts and adds, which
+AVX2 has for 64-bit lanes (it has no 64-bit multiply).
+*/
+static inline void xoshiro256xN_step(Xoshiro256xN *g, uint64_t out[PRNG_LANES]) {
+    uint64_t *s0 = g->s[0], *s1 = g->s[1], *s2 = g->s[2], *s3 = g->s[3];
+    for (int i = 0; i < PRNG_LANES; ++i) {
+        uint64_t x = s1[i] + (s1[i] << 2);
+        x = prng_rotl(x, 7);
+        out[i] = x + (x << 3);
+        uint64_t t = s1[i] << 17;
+        s2[i] ^= s0[i];
+        s3[i] ^= s1[i];
+        s1[i] ^= s2[i];
+        s0[i] ^= s3[i];
+        s2[i] ^= t;
+        s3[i] = prng_rotl(s3[i], 45);
+    }
+}
+
+void xoshiro256xN_fill_u64(Xoshiro256xN *g, uint64_t *out, size_t n) {
+    uint64_t block[PRNG_LANES];
+    size_t i = 0;
+    for (; i + PRNG_LANES <= n; i += PRNG_LANES)
+        xoshiro256xN_step(g, out + i);
+    if (i < n) {
+        xoshiro256xN_step(g, block);
+        memcpy(out + i, block, (n - i) * sizeof(*out));
+    }
+}
+
+void xoshiro256xN_fill_double(Xoshiro256xN *g, double *out, size_t n) {
+    uint64_t block[PRNG_LANES];
+    size_t i = 0;
+    while (i < n) {
+        xoshiro256xN_step(g, block);
+        size_t count = n - i < PRNG_LANES ? n - i : PRNG_LANES;
+        for (size_t k = 0; k < count; ++k)
+            out[i + k] = prng_to_double(block[k]);
+        i += count;
+    }
+}
+
+// 32-bit Lemire with the rejection threshold computed once per call instead of per number.
+void xoshiro256xN_fill_bounded(Xoshiro256xN *g, uint32_t *out, size_t n, uint32_t range) {
+    if (range == 0) // no value to draw; -range % range would divide by zero
+        return;
+    uint64_t block[PRNG_LANES];
+    uint32_t threshold = -range % range;
+    size_t i = 0;
+    while (i < n) {
+        xoshiro256xN_step(g, block);
+        for (int k = 0; k < PRNG_LANES && i < n; ++k) {
+            uint64_t m = (block[k] >> 32) * range;
+            out[i] = (uint32_t)(m >> 32);
+            i += (uint32_t)m >= threshold; // a rejected value is simply overwritten
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Random number generator module (interface).
+
+The chapter's rand/srand keeps one global `next`, returns only 15 bits and cannot be
+shared between threads. Here every generator is a small struct owned by its user:
+  - Xoshiro256: xoshiro256** (256-bit state, 64-bit output), jump() = 2^128 steps,
+    long_jump() = 2^192 steps, so each thread can get a non-overlapping stream
+  - Pcg64: PCG XSL-RR 128/64, with 2^63 selectable streams and O(log n) advance()
+  - Xoshiro256xN: PRNG_LANES independent xoshiro256** streams stored lane by lane
+    (structure of arrays), so bulk fills compile to SIMD code
+
+The per-number functions are static inline here because they are called in hot loops;
+seeding, jumping and bulk fills live in prng.c.
+*/
+
+#define PRNG_LANES 8
+
+typedef struct {
+    uint64_t s[4];
+} Xoshiro256;
+
+typedef struct {
+    unsigned __int128 state;
+    unsigned __int128 inc; // stream selector, always odd
+} Pcg64;
+
+typedef struct {
+    uint64_t s[4][PRNG_LANES];
+} Xoshiro256xN;
+
+// ---- Seeding and streams (prng.c) ----
+
+void xoshiro256_seed(Xoshiro256 *g, uint64_t seed);
+void xoshiro256_jump(Xoshiro256 *g);
+void xoshiro256_long_jump(Xoshiro256 *g);
+// Seeds g and moves it to stream `index` (index * 2^128 steps ahead of stream 0).
+void xoshiro256_stream(Xoshiro256 *g, uint64_t seed, unsigned index);
+
+void pcg64_seed(Pcg64 *g, uint64_t seed, uint64_t stream);
+void pcg64_advance(Pcg64 *g, unsigned __int128 delta);
+
+// Lane i gets `base` jumped i times; base itself is left unchanged.
+void xoshiro256xN_init(Xoshiro256xN *g, const Xoshiro256 *base);
+
+// ---- Bulk fills (prng.c) ----
+// A fill consumes whole blocks of PRNG_LANES numbers; the unused part of the last
+// block is discarded.
+
+void xoshiro256xN_fill_u64(Xoshiro256xN *g, uint64_t *out, size_t n);
+void xoshiro256xN_fill_double(Xoshiro256xN *g, double *out, size_t n); // [0, 1)
+void xoshiro256xN_fill_bounded(Xoshiro256xN *g, uint32_t *out, size_t n, uint32_t range); // range > 0, else writes nothing
+
+// ---- Per-number functions ----
+
+static inline uint64_t prng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t xoshiro256_next(Xoshiro256 *g) {
+    uint64_t *s = g->s;
+    uint64_t result = prng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = prng_rotl(s[3], 45);
+    return result;
+}
+
+#define PCG64_MULT (((unsigned __int128)2549297995355413265ULL << 64) | 4865540595714422341ULL)
+
+static inline uint64_t pcg64_next(Pcg64 *g) {
+    g->state = g->state * PCG64_MULT + g->inc;
+    uint64_t xored = (uint64_t)(g->state >> 64) ^ (uint64_t)g->state;
+    int rot = (int)(g->state >> 122);
+    return (xored >> rot) | (xored << ((-rot) & 63));
+}
+
+/*
+Uniform integer in [0, range) without modulo bias (Lemire's method). The high half of
+x * range is the result; the low half tells whether x fell into the small biased zone,
+and only then (probability < range / 2^64) is the one division computed.
+range must not be 0.
+*/
+static inline uint64_t xoshiro256_bounded(Xoshiro256 *g, uint64_t range) {
+    unsigned __int128 m = (unsigned __int128)xoshiro256_next(g) * range;
+    uint64_t low = (uint64_t)m;
+    if (low < range) {
+        uint64_t threshold = -range % range;
+        while (low < threshold) {
+            m = (unsigned __int128)xoshiro256_next(g) * range;
+            low = (uint64_t)m;
+        }
+    }
+    return (uint64_t)(m >> 64);
+}
+
+static inline uint64_t pcg64_bounded(Pcg64 *g, uint64_t range) {
+    unsigned __int128 m = (unsigned __int128)pcg64_next(g) * range;
+    uint64_t low = (uint64_t)m;
+    if (low < range) {
+        uint64_t threshold = -range % range;
+        while (low < threshold) {
+            m = (unsigned __int128)pcg64_next(g) * range;
+            low = (uint64_t)m;
+        }
+    }
+    return (uint64_t)(m >> 64);
+}
+
+// Uniform integer in [lo, hi], lo <= hi, e.g. xoshiro256_range(&g, 1, 6) for a die. The
+// arithmetic is unsigned, so any range works; [INT64_MIN, INT64_MAX] has 2^64 values,
+// which wraps to 0, and is every output of the generator.
+static inline int64_t xoshiro256_range(Xoshiro256 *g, int64_t lo, int64_t hi) {
+    uint64_t range = (uint64_t)hi - (uint64_t)lo + 1;
+    uint64_t x = range ? xoshiro256_bounded(g, range) : xoshiro256_next(g);
+    return (int64_t)((uint64_t)lo + x);
+}
+
+// The top 53 bits fill a double's mantissa exactly: every value k / 2^53 in [0, 1)
+// is equally likely, from one generator call.
+static inline double prng_to_double(uint64_t x) {
+    return (double)(x >> 11) * 0x1.0p-53;
+}
+
+static inline double xoshiro256_double(Xoshiro256 *g) {
+    return prng_to_double(xoshiro256_next(g));
+}
+
+static inline double pcg64_double(Pcg64 *g) {
+    return prng_to_double(pcg64_next(g));
+}
+
+#endif